@@ -5,30 +5,46 @@
 #include <stddef.h>
 #include <stdint.h>
 
+#include "nuno/resampler.h"
+
 /*
- * Producer / consumer contract (read before touching the double buffer)
- * --------------------------------------------------------------------
+ * Producer / consumer contract (read before touching the block ring)
+ * ------------------------------------------------------------------
  * Two parties touch g_buffer concurrently:
  *
  *   PRODUCER  - fill_buffer(), reached from the audio-task / DMA-complete
- *               path (in the sim: whoever calls AudioBuffer_Done()). It is the
- *               SOLE writer of data[], valid_frames[], end_of_stream and the
- *               buffer state. It only ever writes the *inactive* index.
- *   CONSUMER  - the audio output callback / future DMA ISR. In the sim this is
- *               the SDL audio thread, which calls AudioBuffer_GetBuffer() to
- *               read the *active* index, then AudioBuffer_Done() to advance.
- *
- * Synchronisation is lock-free (no blocking in the consumer path). The shared
- * scalars that cross the producer/consumer boundary - 'active', the per-index
- * 'valid_frames', 'end_of_stream' and 'state' - are C11 atomics. The publishing
- * store of 'active' in AudioBuffer_Done() uses release ordering and the
- * matching load in AudioBuffer_GetBuffer() uses acquire ordering, so a buffer's
- * data[] writes are guaranteed visible before the index that exposes them.
- *
- * Single-writer-per-index is the load-bearing invariant: the producer fills the
- * just-consumed (inactive) buffer while the consumer drains the other, so the
- * raw data[] arrays never need per-sample atomics. Preserve that if you add a
- * second producer.
+ *               path (in the sim: the producer thread in AudioBuffer_Service()).
+ *               It is the SOLE writer of data[], valid_frames[], write_seq,
+ *               end_of_stream and the crossfade/decoder state. It only ever
+ *               writes a slot the consumer has released.
+ *   CONSUMER  - the audio output callback / DMA ISR. In the sim this is the SDL
+ *               audio thread, which calls AudioBuffer_GetBuffer() to read the
+ *               slot at the head of the ring, then AudioBuffer_Done() to
+ *               release it. It is the SOLE writer of read_seq.
+ *
+ * The blocks form a single-producer/single-consumer ring whose depth is fixed
+ * at init (AudioBuffer_InitWithDepth, AUDIO_BUFFER_MIN_BLOCKS..
+ * AUDIO_BUFFER_MAX_BLOCKS). Two monotonically increasing sequence numbers
+ * describe it: read_seq is the block the consumer is playing, write_seq the
+ * next block the producer will fill; slot == seq % depth and
+ * write_seq - read_seq is the number of decoded blocks queued (including the
+ * one being played). The producer may fill while that difference is below the
+ * depth, so a deeper ring rides out a longer decode/storage stall at the cost
+ * of one AUDIO_BUFFER_BYTES block of RAM per slot.
+ *
+ * Synchronisation is lock-free (no blocking in the consumer path). write_seq is
+ * published with release ordering after a slot's data[] writes and loaded with
+ * acquire ordering by the consumer; read_seq is published with release ordering
+ * once the consumer has finished reading a slot and loaded with acquire
+ * ordering by the producer before it overwrites that slot. 'valid_frames',
+ * 'end_of_stream' and 'state' are atomic scalars with relaxed ordering, which
+ * is sufficient because the sequence numbers are the synchronising handoff.
+ *
+ * When the ring runs dry (producer behind) the consumer is handed a silent
+ * block and the underrun is counted; it never reads a slot that is still being
+ * filled. Single-writer-per-slot is the load-bearing invariant: the raw data[]
+ * arrays never need per-sample atomics. Preserve that if you add a second
+ * producer.
  *
  * The volume target (AudioBuffer_SetVolume) may be set from a control thread
  * different from the producer; it is an atomic scalar read by the producer.
@@ -43,6 +59,19 @@ typedef struct FormatDecoder FormatDecoder;
 #define AUDIO_BUFFER_BYTES (AUDIO_BUFFER_SIZE * sizeof(uint16_t))
 #define AUDIO_BUFFER_LOW_WATER_MARK (AUDIO_BUFFER_FRAMES / 4U)
 
+/*
+ * Block ring depth. AUDIO_BUFFER_MAX_BLOCKS sizes the static slot storage (one
+ * AUDIO_BUFFER_BYTES block each), so a board trades RAM for underrun margin by
+ * overriding it at compile time; the depth actually used is picked at init.
+ */
+#define AUDIO_BUFFER_MIN_BLOCKS 2U
+#ifndef AUDIO_BUFFER_MAX_BLOCKS
+#define AUDIO_BUFFER_MAX_BLOCKS 4U
+#endif
+#ifndef AUDIO_BUFFER_DEFAULT_BLOCKS
+#define AUDIO_BUFFER_DEFAULT_BLOCKS AUDIO_BUFFER_MAX_BLOCKS
+#endif
+
 typedef enum {
     BUFFER_STATE_EMPTY,
     BUFFER_STATE_READY,
@@ -54,8 +83,17 @@ typedef enum {
 typedef struct {
     size_t total_samples;
     size_t underruns;
-    uint32_t last_transition_time_ms;
+    uint32_t last_transition_time_ms;  // fill time of the block holding the last track change
+    uint32_t max_transition_time_ms;   // worst of those since the last reset
+    size_t lookahead_hits;             // track changes served by a pre-opened decoder
+    size_t lookahead_misses;           // track changes that opened the next track inline
     float average_utilisation;
+    size_t ring_depth;          // blocks in the ring (fixed at init)
+    size_t ring_occupancy;      // decoded blocks queued right now, incl. the one playing
+    size_t ring_min_occupancy;  // low-water mark seen by the consumer since the last reset
+    size_t fast_path_frames;    // frames decoded straight to S16 (no float conversion)
+    size_t resampled_frames;    // frames produced through the sample-rate converter
+    size_t track_frames_played; // output frames of the current track the consumer has played
 } AudioBufferStats;
 
 typedef struct {
@@ -64,7 +102,15 @@ typedef struct {
     size_t total_underruns;
 } AudioBufferErrorStats;
 
+/* Initialise with the default ring depth (AUDIO_BUFFER_DEFAULT_BLOCKS). */
 bool AudioBuffer_Init(void);
+
+/* Initialise with an explicit ring depth in blocks. Returns false (and leaves
+ * the buffer uninitialised) when block_count is outside
+ * AUDIO_BUFFER_MIN_BLOCKS..AUDIO_BUFFER_MAX_BLOCKS. */
+bool AudioBuffer_InitWithDepth(size_t block_count);
+size_t AudioBuffer_GetDepth(void);
+
 void AudioBuffer_Cleanup(void);
 
 bool AudioBuffer_StartPlayback(void);
@@ -74,6 +120,39 @@ bool AudioBuffer_Done(void);
 void AudioBuffer_HalfDone(void);
 bool AudioBuffer_ProcessComplete(void);
 
+/*
+ * Output mode
+ * -----------
+ * RING (default) hands the consumer whole AUDIO_BUFFER_SIZE blocks: it reads
+ * AudioBuffer_GetBuffer() and calls AudioBuffer_Done() per block. That suits a
+ * pull-style consumer such as the SDL callback.
+ *
+ * PING_PONG matches a circular DMA: one contiguous AUDIO_BUFFER_SIZE region
+ * (AudioBuffer_GetDmaRegion) split into two halves that form a two-slot ring.
+ * The half-transfer interrupt calls AudioBuffer_HalfDone() (first half
+ * drained) and transfer-complete calls AudioBuffer_Done() (second half
+ * drained); the producer refills whichever half just drained while the DMA
+ * plays the other. Output latency and buffer RAM are half of a two-block ring
+ * at the same one-block underrun margin. Ring depth does not apply.
+ *
+ * The mode is a platform binding like the producer wake: set it before
+ * AudioBuffer_Init() and it persists across Init/Cleanup.
+ */
+typedef enum {
+    AUDIO_BUFFER_MODE_RING = 0,
+    AUDIO_BUFFER_MODE_PING_PONG
+} AudioBufferMode;
+
+void AudioBuffer_SetOutputMode(AudioBufferMode mode);
+AudioBufferMode AudioBuffer_GetOutputMode(void);
+
+/* Samples (uint16_t elements) in one ring slot / ping-pong half. */
+size_t AudioBuffer_GetBlockSamples(void);
+
+/* Region to hand DMA_StartTransfer(): both halves in ping-pong mode, otherwise
+ * the block at the head of the ring. *samples receives its length. */
+uint16_t *AudioBuffer_GetDmaRegion(size_t *samples);
+
 /*
  * Producer / consumer decoupling
  * ------------------------------
@@ -81,10 +160,10 @@ bool AudioBuffer_ProcessComplete(void);
  * consumer is the DMA-complete ISR, and doing filesystem reads / decode there is
  * a hard real-time violation; in the sim it is the SDL audio callback. To keep
  * one model across both, register a producer "wake" callback. When one is set,
- * AudioBuffer_Done() (consumer/ISR) only flips the active buffer, marks the
- * just-freed buffer for refill, and calls the wake - it does NOT decode. A
- * dedicated producer (a thread in the sim, a FreeRTOS task on hardware) then
- * calls AudioBuffer_Service() to do the actual decode/fill off the audio path.
+ * AudioBuffer_Done() (consumer/ISR) only releases the drained slot back to the
+ * ring and calls the wake - it does NOT decode. A dedicated producer (a thread
+ * in the sim, a FreeRTOS task on hardware) then calls AudioBuffer_Service() to
+ * do the actual decode/fill off the audio path.
  *
  * The wake runs in the consumer/ISR context, so it must be ISR-safe and
  * non-blocking (e.g. give a semaphore / signal a condvar). Pass NULL to restore
@@ -97,9 +176,10 @@ bool AudioBuffer_ProcessComplete(void);
  */
 void AudioBuffer_SetProducerWake(void (*wake)(void));
 
-/* Producer entry point: refill any buffer the consumer freed via
- * AudioBuffer_Done(). Call from the producer thread/task only. Decodes the next
- * block(s); a no-op when nothing is pending, so spurious wakes are harmless. */
+/* Producer entry point: top the ring back up to its depth, refilling every slot
+ * the consumer released via AudioBuffer_Done(). Call from the producer
+ * thread/task only. A no-op when the ring is already full, so spurious wakes
+ * are harmless. */
 void AudioBuffer_Service(void);
 
 void AudioBuffer_Update(void);
@@ -133,12 +213,30 @@ void AudioBuffer_GetReadChunkConfig(size_t *min_size,
                                     size_t *max_size,
                                     size_t *optimal_size);
 
-void AudioBuffer_ConfigureSampleRate(uint32_t source_rate, uint32_t target_rate);
+/*
+ * Sample-rate conversion. target_rate is the fixed output clock the ring is
+ * played at; whenever the active decoder's rate differs from it the producer
+ * runs the decoded audio through a polyphase resampler (see resampler.h). The
+ * producer follows the decoder's own rate, so a gapless swap to a track at
+ * another rate is converted too. Returns false if source_rate -> target_rate
+ * is not a supported ratio; the caller should then reclock the output instead.
+ * A target_rate of 0 disables conversion.
+ */
+bool AudioBuffer_ConfigureSampleRate(uint32_t source_rate, uint32_t target_rate);
 void AudioBuffer_GetSampleRateConfig(uint32_t *source_rate,
                                      uint32_t *target_rate,
                                      bool *conversion_enabled,
                                      float *ratio);
 
+/* Resampler quality tier (default RESAMPLER_QUALITY_MEDIUM). Takes effect at
+ * the next block; the filter is redesigned on the producer. */
+void AudioBuffer_SetResamplerQuality(ResamplerQuality quality);
+ResamplerQuality AudioBuffer_GetResamplerQuality(void);
+
+/* Cost of the conversion currently running. Returns false (and leaves *cost
+ * untouched) when the producer is not resampling. */
+bool AudioBuffer_GetResamplerCost(ResamplerCost *cost);
+
 void AudioBuffer_ConfigureSampleFormat(uint8_t bits_per_sample,
                                        bool is_float,
                                        bool is_signed);
@@ -195,6 +293,39 @@ typedef FormatDecoder* (*AudioBufferNextTrackProvider)(void* user_data);
 void AudioBuffer_SetNextTrackProvider(AudioBufferNextTrackProvider provider,
                                       void* user_data);
 
+/* ----------------------------------------------------------------------------
+ * Look-ahead
+ *
+ * Opening a track (decoder allocation, file open, header read, metadata parse)
+ * is too slow to run inside the fill that hits EOF while the DMA deadline is
+ * ticking, especially on a slow SD card. With a look-ahead provider registered
+ * the producer opens the NEXT track's decoder once the current one has less
+ * than the look-ahead window left to decode (immediately if its length is
+ * unknown), right after it has topped the ring up, and decodes its first
+ * block into a side buffer. The EOF transition (gapless or crossfade) then
+ * just swaps decoders and plays that pre-roll; 'commit' makes the track
+ * current in the library and must not do I/O.
+ *
+ * 'open' must NOT change the current track: the pre-opened decoder is dropped
+ * if playback is flushed or the decoder replaced first (Skip / Previous /
+ * PlayTrack), and a transition without one falls back to the next-track
+ * provider. AudioBufferStats reports the fill time of transition blocks and
+ * how many transitions the look-ahead served.
+ * -------------------------------------------------------------------------- */
+typedef FormatDecoder* (*AudioBufferLookAheadOpen)(void* user_data);
+typedef void (*AudioBufferLookAheadCommit)(void* user_data);
+void AudioBuffer_SetLookAheadProvider(AudioBufferLookAheadOpen open,
+                                      AudioBufferLookAheadCommit commit,
+                                      void* user_data);
+
+/* Look-ahead window in ms of source audio (default
+ * AUDIO_BUFFER_LOOKAHEAD_DEFAULT_MS); 0 disables the look-ahead. */
+#ifndef AUDIO_BUFFER_LOOKAHEAD_DEFAULT_MS
+#define AUDIO_BUFFER_LOOKAHEAD_DEFAULT_MS 5000U
+#endif
+void AudioBuffer_SetLookAheadMs(uint32_t ms);
+uint32_t AudioBuffer_GetLookAheadMs(void);
+
 /* Monotonic count of gapless track transitions performed by the producer. */
 uint32_t AudioBuffer_GetTrackChangeCount(void);
 
@@ -205,13 +336,20 @@ uint32_t AudioBuffer_GetTrackChangeCount(void);
  */
 bool AudioBuffer_ConsumeTrackChanged(void);
 
+/*
+ * Optional: called on the producer thread/task right after each transition is
+ * published, so a UI loop can block until one happens instead of polling.
+ * Must not block (e.g. notify a task / push an event). NULL removes it.
+ */
+void AudioBuffer_SetTrackChangeWake(void (*wake)(void));
+
 /* ----------------------------------------------------------------------------
  * Crossfade
  *
  * Crossfade is an opt-in extension of the gapless machinery. When enabled and
  * the active decoder hits EOF, instead of an instant decoder swap the producer
  * overlap-mixes the TAIL of the outgoing track (the last `fade` frames it
- * already emitted, kept in a small producer-local ring) with the HEAD of the
+ * already emitted, kept in a producer-local ring) with the HEAD of the
  * incoming track decoded from the next-track provider. The outgoing tail is
  * faded out and the incoming head faded in over the fade window using an
  * equal-power (cos/sin) curve, which keeps the summed energy roughly constant
@@ -222,9 +360,35 @@ bool AudioBuffer_ConsumeTrackChanged(void);
  * atomic scalar so it may be set from a thread other than the producer; the
  * producer snapshots it when a transition begins. The mixing, the second
  * decoder and the tail ring are all producer-local, so no extra locking is
- * needed beyond the existing single-writer-per-index invariant.
+ * needed beyond the existing single-writer-per-slot invariant.
  * -------------------------------------------------------------------------- */
 void AudioBuffer_SetCrossfadeFrames(uint32_t frames);
 uint32_t AudioBuffer_GetCrossfadeFrames(void);
 
+/*
+ * Storage for the crossfade tail. The tail is post-volume S16 stereo
+ * (AUDIO_BUFFER_CROSSFADE_FRAME_BYTES per frame) carved on demand from a region
+ * the platform registers here, sized to the armed fade length; nothing is used
+ * while crossfade is disabled. Without a region crossfade degrades to the hard
+ * gapless cut, and a region shorter than the armed fade shortens the fade.
+ * 'base' must be 2-byte aligned. Like the producer wake this is a platform
+ * binding: it survives Init/Cleanup. Register it before playback starts.
+ */
+#define AUDIO_BUFFER_CROSSFADE_FRAME_BYTES (AUDIO_OUT_CHANNELS * sizeof(int16_t))
+void AudioBuffer_SetCrossfadeRegion(void *base, size_t bytes);
+
+/* Static RAM the audio buffer owns, and what the crossfade feature costs. */
+typedef struct {
+    size_t ring_bytes;              // block ring storage (all slots)
+    size_t scratch_bytes;           // producer decode/downmix scratch
+    size_t resampler_bytes;         // converter coefficients + input history
+    size_t lookahead_bytes;         // pre-roll side buffer for the next track
+    size_t crossfade_region_bytes;  // region registered for the tail
+    size_t crossfade_tail_bytes;    // part of it the armed fade length needs
+    uint32_t crossfade_frames;      // fade length the region can hold
+} AudioBufferMemoryReport;
+
+void AudioBuffer_GetMemoryReport(AudioBufferMemoryReport *report);
+void AudioBuffer_PrintMemoryReport(void);
+
 #endif /* NUNO_AUDIO_BUFFER_H */
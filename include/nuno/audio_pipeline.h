@@ -7,6 +7,16 @@
 
 #define SAMPLE_RATE 44100  // or whatever your sample rate is
 
+/* Directory for per-track seek indexes (see format_decoder_set_seek_cache_dir()). */
+#ifndef NUNO_SEEK_CACHE_DIR
+#define NUNO_SEEK_CACHE_DIR ".nuno-cache"
+#endif
+
+/* Read-ahead window per open track (see ReadAhead_SetWindowBytes()). */
+#ifndef NUNO_READ_AHEAD_BYTES
+#define NUNO_READ_AHEAD_BYTES (256U * 1024U)
+#endif
+
 // Pipeline state enumeration
 typedef enum {
     PIPELINE_STATE_STOPPED,
@@ -94,6 +104,15 @@ bool AudioPipeline_ConsumeTrackChanged(void);
  */
 uint32_t AudioPipeline_GetTrackChangeCount(void);
 
+/**
+ * @brief Register a wake for gapless track transitions.
+ *
+ * 'wake' runs on the audio producer after each transition, so an event-driven
+ * UI loop can sleep until then and pick the change up with
+ * AudioPipeline_ConsumeTrackChanged(). It must not block. NULL removes it.
+ */
+void AudioPipeline_SetTrackChangeWake(void (*wake)(void));
+
 /**
  * @brief Configure pipeline parameters
  * @param config Pointer to configuration structure
@@ -226,6 +245,19 @@ void AudioPipeline_ResetEndOfPlaylistFlag(void);
  */
 bool AudioPipeline_IsEndOfPlaylistReached(void);
 
+/**
+ * @brief Run low-priority audio housekeeping.
+ *
+ * Writes seek indexes queued by closed decoders to the seek cache and runs
+ * one step of a library refresh, if one was started (see
+ * MusicLibrary_StartRefresh()). Call it from an idle or UI context, never
+ * from the buffer producer: it does file I/O and may block on storage.
+ *
+ * @return true while work remains (a refresh is under way), so an
+ *         event-driven caller should call again before it blocks
+ */
+bool AudioPipeline_ServiceIdle(void);
+
 void AudioPipeline_SynchronizeState(void);
 void AudioPipeline_NotifyTransitionComplete(void);
 void AudioPipeline_NotifyCrossfadeComplete(void);
@@ -16,7 +16,9 @@
  * interrupt context.
  *
  * Call AudioTask_Start() once during audio bring-up (DMA_Init does this). It
- * creates the semaphore + task and registers the ISR-safe producer wake.
+ * creates the semaphore + task and registers the ISR-safe producer wake. It
+ * also starts the read-ahead task, which keeps the decoders' input windows
+ * filled from storage (nuno/read_ahead.h) so the producer decodes from RAM.
  */
 bool AudioTask_Start(void);
 
@@ -40,4 +40,9 @@
 /* WM8960 I2C address (7-bit) */
 #define NUNO_CODEC_I2C_ADDR      0x1Au
 
+/* Crossfade tail budget in S16 stereo frames (4 bytes each): 1 s at 48 kHz
+ * is 187.5 KB of AXI SRAM. Longer fades are shortened to fit; 0 disables
+ * crossfade on this board. */
+#define NUNO_CROSSFADE_REGION_FRAMES 48000u
+
 #endif /* NUNO_BOARD_CONFIG_H */
@@ -0,0 +1,93 @@
+#ifndef NUNO_BYTE_SOURCE_H
+#define NUNO_BYTE_SOURCE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/*
+ * Random-access byte stream under the format decoders. A source is a small
+ * struct with an ops table, so decoders read the same way from a stdio file,
+ * a memory block, a mapped file or a read-ahead window (and later a raw SD
+ * block device) without knowing which.
+ *
+ * Sources live in caller storage (the decoder embeds one) and nothing here
+ * allocates. 'map' is optional: a source that already holds its bytes in
+ * memory returns a pointer into them, so a decoder can parse in place
+ * instead of copying through its own input buffer.
+ */
+
+typedef struct ByteSource ByteSource;
+
+typedef struct {
+    /* Reads up to 'bytes' at the current position; returns the bytes read
+     * (short only at the end of the source or on an I/O error). */
+    size_t (*read)(ByteSource *source, void *dst, size_t bytes);
+    bool (*seek)(ByteSource *source, uint64_t offset);
+    uint64_t (*tell)(const ByteSource *source);
+    uint64_t (*size)(const ByteSource *source);
+    /* Optional. Returns the bytes from 'offset' to the end, valid until the
+     * source is closed, and stores their count in 'length'. */
+    const uint8_t *(*map)(ByteSource *source, uint64_t offset, size_t *length);
+    void (*close)(ByteSource *source);
+} ByteSourceOps;
+
+struct ByteSource {
+    const ByteSourceOps *ops;  // NULL when closed
+    union {
+        struct {
+            FILE *file;
+            uint64_t size;
+        } file;
+        struct {
+            const uint8_t *data;
+            size_t size;
+            size_t pos;
+            bool mapped;  // unmap on close
+        } memory;
+        struct {
+            struct ReadAheadStream *stream;  // see nuno/read_ahead.h
+        } read_ahead;
+    } u;
+};
+
+/* Opens 'path' through stdio. */
+bool ByteSource_OpenFile(ByteSource *source, const char *path);
+
+/* Wraps 'size' bytes at 'data', which must outlive the source. */
+void ByteSource_InitMemory(ByteSource *source, const void *data, size_t size);
+
+/* Maps 'path' read-only. Returns false where mmap is unavailable (firmware)
+ * or fails; callers fall back to ByteSource_OpenFile(). */
+bool ByteSource_OpenMapped(ByteSource *source, const char *path);
+
+static inline bool ByteSource_IsOpen(const ByteSource *source) {
+    return source && source->ops;
+}
+
+static inline size_t ByteSource_Read(ByteSource *source, void *dst, size_t bytes) {
+    return source->ops->read(source, dst, bytes);
+}
+
+static inline bool ByteSource_Seek(ByteSource *source, uint64_t offset) {
+    return source->ops->seek(source, offset);
+}
+
+static inline uint64_t ByteSource_Tell(const ByteSource *source) {
+    return source->ops->tell(source);
+}
+
+static inline uint64_t ByteSource_Size(const ByteSource *source) {
+    return source->ops->size(source);
+}
+
+/* NULL when the source cannot map (or 'offset' is past the end). */
+static inline const uint8_t *ByteSource_Map(ByteSource *source, uint64_t offset, size_t *length) {
+    return source->ops->map ? source->ops->map(source, offset, length) : NULL;
+}
+
+/* Releases the source; safe to call on a closed one. */
+void ByteSource_Close(ByteSource *source);
+
+#endif /* NUNO_BYTE_SOURCE_H */
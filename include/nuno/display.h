@@ -2,6 +2,7 @@
 #define NUNO_DISPLAY_H
 
 #include <stdbool.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #include "nuno/device_profile.h"
@@ -48,6 +49,34 @@ bool Display_SwitchProfile(const DeviceProfile *profile);
 
 void Display_Clear(void);
 void Display_Update(void);
+
+/*
+ * Partial update: pushes only 'count' regions of what was drawn since the last
+ * push to the panel, which keeps the rest of its last frame. A renderer that
+ * redrew just a row or an icon passes just that; count 0 pushes nothing and
+ * counts as a skipped frame. Display_Update() pushes the whole screen.
+ */
+typedef struct {
+    int x;
+    int y;
+    int width;
+    int height;
+} DisplayRect;
+
+void Display_UpdateRects(const DisplayRect *rects, size_t count);
+
+/* Panel traffic since Display_Init, in the bytes the active profile's colour
+ * model takes per pixel (1 bit mono, 2 bit gray, RGB565). */
+typedef struct {
+    uint32_t frames;         // pushes, full or partial, including skipped ones
+    uint32_t framesSkipped;  // pushes of nothing
+    uint32_t framesPartial;  // pushes of some regions
+    uint64_t bytesPushed;
+    uint32_t lastFrameBytes;
+    uint32_t fullFrameBytes; // one whole screen, for comparison
+} DisplayStats;
+
+void Display_GetStats(DisplayStats *stats);
 void Display_DrawText(const char *text, int x, int y, uint8_t color);
 void Display_DrawRect(int x, int y, int width, int height, uint8_t color);
 void Display_FillRect(int x, int y, int width, int height, uint8_t color);
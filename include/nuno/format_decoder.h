@@ -7,6 +7,7 @@
 
 // Forward declarations
 typedef struct FormatDecoder FormatDecoder;
+typedef struct ByteSource ByteSource;  // nuno/byte_source.h
 
 /**
  * Error codes for format decoder operations
@@ -123,8 +124,19 @@ enum FormatDecoderError detect_audio_format(const uint8_t* data, size_t size,
                                           AudioFormatInfo* format_info);
 
 /**
- * Creates a new format decoder instance
- * @return Pointer to the new decoder, or NULL if creation failed
+ * Decoder instances come from a fixed pool. Each slot keeps its input/PCM
+ * buffers across tracks, so once a slot has played a format, opening, reading
+ * and closing further files of that format makes no heap calls of its own.
+ * Size the pool for every decoder that can be open at once (playing track,
+ * look-ahead, crossfade incoming, plus one being opened by a skip).
+ */
+#ifndef FORMAT_DECODER_POOL_SIZE
+#define FORMAT_DECODER_POOL_SIZE 4
+#endif
+
+/**
+ * Takes a decoder instance from the pool
+ * @return Pointer to the decoder, or NULL if every pool slot is in use
  */
 FormatDecoder* format_decoder_create(void);
 
@@ -136,6 +148,17 @@ FormatDecoder* format_decoder_create(void);
  */
 bool format_decoder_open(FormatDecoder* decoder, const char* filepath);
 
+/**
+ * Opens an already-open byte source (memory block, mapped file, ...) for
+ * decoding. The decoder takes over the source and closes it on close, also
+ * when the open fails. Such decoders have no path, so they never use the
+ * seek cache.
+ * @param decoder The decoder instance
+ * @param source The source, copied into the decoder
+ * @return true if successful, false otherwise
+ */
+bool format_decoder_open_source(FormatDecoder* decoder, const ByteSource* source);
+
 /**
  * Reads decoded audio frames
  * @param decoder The decoder instance
@@ -146,7 +169,29 @@ bool format_decoder_open(FormatDecoder* decoder, const char* filepath);
 size_t format_decoder_read(FormatDecoder* decoder, float* buffer, size_t frames);
 
 /**
- * Seeks to a specific frame position
+ * Checks whether the decoder can hand out its native interleaved S16 PCM
+ * through format_decoder_read_s16() (e.g. MP3, which decodes to int16)
+ * @param decoder The decoder instance
+ * @return true if format_decoder_read_s16() is available for this stream
+ */
+bool format_decoder_supports_s16(const FormatDecoder* decoder);
+
+/**
+ * Reads decoded audio frames as interleaved S16 without a float round trip.
+ * The samples are exactly what the codec produced; the channel count is
+ * format_decoder_get_channels(). Shares the read position with
+ * format_decoder_read(), so callers may switch between the two per call.
+ * @param decoder The decoder instance
+ * @param buffer Output buffer for decoded audio (frames * channels samples)
+ * @param frames Number of frames to read
+ * @return Number of frames actually read (0 if unsupported or at end of stream)
+ */
+size_t format_decoder_read_s16(FormatDecoder* decoder, int16_t* buffer, size_t frames);
+
+/**
+ * Seeks to a specific frame position. MP3 seeks are sample-exact under
+ * SEEK_ACCURATE. The first seek on a stream loads its cached seek index, if
+ * a cache directory is set (format_decoder_set_seek_cache_dir()).
  * @param decoder The decoder instance
  * @param frame_position Target frame position
  */
@@ -159,11 +204,44 @@ void format_decoder_seek(FormatDecoder* decoder, size_t frame_position);
 void format_decoder_close(FormatDecoder* decoder);
 
 /**
- * Destroys the decoder instance
+ * Closes the decoder and returns it to the pool
  * @param decoder The decoder instance
  */
 void format_decoder_destroy(FormatDecoder* decoder);
 
+/**
+ * Counts the malloc/realloc/free calls the decoder module has made. Heap use
+ * inside libFLAC and the C library's stdio is not included.
+ * @return Number of heap calls since start-up
+ */
+size_t format_decoder_get_heap_calls(void);
+
+/**
+ * Enables the persistent seek index cache: MP3 frame indexes, and seek
+ * points for FLAC files without a SEEKTABLE, are kept in one small file per
+ * track under 'dir' (created if missing), keyed by path, size and mtime.
+ * Set it once at start-up, before any decoder is opened.
+ * @param dir Cache directory, or NULL to disable the cache (the default)
+ * @return false if the path is too long
+ */
+bool format_decoder_set_seek_cache_dir(const char* dir);
+
+/**
+ * Writes the seek indexes queued by decoders closed since the last call.
+ * Does file I/O: call it from a low-priority context, never the audio
+ * producer.
+ * @return Number of cache entries written
+ */
+size_t format_decoder_flush_seek_cache(void);
+
+/**
+ * Gets the number of seek points known for the open stream, whether recorded
+ * while decoding or loaded from the seek cache
+ * @param decoder The decoder instance
+ * @return Number of seek points, 0 if none (or the file has its own SEEKTABLE)
+ */
+size_t format_decoder_get_seek_points(const FormatDecoder* decoder);
+
 /**
  * Gets the number of channels in the audio file
  * @param decoder The decoder instance
@@ -178,6 +256,21 @@ uint32_t format_decoder_get_channels(const FormatDecoder* decoder);
  */
 uint32_t format_decoder_get_sample_rate(const FormatDecoder* decoder);
 
+/**
+ * Gets the length of the stream in frames. Exact for FLAC (STREAMINFO);
+ * estimated from the file size for MP3.
+ * @param decoder The decoder instance
+ * @return Total frames, 0 if unknown or no file is loaded
+ */
+size_t format_decoder_get_total_frames(const FormatDecoder* decoder);
+
+/**
+ * Gets the read position (frames handed out since open or the last seek)
+ * @param decoder The decoder instance
+ * @return Current frame position
+ */
+size_t format_decoder_get_position(const FormatDecoder* decoder);
+
 /**
  * Gets the format type of the loaded audio file
  * @param decoder The decoder instance
@@ -0,0 +1,119 @@
+#ifndef NUNO_LIBRARY_SCANNER_H
+#define NUNO_LIBRARY_SCANNER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Builds the music catalog (nuno/music_catalog.h) by walking a library root
+ * at runtime. Every .mp3/.flac file below the root that the tag reader
+ * (nuno/tag_reader.h) recognises becomes a track; everything else is
+ * ignored, as are hidden files and directories (the seek cache lives in one).
+ *
+ * Directories are visited in name order, so the catalog order is stable
+ * across scans. Title, artist, album, track and disc numbers and duration
+ * come from the file's tags, within the tag reader's per-file byte budget.
+ * Fields the tags lack come from the file name when it follows the
+ * "Artist_-_Album_-_NN_Title" convention of the bundled library (underscores
+ * read as spaces, the track number, or "D-NN" disc and track, split off the
+ * title); otherwise the title is the file name, less any track number, and
+ * the album and artist are the parent and grandparent directories. The
+ * browse index is built once the walk is done.
+ *
+ * On hosts the walk, the stat calls and the tag reads run on a small
+ * work-stealing thread pool (see LibraryScanner_SetThreadCount()). Tracks
+ * are added to the catalog in walk order once the pool is done, so the
+ * result does not depend on the thread count.
+ *
+ * The walker needs POSIX directory and thread calls; elsewhere the scan fails
+ * and the catalog is left empty.
+ */
+
+/* Directory levels below the root that are searched (guards symlink loops). */
+#define LIBRARY_SCAN_MAX_DEPTH 16U
+
+/* Most worker threads a scan starts. */
+#define LIBRARY_SCAN_MAX_THREADS 32U
+
+typedef struct {
+    uint32_t directories;   // visited, the root included
+    uint32_t files;         // regular files seen
+    uint32_t tracks;        // added to the catalog
+    uint32_t tagged;        // of those, named by a title tag
+    uint32_t rejected;      // .mp3/.flac files the tag reader did not recognise
+    uint32_t threads;       // workers that ran, the caller's thread included
+    uint32_t steals;        // tasks a worker took from another's queue
+} LibraryScanStats;
+
+/*
+ * Workers for the next scans: 0 (the default) starts one per online core,
+ * 1 scans on the caller's thread alone. Capped at LIBRARY_SCAN_MAX_THREADS.
+ * GetThreadCount() returns the number a scan would use.
+ */
+void LibraryScanner_SetThreadCount(unsigned threads);
+unsigned LibraryScanner_GetThreadCount(void);
+
+/*
+ * Replaces the catalog's contents with the tracks found under 'root'.
+ * Filenames in the catalog are relative to 'root'. 'stats' may be NULL.
+ * Returns false when the root cannot be read or memory runs out; the tracks
+ * found up to that point stay in the catalog. Each track's file size and
+ * mtime and each directory's mtime are recorded for the refresh below.
+ */
+bool LibraryScanner_Scan(const char *root, LibraryScanStats *stats);
+
+/*
+ * Incremental refresh: brings a scanned (or loaded) catalog up to date with
+ * the tree by re-reading only what changed. Directories whose mtime has moved
+ * are listed again and every known file is stat'ed; tags are read only for
+ * new files and files whose size or mtime differs. Tracks whose files are gone
+ * become tombstones (see MusicCatalogRecord), so no track index moves; new
+ * tracks are added after the existing ones. A refresh that finds no change
+ * leaves the catalog as it is.
+ *
+ * It runs on the caller's thread in steps, so a UI loop can drive it between
+ * frames. The catalog is only written by the last step, as a rebuild that
+ * other threads' readers do not see half-done. Nothing else may change the
+ * catalog while a refresh is under way; a scan cancels it.
+ */
+typedef enum {
+    LIBRARY_REFRESH_IDLE,
+    LIBRARY_REFRESH_CHECKING,    // stat'ing directories and files
+    LIBRARY_REFRESH_PROBING,     // reading tags of new and changed files
+    LIBRARY_REFRESH_COMMITTING,  // rebuilding the catalog
+    LIBRARY_REFRESH_SAVING,      // writing the database (MusicLibrary's refresh)
+    LIBRARY_REFRESH_DONE,
+    LIBRARY_REFRESH_FAILED,      // out of memory; the catalog is as it was
+} LibraryRefreshPhase;
+
+typedef struct {
+    LibraryRefreshPhase phase;
+    uint32_t directories;          // checked, new ones included
+    uint32_t directories_total;    // known plus found so far
+    uint32_t files;                // known files checked
+    uint32_t files_total;
+    uint32_t probes;               // tag reads done
+    uint32_t probes_total;         // queued so far
+    uint32_t listed;               // directories listed again (changed or new)
+    uint32_t directories_removed;
+    uint32_t added;                // tracks, once committed
+    uint32_t updated;
+    uint32_t removed;
+    uint32_t rejected;             // new or changed files the tag reader refused
+    bool committed;                // the catalog was rebuilt
+} LibraryRefreshProgress;
+
+/* Starts a refresh of the catalog scanned from 'root'. False when the catalog
+ * has no directory journal (nothing scanned, or no directory walker on this
+ * platform): scan instead. */
+bool LibraryScanner_BeginRefresh(const char *root);
+
+/* Does about 'budget' stats and tag reads (0: all of it); the commit is one
+ * step of its own. Returns true while there is more to do. */
+bool LibraryScanner_RefreshStep(unsigned budget);
+
+void LibraryScanner_GetRefreshProgress(LibraryRefreshProgress *progress);
+void LibraryScanner_CancelRefresh(void);
+
+#endif /* NUNO_LIBRARY_SCANNER_H */
@@ -1,18 +1,243 @@
 #ifndef NUNO_MUSIC_CATALOG_H
 #define NUNO_MUSIC_CATALOG_H
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 
+/*
+ * A track as callers see it: a view whose strings point into the catalog's
+ * string pool. Views are filled by value (MusicCatalog_GetTrack()) and stay
+ * valid until the catalog is next changed or cleared.
+ */
 typedef struct {
     const char *title;
     const char *album;
     const char *artist;
-    const char *filename;
+    const char *filename;  // relative to the library root
     uint32_t duration_seconds;
+    uint16_t track_number;  // 0 when unknown
+    uint16_t disc_number;   // 0 when unknown
+    uint32_t file_size;     // low 32 bits, when scanned: the rescan's change check
+    uint32_t file_mtime;    // seconds, when scanned
 } MusicLibraryTrack;
 
-extern const MusicLibraryTrack g_music_library_tracks[];
-extern const size_t g_music_library_track_count;
+/*
+ * Stored form of a track: fixed-width, with byte offsets into the string pool
+ * in place of pointers, so the table can be written out and mapped back as is.
+ * Offset 0 is the empty string.
+ *
+ * A track whose file has gone is kept as a removed record (a tombstone: no
+ * strings, MUSIC_CATALOG_REMOVED set) until the catalog is compacted, so the
+ * indices of the tracks around it do not move while something may be playing.
+ */
+typedef struct {
+    uint32_t title;
+    uint32_t album;
+    uint32_t artist;
+    uint32_t filename;
+    uint32_t duration_seconds;
+    uint16_t track_number;
+    uint16_t disc_number;
+    uint32_t file_size;
+    uint32_t file_mtime;
+    uint32_t flags;
+} MusicCatalogRecord;
+
+#define MUSIC_CATALOG_REMOVED 0x1U  // MusicCatalogRecord.flags: a tombstone
+
+/*
+ * A directory of the library as the last scan saw it. A rescan lists again
+ * only the directories whose modification time has moved (an entry was added,
+ * removed or renamed in them).
+ */
+typedef struct {
+    uint32_t path;   // pool offset, relative to the root; "" is the root
+    uint32_t mtime;  // seconds
+} MusicCatalogDirectory;
+
+/*
+ * Browse index, built from the records once (MusicCatalog_BuildIndex()) and
+ * stored in the library database with them:
+ *
+ *   artists       every distinct artist, sorted by name
+ *   albums        every distinct (artist, album) pair, sorted by artist then
+ *                 album, so each artist's albums are one contiguous run
+ *   album tracks  track indices grouped by album in the order above, each
+ *                 album's in disc / track-number / title order
+ *   songs         every track index, sorted by title
+ *   album order   album ids sorted by album name, for the Albums list
+ *
+ * Names sort case-insensitively (ASCII case folded; other bytes compare
+ * raw). Rows are array positions, so the row at position k of any list is a
+ * lookup, and finding where a name prefix starts is a binary search.
+ */
+typedef struct {
+    uint32_t name;         // pool offset
+    uint32_t first_album;  // album id of its first album
+    uint32_t album_count;
+    uint32_t track_count;
+} MusicCatalogArtist;
+
+typedef struct {
+    uint32_t name;         // pool offset
+    uint32_t artist;       // artist id
+    uint32_t first_track;  // position in the album-track list
+    uint32_t track_count;
+} MusicCatalogAlbum;
+
+/* Returned for a row or id that does not exist. */
+#define MUSIC_CATALOG_NONE UINT32_MAX
+
+/*
+ * In-RAM track catalog. The library scanner (nuno/library_scanner.h) fills it
+ * when the library is initialised; readers go through MusicLibrary_GetTrack().
+ *
+ * Memory is linear in the track count: one MusicCatalogRecord per track and
+ * one string pool in which every distinct string is stored once (an album's
+ * tracks share its name and its artist's, and repeated titles are shared too).
+ *
+ * The record table and pool can be saved as a library database and loaded
+ * back without touching the tracks: on hosts the file is mapped and used in
+ * place, elsewhere it is read in a few large reads. A loaded catalog is
+ * copied to the heap the first time a track is added to it.
+ *
+ * Not thread-safe. Fill or load it before readers start. The one exception
+ * is a rebuild (MusicCatalog_BeginRebuild()): while the owner refills the
+ * catalog, GetCount(), GetTrack() and IsRemoved() on any thread keep serving
+ * the tables as they were, and those stay allocated until the next rebuild
+ * begins. That is what lets a library refresh commit while the audio producer
+ * is looking up the next track.
+ */
+
+/* Library database file: this header, then the record table, the browse
+ * index tables, the directory table, the string pool and the library root the
+ * catalog was built from (a NUL-terminated path), each at the offset the
+ * header gives. Integers
+ * are little-endian, the byte order of every supported target; the layout is
+ * that of the structs. The version also changes when the scanner starts
+ * filling in more, so older databases are rescanned rather than kept. */
+#define MUSIC_CATALOG_DB_MAGIC "NUDB"
+#define MUSIC_CATALOG_DB_VERSION 4U  // 4: file stamps, directories, tombstones
+
+typedef struct {
+    char magic[4];           // MUSIC_CATALOG_DB_MAGIC
+    uint16_t version;        // MUSIC_CATALOG_DB_VERSION
+    uint16_t record_bytes;   // sizeof(MusicCatalogRecord)
+    uint32_t track_count;    // removed records included
+    uint32_t removed_count;
+    uint32_t artist_count;
+    uint32_t album_count;
+    uint32_t directory_count;
+    uint32_t records_offset; // file offsets; the tables are 4-byte aligned
+    uint32_t artists_offset;
+    uint32_t albums_offset;
+    uint32_t album_tracks_offset;
+    uint32_t songs_offset;
+    uint32_t album_order_offset;
+    uint32_t directories_offset;
+    uint32_t strings_offset;
+    uint32_t string_bytes;   // pool size, the final NUL included
+    uint32_t root_offset;
+    uint32_t root_bytes;     // NUL included
+} MusicCatalogDbHeader;
+
+/* Drops every track and frees (or unmaps) the catalog's memory. */
+void MusicCatalog_Clear(void);
+
+/* Copies 'track' (strings included) to the end of the catalog. NULL strings
+ * are stored as "". Returns false when out of memory or past the 4 GB pool
+ * limit. */
+bool MusicCatalog_AddTrack(const MusicLibraryTrack *track);
+
+/* Entries, removed ones included. */
+size_t MusicCatalog_GetCount(void);
+
+/* Fills 'track' with a view of entry 'index'; false past the end and for a
+ * removed entry. */
+bool MusicCatalog_GetTrack(size_t index, MusicLibraryTrack *track);
+
+/* Appends a removed entry (a tombstone), keeping the next index in step. */
+bool MusicCatalog_AddRemovedTrack(void);
+bool MusicCatalog_IsRemoved(size_t index);
+size_t MusicCatalog_GetRemovedCount(void);
+
+/* Directory table for the rescan (see MusicCatalogDirectory). */
+bool MusicCatalog_AddDirectory(const char *path, uint32_t mtime);
+size_t MusicCatalog_GetDirectoryCount(void);
+/* Path of directory 'index' relative to the root, "" for the root itself;
+ * NULL past the end. 'mtime' may be NULL. */
+const char *MusicCatalog_GetDirectory(size_t index, uint32_t *mtime);
+
+/*
+ * Starts refilling the catalog from empty while other threads go on reading
+ * the old entries (see above); the browse index is dropped. Add every entry
+ * and directory again, then EndRebuild() switches readers over. The owner's
+ * own GetTrack() calls also see the old entries until then, so it can copy
+ * from them. AbortRebuild() drops what was added and puts the old catalog
+ * back. BeginRebuild() returns false when a rebuild is already under way.
+ */
+bool MusicCatalog_BeginRebuild(void);
+void MusicCatalog_EndRebuild(void);
+void MusicCatalog_AbortRebuild(void);
+
+/*
+ * Drops the removed entries, renumbering the rest in order, and rebuilds the
+ * index. '*track' (may be NULL) is an entry index to carry over: it becomes
+ * that entry's new index, or the index of the nearest kept entry before it
+ * (SIZE_MAX when none) if it was removed itself. Runs as a rebuild, so
+ * readers see either numbering whole. False when out of memory; the catalog
+ * is then left as it was.
+ */
+bool MusicCatalog_Compact(size_t *track);
+/* Heap bytes held by the catalog: records, string pool, intern table,
+ * directories and index. A mapped database counts as 0. */
+size_t MusicCatalog_GetMemoryUsage(void);
+
+/*
+ * Sorts the browse index if it is missing; adding a track drops it. Loading a
+ * database brings its index along. The browse calls below see an empty
+ * library until then. Returns false when out of memory.
+ */
+bool MusicCatalog_BuildIndex(void);
+bool MusicCatalog_HasIndex(void);
+
+size_t MusicCatalog_GetArtistCount(void);
+size_t MusicCatalog_GetAlbumCount(void);
+
+/* Name of artist / album 'id'; NULL for an unknown id. 'album_count' and
+ * 'track_count' may be NULL. */
+const char *MusicCatalog_GetArtistName(uint32_t artist, uint32_t *album_count,
+                                       uint32_t *track_count);
+const char *MusicCatalog_GetAlbumName(uint32_t album, uint32_t *artist, uint32_t *track_count);
+
+/* Row lookups; MUSIC_CATALOG_NONE past the end of the list. Removed entries
+ * are in none of the lists. */
+uint32_t MusicCatalog_ArtistAlbumAt(uint32_t artist, size_t row);  // album id
+uint32_t MusicCatalog_AlbumTrackAt(uint32_t album, size_t row);    // track index
+uint32_t MusicCatalog_AlbumAt(size_t row);  // album id, Albums list (by album name)
+uint32_t MusicCatalog_SongAt(size_t row);   // track index, Songs list (by title)
+
+/* First row whose name is not below 'prefix' (case-folded) in the Artists,
+ * Albums or Songs list; the list length when there is none. */
+size_t MusicCatalog_FindArtist(const char *prefix);
+size_t MusicCatalog_FindAlbum(const char *prefix);
+size_t MusicCatalog_FindSong(const char *prefix);
+
+/*
+ * Writes the catalog and its index (built first if missing) to 'path' as a
+ * library database tagged with 'root' (the library it describes). The file is
+ * written beside 'path' and renamed over it, so a crash leaves the old
+ * database intact.
+ */
+bool MusicCatalog_Save(const char *path, const char *root);
+
+/*
+ * Replaces the catalog with the database at 'path'. Fails, leaving the
+ * catalog empty, when the file is missing, from another version or another
+ * root, or inconsistent. Only the header and pool bounds are checked at
+ * load; a record offset outside the pool reads as "".
+ */
+bool MusicCatalog_Load(const char *path, const char *root);
 
 #endif /* NUNO_MUSIC_CATALOG_H */
@@ -4,23 +4,83 @@
 #include <stdbool.h>
 #include <stddef.h>
 
+#include "nuno/library_scanner.h"
 #include "nuno/music_catalog.h"
 
 #ifndef NUNO_DEFAULT_LIBRARY_PATH
 #define NUNO_DEFAULT_LIBRARY_PATH "assets/music"
 #endif
 
+/* Library database: written after a scan and loaded instead of scanning at
+ * the next start (see MusicCatalog_Save()). */
+#ifndef NUNO_LIBRARY_DB_PATH
+#define NUNO_LIBRARY_DB_PATH NUNO_DEFAULT_LIBRARY_PATH "/.nuno-library.db"
+#endif
+
+/* Stats and tag reads per MusicLibrary_RefreshStep(). */
+#ifndef MUSIC_LIBRARY_REFRESH_BUDGET
+#define MUSIC_LIBRARY_REFRESH_BUDGET 32U
+#endif
+
+/* A library that starts with more than 1/MUSIC_LIBRARY_COMPACT_RATIO of the
+ * catalog as tombstones compacts it. Only at start: compaction renumbers
+ * the tracks, which a playing track and its look-ahead hold by index, so a
+ * refresh while running leaves its tombstones to the next start. */
+#ifndef MUSIC_LIBRARY_COMPACT_RATIO
+#define MUSIC_LIBRARY_COMPACT_RATIO 8U
+#endif
+
+/*
+ * Loads the library database and refreshes it against the tree (see
+ * LibraryScanner_BeginRefresh()), so a start where nothing changed reads
+ * tags for no file; scans the whole tree when there is no usable database.
+ */
 bool MusicLibrary_Init(const char *library_root);
 const char *MusicLibrary_GetRoot(void);
 size_t MusicLibrary_GetTrackCount(void);
-const MusicLibraryTrack *MusicLibrary_GetTrack(size_t index);
-const MusicLibraryTrack *MusicLibrary_GetCurrentTrack(void);
+/* Fill 'track' with a view of the entry (see MusicLibraryTrack); false when
+ * there is no such track. */
+bool MusicLibrary_GetTrack(size_t index, MusicLibraryTrack *track);
+bool MusicLibrary_GetCurrentTrack(MusicLibraryTrack *track);
 size_t MusicLibrary_GetCurrentIndex(void);
 bool MusicLibrary_OpenTrack(size_t index);
+/* Makes 'index' the current track without opening it for raw reads, for a
+ * caller that already has its own decoder on the file. No I/O. */
+bool MusicLibrary_SelectTrack(size_t index);
+/* The track after the current one, past tombstones; SIZE_MAX at the end. */
+size_t MusicLibrary_GetNextIndex(void);
 bool MusicLibrary_OpenNextTrack(void);
 bool MusicLibrary_HasNextTrack(void);
 bool MusicLibrary_OpenPreviousTrack(void);
 bool MusicLibrary_HasPreviousTrack(void);
 size_t MusicLibrary_GetRemainingTracks(void);
 
+/* The Songs list: tracks by title, removed ones left out. SongAt() gives the
+ * track index of 'row' in O(1), SIZE_MAX past the end, so a list view can
+ * fetch just the rows it shows. */
+size_t MusicLibrary_GetSongCount(void);
+size_t MusicLibrary_SongAt(size_t row);
+
+/*
+ * Library refresh: picks up files added, changed or removed since the library
+ * was scanned, without a rescan. Start it, then call RefreshStep() from the UI
+ * loop (AudioPipeline_ServiceIdle() does) until it returns false; each step
+ * does MUSIC_LIBRARY_REFRESH_BUDGET stats or tag reads, and playback carries
+ * on reading the old catalog until the last one swaps the new one in. Removed
+ * tracks stay as tombstones, skipped by the next/previous walks, until the
+ * next MusicLibrary_Init() compacts them (see MUSIC_LIBRARY_COMPACT_RATIO).
+ * The database is saved when anything changed.
+ *
+ * 'callback' (may be NULL) is called after every step with the progress so
+ * far; GetRefreshProgress() returns the same at any time. StartRefresh()
+ * returns false when the library has no directory journal to compare with.
+ */
+typedef void (*MusicLibraryRefreshCallback)(const LibraryRefreshProgress *progress,
+                                            void *context);
+
+bool MusicLibrary_StartRefresh(MusicLibraryRefreshCallback callback, void *context);
+bool MusicLibrary_RefreshStep(void);
+bool MusicLibrary_IsRefreshing(void);
+void MusicLibrary_GetRefreshProgress(LibraryRefreshProgress *progress);
+
 #endif /* NUNO_MUSIC_LIBRARY_H */
@@ -0,0 +1,70 @@
+#ifndef NUNO_PCM_KERNELS_H
+#define NUNO_PCM_KERNELS_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Block-oriented PCM kernels for the audio producer.
+ *
+ * fill_buffer() and the crossfade mixer used to do downmix, gain and S16
+ * quantisation one frame at a time. These kernels do the same work over a
+ * whole run of frames so each build can use the widest integer/float SIMD it
+ * has:
+ *
+ *   SCALAR   - portable reference. Every other variant must match it
+ *              bit-for-bit (tests/core/pcm_kernels_tests.c checks this).
+ *   SSE2     - x86-64 baseline; always available on the host sim.
+ *   AVX2     - x86 with runtime CPU detection; compiled via a target
+ *              attribute so the rest of the build stays at the baseline ISA.
+ *   ARM_DSP  - Cortex-M7 (__ARM_FEATURE_DSP): packed 16-bit multiply and
+ *              saturate for the Q15 gain, paired 32-bit stores for the
+ *              quantiser. The M7 FPU is scalar, so the float stages stay
+ *              scalar there.
+ *
+ * Semantics shared by all variants:
+ *   - Float samples are nominally in [-1, 1]. Quantisation applies the gain,
+ *     clamps to [-1, 1] and truncates x * 32767 toward zero, so the S16 range
+ *     produced is [-32767, 32767].
+ *   - Downmix: mono is duplicated to both sides, stereo passes through, and
+ *     more channels average every channel past the first two into both sides.
+ *   - Q15 gain is a rounded multiply, saturated to int16. A gain of
+ *     PCM_Q15_UNITY (or above) leaves the samples untouched.
+ *
+ * Buffers need no particular alignment. In-place use is only supported where
+ * noted.
+ */
+
+#define PCM_Q15_UNITY 32768
+
+typedef enum {
+    PCM_KERNELS_SCALAR = 0,
+    PCM_KERNELS_SSE2,
+    PCM_KERNELS_AVX2,
+    PCM_KERNELS_ARM_DSP,
+    PCM_KERNELS_VARIANT_COUNT
+} PcmKernelsVariant;
+
+typedef struct {
+    const char *name;
+
+    /* Interleaved 'channels'-channel float frames -> interleaved stereo float,
+     * scaled by 'gain'. 'in' and 'out' must not overlap. channels is 1..8. */
+    void (*downmix_to_stereo)(const float *in, uint32_t channels,
+                              float *out, size_t frames, float gain);
+
+    /* 'samples' floats -> S16 with gain, clamp and truncation (see above). */
+    void (*f32_to_s16)(const float *in, int16_t *out, size_t samples, float gain);
+
+    /* In place: samples[i] = sat16(round(samples[i] * gain_q15 / 32768)). */
+    void (*s16_gain_q15)(int16_t *samples, size_t count, int32_t gain_q15);
+} PcmKernels;
+
+/* Returns the kernels for one variant, or NULL if that variant is not built
+ * into this binary or the CPU does not support it. */
+const PcmKernels *PcmKernels_Get(PcmKernelsVariant variant);
+
+/* Returns the fastest variant available on this CPU (never NULL). */
+const PcmKernels *PcmKernels_Best(void);
+
+#endif /* NUNO_PCM_KERNELS_H */
@@ -0,0 +1,122 @@
+#ifndef NUNO_READ_AHEAD_H
+#define NUNO_READ_AHEAD_H
+
+#include "nuno/byte_source.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Read-ahead I/O stage between storage and the format decoders.
+ *
+ * Each open stream owns a RAM window (a ring over the file) that an I/O
+ * thread keeps filled with large sequential reads, so the decoders on the
+ * producer thread copy their input out of RAM instead of waiting on storage
+ * for every few KB.
+ *
+ * Refills are scheduled for storage power: nothing is read until some window
+ * drains below its low watermark (or a seek empties one). Then every window
+ * is topped up in one burst of back-to-back reads of READ_AHEAD_BURST_BYTES
+ * or more, and the storage hooks are told the card may sleep until the next
+ * burst. A bigger window and a lower watermark mean longer, rarer bursts.
+ *
+ * Streams are ByteSources (ByteSource_OpenReadAhead()); format_decoder_open()
+ * uses one whenever the stage is enabled and a stream slot is free, so the
+ * playing track and the pre-rolled next track are both resident. A seek
+ * inside the window is served from RAM; anywhere else the I/O thread restarts
+ * the window at the new offset.
+ *
+ * The threading follows the audio producer: this module does the work in
+ * ReadAhead_Service() and the platform supplies the thread (the simulator's
+ * SDL thread, the firmware's FreeRTOS task) through ReadAhead_SetIoHooks().
+ * With no hooks registered the service runs inline on the reader's thread
+ * wherever it would have woken the I/O thread, which is what host tests and
+ * benchmarks get.
+ */
+
+/* Streams open at once: the playing track and the look-ahead one. Further
+ * opens fall back to unbuffered file reads. */
+#ifndef READ_AHEAD_STREAMS
+#define READ_AHEAD_STREAMS 2U
+#endif
+
+#define READ_AHEAD_MIN_WINDOW (128U * 1024U)
+#define READ_AHEAD_MAX_WINDOW (2U * 1024U * 1024U)
+
+/* Smallest read the I/O thread issues, except for the tail of a file. */
+#define READ_AHEAD_BURST_BYTES (32U * 1024U)
+
+/*
+ * Sets the window size for streams opened from now on (clamped to
+ * READ_AHEAD_MIN_WINDOW..READ_AHEAD_MAX_WINDOW); 0 disables the stage, so
+ * ByteSource_OpenReadAhead() fails and decoders read the file directly.
+ * Disabled by default. Windows are allocated on first use and kept for reuse.
+ */
+void ReadAhead_SetWindowBytes(size_t bytes);
+size_t ReadAhead_GetWindowBytes(void);
+
+/*
+ * Low watermark as a percentage of the window (10-90, default 50), for
+ * streams opened from now on. It is capped so a burst always has room to
+ * read at least READ_AHEAD_BURST_BYTES.
+ */
+void ReadAhead_SetLowWatermarkPercent(unsigned percent);
+unsigned ReadAhead_GetLowWatermarkPercent(void);
+
+/*
+ * Storage driver hooks around each burst; every member is optional. Set them
+ * before the I/O thread starts (the hooks are copied, not locked).
+ */
+typedef struct {
+    void (*power_up)(void);        // before the first read of a burst
+    void (*power_down)(void);      // after the last one: storage may sleep
+    void (*on_read)(size_t bytes); // after each read, for device models
+    uint32_t (*now_ms)(void);      // clock for the duty-cycle statistics
+} ReadAheadStorageHooks;
+
+void ReadAhead_SetStorageHooks(const ReadAheadStorageHooks *hooks);
+
+/*
+ * Duty-cycle statistics since the last reset. Mean burst size is
+ * kib_read / bursts; mean idle time between bursts is idle_ms / (bursts - 1).
+ * The *_ms fields stay 0 without a now_ms hook.
+ */
+typedef struct {
+    uint32_t bursts;            // storage power-up .. power-down cycles
+    uint32_t kib_read;          // read in those bursts
+    uint32_t last_burst_bytes;
+    uint32_t active_ms;         // summed burst durations
+    uint32_t idle_ms;           // summed gaps between bursts
+    uint32_t last_idle_ms;
+    uint32_t stalls;            // reads that found their window empty
+} ReadAheadStats;
+
+void ReadAhead_GetStats(ReadAheadStats *stats);
+void ReadAhead_ResetStats(void);
+
+/*
+ * Registers the platform's I/O thread. 'wake' asks the thread to run
+ * ReadAhead_Service() (callable from the producer thread; a spurious wake is
+ * harmless). 'wait' blocks a starved reader for about a millisecond while
+ * the thread fills its window. Pass NULLs to go back to inline servicing;
+ * unregister before stopping the thread.
+ */
+void ReadAhead_SetIoHooks(void (*wake)(void), void (*wait)(void));
+
+/*
+ * I/O thread body: restarts windows after out-of-window seeks and, if any
+ * window is below its watermark, runs a burst that tops up every stream
+ * (least-buffered first) until none has room for another read. Returns once
+ * storage has nothing left to do.
+ */
+void ReadAhead_Service(void);
+
+/*
+ * Opens 'path' as a read-ahead stream. Returns false when the stage is
+ * disabled, every stream slot is busy or the file cannot be opened; callers
+ * fall back to ByteSource_OpenFile().
+ */
+bool ByteSource_OpenReadAhead(ByteSource *source, const char *path);
+
+#endif /* NUNO_READ_AHEAD_H */
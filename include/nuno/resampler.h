@@ -0,0 +1,107 @@
+#ifndef NUNO_RESAMPLER_H
+#define NUNO_RESAMPLER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Streaming polyphase sample-rate converter (interleaved stereo float).
+ *
+ * The ratio is reduced to out/in = L/M. The windowed-sinc (Kaiser) prototype
+ * of L * taps coefficients is designed once in Resampler_Configure() and stored
+ * phase-major, so producing an output frame is a single dot product over
+ * 'taps' input frames with the coefficients of one phase; there is no
+ * per-sample trigonometry or interpolation. When downsampling, taps grow with
+ * ceil(M/L) so the anti-alias cutoff keeps the same steepness.
+ *
+ * The converter is pull-driven, which suits the block producer:
+ *
+ *     while (out_frames_needed) {
+ *         n = Resampler_Pull(rs, out, out_frames_needed);
+ *         if (n == 0) {
+ *             in = Resampler_InputSpace(rs, &space);
+ *             ...decode/downmix up to min(space, Resampler_InputFramesFor())
+ *                frames straight into 'in'...
+ *             Resampler_CommitInput(rs, decoded);
+ *         }
+ *     }
+ *
+ * A Resampler is a plain struct so it can live in static storage; treat the
+ * fields as private. Nothing allocates.
+ */
+
+typedef enum {
+    RESAMPLER_QUALITY_LOW = 0,  // 16 taps/phase, ~60 dB stopband
+    RESAMPLER_QUALITY_MEDIUM,   // 32 taps/phase, ~85 dB stopband
+    RESAMPLER_QUALITY_HIGH,     // 64 taps/phase, ~100 dB stopband
+    RESAMPLER_QUALITY_COUNT
+} ResamplerQuality;
+
+/* Coefficient storage (floats) shared by all tiers. A ratio whose L * taps
+ * exceeds it is configured at the highest tier that fits, or rejected. Boards
+ * short on RAM can lower it. */
+#ifndef RESAMPLER_MAX_COEFFS
+#define RESAMPLER_MAX_COEFFS 32768U
+#endif
+
+/* Upper bound on taps per phase (tier taps x decimation factor). */
+#define RESAMPLER_MAX_TAPS 256U
+
+/* Input frames the converter can accept between pulls. */
+#define RESAMPLER_INPUT_FRAMES 1024U
+
+typedef struct {
+    uint32_t taps;                  // taps per phase in use
+    uint32_t phases;                // L
+    uint32_t macs_per_frame;        // multiply-accumulates per stereo output frame
+    uint32_t est_cycles_per_frame;  // Cortex-M7 model, see Resampler_GetCost()
+} ResamplerCost;
+
+typedef struct {
+    uint32_t in_rate;
+    uint32_t out_rate;
+    ResamplerQuality quality;  // tier in effect (may be below the requested one)
+    uint32_t phases;           // L
+    uint32_t step;             // M
+    uint32_t taps;
+    uint32_t phase;            // current phase, 0..L-1
+    size_t pos;                // first input frame of the current window
+    size_t frames;             // input frames buffered
+    float coeffs[RESAMPLER_MAX_COEFFS];
+    float input[(RESAMPLER_MAX_TAPS + RESAMPLER_INPUT_FRAMES) * 2U];
+} Resampler;
+
+/* True when in_rate -> out_rate can be converted at some tier. */
+bool Resampler_IsSupported(uint32_t in_rate, uint32_t out_rate);
+
+/* Designs the filter for in_rate -> out_rate at 'quality' (or the best tier
+ * that fits RESAMPLER_MAX_COEFFS) and resets the stream. Returns false if the
+ * ratio is not supported; the resampler is left unconfigured. */
+bool Resampler_Configure(Resampler *rs, uint32_t in_rate, uint32_t out_rate,
+                         ResamplerQuality quality);
+
+/* Drops buffered input and restarts the stream (e.g. after a seek). */
+void Resampler_Reset(Resampler *rs);
+
+/* Writable space for new input frames (compacts consumed history first). */
+float *Resampler_InputSpace(Resampler *rs, size_t *frames_free);
+void Resampler_CommitInput(Resampler *rs, size_t frames);
+
+/* Input frames still needed before 'out_frames' outputs can be pulled. */
+size_t Resampler_InputFramesFor(const Resampler *rs, size_t out_frames);
+
+/* Produces up to max_frames stereo frames; 0 means more input is needed. */
+size_t Resampler_Pull(Resampler *rs, float *out, size_t max_frames);
+
+/*
+ * CPU cost of a configuration. est_cycles_per_frame models a Cortex-M7: two
+ * VFMA per tap (one per channel) with the coefficient and sample loads
+ * dual-issued, plus ~20 cycles of per-frame bookkeeping. The host bench
+ * (tests/bench/resampler_bench.c) measures the real figure per tier.
+ */
+void Resampler_GetCost(const Resampler *rs, ResamplerCost *cost);
+bool Resampler_EstimateCost(ResamplerQuality quality, uint32_t in_rate,
+                            uint32_t out_rate, ResamplerCost *cost);
+
+#endif /* NUNO_RESAMPLER_H */
@@ -0,0 +1,69 @@
+#ifndef NUNO_TAG_READER_H
+#define NUNO_TAG_READER_H
+
+#include "nuno/format_decoder.h"
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * Track metadata from the header region of a file, without decoding audio.
+ *
+ *   MP3   ID3v2.2-2.4 text frames (TIT2/TPE1/TALB/TRCK/TPOS and their v2.2
+ *         names) and the first MPEG frame: the frame count of a Xing/Info or
+ *         VBRI header, otherwise an estimate from the file size and bitrate
+ *         (exact for CBR).
+ *   FLAC  STREAMINFO (rate, channels, total samples) and VORBIS_COMMENT
+ *         (TITLE/ARTIST/ALBUM/TRACKNUMBER/DISCNUMBER). A leading ID3v2 tag
+ *         is read too.
+ *
+ * A file costs one read of at most TAG_READER_BUDGET_BYTES from its start.
+ * Tag frames and metadata blocks past that are not read, except that an MP3
+ * whose ID3v2 tag outgrows the budget (embedded cover art) gets one more read
+ * of TAG_READER_FRAME_BYTES where its audio starts, so it is still recognised
+ * and timed. Text is converted to UTF-8 and cut at TAG_READER_TEXT_MAX - 1
+ * bytes.
+ *
+ * Stateless and reentrant: callers supply the read buffer.
+ */
+
+#define TAG_READER_BUDGET_BYTES (16U * 1024U)
+
+/* Second read for an MP3 whose ID3v2 tag ends past the budget: room for the
+ * largest MPEG frame with a Xing header and the next frame's sync. */
+#define TAG_READER_FRAME_BYTES 2048U
+
+#define TAG_READER_TEXT_MAX 128U
+
+typedef struct {
+    enum AudioFormatType format;  // AUDIO_FORMAT_MP3 or AUDIO_FORMAT_FLAC
+    char title[TAG_READER_TEXT_MAX];   // "" when the file has no such tag
+    char artist[TAG_READER_TEXT_MAX];
+    char album[TAG_READER_TEXT_MAX];
+    uint16_t track_number;             // 0 when unknown
+    uint16_t disc_number;
+    uint32_t sample_rate;
+    uint8_t channels;
+    bool duration_estimated;           // MP3 without a frame count
+    uint32_t duration_seconds;         // rounded; 0 when unknown
+    uint32_t bytes_read;               // from the file, both reads together
+} TrackTags;
+
+/*
+ * Parses the first 'length' bytes of a file of 'file_size' bytes (0 when
+ * unknown; the MP3 estimate then stays 0). Returns false unless they start an
+ * MP3 or FLAC stream; an MP3 whose audio starts past 'length' is not
+ * recognised here.
+ */
+bool TagReader_Parse(const uint8_t *data, size_t length, uint64_t file_size, TrackTags *tags);
+
+/*
+ * Reads and parses the file at 'path' using 'buffer' ('capacity' bytes, which
+ * bounds the first read; TAG_READER_BUDGET_BYTES is the intended size and at
+ * least TAG_READER_FRAME_BYTES is needed). Returns false when the file cannot
+ * be read or is not MP3 or FLAC.
+ */
+bool TagReader_ReadFile(const char *path, uint8_t *buffer, size_t capacity, TrackTags *tags);
+
+#endif /* NUNO_TAG_READER_H */
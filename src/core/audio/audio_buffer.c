@@ -2,69 +2,107 @@
 
 #include "nuno/filesystem.h"
 #include "nuno/format_decoder.h"
+#include "nuno/pcm_kernels.h"
 #include "nuno/platform.h"
+#include "nuno/resampler.h"
 
 #include <math.h>
 #include <stdatomic.h>
 #include <stdio.h>
 #include <string.h>
 
-#define DMA_BUFFER_COUNT 2U
-
 /*
  * Software volume curve. The public target is a 0..100 percentage; the applied
  * gain is (percent/100)^2, a mild perceptual curve that keeps 100% bit-exact
  * (gain == 1.0) so the default does not alter output. VOLUME_RAMP_STEP bounds
  * how far the per-block applied gain may move toward the target each fill, which
  * removes zipper noise on abrupt volume changes (one fill == AUDIO_BUFFER_FRAMES
- * frames, ~46 ms at 44.1 kHz, so a full 0<->1 sweep takes a handful of blocks).
+ * frames, ~46 ms at 44.1 kHz, or half that in ping-pong mode, so a full 0<->1
+ * sweep takes a handful of blocks).
  */
 #define VOLUME_MAX_PERCENT 100U
 #define VOLUME_RAMP_STEP   0.25f
 
 /*
- * Crossfade tail ring. The producer keeps the last CROSSFADE_MAX_FRAMES frames
- * of decoded (post-volume, float, downmixed-to-stereo) outgoing audio so that
- * when the outgoing decoder hits EOF it can overlap-mix that already-emitted
- * tail against the incoming track's head. The ring is a fixed producer-local
- * buffer (no per-call allocation) sized to the maximum supported fade length;
- * any requested fade is clamped to this. At 44.1 kHz, 4 s == 176400 frames.
- * Stored as interleaved stereo floats: CROSSFADE_MAX_FRAMES * AUDIO_OUT_CHANNELS.
+ * Crossfade tail ring. The producer keeps the last 'fade' frames of emitted
+ * (post-volume, stereo) outgoing audio so that when the outgoing decoder hits
+ * EOF it can overlap-mix that already-emitted tail against the incoming
+ * track's head. The tail is a copy of what went into the ring slots, i.e.
+ * interleaved S16, so it costs AUDIO_BUFFER_CROSSFADE_FRAME_BYTES per frame.
+ * Its storage is carved from the platform's crossfade region when a fade is
+ * armed (see AudioBuffer_SetCrossfadeRegion()), sized to the armed length;
+ * no per-call allocation. CROSSFADE_MAX_FRAMES caps the requested length
+ * (4 s at 44.1 kHz).
  */
 #define CROSSFADE_MAX_FRAMES (4U * 44100U)
 
+/* Inverse of the quantiser's x32767 scale, for mixing the S16 tail. */
+#define S16_TO_FLOAT (1.0f / 32767.0f)
+
+/* Producer scratch: decoded frames of up to 8 channels, and their stereo
+ * downmix (or resampler output). */
+#define DECODE_SCRATCH_SAMPLES (AUDIO_BUFFER_FRAMES * 8U)
+#define STEREO_SCRATCH_SAMPLES (AUDIO_BUFFER_FRAMES * AUDIO_OUT_CHANNELS)
+
+/* Pre-rolled S16 frames are widened exactly as the MP3 float read does. */
+#define PREROLL_S16_TO_FLOAT (1.0f / 32768.0f)
+
 /*
  * Unit conventions for this module (read before touching counts):
  *   - data[]            : interleaved S16 PCM. Indexed in *samples* (uint16_t
- *                         elements); holds AUDIO_BUFFER_SIZE samples ==
- *                         AUDIO_BUFFER_FRAMES frames (AUDIO_OUT_CHANNELS per frame).
+ *                         elements); slot N starts at N * block_frames *
+ *                         AUDIO_OUT_CHANNELS. A ring slot holds
+ *                         AUDIO_BUFFER_FRAMES frames; a ping-pong half holds
+ *                         half that, so both halves share one AUDIO_BUFFER_SIZE
+ *                         region.
+ *   - block_frames      : *frames* per slot for the current mode.
  *   - valid_frames[]    : number of decoded *frames* (stereo sample pairs)
- *                         currently valid in the matching data[] buffer.
+ *                         currently valid in the matching data[] slot.
+ *   - track_start[]     : *frame* in the matching slot where a new track
+ *                         begins, or NO_TRACK_START.
+ *   - read/write_seq    : *block* sequence numbers; slot == seq % depth.
  *   - low/high_threshold: *frame* counts (see AUDIO_BUFFER_FRAMES / LOW_WATER_MARK).
  * One frame == AUDIO_OUT_CHANNELS samples == AUDIO_OUT_CHANNELS * sizeof(uint16_t) bytes.
- * The DMA layer is driven elsewhere with a length of AUDIO_BUFFER_SIZE (samples),
- * matching the uint16_t element count of data[].
+ * The DMA layer is handed AudioBuffer_GetDmaRegion(), whose length is in
+ * samples (uint16_t elements of data[]).
  */
+
+/* Ping-pong needs two slots even when a board only reserves one block of
+ * storage for them (AUDIO_BUFFER_MAX_BLOCKS == 1). */
+#define RING_SLOT_COUNT ((AUDIO_BUFFER_MAX_BLOCKS < 2U) ? 2U : AUDIO_BUFFER_MAX_BLOCKS)
+#define PING_PONG_HALVES 2U
+#define NO_TRACK_START SIZE_MAX
 typedef struct {
     /*
-     * data[]/valid_frames[]/active are shared between the producer (fill_buffer,
-     * driven from the DMA-complete / audio-task path) and the audio output
-     * callback that consumes the active buffer. The double-buffer scheme keeps
-     * them on separate indices so the producer fills the just-consumed buffer
-     * while the callback drains the other; 'active' is flipped only from the
-     * consume path. This is intentionally lock-free and single-writer per index.
+     * data[]/valid_frames[] form an SPSC block ring shared between the producer
+     * (fill_buffer, driven from the audio-task / producer-thread path) and the
+     * audio output callback that consumes the slot at read_seq. Only the first
+     * 'depth' slots are used; the rest of the static storage is the board's
+     * headroom for a deeper ring. The producer only writes slots in
+     * [write_seq, read_seq + depth) and the consumer only reads
+     * [read_seq, write_seq), so each slot has exactly one writer at a time.
      * Keep that invariant if you add producers.
+     *
+     * In ping-pong mode the two half-size slots are the two halves of the one
+     * circular DMA region at the start of data[]. The DMA keeps reading even
+     * when the producer is late, so read_seq always advances on HT/TC and the
+     * producer skips ahead to the half that is not playing (see ring_fill()).
      */
-    uint16_t data[DMA_BUFFER_COUNT][AUDIO_BUFFER_SIZE];
+    uint16_t data[AUDIO_BUFFER_MAX_BLOCKS * AUDIO_BUFFER_SIZE];
     /*
      * Shared producer/consumer scalars are atomic - see the contract in
-     * audio_buffer.h. 'active' is published with release ordering from the
-     * consume path and read with acquire ordering from the producer/consumer;
-     * the others are single-writer (producer) with relaxed loads on the read
-     * side, which is sufficient because 'active' is the synchronising handoff.
+     * audio_buffer.h. write_seq (producer-owned) and read_seq (consumer-owned)
+     * are each published with release ordering and read with acquire ordering
+     * by the other side; valid_frames[] is written before the write_seq store
+     * that exposes its slot, so relaxed loads of it are sufficient.
      */
-    _Atomic size_t valid_frames[DMA_BUFFER_COUNT];  // decoded frames (interleaved stereo pairs)
-    _Atomic size_t active;
+    _Atomic size_t valid_frames[RING_SLOT_COUNT];  // decoded frames (interleaved stereo pairs)
+    _Atomic size_t track_start[RING_SLOT_COUNT];   // written with valid_frames[]
+    _Atomic size_t read_seq;
+    _Atomic size_t write_seq;
+    size_t depth;
+    size_t block_frames;
+    AudioBufferMode mode;
 
     _Atomic int state;        // BufferState, stored as int for atomic ops
     bool initialised;
@@ -72,14 +110,18 @@ typedef struct {
 
     /*
      * Producer decoupling (see the contract in audio_buffer.h). When
-     * producer_wake is non-NULL, AudioBuffer_Done() (consumer/ISR) marks the
-     * freed buffer in fill_pending and calls producer_wake instead of decoding
-     * inline; AudioBuffer_Service() (producer thread/task) performs the fill.
-     * fill_pending is a bitmask of buffer indices awaiting refill.
+     * producer_wake is non-NULL, AudioBuffer_Done() (consumer/ISR) releases the
+     * drained slot and calls producer_wake instead of decoding inline;
+     * AudioBuffer_Service() (producer thread/task) tops the ring back up. The
+     * free slots are implied by the read/write sequence pair, so there is no
+     * separate pending mask to claim.
      */
-    _Atomic uint32_t fill_pending;
     void (*producer_wake)(void);
 
+    /* Platform-registered storage the crossfade tail is carved from. */
+    void* crossfade_region;
+    size_t crossfade_region_bytes;
+
     bool next_track_available;
     size_t remaining_tracks;
 
@@ -94,6 +136,8 @@ typedef struct {
     void* next_track_user_data;
     _Atomic uint32_t track_change_count;
     uint32_t track_change_seen;  // last value latched by ConsumeTrackChanged
+    _Atomic size_t track_frames_played;  // consumer-owned; see count_played()
+    void (*track_change_wake)(void);
 
     size_t low_threshold;
     size_t high_threshold;
@@ -123,6 +167,13 @@ typedef struct {
         uint8_t bytes_per_sample;
         bool is_float;
         bool is_signed;
+        /* Resampler control: 'quality' is the requested tier (any thread);
+         * the rest is producer-owned. 'resampling' is published so control
+         * code can tell whether a conversion is running. */
+        _Atomic int quality;
+        ResamplerQuality quality_in_use;
+        uint32_t rejected_rate;
+        _Atomic bool resampling;
     } format;
 
     /*
@@ -133,18 +184,20 @@ typedef struct {
      *                    'active_frames' when a transition begins.
      *   in_progress    - producer-local: a fade is currently being mixed.
      *   active_frames  - producer-local: the fade length in effect for the
-     *                    current fade (clamped to CROSSFADE_MAX_FRAMES and to
+     *                    current fade (clamped to the tail capacity and to
      *                    however much outgoing tail was actually captured).
      *   pos            - producer-local: frames already emitted into the fade.
      *   incoming       - producer-local: the pre-opened decoder for the track
      *                    being faded in. Owned here for the fade's duration and
      *                    closed/destroyed when the fade completes or aborts.
-     *   tail[]/tail_count/tail_head - producer-local ring of recently emitted
-     *                    outgoing audio (interleaved stereo floats, already
-     *                    volume-scaled). tail_head is the index just past the
+     *   tail/tail_capacity - producer-local ring of recently emitted outgoing
+     *                    audio (interleaved S16 stereo, already volume-scaled),
+     *                    tail_capacity frames carved from crossfade_region by
+     *                    tail_configure(). NULL/0 while crossfade is disabled.
+     *   tail_count/tail_head - tail_head is the index just past the
      *                    most-recently written frame; tail_count saturates at
-     *                    CROSSFADE_MAX_FRAMES. The producer pushes here while a
-     *                    fade is ARMED but not yet in progress.
+     *                    tail_capacity. The producer pushes here while a fade
+     *                    is ARMED but not yet in progress.
      *   tail_anchor/tail_window - the FROZEN tail window for the in-flight fade:
      *                    'tail_window' frames starting at ring index
      *                    'tail_anchor'. Captured in crossfade_begin(); the
@@ -157,23 +210,87 @@ typedef struct {
         uint32_t active_frames;
         uint32_t pos;
         FormatDecoder* incoming;
-        float tail[CROSSFADE_MAX_FRAMES * AUDIO_OUT_CHANNELS];
+        int16_t* tail;
+        size_t tail_capacity;
         size_t tail_count;
         size_t tail_head;
         size_t tail_anchor;
         uint32_t tail_window;
     } crossfade;
 
+    /*
+     * Look-ahead state (see audio_buffer.h). window_ms is the control input
+     * (any thread, atomic); the rest is producer-local.
+     *
+     *   next          - decoder pre-opened for the track after the current
+     *                   one, waiting for the EOF swap.
+     *   attempted     - the provider was already asked for the current
+     *                   decoder's successor, so an end-of-library NULL is not
+     *                   retried on every service call.
+     *   preroll_*     - the first frames of a pre-opened decoder, decoded
+     *                   ahead into 'preroll'. They stay with that decoder
+     *                   ('preroll_owner') across the swap and are handed out
+     *                   by decoder_read()/decoder_read_s16() before the
+     *                   decoder itself is read. Stored as S16 when the decoder
+     *                   has the S16 fast path and the output layout, so the
+     *                   fast path stays bit-exact; float otherwise.
+     */
+    struct {
+        _Atomic uint32_t window_ms;
+        AudioBufferLookAheadOpen open;
+        AudioBufferLookAheadCommit commit;
+        void* user_data;
+        FormatDecoder* next;
+        bool attempted;
+        FormatDecoder* preroll_owner;
+        bool preroll_s16;
+        uint32_t preroll_channels;
+        size_t preroll_frames;
+        size_t preroll_pos;
+        union {
+            float f32[STEREO_SCRATCH_SAMPLES];
+            int16_t s16[STEREO_SCRATCH_SAMPLES];
+        } preroll;
+    } lookahead;
+
     FormatDecoder* decoder;
+
+    /* Downmix/gain/quantise kernels for this CPU (see pcm_kernels.h). */
+    const PcmKernels* kernels;
 } AudioBufferState;
 
 static AudioBufferState g_buffer;
 
+/* Producer-owned sample-rate converter. Kept out of g_buffer: its coefficient
+ * table is large and must survive the memset in reset_internal_state(). */
+static Resampler g_resampler;
+
+/* Handed to the consumer while the ring is empty so it never reads a slot the
+ * producer is still filling. */
+static const uint16_t k_silent_block[AUDIO_BUFFER_SIZE];
+
 static void reset_internal_state(void);
 static bool fill_buffer(size_t index);
+static size_t ring_fill(void);
+static size_t ring_queued_frames(void);
+static bool consume_block(size_t drained_slot);
+static void count_played(size_t seq);
+static inline bool rate_needs_conversion(uint32_t source_rate);
+
+static inline uint16_t *slot_samples(size_t slot) {
+    return &g_buffer.data[slot * g_buffer.block_frames * AUDIO_OUT_CHANNELS];
+}
+
+static inline bool is_ping_pong(void) {
+    return g_buffer.mode == AUDIO_BUFFER_MODE_PING_PONG;
+}
 static void update_utilisation(size_t available_frames);
 static void crossfade_release_incoming(void);
 static void crossfade_abort(void);
+static size_t crossfade_tail_frames(uint32_t fade_frames);
+static void release_decoder(FormatDecoder* decoder);
+static void lookahead_discard(void);
+static void lookahead_service(void);
 
 /* Map a 0..100 volume percentage to a linear gain via a mild quadratic curve.
  * 100% -> 1.0 exactly (bit-exact passthrough); 0% -> 0.0 (silence). */
@@ -205,6 +322,18 @@ static float advance_volume_gain(void) {
     return current;
 }
 
+/* Q15 form of the block gain for the S16 paths (raw PCM and the decoder
+ * integer fast path). PCM_Q15_UNITY means "leave the samples alone". */
+static inline int32_t gain_to_q15(float gain) {
+    if (gain >= 1.0f) {
+        return PCM_Q15_UNITY;
+    }
+    if (gain <= 0.0f) {
+        return 0;
+    }
+    return (int32_t)(gain * (float)PCM_Q15_UNITY + 0.5f);
+}
+
 static inline void set_state(BufferState state) {
     atomic_store_explicit(&g_buffer.state, (int)state, memory_order_relaxed);
 }
@@ -214,18 +343,64 @@ static inline BufferState get_state(void) {
 }
 
 bool AudioBuffer_Init(void) {
+    return AudioBuffer_InitWithDepth(AUDIO_BUFFER_DEFAULT_BLOCKS);
+}
+
+bool AudioBuffer_InitWithDepth(size_t block_count) {
+    if (g_buffer.mode == AUDIO_BUFFER_MODE_PING_PONG) {
+        /* The two halves of one DMA region; the requested depth does not apply. */
+        block_count = PING_PONG_HALVES;
+    } else if (block_count < AUDIO_BUFFER_MIN_BLOCKS ||
+               block_count > AUDIO_BUFFER_MAX_BLOCKS) {
+        printf("Audio buffer depth %zu out of range (%u..%u)\n", block_count,
+               (unsigned)AUDIO_BUFFER_MIN_BLOCKS, (unsigned)AUDIO_BUFFER_MAX_BLOCKS);
+        return false;
+    }
     reset_internal_state();
+    g_buffer.depth = block_count;
+    g_buffer.block_frames = is_ping_pong() ? (AUDIO_BUFFER_FRAMES / PING_PONG_HALVES)
+                                           : AUDIO_BUFFER_FRAMES;
+    g_buffer.high_threshold = g_buffer.block_frames;
+    g_buffer.stats.ring_min_occupancy = block_count;
     g_buffer.initialised = true;
     return true;
 }
 
+size_t AudioBuffer_GetDepth(void) {
+    return g_buffer.depth;
+}
+
+void AudioBuffer_SetOutputMode(AudioBufferMode mode) {
+    g_buffer.mode = mode;
+}
+
+AudioBufferMode AudioBuffer_GetOutputMode(void) {
+    return g_buffer.mode;
+}
+
+size_t AudioBuffer_GetBlockSamples(void) {
+    return g_buffer.block_frames * AUDIO_OUT_CHANNELS;
+}
+
+uint16_t *AudioBuffer_GetDmaRegion(size_t *samples) {
+    if (is_ping_pong()) {
+        /* Both halves, back to back: the DMA runs circularly over all of it. */
+        if (samples) {
+            *samples = PING_PONG_HALVES * g_buffer.block_frames * AUDIO_OUT_CHANNELS;
+        }
+        return g_buffer.data;
+    }
+    if (samples) {
+        *samples = g_buffer.block_frames * AUDIO_OUT_CHANNELS;
+    }
+    return AudioBuffer_GetBuffer();
+}
+
 void AudioBuffer_Cleanup(void) {
     crossfade_abort();
-    if (g_buffer.decoder) {
-        format_decoder_close(g_buffer.decoder);
-        format_decoder_destroy(g_buffer.decoder);
-        g_buffer.decoder = NULL;
-    }
+    lookahead_discard();
+    release_decoder(g_buffer.decoder);
+    g_buffer.decoder = NULL;
     reset_internal_state();
 }
 
@@ -234,28 +409,37 @@ bool AudioBuffer_StartPlayback(void) {
         return false;
     }
 
+    /* Priming runs on the control thread with the consumer idle, so it may
+     * rewind both ends of the ring before refilling it from slot 0. */
+    atomic_store_explicit(&g_buffer.read_seq, 0U, memory_order_relaxed);
+    atomic_store_explicit(&g_buffer.write_seq, 0U, memory_order_relaxed);
+    atomic_store_explicit(&g_buffer.end_of_stream, false, memory_order_relaxed);
+
     if (!fill_buffer(0U)) {
         set_state(BUFFER_STATE_END_OF_STREAM);
         return false;
     }
 
-    if (!fill_buffer(1U)) {
-        /* We can still play the first buffer, but mark end of stream. */
-        atomic_store_explicit(&g_buffer.end_of_stream, true, memory_order_relaxed);
-    }
+    /* Publish the first block with release ordering so its data[] writes are
+     * visible to a consumer that acquires write_seq, then prime the rest of the
+     * ring. A short track simply leaves end_of_stream set for the consumer. */
+    atomic_store_explicit(&g_buffer.write_seq, 1U, memory_order_release);
+    (void)ring_fill();
 
-    /* Publish the initial active index with release ordering so both filled
-     * buffers' data[] writes are visible to a consumer that acquires it. */
-    atomic_store_explicit(&g_buffer.active, 0U, memory_order_release);
     set_state(BUFFER_STATE_READY);
     return true;
 }
 
 uint16_t *AudioBuffer_GetBuffer(void) {
-    /* Acquire the active index published by AudioBuffer_Done() so that the
-     * producer's data[] writes for that buffer are visible to this consumer. */
-    size_t active = atomic_load_explicit(&g_buffer.active, memory_order_acquire);
-    return g_buffer.data[active];
+    /* Acquire write_seq so that the producer's data[] writes for the head slot
+     * are visible to this consumer. An empty ring yields silence rather than a
+     * slot the producer may be writing. */
+    size_t read = atomic_load_explicit(&g_buffer.read_seq, memory_order_relaxed);
+    size_t write = atomic_load_explicit(&g_buffer.write_seq, memory_order_acquire);
+    if (read == write || g_buffer.depth == 0U) {
+        return (uint16_t *)k_silent_block;
+    }
+    return slot_samples(read % g_buffer.depth);
 }
 
 bool AudioBuffer_Done(void) {
@@ -263,41 +447,93 @@ bool AudioBuffer_Done(void) {
         printf("Audio buffer not initialized\n");
         return false;
     }
+    /* Ping-pong: transfer-complete means the second half just drained. */
+    return consume_block(1U);
+}
 
-    size_t consumed_index = atomic_load_explicit(&g_buffer.active,
-                                                 memory_order_relaxed);
-    size_t next_index = (consumed_index + 1U) % DMA_BUFFER_COUNT;
-
-    size_t next_valid = atomic_load_explicit(&g_buffer.valid_frames[next_index],
-                                             memory_order_relaxed);
-    bool eos = atomic_load_explicit(&g_buffer.end_of_stream, memory_order_relaxed);
-    if (next_valid == 0U && eos) {
-        set_state(BUFFER_STATE_END_OF_STREAM);
-        /* Still publish the flip so the consumer sees the (silent) buffer. */
-        atomic_store_explicit(&g_buffer.active, next_index, memory_order_release);
-        return false;
+/* Consumer-side: advance the current track's played-frame count by the block
+ * at 'seq', restarting it where a new track begins inside that block. */
+static void count_played(size_t seq) {
+    size_t slot = seq % g_buffer.depth;
+    size_t frames = atomic_load_explicit(&g_buffer.valid_frames[slot], memory_order_relaxed);
+    size_t start = atomic_load_explicit(&g_buffer.track_start[slot], memory_order_relaxed);
+    size_t played = atomic_load_explicit(&g_buffer.track_frames_played, memory_order_relaxed);
+    if (start != NO_TRACK_START) {
+        played = (frames > start) ? frames - start : 0U;
+    } else {
+        played += frames;
     }
+    atomic_store_explicit(&g_buffer.track_frames_played, played, memory_order_relaxed);
+}
 
-    /* Publish the flip to the next buffer with release ordering. The next
-     * buffer was filled by a prior fill_buffer() whose writes are ordered
-     * before this store, so the consumer's acquire load sees valid data. */
-    atomic_store_explicit(&g_buffer.active, next_index, memory_order_release);
-    set_state(BUFFER_STATE_PLAYING);
+/*
+ * Consumer side of the ring: release the slot at read_seq, wake (or inline)
+ * the producer, then report what the consumer plays next. In ping-pong mode
+ * 'drained_slot' is the half the DMA reported finished; the DMA has moved on
+ * regardless of the producer, so read_seq always advances and is realigned to
+ * that half if an event was missed.
+ */
+static bool consume_block(size_t drained_slot) {
+    size_t read = atomic_load_explicit(&g_buffer.read_seq, memory_order_relaxed);
+    size_t write = atomic_load_explicit(&g_buffer.write_seq, memory_order_acquire);
+    if (is_ping_pong()) {
+        if ((read % PING_PONG_HALVES) != drained_slot) {
+            read++;
+        }
+        /* A half the producer had not published yet was a stale replay. */
+        if ((ptrdiff_t)(write - read) > 0) {
+            count_played(read);
+        }
+        read++;
+        atomic_store_explicit(&g_buffer.read_seq, read, memory_order_release);
+    } else if (read != write) {
+        /* Release the drained slot back to the producer. The consumer's reads
+         * of it are ordered before this store, so the producer's acquire load
+         * of read_seq makes it safe to overwrite. */
+        count_played(read);
+        read++;
+        atomic_store_explicit(&g_buffer.read_seq, read, memory_order_release);
+    }
 
     if (g_buffer.producer_wake) {
         /* Decoupled producer path (the only safe option in an ISR / audio
-         * callback): mark the just-freed buffer and wake the producer to refill
-         * it off the audio path. Decode does NOT happen here. */
-        atomic_fetch_or_explicit(&g_buffer.fill_pending,
-                                 (uint32_t)(1U << consumed_index),
-                                 memory_order_relaxed);
+         * callback): wake the producer to top the ring up off the audio path.
+         * Decode does NOT happen here. */
         g_buffer.producer_wake();
     } else {
         /* No producer registered: refill inline (synchronous fallback). If it
-         * comes up empty, end_of_stream is now set so the following Done() will
-         * report EOS once the freshly-activated buffer drains. */
-        (void)fill_buffer(consumed_index);
+         * comes up empty, end_of_stream is now set and the ring drains to EOS. */
+        (void)ring_fill();
+    }
+
+    write = atomic_load_explicit(&g_buffer.write_seq, memory_order_acquire);
+    /* Signed: in ping-pong mode read_seq can run ahead of a late producer. */
+    ptrdiff_t ahead = (ptrdiff_t)(write - read);
+    size_t queued = (ahead > 0) ? (size_t)ahead : 0U;
+    if (queued < g_buffer.stats.ring_min_occupancy) {
+        g_buffer.stats.ring_min_occupancy = queued;
     }
+
+    if (queued == 0U) {
+        if (atomic_load_explicit(&g_buffer.end_of_stream, memory_order_relaxed)) {
+            if (is_ping_pong()) {
+                /* The DMA cannot be handed a silent block; silence the half it
+                 * just drained instead so it does not loop the final audio. */
+                memset(slot_samples(drained_slot), 0,
+                       g_buffer.block_frames * AUDIO_OUT_CHANNELS * sizeof(uint16_t));
+            }
+            set_state(BUFFER_STATE_END_OF_STREAM);
+            return false;
+        }
+        /* The producer fell behind: the consumer plays the silent block (the
+         * DMA replays the stale half) until the next slot is published. */
+        g_buffer.stats.underruns++;
+        g_buffer.errors.total_underruns++;
+        set_state(BUFFER_STATE_UNDERRUN);
+        return true;
+    }
+
+    set_state(BUFFER_STATE_PLAYING);
     return true;
 }
 
@@ -305,23 +541,33 @@ void AudioBuffer_SetProducerWake(void (*wake)(void)) {
     g_buffer.producer_wake = wake;
 }
 
+void AudioBuffer_SetTrackChangeWake(void (*wake)(void)) {
+    g_buffer.track_change_wake = wake;
+}
+
+/* Publishes a transition for ConsumeTrackChanged() and wakes whoever waits on it. */
+static void publish_track_change(void) {
+    atomic_fetch_add_explicit(&g_buffer.track_change_count, 1U,
+                              memory_order_relaxed);
+    if (g_buffer.track_change_wake) {
+        g_buffer.track_change_wake();
+    }
+}
+
 void AudioBuffer_Service(void) {
     if (!g_buffer.initialised) {
         return;
     }
-    /* Claim and clear the pending set atomically so a Done() concurrent with
-     * this fill can re-arm the next round without losing a request. */
-    uint32_t pending = atomic_exchange_explicit(&g_buffer.fill_pending, 0U,
-                                                memory_order_relaxed);
-    for (size_t i = 0; i < DMA_BUFFER_COUNT; i++) {
-        if (pending & (1U << i)) {
-            (void)fill_buffer(i);
-        }
-    }
+    (void)ring_fill();
 }
 
 void AudioBuffer_HalfDone(void) {
-    /* No-op for the simple double buffer implementation. */
+    /* Only meaningful in ping-pong mode: half-transfer means the first half
+     * drained. The ring advances one whole block per AudioBuffer_Done(). */
+    if (!g_buffer.initialised || !is_ping_pong()) {
+        return;
+    }
+    (void)consume_block(0U);
 }
 
 bool AudioBuffer_ProcessComplete(void) {
@@ -329,15 +575,11 @@ bool AudioBuffer_ProcessComplete(void) {
 }
 
 void AudioBuffer_Update(void) {
-    size_t active = atomic_load_explicit(&g_buffer.active, memory_order_relaxed);
-    update_utilisation(atomic_load_explicit(&g_buffer.valid_frames[active],
-                                            memory_order_relaxed));
+    update_utilisation(ring_queued_frames());
 }
 
 bool AudioBuffer_IsUnderThreshold(void) {
-    size_t active = atomic_load_explicit(&g_buffer.active, memory_order_relaxed);
-    return atomic_load_explicit(&g_buffer.valid_frames[active],
-                                memory_order_relaxed) <= g_buffer.low_threshold;
+    return ring_queued_frames() <= g_buffer.low_threshold;
 }
 
 void AudioBuffer_HandleUnderrun(void) {
@@ -347,16 +589,15 @@ void AudioBuffer_HandleUnderrun(void) {
     g_buffer.errors.total_underruns++;
     g_buffer.stats.underruns++;
 
-    size_t active = atomic_load_explicit(&g_buffer.active, memory_order_relaxed);
-    memset(g_buffer.data[active], 0, AUDIO_BUFFER_BYTES);
-
     g_buffer.underrun.timestamp_ms = start;
-    /* One full buffer was zero-filled; report the loss as a frame count
-     * (the public field is historically named "samples_lost"). */
-    g_buffer.underrun.samples_lost = AUDIO_BUFFER_FRAMES;
+    /* The consumer plays one silent block per starved Done(); report the loss
+     * as a frame count (the public field is historically named "samples_lost"). */
+    g_buffer.underrun.samples_lost = g_buffer.block_frames;
 
-    if (!fill_buffer(active)) {
-        atomic_store_explicit(&g_buffer.end_of_stream, true, memory_order_relaxed);
+    /* With a producer registered it already owns the refill (every Done()
+     * wakes it); filling here too would make this a second producer. */
+    if (!g_buffer.producer_wake) {
+        (void)ring_fill();
     }
 
     g_buffer.underrun.recovery_ms = platform_get_time_ms() - start;
@@ -372,6 +613,10 @@ bool AudioBuffer_Seek(size_t position_in_samples) {
     }
 
     if (g_buffer.decoder) {
+        /* A pre-roll not yet played belongs to the old position too. */
+        if (g_buffer.lookahead.preroll_owner == g_buffer.decoder) {
+            g_buffer.lookahead.preroll_owner = NULL;
+        }
         format_decoder_seek(g_buffer.decoder, position_in_samples);
         if (format_decoder_get_last_error(g_buffer.decoder) != FD_ERROR_NONE) {
             return false;
@@ -383,6 +628,19 @@ bool AudioBuffer_Seek(size_t position_in_samples) {
         }
     }
 
+    /* The track clock restarts at the target, counted at the output rate. */
+    uint64_t position = position_in_samples;
+    uint32_t source_rate = g_buffer.decoder ? format_decoder_get_sample_rate(g_buffer.decoder) : 0U;
+    if (!g_buffer.decoder) {
+        position /= AUDIO_OUT_CHANNELS;  // raw stream: interleaved samples
+    } else if (rate_needs_conversion(source_rate)) {
+        position = position * g_buffer.format.target_rate / source_rate;
+    }
+    atomic_store_explicit(&g_buffer.track_frames_played, (size_t)position,
+                          memory_order_relaxed);
+
+    /* Buffered input belongs to the old position. */
+    Resampler_Reset(&g_resampler);
     atomic_store_explicit(&g_buffer.end_of_stream, false, memory_order_relaxed);
     set_state(BUFFER_STATE_EMPTY);
     return AudioBuffer_StartPlayback();
@@ -400,6 +658,7 @@ BufferState AudioBuffer_GetState(void) {
 
 void AudioBuffer_ResetBufferStats(void) {
     memset(&g_buffer.stats, 0, sizeof(g_buffer.stats));
+    g_buffer.stats.ring_min_occupancy = g_buffer.depth;
 }
 
 void AudioBuffer_GetBufferStats(AudioBufferStats *stats) {
@@ -407,6 +666,14 @@ void AudioBuffer_GetBufferStats(AudioBufferStats *stats) {
         return;
     }
     *stats = g_buffer.stats;
+    size_t read = atomic_load_explicit(&g_buffer.read_seq, memory_order_relaxed);
+    size_t write = atomic_load_explicit(&g_buffer.write_seq, memory_order_relaxed);
+    stats->ring_depth = g_buffer.depth;
+    /* Signed: in ping-pong mode read_seq can run ahead of a late producer. */
+    ptrdiff_t ahead = (ptrdiff_t)(write - read);
+    stats->ring_occupancy = (ahead > 0) ? (size_t)ahead : 0U;
+    stats->track_frames_played = atomic_load_explicit(&g_buffer.track_frames_played,
+                                                      memory_order_relaxed);
 }
 
 void AudioBuffer_GetErrorStats(AudioBufferErrorStats *stats) {
@@ -439,7 +706,9 @@ void AudioBuffer_RegisterUnderrunCallback(void (*callback)(void)) {
 }
 
 void AudioBuffer_ConfigureThresholds(size_t low_threshold, size_t high_threshold) {
-    if (low_threshold >= high_threshold || high_threshold > AUDIO_BUFFER_FRAMES) {
+    /* Thresholds are frame counts over the whole ring, not a single block. */
+    if (low_threshold >= high_threshold ||
+        high_threshold > g_buffer.depth * g_buffer.block_frames) {
         return;
     }
     g_buffer.low_threshold = low_threshold;
@@ -456,7 +725,10 @@ void AudioBuffer_GetThresholdConfig(size_t *low_threshold,
         *high_threshold = g_buffer.high_threshold;
     }
     if (percentage) {
-        *percentage = (float)g_buffer.low_threshold / (float)AUDIO_BUFFER_FRAMES;
+        size_t capacity = g_buffer.depth * g_buffer.block_frames;
+        *percentage = (capacity == 0U)
+                          ? 0.0f
+                          : (float)g_buffer.low_threshold / (float)capacity;
     }
 }
 
@@ -485,11 +757,19 @@ void AudioBuffer_GetReadChunkConfig(size_t *min_size,
     }
 }
 
-void AudioBuffer_ConfigureSampleRate(uint32_t source_rate, uint32_t target_rate) {
+bool AudioBuffer_ConfigureSampleRate(uint32_t source_rate, uint32_t target_rate) {
+    bool convert = (source_rate != 0U) && (target_rate != 0U) && (source_rate != target_rate);
+    if (convert && !Resampler_IsSupported(source_rate, target_rate)) {
+        printf("Unsupported resampling ratio %u -> %u Hz\n",
+               (unsigned)source_rate, (unsigned)target_rate);
+        return false;
+    }
+    /* The producer picks the new rates up at its next block (resampler_sync()). */
     g_buffer.format.source_rate = source_rate;
     g_buffer.format.target_rate = target_rate;
-    g_buffer.format.conversion_enabled = (source_rate != target_rate) && (source_rate != 0U);
+    g_buffer.format.conversion_enabled = convert;
     g_buffer.format.ratio = (source_rate == 0U) ? 1.0f : (float)target_rate / (float)source_rate;
+    return true;
 }
 
 void AudioBuffer_GetSampleRateConfig(uint32_t *source_rate,
@@ -510,6 +790,26 @@ void AudioBuffer_GetSampleRateConfig(uint32_t *source_rate,
     }
 }
 
+void AudioBuffer_SetResamplerQuality(ResamplerQuality quality) {
+    if (quality >= RESAMPLER_QUALITY_COUNT) {
+        quality = RESAMPLER_QUALITY_HIGH;
+    }
+    atomic_store_explicit(&g_buffer.format.quality, (int)quality, memory_order_relaxed);
+}
+
+ResamplerQuality AudioBuffer_GetResamplerQuality(void) {
+    return (ResamplerQuality)atomic_load_explicit(&g_buffer.format.quality,
+                                                  memory_order_relaxed);
+}
+
+bool AudioBuffer_GetResamplerCost(ResamplerCost *cost) {
+    if (!cost || !atomic_load_explicit(&g_buffer.format.resampling, memory_order_relaxed)) {
+        return false;
+    }
+    Resampler_GetCost(&g_resampler, cost);
+    return true;
+}
+
 void AudioBuffer_ConfigureSampleFormat(uint8_t bits_per_sample,
                                        bool is_float,
                                        bool is_signed) {
@@ -543,13 +843,19 @@ void AudioBuffer_GetSampleFormat(uint8_t *bits_per_sample,
 bool AudioBuffer_Flush(bool reset_stats) {
     /* A flush discards in-flight audio (Skip / Previous / track change), so any
      * fade in progress and its captured tail must go too - otherwise the new
-     * track would inherit a stale fade or leak the incoming decoder. */
+     * track would inherit a stale fade or leak the incoming decoder. The
+     * pre-opened next track was picked relative to the old one. */
     crossfade_abort();
+    lookahead_discard();
+    Resampler_Reset(&g_resampler);
     memset(g_buffer.data, 0, sizeof(g_buffer.data));
-    for (size_t i = 0; i < DMA_BUFFER_COUNT; i++) {
+    for (size_t i = 0; i < RING_SLOT_COUNT; i++) {
         atomic_store_explicit(&g_buffer.valid_frames[i], 0U, memory_order_relaxed);
+        atomic_store_explicit(&g_buffer.track_start[i], NO_TRACK_START, memory_order_relaxed);
     }
-    atomic_store_explicit(&g_buffer.active, 0U, memory_order_release);
+    atomic_store_explicit(&g_buffer.track_frames_played, 0U, memory_order_relaxed);
+    atomic_store_explicit(&g_buffer.read_seq, 0U, memory_order_relaxed);
+    atomic_store_explicit(&g_buffer.write_seq, 0U, memory_order_release);
     atomic_store_explicit(&g_buffer.end_of_stream, false, memory_order_relaxed);
     set_state(BUFFER_STATE_EMPTY);
 
@@ -605,16 +911,16 @@ bool AudioBuffer_SetDecoder(FormatDecoder* decoder) {
         return false;
     }
 
-    /* Swapping the primary decoder invalidates any in-flight fade. */
+    /* Swapping the primary decoder invalidates any in-flight fade and the
+     * look-ahead opened for its successor. */
     crossfade_abort();
+    lookahead_discard();
 
     // Clean up existing decoder
-    if (g_buffer.decoder) {
-        format_decoder_close(g_buffer.decoder);
-        format_decoder_destroy(g_buffer.decoder);
-    }
+    release_decoder(g_buffer.decoder);
 
     g_buffer.decoder = decoder;
+    Resampler_Reset(&g_resampler);
     atomic_store_explicit(&g_buffer.end_of_stream, false, memory_order_relaxed);
     set_state(BUFFER_STATE_EMPTY);
     return true;
@@ -622,11 +928,9 @@ bool AudioBuffer_SetDecoder(FormatDecoder* decoder) {
 
 void AudioBuffer_ClearDecoder(void) {
     crossfade_abort();
-    if (g_buffer.decoder) {
-        format_decoder_close(g_buffer.decoder);
-        format_decoder_destroy(g_buffer.decoder);
-        g_buffer.decoder = NULL;
-    }
+    lookahead_discard();
+    release_decoder(g_buffer.decoder);
+    g_buffer.decoder = NULL;
     atomic_store_explicit(&g_buffer.end_of_stream, false, memory_order_relaxed);
     set_state(BUFFER_STATE_EMPTY);
 }
@@ -654,6 +958,23 @@ void AudioBuffer_SetNextTrackProvider(AudioBufferNextTrackProvider provider,
     g_buffer.next_track_user_data = user_data;
 }
 
+void AudioBuffer_SetLookAheadProvider(AudioBufferLookAheadOpen open,
+                                      AudioBufferLookAheadCommit commit,
+                                      void* user_data) {
+    /* Set on the control thread before playback, like the next-track provider. */
+    g_buffer.lookahead.open = open;
+    g_buffer.lookahead.commit = commit;
+    g_buffer.lookahead.user_data = user_data;
+}
+
+void AudioBuffer_SetLookAheadMs(uint32_t ms) {
+    atomic_store_explicit(&g_buffer.lookahead.window_ms, ms, memory_order_relaxed);
+}
+
+uint32_t AudioBuffer_GetLookAheadMs(void) {
+    return atomic_load_explicit(&g_buffer.lookahead.window_ms, memory_order_relaxed);
+}
+
 uint32_t AudioBuffer_GetTrackChangeCount(void) {
     return atomic_load_explicit(&g_buffer.track_change_count, memory_order_relaxed);
 }
@@ -683,13 +1004,61 @@ uint32_t AudioBuffer_GetCrossfadeFrames(void) {
                                 memory_order_relaxed);
 }
 
+void AudioBuffer_SetCrossfadeRegion(void* base, size_t bytes) {
+    /* Control thread, before playback: the producer re-carves the tail from
+     * it at the next block (tail_configure()). */
+    g_buffer.crossfade_region = base;
+    g_buffer.crossfade_region_bytes = base ? bytes : 0U;
+    g_buffer.crossfade.tail = NULL;
+    g_buffer.crossfade.tail_capacity = 0U;
+    g_buffer.crossfade.tail_count = 0U;
+    g_buffer.crossfade.tail_head = 0U;
+}
+
+void AudioBuffer_GetMemoryReport(AudioBufferMemoryReport* report) {
+    if (!report) {
+        return;
+    }
+    uint32_t fade_frames = atomic_load_explicit(&g_buffer.crossfade.target_frames,
+                                                memory_order_relaxed);
+    size_t tail_frames = crossfade_tail_frames(fade_frames);
+    report->ring_bytes = sizeof(g_buffer.data);
+    report->scratch_bytes = (DECODE_SCRATCH_SAMPLES + STEREO_SCRATCH_SAMPLES) * sizeof(float);
+    report->resampler_bytes = sizeof(g_resampler);
+    report->lookahead_bytes = sizeof(g_buffer.lookahead.preroll);
+    report->crossfade_region_bytes = g_buffer.crossfade_region_bytes;
+    report->crossfade_tail_bytes = tail_frames * AUDIO_BUFFER_CROSSFADE_FRAME_BYTES;
+    report->crossfade_frames = (uint32_t)tail_frames;
+}
+
+void AudioBuffer_PrintMemoryReport(void) {
+    AudioBufferMemoryReport report;
+    AudioBuffer_GetMemoryReport(&report);
+    printf("Audio buffer memory: ring %zu B, scratch %zu B, resampler %zu B, "
+           "look-ahead %zu B\n",
+           report.ring_bytes, report.scratch_bytes, report.resampler_bytes,
+           report.lookahead_bytes);
+    printf("Crossfade: %zu B of %zu B region for %u frames\n",
+           report.crossfade_tail_bytes, report.crossfade_region_bytes,
+           (unsigned)report.crossfade_frames);
+}
+
 static void reset_internal_state(void) {
-    /* The producer wake is a platform binding, not buffer state - keep it across
-     * resets (Init/Cleanup/Flush) so the producer stays wired. fill_pending is
-     * cleared by the memset, which is what we want. */
+    /* The wakes, output mode and crossfade region are platform bindings, not
+     * buffer state - keep them across resets (Init/Cleanup/Flush) so the
+     * producer stays wired. The ring sequence numbers are cleared by the
+     * memset, which is what we want. */
     void (*saved_wake)(void) = g_buffer.producer_wake;
+    void (*saved_track_change_wake)(void) = g_buffer.track_change_wake;
+    AudioBufferMode saved_mode = g_buffer.mode;
+    void* saved_region = g_buffer.crossfade_region;
+    size_t saved_region_bytes = g_buffer.crossfade_region_bytes;
     memset(&g_buffer, 0, sizeof(g_buffer));
     g_buffer.producer_wake = saved_wake;
+    g_buffer.track_change_wake = saved_track_change_wake;
+    g_buffer.mode = saved_mode;
+    g_buffer.crossfade_region = saved_region;
+    g_buffer.crossfade_region_bytes = saved_region_bytes;
     g_buffer.low_threshold = AUDIO_BUFFER_LOW_WATER_MARK;
     g_buffer.high_threshold = AUDIO_BUFFER_FRAMES;
     g_buffer.read_cfg.min_bytes = AUDIO_BUFFER_BYTES / 4U;
@@ -702,8 +1071,14 @@ static void reset_internal_state(void) {
     g_buffer.format.source_rate = 0U;
     g_buffer.format.target_rate = 0U;
     g_buffer.format.ratio = 1.0f;
+    atomic_store_explicit(&g_buffer.format.quality, (int)RESAMPLER_QUALITY_MEDIUM,
+                          memory_order_relaxed);
+    Resampler_Reset(&g_resampler);
     g_buffer.next_track_available = false;
     g_buffer.decoder = NULL;
+    g_buffer.depth = AUDIO_BUFFER_DEFAULT_BLOCKS;
+    g_buffer.block_frames = AUDIO_BUFFER_FRAMES;
+    g_buffer.kernels = PcmKernels_Best();
 
     /* Default master volume is 100% == bit-exact passthrough so nothing
      * regresses; start the ramp already at unity to avoid a fade-in. */
@@ -713,98 +1088,290 @@ static void reset_internal_state(void) {
 
     g_buffer.next_track_provider = NULL;
     g_buffer.next_track_user_data = NULL;
+    atomic_store_explicit(&g_buffer.lookahead.window_ms, AUDIO_BUFFER_LOOKAHEAD_DEFAULT_MS,
+                          memory_order_relaxed);
     atomic_store_explicit(&g_buffer.track_change_count, 0U, memory_order_relaxed);
     g_buffer.track_change_seen = 0U;
 }
 
+/* Close and free a decoder, forgetting any pre-roll it still owns (a later
+ * decoder may be allocated at the same address). */
+static void release_decoder(FormatDecoder* decoder) {
+    if (!decoder) {
+        return;
+    }
+    if (g_buffer.lookahead.preroll_owner == decoder) {
+        g_buffer.lookahead.preroll_owner = NULL;
+    }
+    format_decoder_close(decoder);
+    format_decoder_destroy(decoder);
+}
+
+/* Drop the decoder pre-opened for the next track, if any. */
+static void lookahead_discard(void) {
+    release_decoder(g_buffer.lookahead.next);
+    g_buffer.lookahead.next = NULL;
+    g_buffer.lookahead.attempted = false;
+}
+
 /*
- * Gapless transition: the active decoder has hit EOF. Ask the registered
- * provider for the next track's decoder. On success, the old decoder is
- * destroyed, the new one installed, the track-change counter bumped, and true
- * is returned so the caller keeps filling the *same* output buffer from the new
- * decoder - no silence gap. Returns false when there is no provider or no next
- * track (true end of library), leaving the caller to zero-pad and stop.
+ * Decoder reads for the producer. Frames pre-rolled by the look-ahead are
+ * handed out first, then the decoder continues where the pre-roll stopped.
  */
-static bool advance_to_next_track(void) {
+static size_t preroll_take(const FormatDecoder* decoder, size_t frames) {
+    if (g_buffer.lookahead.preroll_owner != decoder) {
+        return 0U;
+    }
+    size_t available = g_buffer.lookahead.preroll_frames - g_buffer.lookahead.preroll_pos;
+    return (frames < available) ? frames : available;
+}
+
+static void preroll_consume(size_t frames) {
+    g_buffer.lookahead.preroll_pos += frames;
+    if (g_buffer.lookahead.preroll_pos >= g_buffer.lookahead.preroll_frames) {
+        g_buffer.lookahead.preroll_owner = NULL;
+    }
+}
+
+static size_t decoder_read(FormatDecoder* decoder, float* buffer, size_t frames) {
+    size_t taken = preroll_take(decoder, frames);
+    if (taken > 0U) {
+        const uint32_t channels = g_buffer.lookahead.preroll_channels;
+        const size_t first = g_buffer.lookahead.preroll_pos * channels;
+        const size_t count = taken * channels;
+        if (g_buffer.lookahead.preroll_s16) {
+            for (size_t i = 0; i < count; i++) {
+                buffer[i] = (float)g_buffer.lookahead.preroll.s16[first + i] * PREROLL_S16_TO_FLOAT;
+            }
+        } else {
+            memcpy(buffer, &g_buffer.lookahead.preroll.f32[first], count * sizeof(float));
+        }
+        preroll_consume(taken);
+        if (taken == frames) {
+            return taken;
+        }
+        buffer += count;
+    }
+    return taken + format_decoder_read(decoder, buffer, frames - taken);
+}
+
+static size_t decoder_read_s16(FormatDecoder* decoder, int16_t* buffer, size_t frames) {
+    size_t taken = preroll_take(decoder, frames);
+    if (taken > 0U) {
+        const size_t count = taken * AUDIO_OUT_CHANNELS;
+        memcpy(buffer,
+               &g_buffer.lookahead.preroll.s16[g_buffer.lookahead.preroll_pos * AUDIO_OUT_CHANNELS],
+               count * sizeof(int16_t));
+        preroll_consume(taken);
+        if (taken == frames) {
+            return taken;
+        }
+        buffer += count;
+    }
+    return taken + format_decoder_read_s16(decoder, buffer, frames - taken);
+}
+
+/* A float pre-roll must be read back through decoder_read(). */
+static inline bool preroll_is_float(const FormatDecoder* decoder) {
+    return g_buffer.lookahead.preroll_owner == decoder && !g_buffer.lookahead.preroll_s16;
+}
+
+/* Decode the first block of a freshly opened decoder into the side buffer. */
+static void lookahead_preroll(FormatDecoder* decoder) {
+    uint32_t channels = format_decoder_get_channels(decoder);
+    if (channels == 0U) {
+        channels = AUDIO_OUT_CHANNELS;
+    }
+    if (channels > 8U) {
+        return;  // the producer will refuse it anyway
+    }
+    size_t frames = g_buffer.block_frames;
+    if (frames > STEREO_SCRATCH_SAMPLES / channels) {
+        frames = STEREO_SCRATCH_SAMPLES / channels;
+    }
+    const bool s16 = (channels == AUDIO_OUT_CHANNELS) && format_decoder_supports_s16(decoder);
+    size_t got = s16 ? format_decoder_read_s16(decoder, g_buffer.lookahead.preroll.s16, frames)
+                     : format_decoder_read(decoder, g_buffer.lookahead.preroll.f32, frames);
+    g_buffer.lookahead.preroll_s16 = s16;
+    g_buffer.lookahead.preroll_channels = channels;
+    g_buffer.lookahead.preroll_frames = got;
+    g_buffer.lookahead.preroll_pos = 0U;
+    g_buffer.lookahead.preroll_owner = (got > 0U) ? decoder : NULL;
+}
+
+/*
+ * Producer-side, after the ring has been topped up: once the current decoder
+ * is inside the look-ahead window, open its successor and pre-roll it. The
+ * ring is full at this point, so the open has a whole ring of audio as slack
+ * instead of the remainder of one block.
+ */
+static void lookahead_service(void) {
+    FormatDecoder* current = g_buffer.decoder;
+    uint32_t window_ms = atomic_load_explicit(&g_buffer.lookahead.window_ms,
+                                              memory_order_relaxed);
+    if (!g_buffer.lookahead.open || window_ms == 0U || !current ||
+        g_buffer.lookahead.next || g_buffer.lookahead.attempted ||
+        g_buffer.crossfade.in_progress ||
+        atomic_load_explicit(&g_buffer.end_of_stream, memory_order_relaxed)) {
+        return;
+    }
+
+    /* Unknown length: open right away rather than risk missing the window. */
+    size_t total = format_decoder_get_total_frames(current);
+    if (total > 0U) {
+        uint64_t window = (uint64_t)window_ms * format_decoder_get_sample_rate(current) / 1000U;
+        size_t position = format_decoder_get_position(current);
+        size_t remaining = (total > position) ? (total - position) : 0U;
+        if ((uint64_t)remaining > window) {
+            return;
+        }
+    }
+
+    g_buffer.lookahead.attempted = true;
+    FormatDecoder* next = g_buffer.lookahead.open(g_buffer.lookahead.user_data);
+    if (!next) {
+        return;  // end of library, or unreadable: the EOF path decides
+    }
+    lookahead_preroll(next);
+    g_buffer.lookahead.next = next;
+}
+
+/*
+ * Producer-side: the decoder for the track after the current one. Takes the
+ * pre-opened look-ahead decoder when there is one (no I/O: the library is
+ * only told it is now current), otherwise opens it through the next-track
+ * provider right here. NULL at the end of the library.
+ */
+static FormatDecoder* next_track_decoder(void) {
+    FormatDecoder* next = g_buffer.lookahead.next;
+    g_buffer.lookahead.next = NULL;
+    g_buffer.lookahead.attempted = false;
+    if (next) {
+        if (g_buffer.lookahead.commit) {
+            g_buffer.lookahead.commit(g_buffer.lookahead.user_data);
+        }
+        g_buffer.stats.lookahead_hits++;
+        return next;
+    }
     if (!g_buffer.next_track_provider) {
-        return false;
+        return NULL;
+    }
+    next = g_buffer.next_track_provider(g_buffer.next_track_user_data);
+    if (next) {
+        g_buffer.stats.lookahead_misses++;
     }
+    return next;
+}
 
-    FormatDecoder* next = g_buffer.next_track_provider(g_buffer.next_track_user_data);
+/*
+ * Gapless transition: the active decoder has hit EOF. Take the next track's
+ * decoder (pre-opened by the look-ahead, or from the provider). On success,
+ * the old decoder is destroyed, the new one installed, the track-change
+ * counter bumped, and true is returned so the caller keeps filling the *same*
+ * output buffer from the new decoder - no silence gap. Returns false when
+ * there is no next track (true end of library), leaving the caller to
+ * zero-pad and stop.
+ */
+static bool advance_to_next_track(void) {
+    FormatDecoder* next = next_track_decoder();
     if (!next) {
         return false;  // end of library: drain cleanly
     }
 
-    if (g_buffer.decoder) {
-        format_decoder_close(g_buffer.decoder);
-        format_decoder_destroy(g_buffer.decoder);
-    }
+    release_decoder(g_buffer.decoder);
     g_buffer.decoder = next;
 
     /* Publish the transition so a UI poll loop can refresh "Now Playing". */
-    atomic_fetch_add_explicit(&g_buffer.track_change_count, 1U,
-                              memory_order_relaxed);
+    publish_track_change();
     return true;
 }
 
+/* True when audio decoded at 'source_rate' must be converted for the output. */
+static inline bool rate_needs_conversion(uint32_t source_rate) {
+    uint32_t target_rate = g_buffer.format.target_rate;
+    return (target_rate != 0U) && (source_rate != 0U) && (source_rate != target_rate);
+}
+
 /*
- * Downmix one decoded interleaved frame (any channel count, already validated
- * <= 8) to a stereo float pair. Mirrors the per-frame mixing in fill_buffer so
- * the gapless and crossfade paths share one definition.
+ * Producer-side: bring the resampler in line with the active decoder and the
+ * requested quality tier. Returns true when this block's audio must go through
+ * it. The filter is only redesigned when the source rate or the tier changes,
+ * so a gapless run of same-rate tracks streams through one continuous filter
+ * state; a swap to another rate restarts it (dropping at most half a window
+ * of the outgoing track's last frames).
  */
-static inline void downmix_frame(const float* frame, uint32_t channels,
-                                 float* out_left, float* out_right) {
-    float left;
-    float right;
-    if (channels == 1U) {
-        left = frame[0];
-        right = frame[0];
-    } else if (channels == 2U) {
-        left = frame[0];
-        right = frame[1];
-    } else {
-        left = frame[0];
-        right = frame[1];
-        for (uint32_t ch = 2U; ch < channels; ch++) {
-            float sample = frame[ch];
-            left += sample;
-            right += sample;
+static bool resampler_sync(uint32_t source_rate) {
+    bool convert = rate_needs_conversion(source_rate);
+    if (convert) {
+        ResamplerQuality quality = (ResamplerQuality)atomic_load_explicit(
+            &g_buffer.format.quality, memory_order_relaxed);
+        if (g_resampler.in_rate != source_rate ||
+            g_resampler.out_rate != g_buffer.format.target_rate ||
+            g_buffer.format.quality_in_use != quality) {
+            if (source_rate == g_buffer.format.rejected_rate) {
+                convert = false;  // already reported; play it unconverted
+            } else if (Resampler_Configure(&g_resampler, source_rate,
+                                           g_buffer.format.target_rate, quality)) {
+                g_buffer.format.quality_in_use = quality;
+            } else {
+                printf("Cannot resample %u -> %u Hz; playing at the source rate\n",
+                       (unsigned)source_rate, (unsigned)g_buffer.format.target_rate);
+                g_buffer.format.rejected_rate = source_rate;
+                convert = false;
+            }
         }
-        float scale = 1.0f / (float)channels;
-        left *= scale;
-        right *= scale;
     }
-    *out_left = left;
-    *out_right = right;
+    if (!convert && atomic_load_explicit(&g_buffer.format.resampling, memory_order_relaxed)) {
+        /* Left over from the previous track; must not leak into a later one. */
+        Resampler_Reset(&g_resampler);
+    }
+    atomic_store_explicit(&g_buffer.format.resampling, convert, memory_order_relaxed);
+    return convert;
 }
 
-/* Clamp a stereo float pair to [-1,1], quantise to S16 and write it at the
- * given frame offset of the destination buffer. */
-static inline void write_stereo_frame(size_t index, size_t frame_offset,
-                                      float left, float right) {
-    if (left > 1.0f) left = 1.0f;
-    if (left < -1.0f) left = -1.0f;
-    if (right > 1.0f) right = 1.0f;
-    if (right < -1.0f) right = -1.0f;
+/* Tail frames the registered region can hold for a fade of 'fade_frames'. */
+static size_t crossfade_tail_frames(uint32_t fade_frames) {
+    size_t region_frames = g_buffer.crossfade_region_bytes / AUDIO_BUFFER_CROSSFADE_FRAME_BYTES;
+    return (fade_frames < region_frames) ? fade_frames : region_frames;
+}
 
-    int16_t left_i = (int16_t)(left * 32767.0f);
-    int16_t right_i = (int16_t)(right * 32767.0f);
-    size_t out_index = frame_offset * AUDIO_OUT_CHANNELS;
-    g_buffer.data[index][out_index] = (uint16_t)left_i;
-    g_buffer.data[index][out_index + 1U] = (uint16_t)right_i;
+/*
+ * Producer-side: carve the tail ring out of the crossfade region for the
+ * armed fade length (or release it when crossfade is disabled). Only called
+ * between fades, since it restarts the captured tail.
+ */
+static void tail_configure(size_t capacity) {
+    g_buffer.crossfade.tail = (capacity > 0U) ? (int16_t*)g_buffer.crossfade_region : NULL;
+    g_buffer.crossfade.tail_capacity = capacity;
+    g_buffer.crossfade.tail_count = 0U;
+    g_buffer.crossfade.tail_head = 0U;
 }
 
-/* Append one already-volume-scaled stereo frame to the crossfade tail ring so
- * it is available as outgoing-track tail if the decoder hits EOF soon. Only
- * worth maintaining while a fade length is armed. */
-static inline void tail_push(float left, float right) {
-    float* slot = &g_buffer.crossfade.tail[g_buffer.crossfade.tail_head * AUDIO_OUT_CHANNELS];
-    slot[0] = left;
-    slot[1] = right;
-    g_buffer.crossfade.tail_head =
-        (g_buffer.crossfade.tail_head + 1U) % CROSSFADE_MAX_FRAMES;
-    if (g_buffer.crossfade.tail_count < CROSSFADE_MAX_FRAMES) {
-        g_buffer.crossfade.tail_count++;
+/* Append already-volume-scaled S16 frames (as written to a ring slot) to the
+ * crossfade tail ring so they are available as outgoing-track tail if the
+ * decoder hits EOF soon. Only worth maintaining while a fade length is armed. */
+static void tail_push(const int16_t* frames, size_t count) {
+    const size_t capacity = g_buffer.crossfade.tail_capacity;
+    if (capacity == 0U || count == 0U) {
+        return;
+    }
+    if (count > capacity) {
+        frames += (count - capacity) * AUDIO_OUT_CHANNELS;
+        count = capacity;
+    }
+    size_t head = g_buffer.crossfade.tail_head;
+    size_t first = capacity - head;
+    if (first > count) {
+        first = count;
+    }
+    memcpy(&g_buffer.crossfade.tail[head * AUDIO_OUT_CHANNELS], frames,
+           first * AUDIO_BUFFER_CROSSFADE_FRAME_BYTES);
+    memcpy(g_buffer.crossfade.tail, &frames[first * AUDIO_OUT_CHANNELS],
+           (count - first) * AUDIO_BUFFER_CROSSFADE_FRAME_BYTES);
+    g_buffer.crossfade.tail_head = (head + count) % capacity;
+    g_buffer.crossfade.tail_count += count;
+    if (g_buffer.crossfade.tail_count > capacity) {
+        g_buffer.crossfade.tail_count = capacity;
     }
 }
 
@@ -822,19 +1389,16 @@ static inline void tail_window_at(uint32_t i, float* left, float* right) {
         *right = 0.0f;
         return;
     }
-    size_t idx = (g_buffer.crossfade.tail_anchor + i) % CROSSFADE_MAX_FRAMES;
-    const float* slot = &g_buffer.crossfade.tail[idx * AUDIO_OUT_CHANNELS];
-    *left = slot[0];
-    *right = slot[1];
+    size_t idx = (g_buffer.crossfade.tail_anchor + i) % g_buffer.crossfade.tail_capacity;
+    const int16_t* slot = &g_buffer.crossfade.tail[idx * AUDIO_OUT_CHANNELS];
+    *left = (float)slot[0] * S16_TO_FLOAT;
+    *right = (float)slot[1] * S16_TO_FLOAT;
 }
 
 /* Discard the incoming decoder held for a fade, if any. */
 static void crossfade_release_incoming(void) {
-    if (g_buffer.crossfade.incoming) {
-        format_decoder_close(g_buffer.crossfade.incoming);
-        format_decoder_destroy(g_buffer.crossfade.incoming);
-        g_buffer.crossfade.incoming = NULL;
-    }
+    release_decoder(g_buffer.crossfade.incoming);
+    g_buffer.crossfade.incoming = NULL;
 }
 
 /*
@@ -857,27 +1421,25 @@ static void crossfade_abort(void) {
 }
 
 /*
- * Begin a crossfade after the outgoing decoder hit EOF. Pulls the incoming
- * decoder from the next-track provider and arms the fade window. Returns true
- * if a fade was started (incoming decoder installed, track-change published),
- * false if there is no next track or no captured tail to fade against - in
- * which case the caller falls back to the plain gapless swap / drain.
+ * Begin a crossfade after the outgoing decoder hit EOF. Takes the incoming
+ * decoder (see next_track_decoder()) and arms the fade window. Returns true
+ * once the transition is made: normally a fade was started (incoming decoder
+ * held, track-change published), but an incoming track the fade cannot mix is
+ * swapped in directly instead. Returns false if there is no next track or no
+ * captured tail to fade against - in which case the caller falls back to the
+ * plain gapless swap / drain.
  *
- * NOTE: the next-track provider both advances the music library AND opens the
- * decoder, so calling it here performs the same library advance the gapless
- * path would. The fade then plays the incoming head while fading the captured
- * outgoing tail; afterwards g_buffer.decoder is swapped to this incoming
- * decoder and normal filling resumes.
+ * NOTE: taking the incoming decoder performs the same library advance the
+ * gapless path would. The fade then plays the incoming head while fading the
+ * captured outgoing tail; afterwards g_buffer.decoder is swapped to this
+ * incoming decoder and normal filling resumes.
  */
 static bool crossfade_begin(uint32_t fade_frames) {
     if (fade_frames == 0U || g_buffer.crossfade.tail_count == 0U) {
         return false;
     }
-    if (!g_buffer.next_track_provider) {
-        return false;
-    }
 
-    FormatDecoder* incoming = g_buffer.next_track_provider(g_buffer.next_track_user_data);
+    FormatDecoder* incoming = next_track_decoder();
     if (!incoming) {
         return false;  // end of library: no fade, drain cleanly
     }
@@ -886,17 +1448,15 @@ static bool crossfade_begin(uint32_t fade_frames) {
     if (channels == 0U) {
         channels = AUDIO_OUT_CHANNELS;
     }
-    if (channels > 8U) {
-        /* Cannot mix an unsupported layout; abandon the fade and let the plain
-         * gapless path take over by swapping straight to this decoder. */
-        if (g_buffer.decoder) {
-            format_decoder_close(g_buffer.decoder);
-            format_decoder_destroy(g_buffer.decoder);
-        }
+    if (channels > 8U ||
+        rate_needs_conversion(format_decoder_get_sample_rate(incoming))) {
+        /* Cannot mix an unsupported layout, and the fade mixes the incoming
+         * head at the output rate; abandon the fade and let the plain gapless
+         * path take over (resampling it) by swapping straight to this decoder. */
+        release_decoder(g_buffer.decoder);
         g_buffer.decoder = incoming;
-        atomic_fetch_add_explicit(&g_buffer.track_change_count, 1U,
-                                  memory_order_relaxed);
-        return false;
+        publish_track_change();
+        return true;
     }
 
     /* Clamp the fade to however much outgoing tail we actually captured (a
@@ -910,8 +1470,8 @@ static bool crossfade_begin(uint32_t fade_frames) {
      * the fade's duration, so this anchor stays valid and is read by absolute
      * offset in crossfade_emit(). */
     g_buffer.crossfade.tail_anchor =
-        (g_buffer.crossfade.tail_head + CROSSFADE_MAX_FRAMES - fade_frames)
-        % CROSSFADE_MAX_FRAMES;
+        (g_buffer.crossfade.tail_head + g_buffer.crossfade.tail_capacity - fade_frames)
+        % g_buffer.crossfade.tail_capacity;
     g_buffer.crossfade.tail_window = fade_frames;
 
     g_buffer.crossfade.incoming = incoming;
@@ -921,8 +1481,7 @@ static bool crossfade_begin(uint32_t fade_frames) {
 
     /* Publish the transition now so the UI refreshes "Now Playing" at the
      * point the incoming track becomes audible (start of the fade). */
-    atomic_fetch_add_explicit(&g_buffer.track_change_count, 1U,
-                              memory_order_relaxed);
+    publish_track_change();
     return true;
 }
 
@@ -934,14 +1493,16 @@ static bool crossfade_begin(uint32_t fade_frames) {
  *     t in [0,1]:  gain_out = cos(t * PI/2),  gain_in = sin(t * PI/2)
  *     gain_out^2 + gain_in^2 == 1  ->  constant summed power, no mid-fade dip.
  *
- * Incoming frames are decoded one block at a time into 'scratch' and already
- * have master volume applied (the tail was captured post-volume too, so both
+ * Incoming frames are decoded one block at a time into 'scratch', downmixed
+ * into 'stereo' (at most AUDIO_BUFFER_FRAMES frames) and already have master
+ * volume applied (the tail was captured post-volume too, so both
  * sides share the same gain). Writes up to 'max_frames' frames; returns the
  * number written. Sets *fade_done when the window is exhausted. If the incoming
  * decoder unexpectedly ends mid-fade, the fade is cut short and *fade_done set.
  */
 static size_t crossfade_emit(size_t index, size_t out_frame, size_t max_frames,
-                             float gain, float* scratch, bool* fade_done) {
+                             float gain, float* scratch, float* stereo,
+                             bool* fade_done) {
     *fade_done = false;
     size_t written = 0U;
     uint32_t total = g_buffer.crossfade.active_frames;
@@ -958,7 +1519,7 @@ static size_t crossfade_emit(size_t index, size_t out_frame, size_t max_frames,
             want = remaining;
         }
 
-        size_t got = format_decoder_read(g_buffer.crossfade.incoming, scratch, want);
+        size_t got = decoder_read(g_buffer.crossfade.incoming, scratch, want);
         if (got == 0U) {
             /* Incoming track is shorter than the fade window: end the fade
              * early; the outgoing tail simply finishes faded out. */
@@ -966,12 +1527,12 @@ static size_t crossfade_emit(size_t index, size_t out_frame, size_t max_frames,
             break;
         }
 
+        g_buffer.kernels->downmix_to_stereo(scratch, channels, stereo, got, gain);
+
         for (size_t i = 0; i < got; i++) {
-            float in_l;
-            float in_r;
-            downmix_frame(&scratch[i * channels], channels, &in_l, &in_r);
-            in_l *= gain;
-            in_r *= gain;
+            float* frame = &stereo[i * AUDIO_OUT_CHANNELS];
+            float in_l = frame[0];
+            float in_r = frame[1];
 
             /* Outgoing tail frame at this fade position (frozen window). */
             float out_l;
@@ -986,16 +1547,18 @@ static size_t crossfade_emit(size_t index, size_t out_frame, size_t max_frames,
             float g_out = cosf(t * 1.57079632679f);
             float g_in = sinf(t * 1.57079632679f);
 
-            float left = out_l * g_out + in_l * g_in;
-            float right = out_r * g_out + in_r * g_in;
+            frame[0] = out_l * g_out + in_l * g_in;
+            frame[1] = out_r * g_out + in_r * g_in;
 
             /* Do NOT push to the tail ring during a fade: the frozen window
              * anchored in crossfade_begin() must stay intact. Normal tail
              * capture resumes once the incoming decoder becomes primary. */
-
-            write_stereo_frame(index, out_frame + written + i, left, right);
             g_buffer.crossfade.pos++;
         }
+
+        /* Volume is already in both sides of the mix: quantise at unity. */
+        int16_t* dst = (int16_t*)&slot_samples(index)[(out_frame + written) * AUDIO_OUT_CHANNELS];
+        g_buffer.kernels->f32_to_s16(stereo, dst, got * AUDIO_OUT_CHANNELS, 1.0f);
         written += got;
     }
 
@@ -1008,31 +1571,35 @@ static size_t crossfade_emit(size_t index, size_t out_frame, size_t max_frames,
 static bool fill_buffer(size_t index) {
     /* Snapshot the master-volume gain once per block (ramped toward target). */
     const float gain = advance_volume_gain();
+    const int32_t gain_q15 = gain_to_q15(gain);
+
+    uint16_t *const out = slot_samples(index);
+    const size_t block_frames = g_buffer.block_frames;
+    const size_t block_samples = block_frames * AUDIO_OUT_CHANNELS;
 
     if (!g_buffer.decoder) {
         // Fallback to raw data reading if no decoder
-        size_t bytes_read = FileSystem_ReadAudioData(g_buffer.data[index], AUDIO_BUFFER_BYTES);
+        size_t bytes_read = FileSystem_ReadAudioData(out, block_samples * sizeof(uint16_t));
         size_t samples_read = bytes_read / sizeof(uint16_t);
         size_t frames_read = samples_read / AUDIO_OUT_CHANNELS;
 
         /* Apply master volume to the raw S16 stream as well. Skip the scan at
          * unity gain so the default path stays bit-exact. */
-        if (gain < 1.0f) {
-            for (size_t s = 0; s < samples_read; s++) {
-                int16_t v = (int16_t)g_buffer.data[index][s];
-                g_buffer.data[index][s] = (uint16_t)(int16_t)((float)v * gain);
-            }
+        if (gain_q15 < PCM_Q15_UNITY) {
+            g_buffer.kernels->s16_gain_q15((int16_t *)out, samples_read, gain_q15);
         }
 
-        if (samples_read < AUDIO_BUFFER_SIZE) {
-            size_t remaining = AUDIO_BUFFER_SIZE - samples_read;
-            memset(&g_buffer.data[index][samples_read], 0, remaining * sizeof(uint16_t));
+        if (samples_read < block_samples) {
+            size_t remaining = block_samples - samples_read;
+            memset(&out[samples_read], 0, remaining * sizeof(uint16_t));
             atomic_store_explicit(&g_buffer.end_of_stream, (frames_read == 0U),
                                   memory_order_relaxed);
         }
 
         atomic_store_explicit(&g_buffer.valid_frames[index], frames_read,
                               memory_order_relaxed);
+        atomic_store_explicit(&g_buffer.track_start[index], NO_TRACK_START,
+                              memory_order_relaxed);
         g_buffer.stats.total_samples += frames_read;
         return frames_read > 0U;
     }
@@ -1040,33 +1607,43 @@ static bool fill_buffer(size_t index) {
     // Use format decoder to get decoded audio data (downmix to stereo if needed)
     size_t frames_read_total = 0;
 
-    static float decode_buffer[AUDIO_BUFFER_FRAMES * 8U];
+    /* A block that crosses a track boundary is timed: with the look-ahead it
+     * should cost no more than any other block. */
+    const uint32_t fill_start_ms = platform_get_time_ms();
+    bool track_changed = false;
+    size_t track_start = NO_TRACK_START;  // frame where the new track begins
+
+    static float decode_buffer[DECODE_SCRATCH_SAMPLES];
+    static float stereo_buffer[STEREO_SCRATCH_SAMPLES];
 
     /* Snapshot the armed fade length once per fill. While > 0 the producer
      * captures a tail ring so it can crossfade on EOF; 0 keeps the existing
-     * hard-cut gapless behaviour with no tail bookkeeping. */
+     * hard-cut gapless behaviour with no tail bookkeeping. A changed length
+     * re-sizes the tail between fades. */
     const uint32_t fade_frames = atomic_load_explicit(
         &g_buffer.crossfade.target_frames, memory_order_relaxed);
-    const bool crossfade_armed = (fade_frames > 0U);
+    if (!g_buffer.crossfade.in_progress &&
+        crossfade_tail_frames(fade_frames) != g_buffer.crossfade.tail_capacity) {
+        tail_configure(crossfade_tail_frames(fade_frames));
+    }
+    const bool crossfade_armed = (g_buffer.crossfade.tail_capacity > 0U);
 
-    while (frames_read_total < AUDIO_BUFFER_FRAMES) {
+    while (frames_read_total < block_frames) {
         /* If a crossfade is mid-flight, finish (or advance) its window before
          * decoding any more of the incoming track normally. */
         if (g_buffer.crossfade.in_progress) {
             bool fade_done = false;
             size_t emitted = crossfade_emit(index, frames_read_total,
-                                            AUDIO_BUFFER_FRAMES - frames_read_total,
-                                            gain, decode_buffer, &fade_done);
+                                            block_frames - frames_read_total,
+                                            gain, decode_buffer, stereo_buffer,
+                                            &fade_done);
             frames_read_total += emitted;
             if (fade_done) {
                 /* Fade complete: promote the incoming decoder to the primary
                  * decoder and resume normal filling from where the head left
                  * off. The outgoing decoder was already closed in
                  * crossfade_begin()'s provider call path; close nothing else. */
-                if (g_buffer.decoder) {
-                    format_decoder_close(g_buffer.decoder);
-                    format_decoder_destroy(g_buffer.decoder);
-                }
+                release_decoder(g_buffer.decoder);
                 g_buffer.decoder = g_buffer.crossfade.incoming;
                 g_buffer.crossfade.incoming = NULL;
                 g_buffer.crossfade.in_progress = false;
@@ -1091,9 +1668,56 @@ static bool fill_buffer(size_t index) {
             break;  // stop filling; zero-pad below
         }
 
-        size_t frames_to_read = AUDIO_BUFFER_FRAMES - frames_read_total;
-        // Read interleaved float frames (channels from decoder)
-        size_t frames_read = format_decoder_read(g_buffer.decoder, decode_buffer, frames_to_read);
+        size_t frames_to_read = block_frames - frames_read_total;
+        size_t frames_read;
+        int16_t *dst = (int16_t *)&out[frames_read_total * AUDIO_OUT_CHANNELS];
+
+        /* Sample-rate conversion: pull what the resampler can already produce
+         * (output-rate stereo, volume applied on the way in) and quantise it;
+         * only when it needs input is the decoder read, for no more frames
+         * than the remaining outputs require. */
+        const bool resampling = resampler_sync(format_decoder_get_sample_rate(g_buffer.decoder));
+        float *resampler_in = NULL;
+        if (resampling) {
+            size_t produced = Resampler_Pull(&g_resampler, stereo_buffer, frames_to_read);
+            if (produced > 0U) {
+                g_buffer.kernels->f32_to_s16(stereo_buffer, dst,
+                                             produced * AUDIO_OUT_CHANNELS, 1.0f);
+                if (crossfade_armed) {
+                    tail_push(dst, produced);
+                }
+                g_buffer.stats.resampled_frames += produced;
+                frames_read_total += produced;
+                continue;
+            }
+            size_t space = 0U;
+            resampler_in = Resampler_InputSpace(&g_resampler, &space);
+            frames_to_read = Resampler_InputFramesFor(&g_resampler, frames_to_read);
+            if (frames_to_read > space) {
+                frames_to_read = space;
+            }
+            if (frames_to_read > AUDIO_BUFFER_FRAMES) {
+                frames_to_read = AUDIO_BUFFER_FRAMES;
+            }
+        }
+
+        /* Integer fast path: a stereo S16 source already has the output
+         * layout, so decode straight into the slot and skip the int16 ->
+         * float -> int16 round trip. Unity gain is a plain copy (bit-exact
+         * with the codec); otherwise a Q15 multiply. */
+        const bool s16_direct = (channels == AUDIO_OUT_CHANNELS) && !resampling &&
+                                format_decoder_supports_s16(g_buffer.decoder) &&
+                                !preroll_is_float(g_buffer.decoder);
+        if (s16_direct) {
+            frames_read = decoder_read_s16(g_buffer.decoder, dst, frames_to_read);
+            if (frames_read > 0U && gain_q15 < PCM_Q15_UNITY) {
+                g_buffer.kernels->s16_gain_q15(dst, frames_read * AUDIO_OUT_CHANNELS, gain_q15);
+            }
+            g_buffer.stats.fast_path_frames += frames_read;
+        } else {
+            // Read interleaved float frames (channels from decoder)
+            frames_read = decoder_read(g_buffer.decoder, decode_buffer, frames_to_read);
+        }
 
         if (frames_read == 0) {
             // Current decoder is exhausted. With crossfade armed, overlap-mix the
@@ -1102,56 +1726,142 @@ static bool fill_buffer(size_t index) {
             printf("Decoder EOF; attempting transition\n");
             if (crossfade_armed && crossfade_begin(fade_frames)) {
                 printf("Crossfade: started fade to next track\n");
-                continue;  // fade is now in_progress; handled at loop top
+                track_changed = true;
+                track_start = frames_read_total;
+                continue;  // fade (if any) is now in_progress; handled at loop top
             }
             if (advance_to_next_track()) {
                 printf("Gapless: advanced to next track, continuing fill\n");
+                track_changed = true;
+                track_start = frames_read_total;
                 continue;
             }
             printf("No next track; ending stream\n");
             break;
         }
 
-        for (size_t i = 0; i < frames_read; i++) {
-            float left;
-            float right;
-            downmix_frame(&decode_buffer[i * channels], channels, &left, &right);
-
-            // Apply master volume in the float domain before clamping/quantising.
-            left *= gain;
-            right *= gain;
-
-            /* Capture the post-volume tail so a crossfade on the next EOF can
-             * fade this track out against the incoming head. */
+        if (s16_direct) {
             if (crossfade_armed) {
-                tail_push(left, right);
+                tail_push(dst, frames_read);
             }
+            frames_read_total += frames_read;  // already in the slot
+            continue;
+        }
+
+        if (resampling) {
+            /* Downmix with master volume straight into the resampler input;
+             * the output is produced on the next pass. */
+            g_buffer.kernels->downmix_to_stereo(decode_buffer, channels, resampler_in,
+                                                frames_read, gain);
+            Resampler_CommitInput(&g_resampler, frames_read);
+            continue;
+        }
 
-            write_stereo_frame(index, frames_read_total + i, left, right);
+        if (channels == AUDIO_OUT_CHANNELS) {
+            /* Already stereo: apply master volume and quantise straight into
+             * the slot in one pass. */
+            g_buffer.kernels->f32_to_s16(decode_buffer, dst,
+                                         frames_read * AUDIO_OUT_CHANNELS, gain);
+        } else {
+            // Downmix with master volume applied, before clamping/quantising.
+            g_buffer.kernels->downmix_to_stereo(decode_buffer, channels, stereo_buffer,
+                                                frames_read, gain);
+            g_buffer.kernels->f32_to_s16(stereo_buffer, dst,
+                                         frames_read * AUDIO_OUT_CHANNELS, 1.0f);
+        }
+
+        /* Capture the post-volume tail so a crossfade on the next EOF can
+         * fade this track out against the incoming head. */
+        if (crossfade_armed) {
+            tail_push(dst, frames_read);
         }
 
         frames_read_total += frames_read;
     }
 
-    if (frames_read_total < AUDIO_BUFFER_FRAMES) {
-        size_t remaining_frames = AUDIO_BUFFER_FRAMES - frames_read_total;
+    if (frames_read_total < block_frames) {
+        size_t remaining_frames = block_frames - frames_read_total;
         size_t remaining_samples = remaining_frames * AUDIO_OUT_CHANNELS;
-        memset(&g_buffer.data[index][frames_read_total * AUDIO_OUT_CHANNELS],
+        memset(&out[frames_read_total * AUDIO_OUT_CHANNELS],
                0,
                remaining_samples * sizeof(uint16_t));
         atomic_store_explicit(&g_buffer.end_of_stream, (frames_read_total == 0U),
                               memory_order_relaxed);
     }
 
+    if (track_changed) {
+        uint32_t elapsed_ms = platform_get_time_ms() - fill_start_ms;
+        g_buffer.stats.last_transition_time_ms = elapsed_ms;
+        if (elapsed_ms > g_buffer.stats.max_transition_time_ms) {
+            g_buffer.stats.max_transition_time_ms = elapsed_ms;
+        }
+    }
+
     atomic_store_explicit(&g_buffer.valid_frames[index], frames_read_total,
                           memory_order_relaxed);
+    atomic_store_explicit(&g_buffer.track_start[index], track_start,
+                          memory_order_relaxed);
     g_buffer.stats.total_samples += frames_read_total;
     return frames_read_total > 0U;
 }
 
+/*
+ * Producer-side: fill every free slot until the ring is full or the stream
+ * ends, publishing each block as soon as it is ready so the consumer never
+ * waits on the whole batch, then let the look-ahead pre-open the next track
+ * if it is due. Returns the number of blocks published.
+ */
+static size_t ring_fill(void) {
+    size_t published = 0U;
+    size_t write = atomic_load_explicit(&g_buffer.write_seq, memory_order_relaxed);
+
+    while (!atomic_load_explicit(&g_buffer.end_of_stream, memory_order_relaxed)) {
+        /* Acquire read_seq: the consumer is done with every slot before it. */
+        size_t read = atomic_load_explicit(&g_buffer.read_seq, memory_order_acquire);
+        if (is_ping_pong() && (ptrdiff_t)(write - read) <= 0) {
+            /* Late in ping-pong mode: the DMA is already replaying the stale
+             * half at read_seq, so resume on the other half instead of
+             * writing under it. */
+            write = read + 1U;
+        }
+        if (write - read >= g_buffer.depth) {
+            break;  // full: the next slot is the one being played
+        }
+        if (!fill_buffer(write % g_buffer.depth)) {
+            break;  // decoder exhausted; end_of_stream is now set
+        }
+        write++;
+        atomic_store_explicit(&g_buffer.write_seq, write, memory_order_release);
+        published++;
+    }
+    lookahead_service();
+    return published;
+}
+
+/* Frames decoded and queued for the consumer across every ready slot. */
+static size_t ring_queued_frames(void) {
+    if (g_buffer.depth == 0U) {
+        return 0U;
+    }
+    size_t read = atomic_load_explicit(&g_buffer.read_seq, memory_order_relaxed);
+    size_t write = atomic_load_explicit(&g_buffer.write_seq, memory_order_acquire);
+    /* A late ping-pong producer leaves read_seq ahead: nothing is queued. */
+    if ((ptrdiff_t)(write - read) <= 0) {
+        return 0U;
+    }
+    size_t frames = 0U;
+    for (size_t seq = read; seq != write; seq++) {
+        frames += atomic_load_explicit(&g_buffer.valid_frames[seq % g_buffer.depth],
+                                       memory_order_relaxed);
+    }
+    return frames;
+}
+
 static void update_utilisation(size_t available_frames) {
-    /* frames / frames -> 0..1 fill ratio (both operands are frame counts). */
-    float current = (float)available_frames / (float)AUDIO_BUFFER_FRAMES;
+    /* frames / frames -> 0..1 fill ratio over the whole ring. */
+    size_t capacity = g_buffer.depth * g_buffer.block_frames;
+    float current = (capacity == 0U) ? 0.0f
+                                     : (float)available_frames / (float)capacity;
     g_buffer.stats.average_utilisation =
         (g_buffer.stats.average_utilisation * 0.9f) + (current * 0.1f);
 }
@@ -6,6 +6,7 @@
 #include "nuno/format_decoder.h"
 #include "nuno/music_library.h"
 #include "nuno/platform.h"
+#include "nuno/read_ahead.h"
 
 #include <stdio.h>
 #include <string.h>
@@ -22,6 +23,7 @@ typedef struct {
     bool end_of_playlist;
     bool transition_pending;
     uint16_t crossfade_ms;  // requested crossfade duration; 0 == disabled
+    size_t lookahead_index; // library index of the track the look-ahead opened
 } AudioPipelineContext;
 
 static AudioPipelineContext g_pipeline;
@@ -30,9 +32,13 @@ static void set_state(PipelineState new_state);
 static bool ensure_buffer_ready(void);
 static void configure_codec(uint32_t sample_rate, uint8_t bit_depth);
 static void update_next_track_status(void);
+static FormatDecoder* open_decoder_for_track(const MusicLibraryTrack* track);
 static FormatDecoder* open_decoder_for_current_track(void);
 static FormatDecoder* gapless_next_track_provider(void* user_data);
+static FormatDecoder* lookahead_open_next(void* user_data);
+static void lookahead_commit_next(void* user_data);
 static void apply_crossfade_frames(void);
+static bool adopt_decoder_rate(FormatDecoder* decoder);
 
 bool AudioPipeline_Init(void) {
     printf("AudioPipeline_Init starting...\n");
@@ -54,6 +60,9 @@ bool AudioPipeline_Init(void) {
     /* Register the gapless next-track provider so the buffer producer can
      * transparently advance to the next track on EOF without silence. */
     AudioBuffer_SetNextTrackProvider(gapless_next_track_provider, NULL);
+    /* ...and have it open that track ahead of time, so the EOF transition is
+     * a decoder swap rather than a file open. */
+    AudioBuffer_SetLookAheadProvider(lookahead_open_next, lookahead_commit_next, NULL);
 
     printf("Initializing audio codec...\n");
     if (!AudioCodec_Init(g_pipeline.config.sample_rate, g_pipeline.config.bit_depth)) {
@@ -69,6 +78,14 @@ bool AudioPipeline_Init(void) {
     }
     printf("Music library initialized\n");
 
+    /* Remember seek indexes between runs; a missing cache only costs speed. */
+    if (!format_decoder_set_seek_cache_dir(NUNO_SEEK_CACHE_DIR)) {
+        printf("Seek cache disabled (%s unavailable)\n", NUNO_SEEK_CACHE_DIR);
+    }
+
+    /* Decoders read from RAM windows the platform's I/O thread fills. */
+    ReadAhead_SetWindowBytes(NUNO_READ_AHEAD_BYTES);
+
     update_next_track_status();
 
     set_state(PIPELINE_STATE_STOPPED);
@@ -81,23 +98,20 @@ bool AudioPipeline_Play(void) {
         return true;
     }
 
-    if (!MusicLibrary_GetCurrentTrack()) {
+    MusicLibraryTrack track;
+    if (!MusicLibrary_GetCurrentTrack(&track)) {
         if (!MusicLibrary_OpenTrack(0U)) {
             return false;
         }
     }
 
     // Create and set up format decoder for the current track if not already done
-    const MusicLibraryTrack* track = MusicLibrary_GetCurrentTrack();
-    if (track && !AudioBuffer_GetDecoder()) {  // Check if decoder is already set
+    if (MusicLibrary_GetCurrentTrack(&track) && !AudioBuffer_GetDecoder()) {  // Check if decoder is already set
         FormatDecoder* decoder = open_decoder_for_current_track();
         if (decoder) {
-            uint32_t sample_rate = format_decoder_get_sample_rate(decoder);
-            if (sample_rate != 0U && sample_rate != g_pipeline.config.sample_rate) {
-                if (!AudioPipeline_ReconfigureFormat(sample_rate, g_pipeline.config.bit_depth)) {
-                    format_decoder_destroy(decoder);
-                    return false;
-                }
+            if (!adopt_decoder_rate(decoder)) {
+                format_decoder_destroy(decoder);
+                return false;
             }
             AudioBuffer_SetDecoder(decoder);
         }
@@ -112,10 +126,12 @@ bool AudioPipeline_Play(void) {
     }
 
     // Ensure audio streaming is (re)started when transitioning to PLAYING.
-    // DMA length is AUDIO_BUFFER_SIZE *samples* (uint16_t element count of the
-    // buffer), i.e. AUDIO_BUFFER_FRAMES * AUDIO_OUT_CHANNELS. This matches every
-    // other DMA_StartTransfer call site in the project.
-    (void)DMA_StartTransfer(AudioBuffer_GetBuffer(), AUDIO_BUFFER_SIZE);
+    // DMA length is in *samples* (uint16_t element count of the region): one
+    // ring block, or both ping-pong halves. Every DMA_StartTransfer call site
+    // in the project takes it from AudioBuffer_GetDmaRegion().
+    size_t dma_samples = 0U;
+    uint16_t *dma_region = AudioBuffer_GetDmaRegion(&dma_samples);
+    (void)DMA_StartTransfer(dma_region, dma_samples);
 
     set_state(PIPELINE_STATE_PLAYING);
     return true;
@@ -164,12 +180,9 @@ bool AudioPipeline_Skip(void) {
      * buffer plays the new track rather than the stale previous decoder. */
     FormatDecoder* decoder = open_decoder_for_current_track();
     if (decoder) {
-        uint32_t sample_rate = format_decoder_get_sample_rate(decoder);
-        if (sample_rate != 0U && sample_rate != g_pipeline.config.sample_rate) {
-            if (!AudioPipeline_ReconfigureFormat(sample_rate, g_pipeline.config.bit_depth)) {
-                format_decoder_destroy(decoder);
-                return false;
-            }
+        if (!adopt_decoder_rate(decoder)) {
+            format_decoder_destroy(decoder);
+            return false;
         }
         AudioBuffer_SetDecoder(decoder);  // closes/destroys any previous decoder
     }
@@ -194,12 +207,9 @@ bool AudioPipeline_Previous(void) {
 
     FormatDecoder* decoder = open_decoder_for_current_track();
     if (decoder) {
-        uint32_t sample_rate = format_decoder_get_sample_rate(decoder);
-        if (sample_rate != 0U && sample_rate != g_pipeline.config.sample_rate) {
-            if (!AudioPipeline_ReconfigureFormat(sample_rate, g_pipeline.config.bit_depth)) {
-                format_decoder_destroy(decoder);
-                return false;
-            }
+        if (!adopt_decoder_rate(decoder)) {
+            format_decoder_destroy(decoder);
+            return false;
         }
         AudioBuffer_SetDecoder(decoder);  // closes/destroys any previous decoder
     }
@@ -224,20 +234,17 @@ bool AudioPipeline_PlayTrack(size_t track_index) {
     printf("Successfully opened track %zu\n", track_index);
 
     // Create and set up format decoder for the track
-    const MusicLibraryTrack* track = MusicLibrary_GetCurrentTrack();
-    if (track) {
-        printf("Track: %s - %s by %s\n", track->title, track->album, track->artist);
+    MusicLibraryTrack track;
+    if (MusicLibrary_GetCurrentTrack(&track)) {
+        printf("Track: %s - %s by %s\n", track.title, track.album, track.artist);
 
         FormatDecoder* decoder = open_decoder_for_current_track();
         if (decoder) {
             printf("Successfully opened decoder\n");
-            uint32_t sample_rate = format_decoder_get_sample_rate(decoder);
-            if (sample_rate != 0U && sample_rate != g_pipeline.config.sample_rate) {
-                if (!AudioPipeline_ReconfigureFormat(sample_rate, g_pipeline.config.bit_depth)) {
-                    printf("Failed to reconfigure format\n");
-                    format_decoder_destroy(decoder);
-                    return false;
-                }
+            if (!adopt_decoder_rate(decoder)) {
+                printf("Failed to reconfigure format\n");
+                format_decoder_destroy(decoder);
+                return false;
             }
             AudioBuffer_SetDecoder(decoder);
         } else {
@@ -283,6 +290,15 @@ uint32_t AudioPipeline_GetTrackChangeCount(void) {
     return AudioBuffer_GetTrackChangeCount();
 }
 
+void AudioPipeline_SetTrackChangeWake(void (*wake)(void)) {
+    AudioBuffer_SetTrackChangeWake(wake);
+}
+
+bool AudioPipeline_ServiceIdle(void) {
+    format_decoder_flush_seek_cache();
+    return MusicLibrary_RefreshStep();
+}
+
 bool AudioPipeline_Configure(const AudioPipelineConfig *config) {
     if (!config) {
         return false;
@@ -330,9 +346,7 @@ void AudioPipeline_HandleEndOfFile(void) {
 
         FormatDecoder* decoder = open_decoder_for_current_track();
         if (decoder) {
-            uint32_t sample_rate = format_decoder_get_sample_rate(decoder);
-            if (sample_rate == 0U || sample_rate == g_pipeline.config.sample_rate ||
-                AudioPipeline_ReconfigureFormat(sample_rate, g_pipeline.config.bit_depth)) {
+            if (adopt_decoder_rate(decoder)) {
                 AudioBuffer_SetDecoder(decoder);
             } else {
                 format_decoder_destroy(decoder);
@@ -429,10 +443,29 @@ bool AudioPipeline_Seek(size_t sample_position) {
     return true;
 }
 
+/*
+ * Make a newly opened decoder playable on the current output clock. The I2S
+ * clock stays fixed and the buffer producer resamples a track at another rate
+ * (so a mixed-rate library never tears the DMA down between tracks); only a
+ * ratio the resampler cannot handle falls back to reclocking the output.
+ */
+static bool adopt_decoder_rate(FormatDecoder* decoder) {
+    uint32_t sample_rate = format_decoder_get_sample_rate(decoder);
+    if (sample_rate == 0U || sample_rate == g_pipeline.config.sample_rate) {
+        (void)AudioBuffer_ConfigureSampleRate(g_pipeline.config.sample_rate,
+                                              g_pipeline.config.sample_rate);
+        return true;
+    }
+    if (AudioBuffer_ConfigureSampleRate(sample_rate, g_pipeline.config.sample_rate)) {
+        return true;
+    }
+    return AudioPipeline_ReconfigureFormat(sample_rate, g_pipeline.config.bit_depth);
+}
+
 bool AudioPipeline_ReconfigureFormat(uint32_t new_sample_rate, uint8_t new_bit_depth) {
     g_pipeline.config.sample_rate = new_sample_rate;
     g_pipeline.config.bit_depth = new_bit_depth;
-    AudioBuffer_ConfigureSampleRate(new_sample_rate, new_sample_rate);
+    (void)AudioBuffer_ConfigureSampleRate(new_sample_rate, new_sample_rate);
     AudioBuffer_ConfigureSampleFormat(new_bit_depth, false, true);
 
     /* The crossfade window is stored in frames; re-derive it from the ms
@@ -526,13 +559,12 @@ static void update_next_track_status(void) {
 }
 
 /*
- * Create and open a FormatDecoder for whatever track is currently selected in
- * the music library. Returns NULL on failure (file missing, unknown format).
- * Shared by AudioPipeline_Play / _PlayTrack and the gapless provider so the
- * path-resolution / open logic lives in one place.
+ * Create and open a FormatDecoder for a library track. Returns NULL on failure
+ * (file missing, unknown format). Shared by AudioPipeline_Play / _PlayTrack,
+ * the gapless provider and the look-ahead so the path-resolution / open logic
+ * lives in one place.
  */
-static FormatDecoder* open_decoder_for_current_track(void) {
-    const MusicLibraryTrack* track = MusicLibrary_GetCurrentTrack();
+static FormatDecoder* open_decoder_for_track(const MusicLibraryTrack* track) {
     if (!track) {
         return NULL;
     }
@@ -559,6 +591,12 @@ static FormatDecoder* open_decoder_for_current_track(void) {
     return decoder;
 }
 
+/* Decoder for whatever track is currently selected in the music library. */
+static FormatDecoder* open_decoder_for_current_track(void) {
+    MusicLibraryTrack track;
+    return MusicLibrary_GetCurrentTrack(&track) ? open_decoder_for_track(&track) : NULL;
+}
+
 /*
  * Gapless next-track provider, invoked by the audio buffer's producer when the
  * current decoder hits EOF. Advances the music library to the next track and
@@ -585,3 +623,32 @@ static FormatDecoder* gapless_next_track_provider(void* user_data) {
     update_next_track_status();
     return decoder;
 }
+
+/*
+ * Look-ahead provider, invoked by the producer shortly before the current
+ * track ends. Opens the track after the current one WITHOUT selecting it, so
+ * a Skip that lands first still sees the library where the listener left it;
+ * the buffer drops this decoder in that case. Tracks a refresh removed are
+ * skipped, as OpenNextTrack() skips them.
+ */
+static FormatDecoder* lookahead_open_next(void* user_data) {
+    (void)user_data;
+
+    size_t next_index = MusicLibrary_GetNextIndex();
+    MusicLibraryTrack track;
+    FormatDecoder* decoder = MusicLibrary_GetTrack(next_index, &track)
+        ? open_decoder_for_track(&track)
+        : NULL;
+    if (decoder) {
+        g_pipeline.lookahead_index = next_index;
+    }
+    return decoder;
+}
+
+/* The pre-opened track is now playing: make it current. No I/O. */
+static void lookahead_commit_next(void* user_data) {
+    (void)user_data;
+
+    (void)MusicLibrary_SelectTrack(g_pipeline.lookahead_index);
+    update_next_track_status();
+}
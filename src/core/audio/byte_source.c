@@ -0,0 +1,174 @@
+#define _POSIX_C_SOURCE 200809L  // mmap/fstat on hosts
+
+#include "nuno/byte_source.h"
+
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define BYTE_SOURCE_HAVE_MMAP 1
+#endif
+
+// ---------------------------------------------------------------------------
+// stdio file
+// ---------------------------------------------------------------------------
+
+static size_t file_read(ByteSource *source, void *dst, size_t bytes) {
+    return fread(dst, 1, bytes, source->u.file.file);
+}
+
+static bool file_seek(ByteSource *source, uint64_t offset) {
+    return fseek(source->u.file.file, (long)offset, SEEK_SET) == 0;
+}
+
+static uint64_t file_tell(const ByteSource *source) {
+    long pos = ftell(source->u.file.file);
+    return (pos < 0) ? 0U : (uint64_t)pos;
+}
+
+static uint64_t file_size(const ByteSource *source) {
+    return source->u.file.size;
+}
+
+static void file_close(ByteSource *source) {
+    fclose(source->u.file.file);
+    source->u.file.file = NULL;
+}
+
+static const ByteSourceOps k_file_ops = {
+    .read = file_read,
+    .seek = file_seek,
+    .tell = file_tell,
+    .size = file_size,
+    .map = NULL,
+    .close = file_close,
+};
+
+bool ByteSource_OpenFile(ByteSource *source, const char *path) {
+    if (!source || !path) {
+        return false;
+    }
+    source->ops = NULL;
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    // Measured once: decoders ask for the size to estimate lengths and seeks.
+    long size = -1;
+    if (fseek(file, 0, SEEK_END) == 0) {
+        size = ftell(file);
+    }
+    if (size < 0 || fseek(file, 0, SEEK_SET) != 0) {
+        fclose(file);
+        return false;
+    }
+    source->u.file.file = file;
+    source->u.file.size = (uint64_t)size;
+    source->ops = &k_file_ops;
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Memory block (also backs mapped files)
+// ---------------------------------------------------------------------------
+
+static size_t memory_read(ByteSource *source, void *dst, size_t bytes) {
+    size_t available = source->u.memory.size - source->u.memory.pos;
+    if (bytes > available) {
+        bytes = available;
+    }
+    memcpy(dst, source->u.memory.data + source->u.memory.pos, bytes);
+    source->u.memory.pos += bytes;
+    return bytes;
+}
+
+static bool memory_seek(ByteSource *source, uint64_t offset) {
+    if (offset > source->u.memory.size) {
+        return false;
+    }
+    source->u.memory.pos = (size_t)offset;
+    return true;
+}
+
+static uint64_t memory_tell(const ByteSource *source) {
+    return source->u.memory.pos;
+}
+
+static uint64_t memory_size(const ByteSource *source) {
+    return source->u.memory.size;
+}
+
+static const uint8_t *memory_map(ByteSource *source, uint64_t offset, size_t *length) {
+    if (offset > source->u.memory.size) {
+        return NULL;
+    }
+    *length = source->u.memory.size - (size_t)offset;
+    return source->u.memory.data + offset;
+}
+
+static void memory_close(ByteSource *source) {
+#ifdef BYTE_SOURCE_HAVE_MMAP
+    if (source->u.memory.mapped && source->u.memory.size > 0U) {
+        munmap((void *)source->u.memory.data, source->u.memory.size);
+    }
+#endif
+    source->u.memory.data = NULL;
+}
+
+static const ByteSourceOps k_memory_ops = {
+    .read = memory_read,
+    .seek = memory_seek,
+    .tell = memory_tell,
+    .size = memory_size,
+    .map = memory_map,
+    .close = memory_close,
+};
+
+void ByteSource_InitMemory(ByteSource *source, const void *data, size_t size) {
+    if (!source) {
+        return;
+    }
+    source->u.memory.data = (const uint8_t *)data;
+    source->u.memory.size = data ? size : 0U;
+    source->u.memory.pos = 0U;
+    source->u.memory.mapped = false;
+    source->ops = &k_memory_ops;
+}
+
+bool ByteSource_OpenMapped(ByteSource *source, const char *path) {
+    if (!source || !path) {
+        return false;
+    }
+    source->ops = NULL;
+#ifdef BYTE_SOURCE_HAVE_MMAP
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat st;
+    void *data = NULL;
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    close(fd);  // the mapping keeps the file referenced
+    if (!data || data == MAP_FAILED) {
+        return false;
+    }
+    ByteSource_InitMemory(source, data, (size_t)st.st_size);
+    source->u.memory.mapped = true;
+    return true;
+#else
+    return false;
+#endif
+}
+
+void ByteSource_Close(ByteSource *source) {
+    if (!ByteSource_IsOpen(source)) {
+        return;
+    }
+    source->ops->close(source);
+    source->ops = NULL;
+}
@@ -1,9 +1,13 @@
 #include "nuno/format_decoder.h"
+#include "nuno/byte_source.h"
+#include "nuno/read_ahead.h"
 #include "minimp3.h"
 #include "FLAC/stream_decoder.h"
+#include <stdatomic.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 
 /*
  * Per-format decoder backend vtable.
@@ -16,17 +20,41 @@
  *
  * Backends currently share the one FormatDecoder struct below; each backend
  * only touches its own fields. open() returns true on success and is expected
- * to have set last_error on failure.
+ * to have set last_error on failure. read_s16() is the only optional entry.
  */
 typedef struct DecoderBackend {
     bool     (*open)(FormatDecoder* decoder);
     size_t   (*read)(FormatDecoder* decoder, float* buffer, size_t frames);
+    /* Optional: native interleaved S16 read for codecs that decode to int16.
+     * NULL when the backend only produces float. */
+    size_t   (*read_s16)(FormatDecoder* decoder, int16_t* buffer, size_t frames);
     void     (*seek)(FormatDecoder* decoder, size_t frame_position);
     void     (*close)(FormatDecoder* decoder);
     uint32_t (*get_channels)(const FormatDecoder* decoder);
     uint32_t (*get_sample_rate)(const FormatDecoder* decoder);
+    /* Optional: stream length in frames, 0 when unknown. */
+    size_t   (*get_total_frames)(const FormatDecoder* decoder);
 } DecoderBackend;
 
+/* MP3 seek index: byte offsets of every Nth frame, recorded while decoding
+ * or walking headers. N starts at MP3_SEEK_INDEX_STRIDE and doubles whenever
+ * the table fills, so any length fits in a fixed per-decoder array. */
+#define MP3_SEEK_INDEX_ENTRIES 512U
+#define MP3_SEEK_INDEX_STRIDE 16U
+
+/* FLAC seek points for files without a SEEKTABLE: one frame start at least
+ * every FLAC_SEEK_POINT_SPACING samples, the spacing doubling when full. */
+#define FLAC_SEEK_POINTS 256U
+#define FLAC_SEEK_POINT_SPACING 65536U
+
+typedef struct {
+    uint64_t sample;  // first sample (per channel) of the frame
+    uint64_t offset;  // file offset of the frame header
+} FlacSeekPoint;
+
+/* Longest path kept for the seek cache key; longer paths are not cached. */
+#define SEEK_CACHE_PATH_MAX 256U
+
 struct FormatDecoder {
     mp3dec_t mp3d;
     mp3dec_frame_info_t frame_info;
@@ -40,37 +68,104 @@ struct FormatDecoder {
     // Selected per-format backend (NULL until format_decoder_open succeeds)
     const DecoderBackend* backend;
 
+    // Input; closed by format_decoder_close()
+    ByteSource source;
+
     // MP3-specific data
-    FILE* file;
-    // Encoded (input) buffer
+    // Encoded (input) buffer. 'input' is 'buffer', or the source's own bytes
+    // when it can map them (memory and mmap sources are parsed in place).
     uint8_t* buffer;
     size_t buffer_size;
+    const uint8_t* input;
     size_t buffer_pos;
     size_t buffer_len;
 
-    // Decoded PCM (output) buffer
-    uint8_t* pcm_buffer;     // stores interleaved int16 frames
-    size_t pcm_capacity;
-    size_t pcm_size;         // bytes valid in pcm_buffer
-    size_t pcm_pos;          // read position in pcm_buffer
-
-    // FLAC-specific data
+    // Carry-over for a decoded frame that did not fit the caller's buffer
+    mp3d_sample_t* pcm_buffer; // one frame, interleaved (MINIMP3_MAX_SAMPLES_PER_FRAME)
+    size_t pcm_size;         // samples valid in pcm_buffer
+    size_t pcm_pos;          // read position in pcm_buffer, in samples
+    size_t mp3_total_frames; // length from the Xing/Info header or estimated at open (0 if unknown)
+    size_t mp3_stream_bytes; // encoded bytes spanning mp3_total_frames (0 if unknown)
+    bool mp3_xing;           // totals came from a Xing/Info/VBRI header
+    size_t mp3_frame_samples; // samples per channel in each frame
+    long mp3_data_offset;    // file offset of the first frame (after any ID3v2 tag)
+    long mp3_buffer_offset;  // file offset of buffer[0]
+    bool mp3_input_eof;      // the file has been read to the end
+    size_t mp3_frame;        // number of the next frame to parse
+    bool mp3_frame_known;    // mp3_frame is exact (false after a coarse seek)
+    bool mp3_has_toc;
+    uint8_t mp3_toc[100];    // Xing-style TOC: 256ths of mp3_stream_bytes per 1% of frames
+    size_t mp3_index_count;
+    size_t mp3_index_stride;
+
+    // FLAC-specific data. The stream decoder object is created once per pool
+    // slot and re-initialised for each file.
     FLAC__StreamDecoder* flac_decoder;
     uint32_t flac_sample_rate;
     uint32_t flac_channels;
     uint8_t flac_bits_per_sample;
     bool flac_eof;
-    float* flac_buffer;      // interleaved float samples
-    size_t flac_capacity;    // samples capacity
-    size_t flac_samples;     // samples valid in flac_buffer
-    size_t flac_pos;         // read position in samples
+    uint64_t flac_total_samples;  // per channel, from STREAMINFO (0 if unknown)
+    // The current frame, read in place from libFLAC's per-channel output
+    // arrays, which it keeps until it decodes the next frame
+    const FLAC__int32* flac_planes[FLAC__MAX_CHANNELS];
+    float flac_scale;        // 1 / 2^(bits - 1) for the current frame
+    size_t flac_frame_len;   // samples per channel in the current frame
+    size_t flac_frame_pos;   // next sample per channel to hand out
+    bool flac_has_seektable; // libFLAC seeks from the file's own table
+    bool flac_skipping;      // dropping decoded samples up to flac_skip_to
+    uint64_t flac_skip_to;
+    size_t flac_point_count;
+    uint64_t flac_point_spacing;
+
+    // Seek index; only the open format's table is live.
+    union {
+        uint32_t mp3_index[MP3_SEEK_INDEX_ENTRIES]; // file offset of frame i * mp3_index_stride
+        FlacSeekPoint flac_points[FLAC_SEEK_POINTS]; // ascending by sample
+    };
+
+    // Seek cache key (see format_decoder_set_seek_cache_dir())
+    char path[SEEK_CACHE_PATH_MAX]; // empty when the stream is not cached
+    uint64_t file_size;
+    int64_t file_mtime;
+    bool seek_cache_checked;        // lazy load already attempted
+    uint64_t seek_cache_coverage;   // last sample the index reached when loaded
 };
 
+/*
+ * Decoder pool.
+ *
+ * Decoders are fixed slots handed out by format_decoder_create() and returned
+ * by format_decoder_destroy(); slots are claimed atomically because the
+ * producer's look-ahead and the control thread both open tracks. A slot keeps
+ * its MP3 input/carry-over buffers and its libFLAC stream decoder after
+ * close, so they are allocated the first time the slot plays a format and
+ * only reused afterwards: a gapless run of tracks makes no heap calls of its
+ * own. Every allocation goes through decoder_alloc()/decoder_free(),
+ * which count them for format_decoder_get_heap_calls().
+ */
+static FormatDecoder g_pool[FORMAT_DECODER_POOL_SIZE];
+static _Atomic bool g_pool_in_use[FORMAT_DECODER_POOL_SIZE];
+static _Atomic size_t g_heap_calls;
+
+/* MP3 input is read from the file in chunks of this size. */
+#define MP3_INPUT_BUFFER_SIZE 8192U
+
+static void* decoder_alloc(size_t bytes) {
+    atomic_fetch_add_explicit(&g_heap_calls, 1U, memory_order_relaxed);
+    return malloc(bytes);
+}
+
+static void decoder_free(void* block) {
+    if (block) {
+        atomic_fetch_add_explicit(&g_heap_calls, 1U, memory_order_relaxed);
+        free(block);
+    }
+}
+
 // Forward declaration
 static bool read_next_frame(FormatDecoder* decoder);
 static bool init_flac_decoder(FormatDecoder* decoder);
-static void flac_compact_buffer(FormatDecoder* decoder);
-static bool flac_ensure_capacity(FormatDecoder* decoder, size_t additional_samples);
 static FLAC__StreamDecoderWriteStatus flac_write_callback(
     const FLAC__StreamDecoder* decoder,
     const FLAC__Frame* frame,
@@ -83,6 +178,11 @@ static void flac_error_callback(const FLAC__StreamDecoder* decoder,
                                 FLAC__StreamDecoderErrorStatus status,
                                 void* client_data);
 
+// Seek index cache (defined after format_decoder_seek)
+static void seek_cache_key(FormatDecoder* decoder, const char* filepath);
+static void seek_cache_load(FormatDecoder* decoder);
+static void seek_cache_queue(FormatDecoder* decoder);
+
 // Per-format backend selection (defined at end of file)
 static const DecoderBackend* backend_for_format(enum AudioFormatType format_type);
 
@@ -232,9 +332,20 @@ static const DecoderCapabilities ogg_capabilities = {
 #define OGG_FRAMES_PER_BUFFER 8
 
 FormatDecoder* format_decoder_create(void) {
-    FormatDecoder* decoder = (FormatDecoder*)malloc(sizeof(FormatDecoder));
-    if (!decoder) return NULL;
-    
+    FormatDecoder* decoder = NULL;
+    for (size_t i = 0; i < FORMAT_DECODER_POOL_SIZE; i++) {
+        if (!atomic_exchange_explicit(&g_pool_in_use[i], true, memory_order_acquire)) {
+            decoder = &g_pool[i];
+            break;
+        }
+    }
+    if (!decoder) {
+        printf("Decoder pool exhausted (%u in use)\n", (unsigned)FORMAT_DECODER_POOL_SIZE);
+        return NULL;
+    }
+
+    // Reset the per-stream state; the slot's buffers (and their capacities)
+    // and its FLAC stream decoder are kept for reuse.
     decoder->position = 0;
     decoder->initialized = false;
     decoder->last_error = FD_ERROR_NONE;
@@ -246,61 +357,52 @@ FormatDecoder* format_decoder_create(void) {
     memcpy(&decoder->config, &default_config, sizeof(DecoderConfig));
     
     mp3dec_init(&decoder->mp3d);
-    decoder->file = NULL;
-    decoder->buffer = NULL;
-    decoder->buffer_size = 0;
+    decoder->source.ops = NULL;
+    decoder->input = NULL;
     decoder->buffer_pos = 0;
     decoder->buffer_len = 0;
-    decoder->pcm_buffer = NULL;
-    decoder->pcm_capacity = 0;
     decoder->pcm_size = 0;
     decoder->pcm_pos = 0;
+    decoder->mp3_total_frames = 0;
+    decoder->mp3_stream_bytes = 0;
+    decoder->mp3_xing = false;
+    decoder->mp3_has_toc = false;
+    decoder->mp3_index_count = 0;
 
-    decoder->flac_decoder = NULL;
     decoder->flac_sample_rate = 0;
     decoder->flac_channels = 0;
     decoder->flac_bits_per_sample = 0;
     decoder->flac_eof = false;
-    decoder->flac_buffer = NULL;
-    decoder->flac_capacity = 0;
-    decoder->flac_samples = 0;
-    decoder->flac_pos = 0;
+    decoder->flac_total_samples = 0;
+    decoder->flac_frame_len = 0;
+    decoder->flac_frame_pos = 0;
+    decoder->flac_has_seektable = false;
+    decoder->flac_skipping = false;
+    decoder->flac_point_count = 0;
+
+    decoder->path[0] = '\0';
+    decoder->seek_cache_checked = false;
+    decoder->seek_cache_coverage = 0;
     
     return decoder;
 }
 
-bool format_decoder_open(FormatDecoder* decoder, const char* filepath) {
-    if (!decoder || !filepath) {
-        if (decoder) decoder->last_error = FD_ERROR_INVALID_PARAM;
-        return false;
-    }
-
-    // Reset state
-    decoder->position = 0;
-    decoder->last_error = FD_ERROR_NONE;
-
-    // Open file
-    decoder->file = fopen(filepath, "rb");
-    if (!decoder->file) {
-        decoder->last_error = FD_ERROR_FILE_NOT_FOUND;
-        return false;
-    }
-
+/* Detects the format of decoder->source and opens the matching backend. */
+static bool open_from_source(FormatDecoder* decoder) {
     // Read initial buffer for format detection
     uint8_t header_buffer[8192];  // Reasonable size for detection
-    size_t bytes_read = fread(header_buffer, 1, sizeof(header_buffer), decoder->file);
+    size_t bytes_read = ByteSource_Read(&decoder->source, header_buffer, sizeof(header_buffer));
 
     // Detect format
     decoder->last_error = detect_audio_format(header_buffer, bytes_read,
                                             &decoder->format_info);
     if (decoder->last_error != FD_ERROR_NONE) {
-        fclose(decoder->file);
-        decoder->file = NULL;
+        ByteSource_Close(&decoder->source);
         return false;
     }
 
     // Rewind after detection so decoding starts from the beginning
-    fseek(decoder->file, 0, SEEK_SET);
+    ByteSource_Seek(&decoder->source, 0);
 
     // Select the polymorphic backend for the detected format.
     decoder->backend = backend_for_format(decoder->format_info.format_type);
@@ -319,145 +421,391 @@ bool format_decoder_open(FormatDecoder* decoder, const char* filepath) {
     return true;
 }
 
+bool format_decoder_open(FormatDecoder* decoder, const char* filepath) {
+    if (!decoder || !filepath) {
+        if (decoder) decoder->last_error = FD_ERROR_INVALID_PARAM;
+        return false;
+    }
+
+    // Reset state
+    decoder->position = 0;
+    decoder->last_error = FD_ERROR_NONE;
+    seek_cache_key(decoder, filepath);
+
+    // Through the read-ahead window when the stage has a stream free
+    if (!ByteSource_OpenReadAhead(&decoder->source, filepath) &&
+        !ByteSource_OpenFile(&decoder->source, filepath)) {
+        decoder->last_error = FD_ERROR_FILE_NOT_FOUND;
+        return false;
+    }
+    return open_from_source(decoder);
+}
+
+bool format_decoder_open_source(FormatDecoder* decoder, const ByteSource* source) {
+    if (!decoder || !ByteSource_IsOpen(source)) {
+        if (decoder) decoder->last_error = FD_ERROR_INVALID_PARAM;
+        return false;
+    }
+
+    decoder->position = 0;
+    decoder->last_error = FD_ERROR_NONE;
+    seek_cache_key(decoder, NULL);  // no path: nothing to key a cache entry on
+
+    decoder->source = *source;
+    return open_from_source(decoder);
+}
+
 // ---------------------------------------------------------------------------
 // MP3 backend (minimp3)
 // ---------------------------------------------------------------------------
 
-static bool mp3_backend_open(FormatDecoder* decoder) {
-    // Initialize MP3 decoder
-    mp3dec_init(&decoder->mp3d);
+/* Refill the input buffer whenever fewer bytes than this remain, so a whole
+ * frame plus the next header (which minimp3 checks for sync) is always
+ * buffered. Covers a 320 kbps/32 kHz frame and minimp3's free-format limit. */
+#define MP3_REFILL_THRESHOLD 4096U
 
-    // Allocate buffer for frame reading
-    decoder->buffer_size = 8192;
-    decoder->buffer = (uint8_t*)malloc(decoder->buffer_size);
-    if (!decoder->buffer) {
-        decoder->last_error = FD_ERROR_MEMORY;
+/* Frames decoded and discarded ahead of an exact seek target. Layer III
+ * frames borrow up to 511 bytes of main data from earlier frames (the bit
+ * reservoir) and overlap-add with the previous granule, so the target frame
+ * only decodes bit-exactly once its predecessors have been through minimp3. */
+#define MP3_PREDECODE_FRAMES 4U
+
+static uint32_t read_be32(const uint8_t* p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static uint16_t read_be16(const uint8_t* p) {
+    return (uint16_t)(((uint16_t)p[0] << 8) | p[1]);
+}
+
+/*
+ * Reads the stream totals and seek table from a Xing ("Xing"/"Info") or
+ * Fraunhofer VBRI tag in the first MPEG audio frame. Xing sits right after
+ * the side information, whose size depends on the MPEG version and channel
+ * mode; VBRI always sits 32 bytes after the header. A VBRI table is resampled
+ * into the Xing TOC layout so seeking has one coarse table to consult.
+ * Returns false if there is no tag or it carries no frame count.
+ */
+static bool parse_vbr_header(FormatDecoder* decoder, const uint8_t* frame, size_t len) {
+    if (len < 4 || frame[0] != 0xFF || (frame[1] & 0xE0) != 0xE0) {
         return false;
     }
+    bool mpeg1 = (frame[1] & 0x18) == 0x18;
+    bool mono = (frame[3] & 0xC0) == 0xC0;
+    size_t offset = 4U + (mpeg1 ? (mono ? 17U : 32U) : (mono ? 9U : 17U));
+    if (offset + 8U <= len &&
+        (memcmp(frame + offset, "Xing", 4) == 0 || memcmp(frame + offset, "Info", 4) == 0)) {
+        const uint8_t* p = frame + offset + 4U;
+        const uint8_t* end = frame + len;
+        uint32_t flags = read_be32(p);
+        p += 4;
+        if (!(flags & 0x1U) || p + 4 > end) {
+            return false;
+        }
+        decoder->mp3_total_frames = read_be32(p) * decoder->mp3_frame_samples;
+        p += 4;
+        if ((flags & 0x2U) && p + 4 <= end) {
+            decoder->mp3_stream_bytes = read_be32(p);
+            p += 4;
+        }
+        if ((flags & 0x4U) && p + 100 <= end) {
+            memcpy(decoder->mp3_toc, p, sizeof(decoder->mp3_toc));
+            decoder->mp3_has_toc = true;
+        }
+        return decoder->mp3_total_frames > 0;
+    }
 
+    offset = 4U + 32U;
+    if (offset + 26U <= len && memcmp(frame + offset, "VBRI", 4) == 0) {
+        const uint8_t* p = frame + offset;
+        uint32_t bytes = read_be32(p + 10);
+        uint32_t frames = read_be32(p + 14);
+        uint16_t entries = read_be16(p + 18);
+        uint16_t scale = read_be16(p + 20);
+        uint16_t entry_bytes = read_be16(p + 22);
+        uint16_t frames_per_entry = read_be16(p + 24);
+        if (frames == 0) {
+            return false;
+        }
+        decoder->mp3_total_frames = (size_t)frames * decoder->mp3_frame_samples;
+        decoder->mp3_stream_bytes = bytes;
+
+        // Entry i holds the byte size of frames [i, i + 1) * frames_per_entry.
+        const uint8_t* table = p + 26;
+        if (bytes > 0 && entries > 0 && frames_per_entry > 0 && entry_bytes >= 1 && entry_bytes <= 4 &&
+            table + (size_t)entries * entry_bytes <= frame + len) {
+            uint64_t covered_bytes = 0;
+            uint64_t covered_frames = 0;
+            uint16_t e = 0;
+            for (uint32_t percent = 0; percent < 100U; percent++) {
+                uint64_t want = (uint64_t)frames * percent / 100U;
+                while (e < entries && covered_frames + frames_per_entry <= want) {
+                    uint32_t size = 0;
+                    for (uint16_t b = 0; b < entry_bytes; b++) {
+                        size = (size << 8) | table[(size_t)e * entry_bytes + b];
+                    }
+                    covered_bytes += (uint64_t)size * scale;
+                    covered_frames += frames_per_entry;
+                    e++;
+                }
+                uint64_t fraction = covered_bytes * 256U / bytes;
+                decoder->mp3_toc[percent] = (uint8_t)(fraction > 255U ? 255U : fraction);
+            }
+            decoder->mp3_has_toc = true;
+        }
+        return true;
+    }
+    return false;
+}
+
+/* Records the offset of frame 'frame' if it is the next index point. When the
+ * table is full, every other entry is dropped and the stride doubles. */
+static void mp3_index_note(FormatDecoder* decoder, size_t frame, long offset) {
+    if (offset < 0 || (uint64_t)offset > UINT32_MAX) {
+        return;
+    }
+    if (decoder->mp3_index_count == MP3_SEEK_INDEX_ENTRIES) {
+        for (size_t i = 0; i < MP3_SEEK_INDEX_ENTRIES / 2U; i++) {
+            decoder->mp3_index[i] = decoder->mp3_index[i * 2U];
+        }
+        decoder->mp3_index_count = MP3_SEEK_INDEX_ENTRIES / 2U;
+        decoder->mp3_index_stride *= 2U;
+    }
+    if (frame == decoder->mp3_index_count * decoder->mp3_index_stride) {
+        decoder->mp3_index[decoder->mp3_index_count++] = (uint32_t)offset;
+    }
+}
+
+/* Moves the input to 'offset' and drops everything buffered or decoded. */
+static bool mp3_reposition(FormatDecoder* decoder, long offset) {
+    mp3dec_init(&decoder->mp3d);
     decoder->buffer_pos = 0;
     decoder->buffer_len = 0;
     decoder->pcm_size = 0;
     decoder->pcm_pos = 0;
+    decoder->mp3_input_eof = false;
+    decoder->mp3_buffer_offset = offset;
+    return offset >= 0 && ByteSource_Seek(&decoder->source, (uint64_t)offset);
+}
 
-    // Read first frame to get format info
-    if (!read_next_frame(decoder)) {
-        return false;
+/* Tops the input buffer up, carrying the unread tail (a partial frame) over
+ * to the front so no frame is split across a refill. A source that can map
+ * its bytes instead exposes everything from the read position on at once. */
+static void mp3_refill(FormatDecoder* decoder) {
+    long offset = decoder->mp3_buffer_offset + (long)decoder->buffer_pos;
+    size_t mapped_len = 0;
+    const uint8_t* mapped = ByteSource_Map(&decoder->source, (uint64_t)offset, &mapped_len);
+    if (mapped) {
+        decoder->input = mapped;
+        decoder->mp3_buffer_offset = offset;
+        decoder->buffer_pos = 0;
+        decoder->buffer_len = mapped_len;
+        decoder->mp3_input_eof = true;
+        return;
     }
 
-    return true;
+    decoder->input = decoder->buffer;
+    size_t remaining = decoder->buffer_len - decoder->buffer_pos;
+    if (decoder->buffer_pos > 0) {
+        memmove(decoder->buffer, decoder->buffer + decoder->buffer_pos, remaining);
+        decoder->mp3_buffer_offset += (long)decoder->buffer_pos;
+        decoder->buffer_pos = 0;
+    }
+    size_t bytes_read = ByteSource_Read(&decoder->source, decoder->buffer + remaining,
+                                        decoder->buffer_size - remaining);
+    decoder->buffer_len = remaining + bytes_read;
+    if (bytes_read < decoder->buffer_size - remaining) {
+        decoder->mp3_input_eof = true;
+    }
 }
 
-static bool read_next_frame(FormatDecoder* decoder) {
-    if (!decoder->file || !decoder->buffer) {
-        return false;
+/*
+ * Restarts minimp3 at the frame boundary at buffer_pos. The synthesis and
+ * bit-reservoir state is cleared, but the decoder stays locked to that
+ * frame's header, so decoding resumes without minimp3's multi-frame sync
+ * search (which fails within a few frames of an ID3v1 tag at end of file).
+ */
+static void mp3_restart_at_frame(FormatDecoder* decoder) {
+    int free_format_bytes = decoder->mp3d.free_format_bytes;
+    memset(&decoder->mp3d, 0, sizeof(decoder->mp3d));
+    decoder->mp3d.free_format_bytes = free_format_bytes;
+    if (decoder->buffer_len - decoder->buffer_pos < MP3_REFILL_THRESHOLD && !decoder->mp3_input_eof) {
+        mp3_refill(decoder);
     }
+    if (decoder->buffer_len - decoder->buffer_pos >= sizeof(decoder->mp3d.header)) {
+        memcpy(decoder->mp3d.header, decoder->input + decoder->buffer_pos, sizeof(decoder->mp3d.header));
+    }
+}
 
-    // Iterate to find the next decodable frame; avoid recursion to prevent stack overflow
+/*
+ * Parses the next frame. With 'pcm' set it is decoded into 'pcm'; without,
+ * only its header is read, which is how seeks walk forward cheaply. Frames
+ * are counted and indexed either way. Returns the samples per channel the
+ * frame produced (0 for a frame minimp3 could not decode, e.g. one whose bit
+ * reservoir precedes a seek point), or -1 at the end of the stream.
+ */
+static int mp3_next_frame(FormatDecoder* decoder, mp3d_sample_t* pcm) {
     for (;;) {
-        // Refill encoded buffer if exhausted
-        if (decoder->buffer_pos >= decoder->buffer_len) {
-            size_t bytes_read = fread(decoder->buffer, 1, decoder->buffer_size, decoder->file);
-            if (bytes_read == 0) {
-                return false; // End of file
-            }
-            decoder->buffer_pos = 0;
-            decoder->buffer_len = bytes_read;
+        if (decoder->buffer_len - decoder->buffer_pos < MP3_REFILL_THRESHOLD && !decoder->mp3_input_eof) {
+            mp3_refill(decoder);
+        }
+        size_t remaining = decoder->buffer_len - decoder->buffer_pos;
+        if (remaining == 0) {
+            return -1;
         }
 
-        int16_t frame_buffer[MINIMP3_MAX_SAMPLES_PER_FRAME];
+        // hz is only written when minimp3 finds a frame header.
+        decoder->frame_info.hz = 0;
         int samples = mp3dec_decode_frame(&decoder->mp3d,
-                                          decoder->buffer + decoder->buffer_pos,
-                                          decoder->buffer_len - decoder->buffer_pos,
-                                          frame_buffer,
+                                          decoder->input + decoder->buffer_pos,
+                                          (int)remaining,
+                                          pcm,
                                           &decoder->frame_info);
-
-        if (samples <= 0) {
-            // Advance by reported frame bytes if available, else by 1 byte to search for sync
-            int advance = decoder->frame_info.frame_bytes > 0 ? decoder->frame_info.frame_bytes : 1;
-            decoder->buffer_pos += (size_t)advance;
+        if (decoder->frame_info.hz == 0) {
+            // No frame in what is buffered. Drop it but keep a tail short of
+            // the refill threshold, which may hold the start of one, unless
+            // the file is exhausted.
+            if (decoder->mp3_input_eof) {
+                decoder->buffer_pos = decoder->buffer_len;
+                return -1;
+            }
+            decoder->buffer_pos += (remaining >= MP3_REFILL_THRESHOLD) ? remaining - MP3_REFILL_THRESHOLD + 1U : 1U;
             continue;
         }
 
-        // We decoded a frame. Copy to PCM buffer (interleaved int16)
-        uint32_t channels = (decoder->frame_info.channels == 0) ? 2U : (uint32_t)decoder->frame_info.channels;
-        size_t bytes = (size_t)samples * (size_t)channels * sizeof(int16_t);
-        if (bytes > decoder->pcm_capacity) {
-            size_t new_cap = bytes;
-            // round up to at least 4KB to limit realloc frequency
-            if (new_cap < 4096) new_cap = 4096;
-            uint8_t* newbuf = (uint8_t*)realloc(decoder->pcm_buffer, new_cap);
-            if (!newbuf) {
-                return false;
-            }
-            decoder->pcm_buffer = newbuf;
-            decoder->pcm_capacity = new_cap;
+        if (decoder->mp3_frame_known) {
+            mp3_index_note(decoder, decoder->mp3_frame,
+                           decoder->mp3_buffer_offset + (long)decoder->buffer_pos +
+                               (long)decoder->frame_info.frame_offset);
         }
-        memcpy(decoder->pcm_buffer, frame_buffer, bytes);
-        decoder->pcm_size = bytes;
-        decoder->pcm_pos = 0;
-
-        // Advance encoded buffer position by the frame bytes consumed
-        size_t consumed = (size_t)(decoder->frame_info.frame_bytes > 0 ? decoder->frame_info.frame_bytes : 1);
-        decoder->buffer_pos += consumed;
-
-        return true;
+        decoder->mp3_frame++;
+        decoder->buffer_pos += (size_t)decoder->frame_info.frame_bytes;
+        return samples;
     }
 }
 
-static void flac_compact_buffer(FormatDecoder* decoder) {
-    if (!decoder) {
-        return;
-    }
-    if (decoder->flac_pos == 0 || decoder->flac_samples == 0) {
-        return;
+static inline uint32_t mp3_channels(const FormatDecoder* decoder) {
+    return decoder->frame_info.channels ? (uint32_t)decoder->frame_info.channels : 2U;
+}
+
+/* Decodes the next frame into 'pcm', skipping frames that produce no audio.
+ * Returns the samples per channel, or 0 at the end of the stream. */
+static size_t mp3_decode_frame(FormatDecoder* decoder, mp3d_sample_t* pcm) {
+    if (!ByteSource_IsOpen(&decoder->source) || !decoder->buffer) {
+        return 0;
     }
-    if (decoder->flac_pos >= decoder->flac_samples) {
-        decoder->flac_pos = 0;
-        decoder->flac_samples = 0;
-        return;
+    for (;;) {
+        int samples = mp3_next_frame(decoder, pcm);
+        if (samples < 0) {
+            return 0;
+        }
+        if (samples > 0) {
+            return (size_t)samples;
+        }
     }
+}
 
-    size_t remaining = decoder->flac_samples - decoder->flac_pos;
-    memmove(decoder->flac_buffer,
-            decoder->flac_buffer + decoder->flac_pos,
-            remaining * sizeof(float));
-    decoder->flac_samples = remaining;
-    decoder->flac_pos = 0;
+/* Decodes the next frame into the carry-over buffer. */
+static bool read_next_frame(FormatDecoder* decoder) {
+    size_t samples = mp3_decode_frame(decoder, decoder->pcm_buffer);
+    decoder->pcm_size = samples * mp3_channels(decoder);
+    decoder->pcm_pos = 0;
+    return samples > 0;
 }
 
-static bool flac_ensure_capacity(FormatDecoder* decoder, size_t additional_samples) {
-    if (!decoder) {
-        return false;
+static bool mp3_backend_open(FormatDecoder* decoder) {
+    // Input and carry-over buffers belong to the pool slot: allocate them the
+    // first time it plays an MP3. The carry holds at most one decoded frame.
+    if (!decoder->buffer) {
+        decoder->buffer = (uint8_t*)decoder_alloc(MP3_INPUT_BUFFER_SIZE);
+        if (!decoder->buffer) {
+            decoder->last_error = FD_ERROR_MEMORY;
+            return false;
+        }
+        decoder->buffer_size = MP3_INPUT_BUFFER_SIZE;
+    }
+    if (!decoder->pcm_buffer) {
+        decoder->pcm_buffer = (mp3d_sample_t*)decoder_alloc(MINIMP3_MAX_SAMPLES_PER_FRAME *
+                                                            sizeof(mp3d_sample_t));
+        if (!decoder->pcm_buffer) {
+            decoder->last_error = FD_ERROR_MEMORY;
+            return false;
+        }
     }
 
-    flac_compact_buffer(decoder);
+    mp3_reposition(decoder, 0);
+    decoder->mp3_frame = 0;
+    decoder->mp3_frame_known = true;
+    decoder->mp3_index_count = 0;
+    decoder->mp3_index_stride = MP3_SEEK_INDEX_STRIDE;
+    decoder->mp3_total_frames = 0;
+    decoder->mp3_stream_bytes = 0;
+    decoder->mp3_xing = false;
+    decoder->mp3_has_toc = false;
 
-    size_t required = decoder->flac_samples + additional_samples;
-    if (required <= decoder->flac_capacity) {
-        return true;
+    // Read first frame to get format info
+    if (!read_next_frame(decoder)) {
+        return false;
     }
-
-    size_t new_cap = required;
-    if (new_cap < 4096) {
-        new_cap = 4096;
+    decoder->mp3_data_offset = (decoder->mp3_index_count > 0) ? (long)decoder->mp3_index[0] : 0;
+    decoder->mp3_frame_samples = decoder->pcm_size / mp3_channels(decoder);
+
+    // Prefer the exact length from a Xing/Info or VBRI header in the first
+    // frame (VBR encoders always write one). Otherwise estimate from the file
+    // size and the first frame, which is exact for CBR only.
+    long frame_start = decoder->mp3_data_offset - decoder->mp3_buffer_offset;
+    if (frame_start >= 0 && (size_t)frame_start < decoder->buffer_len) {
+        size_t frame_len = (size_t)decoder->frame_info.frame_bytes - (size_t)decoder->frame_info.frame_offset;
+        if ((size_t)frame_start + frame_len > decoder->buffer_len) {
+            frame_len = decoder->buffer_len - (size_t)frame_start;
+        }
+        decoder->mp3_xing = parse_vbr_header(decoder, decoder->input + frame_start, frame_len);
+    }
+    if (!decoder->mp3_xing) {
+        decoder->mp3_total_frames = 0;
+        decoder->mp3_stream_bytes = 0;
+        decoder->mp3_has_toc = false;
     }
 
-    float* newbuf = (float*)realloc(decoder->flac_buffer, new_cap * sizeof(float));
-    if (!newbuf) {
-        return false;
+    long file_bytes = (long)ByteSource_Size(&decoder->source) - decoder->mp3_data_offset;
+    if (file_bytes > 0) {
+        if (decoder->mp3_stream_bytes == 0) {
+            decoder->mp3_stream_bytes = (size_t)file_bytes;
+        }
+        size_t first_frame_bytes = (size_t)decoder->frame_info.frame_bytes - (size_t)decoder->frame_info.frame_offset;
+        if (decoder->mp3_total_frames == 0 && first_frame_bytes > 0) {
+            decoder->mp3_total_frames = (size_t)file_bytes / first_frame_bytes * decoder->mp3_frame_samples;
+        }
     }
-    decoder->flac_buffer = newbuf;
-    decoder->flac_capacity = new_cap;
+
     return true;
 }
 
+/* Records a frame start if it is at least the current spacing past the last
+ * point. When the table is full, every other point is dropped and the
+ * spacing doubles. Points only ever extend the table forwards. */
+static void flac_note_point(FormatDecoder* decoder, uint64_t sample, uint64_t offset) {
+    size_t count = decoder->flac_point_count;
+    if (count > 0 && sample < decoder->flac_points[count - 1].sample + decoder->flac_point_spacing) {
+        return;
+    }
+    if (count == FLAC_SEEK_POINTS) {
+        for (size_t i = 0; i < FLAC_SEEK_POINTS / 2U; i++) {
+            decoder->flac_points[i] = decoder->flac_points[i * 2U];
+        }
+        count = FLAC_SEEK_POINTS / 2U;
+        decoder->flac_point_spacing *= 2U;
+    }
+    decoder->flac_points[count].sample = sample;
+    decoder->flac_points[count].offset = offset;
+    decoder->flac_point_count = count + 1U;
+}
+
 static FLAC__StreamDecoderWriteStatus flac_write_callback(
     const FLAC__StreamDecoder* flac_decoder,
     const FLAC__Frame* frame,
     const FLAC__int32* const buffer[],
     void* client_data) {
-    (void)flac_decoder;
     if (!frame || !buffer || !client_data) {
         return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
     }
@@ -469,9 +817,33 @@ static FLAC__StreamDecoderWriteStatus flac_write_callback(
         return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
     }
 
+    // The decode position is now the end of this frame: the next one's start.
+    uint64_t first_sample = frame->header.number.sample_number;
+    FLAC__uint64 next_offset;
+    if (!decoder->flac_has_seektable &&
+        FLAC__stream_decoder_get_decode_position(flac_decoder, &next_offset)) {
+        flac_note_point(decoder, first_sample + blocksize, next_offset);
+    }
+
+    // Seeking from a recorded point: drop everything before the target.
+    uint32_t skip = 0;
+    if (decoder->flac_skipping) {
+        if (first_sample + blocksize <= decoder->flac_skip_to) {
+            return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
+        }
+        if (decoder->flac_skip_to > first_sample) {
+            skip = (uint32_t)(decoder->flac_skip_to - first_sample);
+        }
+        decoder->flac_skipping = false;
+    }
+
     if (decoder->flac_channels == 0) {
         decoder->flac_channels = channels;
     }
+    if (channels != decoder->flac_channels) {
+        decoder->last_error = FD_ERROR_DECODE;  // readers interleave for STREAMINFO's layout
+        return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
+    }
     uint8_t bits = frame->header.bits_per_sample;
     if (bits == 0) {
         bits = decoder->flac_bits_per_sample;
@@ -480,28 +852,14 @@ static FLAC__StreamDecoderWriteStatus flac_write_callback(
         bits = 16;
     }
 
-    size_t frame_samples = (size_t)blocksize * (size_t)channels;
-    if (!flac_ensure_capacity(decoder, frame_samples)) {
-        decoder->last_error = FD_ERROR_MEMORY;
-        return FLAC__STREAM_DECODER_WRITE_STATUS_ABORT;
-    }
-
-    double scale = (bits <= 31) ? (double)(1u << (bits - 1)) : 2147483648.0;
-    float* dest = decoder->flac_buffer + decoder->flac_samples;
-
-    for (uint32_t i = 0; i < blocksize; i++) {
-        for (uint32_t ch = 0; ch < channels; ch++) {
-            float sample = (float)((double)buffer[ch][i] / scale);
-            if (sample > 1.0f) {
-                sample = 1.0f;
-            } else if (sample < -1.0f) {
-                sample = -1.0f;
-            }
-            *dest++ = sample;
-        }
+    // Nothing is copied here: the reader interleaves straight out of the
+    // planes, so no PCM buffer sized for the worst-case block is needed.
+    for (uint32_t ch = 0; ch < channels; ch++) {
+        decoder->flac_planes[ch] = buffer[ch];
     }
-
-    decoder->flac_samples += frame_samples;
+    decoder->flac_scale = 1.0f / (float)(1ULL << (bits - 1U));
+    decoder->flac_frame_len = blocksize;
+    decoder->flac_frame_pos = skip;
     return FLAC__STREAM_DECODER_WRITE_STATUS_CONTINUE;
 }
 
@@ -518,7 +876,10 @@ static void flac_metadata_callback(const FLAC__StreamDecoder* flac_decoder,
         decoder->flac_sample_rate = metadata->data.stream_info.sample_rate;
         decoder->flac_channels = metadata->data.stream_info.channels;
         decoder->flac_bits_per_sample = metadata->data.stream_info.bits_per_sample;
+        decoder->flac_total_samples = metadata->data.stream_info.total_samples;
         decoder->format_info.sampling_rate = decoder->flac_sample_rate;
+    } else if (metadata->type == FLAC__METADATA_TYPE_SEEKTABLE) {
+        decoder->flac_has_seektable = metadata->data.seek_table.num_points > 0;
     }
 }
 
@@ -534,22 +895,71 @@ static void flac_error_callback(const FLAC__StreamDecoder* flac_decoder,
     decoder->last_error = FD_ERROR_DECODE;
 }
 
+/* libFLAC reads through the decoder's ByteSource. */
+static FLAC__StreamDecoderReadStatus flac_read_callback(const FLAC__StreamDecoder* flac_decoder,
+                                                        FLAC__byte buffer[], size_t* bytes,
+                                                        void* client_data) {
+    (void)flac_decoder;
+    FormatDecoder* decoder = (FormatDecoder*)client_data;
+    if (*bytes == 0) {
+        return FLAC__STREAM_DECODER_READ_STATUS_ABORT;
+    }
+    *bytes = ByteSource_Read(&decoder->source, buffer, *bytes);
+    return (*bytes == 0) ? FLAC__STREAM_DECODER_READ_STATUS_END_OF_STREAM
+                         : FLAC__STREAM_DECODER_READ_STATUS_CONTINUE;
+}
+
+static FLAC__StreamDecoderSeekStatus flac_seek_callback(const FLAC__StreamDecoder* flac_decoder,
+                                                        FLAC__uint64 offset, void* client_data) {
+    (void)flac_decoder;
+    FormatDecoder* decoder = (FormatDecoder*)client_data;
+    return ByteSource_Seek(&decoder->source, offset) ? FLAC__STREAM_DECODER_SEEK_STATUS_OK
+                                                     : FLAC__STREAM_DECODER_SEEK_STATUS_ERROR;
+}
+
+static FLAC__StreamDecoderTellStatus flac_tell_callback(const FLAC__StreamDecoder* flac_decoder,
+                                                        FLAC__uint64* offset, void* client_data) {
+    (void)flac_decoder;
+    *offset = ByteSource_Tell(&((FormatDecoder*)client_data)->source);
+    return FLAC__STREAM_DECODER_TELL_STATUS_OK;
+}
+
+static FLAC__StreamDecoderLengthStatus flac_length_callback(const FLAC__StreamDecoder* flac_decoder,
+                                                            FLAC__uint64* length, void* client_data) {
+    (void)flac_decoder;
+    *length = ByteSource_Size(&((FormatDecoder*)client_data)->source);
+    return FLAC__STREAM_DECODER_LENGTH_STATUS_OK;
+}
+
+static FLAC__bool flac_eof_callback(const FLAC__StreamDecoder* flac_decoder, void* client_data) {
+    (void)flac_decoder;
+    const ByteSource* source = &((FormatDecoder*)client_data)->source;
+    return ByteSource_Tell(source) >= ByteSource_Size(source);
+}
+
 static bool init_flac_decoder(FormatDecoder* decoder) {
-    if (!decoder || !decoder->file) {
+    if (!decoder || !ByteSource_IsOpen(&decoder->source)) {
         return false;
     }
 
-    decoder->flac_decoder = FLAC__stream_decoder_new();
     if (!decoder->flac_decoder) {
-        decoder->last_error = FD_ERROR_MEMORY;
-        return false;
+        decoder->flac_decoder = FLAC__stream_decoder_new();
+        if (!decoder->flac_decoder) {
+            decoder->last_error = FD_ERROR_MEMORY;
+            return false;
+        }
     }
 
     FLAC__stream_decoder_set_metadata_respond(decoder->flac_decoder, FLAC__METADATA_TYPE_STREAMINFO);
+    FLAC__stream_decoder_set_metadata_respond(decoder->flac_decoder, FLAC__METADATA_TYPE_SEEKTABLE);
 
-    FLAC__StreamDecoderInitStatus status = FLAC__stream_decoder_init_FILE(
+    FLAC__StreamDecoderInitStatus status = FLAC__stream_decoder_init_stream(
         decoder->flac_decoder,
-        decoder->file,
+        flac_read_callback,
+        flac_seek_callback,
+        flac_tell_callback,
+        flac_length_callback,
+        flac_eof_callback,
         flac_write_callback,
         flac_metadata_callback,
         flac_error_callback,
@@ -569,81 +979,186 @@ static bool init_flac_decoder(FormatDecoder* decoder) {
         return false;
     }
 
-    if (decoder->flac_sample_rate != 44100U && decoder->flac_sample_rate != 48000U) {
+    /* Rates other than the output clock are resampled by the buffer producer,
+     * so accept anything within the advertised capability range. */
+    if (decoder->flac_sample_rate < flac_capabilities.min_sample_rate ||
+        decoder->flac_sample_rate > flac_capabilities.max_sample_rate) {
         decoder->last_error = FD_ERROR_INVALID_PARAM;
         return false;
     }
 
     decoder->flac_eof = false;
-    decoder->flac_samples = 0;
-    decoder->flac_pos = 0;
+    decoder->flac_frame_len = 0;
+    decoder->flac_frame_pos = 0;
     return true;
 }
 
 static bool flac_backend_open(FormatDecoder* decoder) {
+    decoder->flac_has_seektable = false;
+    decoder->flac_skipping = false;
+    decoder->flac_point_count = 0;
+    decoder->flac_point_spacing = FLAC_SEEK_POINT_SPACING;
     return init_flac_decoder(decoder);
 }
 
-static size_t mp3_backend_read(FormatDecoder* decoder, float* buffer, size_t frames) {
+/*
+ * minimp3 writes mp3d_sample_t: int16 by default, float when it is built with
+ * MINIMP3_FLOAT_OUTPUT (NUNO_MP3_FLOAT_OUTPUT in CMake). Reads in that native
+ * format decode straight into the caller's buffer whenever a whole frame
+ * fits, so each sample is written once; only the frame that straddles the
+ * end of a read goes through the carry-over. Reads in the other format
+ * decode into the carry and convert on the way out.
+ */
+#ifdef MINIMP3_FLOAT_OUTPUT
+typedef int16_t mp3_converted_t;
+
+/* Rounds like minimp3's scalar int16 synthesis (the path Cortex-M takes).
+ * mp3dec_f32_to_s16() rounds differently on its SIMD and scalar paths, so
+ * its output would depend on how a read is chunked. */
+static void mp3_convert(const mp3d_sample_t* in, mp3_converted_t* out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        float sample = in[i] * 32768.0f;
+        if (sample >= 32766.5f) {
+            out[i] = 32767;
+        } else if (sample <= -32767.5f) {
+            out[i] = -32768;
+        } else {
+            int16_t s = (int16_t)(sample + 0.5f);
+            out[i] = (int16_t)(s - (s < 0));
+        }
+    }
+}
+#else
+typedef float mp3_converted_t;
+
+static void mp3_convert(const mp3d_sample_t* in, mp3_converted_t* out, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        out[i] = (float)in[i] * (1.0f / 32768.0f);
+    }
+}
+#endif
+
+/* Copies what is left of the carry-over; returns the frames copied. */
+static size_t mp3_take_carry(FormatDecoder* decoder, mp3d_sample_t* native,
+                             mp3_converted_t* converted, size_t frames) {
+    uint32_t channels = mp3_channels(decoder);
+    size_t count = decoder->pcm_size - decoder->pcm_pos;
+    if (count > frames * channels) {
+        count = frames * channels;
+    }
+    const mp3d_sample_t* src = decoder->pcm_buffer + decoder->pcm_pos;
+    if (native) {
+        memcpy(native, src, count * sizeof(mp3d_sample_t));
+    } else {
+        mp3_convert(src, converted, count);
+    }
+    decoder->pcm_pos += count;
+    return count / channels;
+}
+
+/*
+ * Fills 'native' or 'converted' with up to 'frames' frames. The caller laid
+ * its buffer out for the channel count it saw on entry, so the read stops
+ * early if the stream changes layout and leaves that frame in the carry.
+ */
+static size_t mp3_read_frames(FormatDecoder* decoder, mp3d_sample_t* native,
+                              mp3_converted_t* converted, size_t frames) {
+    const uint32_t entry_channels = mp3_channels(decoder);
     size_t frames_read = 0;
 
     while (frames_read < frames) {
-        // If we have decoded PCM available, copy it
+        size_t offset = frames_read * entry_channels;
         if (decoder->pcm_pos < decoder->pcm_size) {
-            uint32_t channels = decoder->frame_info.channels ? (uint32_t)decoder->frame_info.channels : 2U;
-            size_t bytes_per_frame = (size_t)channels * sizeof(int16_t);
-            size_t bytes_available = decoder->pcm_size - decoder->pcm_pos;
-            size_t bytes_needed = (frames - frames_read) * bytes_per_frame;
-            if (bytes_needed > bytes_available) {
-                bytes_needed = bytes_available;
-            }
+            frames_read += mp3_take_carry(decoder, native ? native + offset : NULL,
+                                          converted ? converted + offset : NULL,
+                                          frames - frames_read);
+            continue;
+        }
 
-            size_t samples_to_copy = bytes_needed / sizeof(int16_t);
-            int16_t* int_buffer = (int16_t*)(decoder->pcm_buffer + decoder->pcm_pos);
-            for (size_t i = 0; i < samples_to_copy; i++) {
-                buffer[frames_read * channels + i] = int_buffer[i] / 32768.0f;
+        // Whole frame fits: decode in place. Sized for the largest frame
+        // minimp3 can emit, so a layout change cannot overrun the buffer.
+        if (native && (frames - frames_read) * entry_channels >= MINIMP3_MAX_SAMPLES_PER_FRAME) {
+            size_t samples = mp3_decode_frame(decoder, native + offset);
+            if (samples == 0) {
+                break;  // End of file
             }
-
-            decoder->pcm_pos += bytes_needed;
-            frames_read += bytes_needed / bytes_per_frame;
-            if (frames_read >= frames) {
+            if (mp3_channels(decoder) != entry_channels) {
+                decoder->pcm_size = samples * mp3_channels(decoder);
+                decoder->pcm_pos = 0;
+                memcpy(decoder->pcm_buffer, native + offset, decoder->pcm_size * sizeof(mp3d_sample_t));
                 break;
             }
+            frames_read += samples;
+            continue;
         }
 
-        // Need to decode next frame into PCM buffer
         if (!read_next_frame(decoder)) {
-            break; // End of file
+            break;  // End of file
+        }
+        if (mp3_channels(decoder) != entry_channels) {
+            break;
         }
     }
 
     return frames_read;
 }
 
+#ifdef MINIMP3_FLOAT_OUTPUT
+static size_t mp3_backend_read(FormatDecoder* decoder, float* buffer, size_t frames) {
+    return mp3_read_frames(decoder, buffer, NULL, frames);
+}
+
+static size_t mp3_backend_read_s16(FormatDecoder* decoder, int16_t* buffer, size_t frames) {
+    return mp3_read_frames(decoder, NULL, buffer, frames);
+}
+#else
+static size_t mp3_backend_read(FormatDecoder* decoder, float* buffer, size_t frames) {
+    return mp3_read_frames(decoder, NULL, buffer, frames);
+}
+
+/* Bit-exact with minimp3's output: no scaling on this path. */
+static size_t mp3_backend_read_s16(FormatDecoder* decoder, int16_t* buffer, size_t frames) {
+    return mp3_read_frames(decoder, buffer, NULL, frames);
+}
+#endif
+
+/* Interleaves 'frames' frames of the current FLAC frame into 'out'. The
+ * decoded samples fit in the frame's bit depth, so no clamping is needed. */
+static void flac_interleave(FormatDecoder* decoder, float* out, size_t frames) {
+    const uint32_t channels = decoder->flac_channels;
+    const size_t first = decoder->flac_frame_pos;
+    const float scale = decoder->flac_scale;
+    if (channels == 2U) {
+        const FLAC__int32* left = decoder->flac_planes[0] + first;
+        const FLAC__int32* right = decoder->flac_planes[1] + first;
+        for (size_t i = 0; i < frames; i++) {
+            out[i * 2U] = (float)left[i] * scale;
+            out[i * 2U + 1U] = (float)right[i] * scale;
+        }
+    } else {
+        for (uint32_t ch = 0; ch < channels; ch++) {
+            const FLAC__int32* plane = decoder->flac_planes[ch] + first;
+            for (size_t i = 0; i < frames; i++) {
+                out[i * channels + ch] = (float)plane[i] * scale;
+            }
+        }
+    }
+    decoder->flac_frame_pos += frames;
+}
+
 static size_t flac_backend_read(FormatDecoder* decoder, float* buffer, size_t frames) {
     size_t frames_read = 0;
     uint32_t channels = decoder->flac_channels ? decoder->flac_channels : 2U;
 
     while (frames_read < frames) {
-        size_t samples_available = (decoder->flac_samples > decoder->flac_pos)
-            ? (decoder->flac_samples - decoder->flac_pos)
-            : 0U;
-        size_t frames_available = samples_available / channels;
+        size_t frames_available = decoder->flac_frame_len - decoder->flac_frame_pos;
         if (frames_available > 0) {
             size_t frames_to_copy = frames - frames_read;
             if (frames_to_copy > frames_available) {
                 frames_to_copy = frames_available;
             }
-            size_t samples_to_copy = frames_to_copy * channels;
-            memcpy(&buffer[frames_read * channels],
-                   &decoder->flac_buffer[decoder->flac_pos],
-                   samples_to_copy * sizeof(float));
-            decoder->flac_pos += samples_to_copy;
+            flac_interleave(decoder, &buffer[frames_read * channels], frames_to_copy);
             frames_read += frames_to_copy;
-            if (decoder->flac_pos >= decoder->flac_samples) {
-                decoder->flac_pos = 0;
-                decoder->flac_samples = 0;
-            }
             continue;
         }
 
@@ -651,6 +1166,9 @@ static size_t flac_backend_read(FormatDecoder* decoder, float* buffer, size_t fr
             break;
         }
 
+        // The planes are only valid until libFLAC decodes the next frame.
+        decoder->flac_frame_len = 0;
+        decoder->flac_frame_pos = 0;
         if (!FLAC__stream_decoder_process_single(decoder->flac_decoder)) {
             decoder->last_error = FD_ERROR_DECODE;
             break;
@@ -674,92 +1192,185 @@ size_t format_decoder_read(FormatDecoder* decoder, float* buffer, size_t frames)
     return frames_read;
 }
 
-static void mp3_backend_seek(FormatDecoder* decoder, size_t frame_position) {
-    if (!decoder->file) {
-        decoder->last_error = FD_ERROR_FILE_READ;
-        return;
-    }
+bool format_decoder_supports_s16(const FormatDecoder* decoder) {
+    return decoder && decoder->initialized && decoder->backend &&
+           decoder->backend->read_s16 != NULL;
+}
 
-    // Capture the current read offset (bytes consumed to reach decoder->position
-    // frames) BEFORE we disturb the file pointer, so we can calibrate an
-    // average bytes-per-frame for the approximate seek below.
-    long current_offset = ftell(decoder->file);
+size_t format_decoder_read_s16(FormatDecoder* decoder, int16_t* buffer, size_t frames) {
+    if (!format_decoder_supports_s16(decoder) || !buffer) return 0;
 
-    // Discard any decoded PCM and reset the minimp3 frame state so the next
-    // read decodes from a fresh position rather than from the stale buffer.
-    mp3dec_init(&decoder->mp3d);
-    decoder->buffer_pos = 0;
-    decoder->buffer_len = 0;
-    decoder->pcm_size = 0;
-    decoder->pcm_pos = 0;
+    size_t frames_read = decoder->backend->read_s16(decoder, buffer, frames);
 
-    if (frame_position == 0) {
-        // Seek-to-0 (restart) is EXACT: rewind and re-prime the first frame so
-        // format info / channel counts stay valid for subsequent reads.
-        if (fseek(decoder->file, 0, SEEK_SET) != 0) {
-            decoder->last_error = FD_ERROR_FILE_READ;
-            return;
-        }
-        if (!read_next_frame(decoder)) {
-            decoder->last_error = FD_ERROR_DECODE;
+    decoder->position += frames_read;
+    return frames_read;
+}
+
+/*
+ * Exact seek. Starts from the nearest index point at or before the target
+ * (or from the current position when that is closer), walks frame headers
+ * without decoding to MP3_PREDECODE_FRAMES short of the target, decodes
+ * those to rebuild minimp3's state, then drops the leading samples of the
+ * target frame. The walk extends the index as it goes, so the first seek into
+ * unvisited territory reads forward once and later seeks there are a lookup.
+ * Returns false if the target is past the end of the stream.
+ */
+static bool mp3_seek_exact(FormatDecoder* decoder, size_t frame_position) {
+    const size_t frame_samples = decoder->mp3_frame_samples;
+    const size_t target = frame_position / frame_samples;
+    const size_t start = (target > MP3_PREDECODE_FRAMES) ? target - MP3_PREDECODE_FRAMES : 0;
+
+    size_t entry = start / decoder->mp3_index_stride;
+    if (entry >= decoder->mp3_index_count) {
+        entry = decoder->mp3_index_count - 1U;
+    }
+    size_t entry_frame = entry * decoder->mp3_index_stride;
+    if (decoder->mp3_frame_known && decoder->mp3_frame >= entry_frame && decoder->mp3_frame <= start) {
+        decoder->pcm_size = 0;
+        decoder->pcm_pos = 0;
+    } else {
+        if (!mp3_reposition(decoder, (long)decoder->mp3_index[entry])) {
+            return false;
         }
-        return;
+        decoder->mp3_frame = entry_frame;
+        decoder->mp3_frame_known = true;
+        mp3_restart_at_frame(decoder);
     }
 
-    // APPROXIMATE byte-offset seek for arbitrary targets.
-    //
-    // minimp3 exposes no sample-accurate seek and this decoder keeps no frame
-    // index, so we estimate a byte offset and let read_next_frame() resync to
-    // the next valid frame header. Two estimators, best-effort:
-    //   1. If we have already decoded some frames, use the average
-    //      bytes-per-frame observed so far (current_offset / position).
-    //   2. Otherwise fall back to whole-file proportional placement.
-    // This is fine for scrubbing but is NOT sample-accurate (especially VBR).
-    // TODO: parse the Xing/VBRI TOC or build a frame index for accurate seek.
-    long file_size = 0;
-    if (fseek(decoder->file, 0, SEEK_END) == 0) {
-        file_size = ftell(decoder->file);
+    if (decoder->mp3_frame < start) {
+        while (decoder->mp3_frame < start) {
+            if (mp3_next_frame(decoder, NULL) < 0) {
+                return false;
+            }
+        }
+        // Headers only so far: start decoding from a clean state.
+        mp3_restart_at_frame(decoder);
+    }
+    while (decoder->mp3_frame < target) {
+        if (mp3_next_frame(decoder, decoder->pcm_buffer) < 0) {
+            return false;
+        }
+    }
+    if (!read_next_frame(decoder)) {
+        return false;
     }
 
-    long byte_offset = 0;
-    if (current_offset > 0 && decoder->position > 0) {
-        double bytes_per_frame = (double)current_offset / (double)decoder->position;
-        byte_offset = (long)(bytes_per_frame * (double)frame_position);
-    } else if (file_size > 0) {
-        // No calibration data: assume CBR-ish placement against a nominal frame
-        // length (1152 samples/frame for MPEG-1 Layer III).
-        const double MP3_SAMPLES_PER_FRAME = 1152.0;
-        double approx_frame_bytes =
-            (decoder->frame_info.frame_bytes > 0) ? (double)decoder->frame_info.frame_bytes : 417.0;
-        byte_offset = (long)((double)frame_position / MP3_SAMPLES_PER_FRAME * approx_frame_bytes);
+    size_t skip = (frame_position - target * frame_samples) * mp3_channels(decoder);
+    decoder->pcm_pos = (skip < decoder->pcm_size) ? skip : decoder->pcm_size;
+    return true;
+}
+
+/*
+ * Coarse O(1) seek: a byte offset from the Xing/VBRI TOC, interpolated
+ * between its 1% points, or proportional on the stream length without one.
+ * read_next_frame() resyncs to the next frame header. The frame number this
+ * lands on is not known, so indexing pauses until the next exact seek.
+ */
+static bool mp3_seek_coarse(FormatDecoder* decoder, size_t frame_position) {
+    double fraction = 0.0;
+    if (decoder->mp3_total_frames > 0) {
+        fraction = (double)frame_position / (double)decoder->mp3_total_frames;
+    }
+    if (fraction > 1.0) {
+        fraction = 1.0;
     }
 
-    if (byte_offset < 0) {
-        byte_offset = 0;
+    double byte_fraction = fraction;
+    if (decoder->mp3_has_toc) {
+        double percent = fraction * 100.0;
+        size_t i = (size_t)percent;
+        if (i > 99U) {
+            i = 99U;
+        }
+        double lower = decoder->mp3_toc[i];
+        double upper = (i < 99U) ? decoder->mp3_toc[i + 1U] : 256.0;
+        byte_fraction = (lower + (upper - lower) * (percent - (double)i)) / 256.0;
     }
-    if (file_size > 0 && byte_offset > file_size) {
-        byte_offset = file_size;
+
+    long offset = decoder->mp3_data_offset + (long)(byte_fraction * (double)decoder->mp3_stream_bytes);
+    if (!mp3_reposition(decoder, offset)) {
+        return false;
     }
+    decoder->mp3_frame_known = false;
+    return read_next_frame(decoder);
+}
 
-    if (fseek(decoder->file, byte_offset, SEEK_SET) != 0) {
+/*
+ * SEEK_ACCURATE (the default) is always sample-exact. The other policies
+ * take the exact path only where the index already covers the target and the
+ * coarse TOC seek elsewhere, for scrubbing that must not read ahead.
+ */
+static void mp3_backend_seek(FormatDecoder* decoder, size_t frame_position) {
+    if (!ByteSource_IsOpen(&decoder->source)) {
         decoder->last_error = FD_ERROR_FILE_READ;
         return;
     }
 
-    // Prime the next decodable frame from the new offset. read_next_frame()
-    // resynchronises to the next valid MP3 frame header.
-    if (!read_next_frame(decoder)) {
+    bool indexed = frame_position / decoder->mp3_frame_samples <
+                   decoder->mp3_index_count * decoder->mp3_index_stride;
+    bool ok = (indexed || decoder->config.seeking_behavior == SEEK_ACCURATE)
+                  ? mp3_seek_exact(decoder, frame_position)
+                  : mp3_seek_coarse(decoder, frame_position);
+    if (!ok) {
         decoder->last_error = FD_ERROR_DECODE;
     }
 }
 
+/*
+ * Seeks from a recorded frame start close to the target, for files without
+ * a SEEKTABLE (where libFLAC would otherwise bisect the file): moves the
+ * input there, lets libFLAC resync on that frame and drops the samples ahead
+ * of the target in the write callback. Returns false, leaving the seek to
+ * libFLAC, when no point lies within two spacings of the target.
+ */
+static bool flac_seek_from_point(FormatDecoder* decoder, uint64_t target) {
+    if (decoder->flac_has_seektable || decoder->flac_point_count == 0) {
+        return false;
+    }
+    size_t lo = 0;
+    size_t hi = decoder->flac_point_count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2U;
+        if (decoder->flac_points[mid].sample <= target) {
+            lo = mid + 1U;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == 0) {
+        return false;
+    }
+    const FlacSeekPoint* point = &decoder->flac_points[lo - 1U];
+    if (target - point->sample > 2U * decoder->flac_point_spacing ||
+        !FLAC__stream_decoder_flush(decoder->flac_decoder) ||
+        !ByteSource_Seek(&decoder->source, point->offset)) {
+        return false;
+    }
+
+    decoder->flac_skip_to = target;
+    decoder->flac_skipping = true;
+    while (decoder->flac_skipping &&
+           FLAC__stream_decoder_process_single(decoder->flac_decoder) &&
+           FLAC__stream_decoder_get_state(decoder->flac_decoder) != FLAC__STREAM_DECODER_END_OF_STREAM) {
+    }
+    if (decoder->flac_skipping) {
+        decoder->flac_skipping = false;
+        decoder->flac_frame_len = 0;
+        return false;
+    }
+    return true;
+}
+
 static void flac_backend_seek(FormatDecoder* decoder, size_t frame_position) {
     if (!decoder->flac_decoder) {
         return;
     }
-    decoder->flac_samples = 0;
-    decoder->flac_pos = 0;
+    decoder->flac_frame_len = 0;
+    decoder->flac_frame_pos = 0;
     decoder->flac_eof = false;
+    if (flac_seek_from_point(decoder, (uint64_t)frame_position)) {
+        return;
+    }
     if (!FLAC__stream_decoder_seek_absolute(decoder->flac_decoder, (FLAC__uint64)frame_position)) {
         decoder->last_error = FD_ERROR_DECODE;
     }
@@ -769,6 +1380,9 @@ void format_decoder_seek(FormatDecoder* decoder, size_t frame_position) {
     if (!decoder || !decoder->initialized || !decoder->backend) return;
 
     decoder->last_error = FD_ERROR_NONE;
+    if (!decoder->seek_cache_checked) {
+        seek_cache_load(decoder);
+    }
 
     size_t target_position = frame_position;
 
@@ -800,77 +1414,335 @@ void format_decoder_seek(FormatDecoder* decoder, size_t frame_position) {
     decoder->position = target_position;
 }
 
-static void mp3_backend_close(FormatDecoder* decoder) {
-    if (decoder->buffer) {
-        free(decoder->buffer);
-        decoder->buffer = NULL;
+// ---------------------------------------------------------------------------
+// Seek index cache
+// ---------------------------------------------------------------------------
+
+/*
+ * The MP3 frame index and the FLAC seek points outlive the decoder in one
+ * small file per track under the cache directory. The file is named by a hash
+ * of the track path and keyed inside by path, size and mtime, so an edited or
+ * replaced track simply misses. format_decoder_seek() loads the entry on a
+ * stream's first seek. Closing a stream whose index grew copies it to a
+ * pending record, a memcpy that is fine on the producer thread, and
+ * format_decoder_flush_seek_cache() does the file I/O later from a
+ * low-priority context. Records are native-endian: the cache belongs to the
+ * device that wrote it.
+ */
+#define SEEK_CACHE_MAGIC "NSK1"
+#define SEEK_CACHE_PENDING 2U
+
+typedef struct {
+    char magic[4];
+    uint32_t format;        // enum AudioFormatType
+    uint32_t path_length;
+    uint32_t count;         // entries that follow the path
+    uint64_t stride;        // MP3 frames per entry, or FLAC point spacing in samples
+    uint64_t coverage;      // last indexed sample
+    uint64_t file_size;
+    int64_t file_mtime;
+} SeekCacheHeader;
+
+typedef struct {
+    SeekCacheHeader header;
+    char path[SEEK_CACHE_PATH_MAX];
+    union {
+        uint32_t mp3_index[MP3_SEEK_INDEX_ENTRIES];
+        FlacSeekPoint flac_points[FLAC_SEEK_POINTS];
+    };
+} SeekCacheRecord;
+
+enum { SEEK_CACHE_FREE, SEEK_CACHE_BUSY, SEEK_CACHE_READY };
+
+static char g_seek_cache_dir[SEEK_CACHE_PATH_MAX];
+/* Cache file names: the directory plus "/<16 hex digits>.tmp". */
+#define SEEK_CACHE_NAME_MAX (SEEK_CACHE_PATH_MAX + 22U)
+static SeekCacheRecord g_seek_cache_pending[SEEK_CACHE_PENDING];
+static _Atomic int g_seek_cache_state[SEEK_CACHE_PENDING];
+
+/* FNV-1a; only names the file, the key inside settles collisions. */
+static uint64_t seek_cache_hash(const char* path) {
+    uint64_t hash = 14695981039346656037ULL;
+    for (const unsigned char* p = (const unsigned char*)path; *p; p++) {
+        hash = (hash ^ *p) * 1099511628211ULL;
     }
+    return hash;
+}
 
-    if (decoder->pcm_buffer) {
-        free(decoder->pcm_buffer);
-        decoder->pcm_buffer = NULL;
-        decoder->pcm_capacity = 0;
-        decoder->pcm_size = 0;
-        decoder->pcm_pos = 0;
+static void seek_cache_file_name(char* name, size_t size, const char* path, const char* suffix) {
+    snprintf(name, size, "%s/%016llx%s", g_seek_cache_dir,
+             (unsigned long long)seek_cache_hash(path), suffix);
+}
+
+/* Bytes of index data following the header and path. */
+static size_t seek_cache_entry_size(uint32_t format) {
+    return (format == AUDIO_FORMAT_MP3) ? sizeof(uint32_t) : sizeof(FlacSeekPoint);
+}
+
+/* Last sample the stream's index reaches (0 when there is nothing to cache). */
+static uint64_t seek_index_coverage(const FormatDecoder* decoder) {
+    if (decoder->format_info.format_type == AUDIO_FORMAT_MP3 && decoder->mp3_index_count > 0) {
+        return (uint64_t)(decoder->mp3_index_count - 1U) * decoder->mp3_index_stride *
+               decoder->mp3_frame_samples;
+    }
+    if (decoder->format_info.format_type == AUDIO_FORMAT_FLAC && !decoder->flac_has_seektable &&
+        decoder->flac_point_count > 0) {
+        return decoder->flac_points[decoder->flac_point_count - 1U].sample;
+    }
+    return 0;
+}
+
+bool format_decoder_set_seek_cache_dir(const char* dir) {
+    if (!dir) {
+        g_seek_cache_dir[0] = '\0';
+        return true;
+    }
+    size_t length = strlen(dir);
+    if (length == 0 || length >= sizeof(g_seek_cache_dir)) {
+        return false;
+    }
+    memcpy(g_seek_cache_dir, dir, length + 1U);
+    (void)mkdir(dir, 0755);  // usually exists already
+    return true;
+}
+
+static void seek_cache_key(FormatDecoder* decoder, const char* filepath) {
+    decoder->path[0] = '\0';
+    decoder->seek_cache_checked = false;
+    decoder->seek_cache_coverage = 0;
+
+    struct stat st;
+    size_t length = filepath ? strlen(filepath) : 0;
+    if (g_seek_cache_dir[0] == '\0' || length == 0 || length >= sizeof(decoder->path) ||
+        stat(filepath, &st) != 0) {
+        return;
+    }
+    memcpy(decoder->path, filepath, length + 1U);
+    decoder->file_size = (uint64_t)st.st_size;
+    decoder->file_mtime = (int64_t)st.st_mtime;
+}
+
+/* Reads the entry's header and path; true if it belongs to this exact file. */
+static bool seek_cache_read_key(FILE* file, SeekCacheHeader* header, uint32_t format,
+                                const char* path, uint64_t size, int64_t mtime) {
+    char stored[SEEK_CACHE_PATH_MAX];
+    size_t length = strlen(path);
+    return fread(header, sizeof(*header), 1, file) == 1 &&
+           memcmp(header->magic, SEEK_CACHE_MAGIC, sizeof(header->magic)) == 0 &&
+           header->format == format && header->file_size == size && header->file_mtime == mtime &&
+           header->path_length == length && length < sizeof(stored) &&
+           fread(stored, 1, length, file) == length && memcmp(stored, path, length) == 0;
+}
+
+static void seek_cache_load(FormatDecoder* decoder) {
+    decoder->seek_cache_checked = true;
+    if (decoder->path[0] == '\0') {
+        return;
+    }
+    char name[SEEK_CACHE_NAME_MAX];
+    seek_cache_file_name(name, sizeof(name), decoder->path, ".sk");
+    FILE* file = fopen(name, "rb");
+    if (!file) {
+        return;
+    }
+
+    uint32_t format = (uint32_t)decoder->format_info.format_type;
+    SeekCacheHeader header;
+    if (seek_cache_read_key(file, &header, format, decoder->path, decoder->file_size, decoder->file_mtime) &&
+        header.count > 0 && header.coverage > seek_index_coverage(decoder)) {
+        // The stored index reaches further than what this open has built.
+        if (format == AUDIO_FORMAT_MP3 && header.count <= MP3_SEEK_INDEX_ENTRIES &&
+            header.stride >= MP3_SEEK_INDEX_STRIDE) {
+            if (fread(decoder->mp3_index, sizeof(uint32_t), header.count, file) == header.count) {
+                decoder->mp3_index_count = header.count;
+                decoder->mp3_index_stride = (size_t)header.stride;
+            } else {
+                // Partial read: fall back to the one entry that is always known.
+                decoder->mp3_index[0] = (uint32_t)decoder->mp3_data_offset;
+                decoder->mp3_index_count = 1;
+                decoder->mp3_index_stride = MP3_SEEK_INDEX_STRIDE;
+            }
+        } else if (format == AUDIO_FORMAT_FLAC && !decoder->flac_has_seektable &&
+                   header.count <= FLAC_SEEK_POINTS && header.stride >= FLAC_SEEK_POINT_SPACING) {
+            size_t read = fread(decoder->flac_points, sizeof(FlacSeekPoint), header.count, file);
+            decoder->flac_point_count = (read == header.count) ? header.count : 0;
+            decoder->flac_point_spacing = header.stride;
+        }
+    }
+    decoder->seek_cache_coverage = seek_index_coverage(decoder);
+    fclose(file);
+}
+
+static void seek_cache_queue(FormatDecoder* decoder) {
+    if (!decoder->initialized || decoder->path[0] == '\0') {
+        return;
+    }
+    uint64_t coverage = seek_index_coverage(decoder);
+    if (coverage <= decoder->seek_cache_coverage) {
+        return;
+    }
+    for (size_t i = 0; i < SEEK_CACHE_PENDING; i++) {
+        int expected = SEEK_CACHE_FREE;
+        if (!atomic_compare_exchange_strong(&g_seek_cache_state[i], &expected, SEEK_CACHE_BUSY)) {
+            continue;
+        }
+        SeekCacheRecord* record = &g_seek_cache_pending[i];
+        SeekCacheHeader* header = &record->header;
+        memcpy(header->magic, SEEK_CACHE_MAGIC, sizeof(header->magic));
+        header->format = (uint32_t)decoder->format_info.format_type;
+        header->path_length = (uint32_t)strlen(decoder->path);
+        header->coverage = coverage;
+        header->file_size = decoder->file_size;
+        header->file_mtime = decoder->file_mtime;
+        memcpy(record->path, decoder->path, header->path_length + 1U);
+        if (header->format == AUDIO_FORMAT_MP3) {
+            header->count = (uint32_t)decoder->mp3_index_count;
+            header->stride = decoder->mp3_index_stride;
+            memcpy(record->mp3_index, decoder->mp3_index, header->count * sizeof(uint32_t));
+        } else {
+            header->count = (uint32_t)decoder->flac_point_count;
+            header->stride = decoder->flac_point_spacing;
+            memcpy(record->flac_points, decoder->flac_points, header->count * sizeof(FlacSeekPoint));
+        }
+        atomic_store(&g_seek_cache_state[i], SEEK_CACHE_READY);
+        return;
+    }
+    // Both records are waiting for a flush: drop this one, it is rebuilt the
+    // next time the track plays.
+}
+
+/* Writes one record via a temporary file, unless the stored entry for the
+ * same file already reaches as far. */
+static bool seek_cache_write(const SeekCacheRecord* record) {
+    const SeekCacheHeader* header = &record->header;
+    char name[SEEK_CACHE_NAME_MAX];
+    char temp[SEEK_CACHE_NAME_MAX];
+    seek_cache_file_name(name, sizeof(name), record->path, ".sk");
+    seek_cache_file_name(temp, sizeof(temp), record->path, ".tmp");
+
+    FILE* file = fopen(name, "rb");
+    if (file) {
+        SeekCacheHeader stored;
+        bool current = seek_cache_read_key(file, &stored, header->format, record->path,
+                                           header->file_size, header->file_mtime) &&
+                       stored.coverage >= header->coverage;
+        fclose(file);
+        if (current) {
+            return false;
+        }
+    }
+
+    file = fopen(temp, "wb");
+    if (!file) {
+        return false;
+    }
+    size_t entry_size = seek_cache_entry_size(header->format);
+    const void* entries = (header->format == AUDIO_FORMAT_MP3) ? (const void*)record->mp3_index
+                                                              : (const void*)record->flac_points;
+    bool ok = fwrite(header, sizeof(*header), 1, file) == 1 &&
+              fwrite(record->path, 1, header->path_length, file) == header->path_length &&
+              fwrite(entries, entry_size, header->count, file) == header->count;
+    ok = (fclose(file) == 0) && ok;
+    if (ok) {
+        remove(name);  // rename() does not replace on every filesystem
+        ok = rename(temp, name) == 0;
+    }
+    if (!ok) {
+        remove(temp);
     }
+    return ok;
+}
+
+size_t format_decoder_flush_seek_cache(void) {
+    size_t written = 0;
+    for (size_t i = 0; i < SEEK_CACHE_PENDING; i++) {
+        int expected = SEEK_CACHE_READY;
+        if (!atomic_compare_exchange_strong(&g_seek_cache_state[i], &expected, SEEK_CACHE_BUSY)) {
+            continue;
+        }
+        if (g_seek_cache_dir[0] != '\0' && seek_cache_write(&g_seek_cache_pending[i])) {
+            written++;
+        }
+        atomic_store(&g_seek_cache_state[i], SEEK_CACHE_FREE);
+    }
+    return written;
+}
+
+size_t format_decoder_get_seek_points(const FormatDecoder* decoder) {
+    if (!decoder || !decoder->initialized) {
+        return 0;
+    }
+    if (decoder->format_info.format_type == AUDIO_FORMAT_MP3) {
+        return decoder->mp3_index_count;
+    }
+    return decoder->flac_has_seektable ? 0 : decoder->flac_point_count;
+}
+
+static void mp3_backend_close(FormatDecoder* decoder) {
+    // The buffers stay with the pool slot; only the stream state is dropped.
+    decoder->buffer_pos = 0;
+    decoder->buffer_len = 0;
+    decoder->pcm_size = 0;
+    decoder->pcm_pos = 0;
 }
 
 static void flac_backend_close(FormatDecoder* decoder) {
     if (decoder->flac_decoder) {
         if (FLAC__stream_decoder_get_state(decoder->flac_decoder) !=
             FLAC__STREAM_DECODER_UNINITIALIZED) {
-            // FLAC__stream_decoder_finish() releases the FILE* we handed to
-            // init_FILE(); format_decoder_close() must not fclose() it again.
+            // Stream callbacks: finishing never touches the source, which
+            // format_decoder_close() closes afterwards.
             (void)FLAC__stream_decoder_finish(decoder->flac_decoder);
         }
-        FLAC__stream_decoder_delete(decoder->flac_decoder);
-        decoder->flac_decoder = NULL;
+        // Kept (uninitialised) with the slot for the next FLAC file.
     }
 
-    if (decoder->flac_buffer) {
-        free(decoder->flac_buffer);
-        decoder->flac_buffer = NULL;
-        decoder->flac_capacity = 0;
-        decoder->flac_samples = 0;
-        decoder->flac_pos = 0;
-    }
+    decoder->flac_frame_len = 0;
+    decoder->flac_frame_pos = 0;
     decoder->flac_sample_rate = 0;
     decoder->flac_channels = 0;
     decoder->flac_bits_per_sample = 0;
     decoder->flac_eof = false;
+    decoder->flac_total_samples = 0;
 }
 
 void format_decoder_close(FormatDecoder* decoder) {
     if (!decoder) return;
 
-    // Tear down per-format state first. The teardown order (FLAC decoder before
-    // fclose, see flac_backend_close) is preserved from the original code. The
-    // individual buffer frees are NULL-guarded, so this is safe even when open()
+    seek_cache_queue(decoder);
+
+    // Tear down per-format state first: the FLAC decoder may still read
+    // from the source while it finishes. Neither teardown frees anything
+    // (buffers stay with the pool slot), so this is safe even when open()
     // failed partway through. We unconditionally run both teardowns to stay
-    // robust against a half-initialised decoder, just like the original close.
+    // robust against a half-initialised decoder.
     mp3_backend_close(decoder);
     flac_backend_close(decoder);
 
-    if (decoder->file) {
-        fclose(decoder->file);
-        decoder->file = NULL;
-    }
+    ByteSource_Close(&decoder->source);
+    decoder->input = NULL;
 
     decoder->backend = NULL;
     decoder->initialized = false;
 
     // Free any format-specific data
-    if (decoder->format_specific_data) {
-        free(decoder->format_specific_data);
-        decoder->format_specific_data = NULL;
-    }
+    decoder_free(decoder->format_specific_data);
+    decoder->format_specific_data = NULL;
 }
 
 void format_decoder_destroy(FormatDecoder* decoder) {
     if (!decoder) return;
     
     format_decoder_close(decoder);
-    free(decoder);
+
+    size_t slot = (size_t)(decoder - g_pool);
+    if (slot < FORMAT_DECODER_POOL_SIZE) {
+        atomic_store_explicit(&g_pool_in_use[slot], false, memory_order_release);
+    }
+}
+
+size_t format_decoder_get_heap_calls(void) {
+    return atomic_load_explicit(&g_heap_calls, memory_order_relaxed);
 }
 
 static uint32_t mp3_backend_get_channels(const FormatDecoder* decoder) {
@@ -881,6 +1753,10 @@ static uint32_t mp3_backend_get_sample_rate(const FormatDecoder* decoder) {
     return (uint32_t)decoder->frame_info.hz;
 }
 
+static size_t mp3_backend_get_total_frames(const FormatDecoder* decoder) {
+    return decoder->mp3_total_frames;
+}
+
 static uint32_t flac_backend_get_channels(const FormatDecoder* decoder) {
     return decoder->flac_channels;
 }
@@ -889,6 +1765,10 @@ static uint32_t flac_backend_get_sample_rate(const FormatDecoder* decoder) {
     return decoder->flac_sample_rate;
 }
 
+static size_t flac_backend_get_total_frames(const FormatDecoder* decoder) {
+    return (size_t)decoder->flac_total_samples;
+}
+
 uint32_t format_decoder_get_channels(const FormatDecoder* decoder) {
     if (!decoder || !decoder->initialized || !decoder->backend) {
         return 0;
@@ -903,6 +1783,18 @@ uint32_t format_decoder_get_sample_rate(const FormatDecoder* decoder) {
     return decoder->backend->get_sample_rate(decoder);
 }
 
+size_t format_decoder_get_total_frames(const FormatDecoder* decoder) {
+    if (!decoder || !decoder->initialized || !decoder->backend ||
+        !decoder->backend->get_total_frames) {
+        return 0;
+    }
+    return decoder->backend->get_total_frames(decoder);
+}
+
+size_t format_decoder_get_position(const FormatDecoder* decoder) {
+    return decoder ? decoder->position : 0;
+}
+
 enum AudioFormatType format_decoder_get_format_type(const FormatDecoder* decoder) {
     return decoder ? decoder->format_info.format_type : AUDIO_FORMAT_UNKNOWN;
 }
@@ -1078,7 +1970,8 @@ const char* format_decoder_error_string(enum FormatDecoderError error) {
 // Backend vtables + selector
 //
 // Each format implements the DecoderBackend interface above. To add a new
-// format: implement <fmt>_backend_{open,read,seek,close,get_*}, register a
+// format: implement <fmt>_backend_{open,read,seek,close,get_*} (and read_s16
+// if the codec decodes to int16), register a
 // static const DecoderBackend below, and add a case to backend_for_format()
 // plus detection in detect_audio_format().
 // TODO: add aac/wav/ogg backends here.
@@ -1087,19 +1980,23 @@ const char* format_decoder_error_string(enum FormatDecoderError error) {
 static const DecoderBackend mp3_backend = {
     .open            = mp3_backend_open,
     .read            = mp3_backend_read,
+    .read_s16        = mp3_backend_read_s16,
     .seek            = mp3_backend_seek,
     .close           = mp3_backend_close,
     .get_channels    = mp3_backend_get_channels,
     .get_sample_rate = mp3_backend_get_sample_rate,
+    .get_total_frames = mp3_backend_get_total_frames,
 };
 
 static const DecoderBackend flac_backend = {
     .open            = flac_backend_open,
     .read            = flac_backend_read,
+    .read_s16        = NULL,
     .seek            = flac_backend_seek,
     .close           = flac_backend_close,
     .get_channels    = flac_backend_get_channels,
     .get_sample_rate = flac_backend_get_sample_rate,
+    .get_total_frames = flac_backend_get_total_frames,
 };
 
 static const DecoderBackend* backend_for_format(enum AudioFormatType format_type) {
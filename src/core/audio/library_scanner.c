@@ -0,0 +1,1452 @@
+#define _POSIX_C_SOURCE 200809L  // opendir/stat, threads and sysconf on hosts
+
+#include "nuno/library_scanner.h"
+
+#include "nuno/music_catalog.h"
+#include "nuno/tag_reader.h"
+
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <dirent.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdatomic.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#define LIBRARY_SCANNER_HAVE_DIRENT 1
+#endif
+
+#if !defined(PATH_MAX)
+#define PATH_MAX 512
+#endif
+
+/* Longest title/album/artist kept; longer names are cut. */
+#define SCAN_NAME_MAX 128U
+
+/* Directory entries per task, so one large directory still spreads across
+ * every worker. */
+#define SCAN_BATCH_ENTRIES 32U
+
+/* Workers' string arenas grow in blocks of this size. */
+#define SCAN_ARENA_BLOCK (64U * 1024U)
+
+/* Failed steal rounds a worker yields through before it starts sleeping. */
+#define SCAN_IDLE_SPINS 64U
+
+static unsigned g_thread_count;  // 0: one per core
+
+static bool has_audio_extension(const char *name) {
+    const char *dot = strrchr(name, '.');
+    if (!dot) {
+        return false;
+    }
+    static const char *const k_extensions[] = { ".mp3", ".flac" };
+    for (size_t i = 0; i < sizeof(k_extensions) / sizeof(k_extensions[0]); i++) {
+        const char *ext = k_extensions[i];
+        size_t n = 0;
+        while (ext[n] && dot[n] && (dot[n] | 0x20) == ext[n]) {
+            n++;
+        }
+        if (!ext[n] && !dot[n]) {
+            return true;
+        }
+    }
+    return false;
+}
+
+/* Copies at most SCAN_NAME_MAX - 1 bytes of [start, end), underscores as
+ * spaces and surrounding blanks trimmed. */
+static void copy_name(char *dst, const char *start, const char *end) {
+    while (start < end && (*start == ' ' || *start == '_')) {
+        start++;
+    }
+    while (end > start && (end[-1] == ' ' || end[-1] == '_')) {
+        end--;
+    }
+    size_t length = (size_t)(end - start);
+    if (length >= SCAN_NAME_MAX) {
+        length = SCAN_NAME_MAX - 1U;
+    }
+    for (size_t i = 0; i < length; i++) {
+        dst[i] = (start[i] == '_') ? ' ' : start[i];
+    }
+    dst[length] = '\0';
+}
+
+/* Finds the next " - " / "_-_" field separator in [text, end). */
+static const char *find_separator(const char *text, const char *end) {
+    for (const char *p = text; p + 3 <= end; p++) {
+        if ((p[0] == ' ' || p[0] == '_') && p[1] == '-' && (p[2] == ' ' || p[2] == '_')) {
+            return p;
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Splits a leading track number ("02 ", "2. ", "02-", or "1-02 " with a disc
+ * number) off a title, when a title remains. Returns where the title starts.
+ */
+static const char *split_track_number(const char *start, const char *end, uint16_t *track,
+                                      uint16_t *disc) {
+    unsigned numbers[2] = { 0U, 0U };
+    unsigned found = 0U;
+    const char *p = start;
+    while (found < 2U && p < end && *p >= '0' && *p <= '9') {
+        const char *digits = p;
+        while (p < end && *p >= '0' && *p <= '9' && p - digits < 3) {
+            numbers[found] = numbers[found] * 10U + (unsigned)(*p++ - '0');
+        }
+        if (p < end && *p >= '0' && *p <= '9') {
+            return start;  // four digits or more: a year or part of the title
+        }
+        found++;
+        if (found == 1U && p + 1 < end && *p == '-' && p[1] >= '0' && p[1] <= '9') {
+            p++;  // disc-track
+        } else {
+            break;
+        }
+    }
+    if (found == 0U) {
+        return start;
+    }
+    const char *title = p;
+    while (title < end && (*title == ' ' || *title == '_' || *title == '.' || *title == '-')) {
+        title++;
+    }
+    if (title == p || title >= end) {
+        return start;
+    }
+    *track = (uint16_t)numbers[found - 1U];
+    *disc = (found == 2U) ? (uint16_t)numbers[0] : 0U;
+    return title;
+}
+
+/* Last component of the directory 'path' ends at 'end'; "" at the root. */
+static void directory_name(char *dst, const char *path, size_t end, size_t root_length) {
+    if (end <= root_length) {
+        dst[0] = '\0';
+        return;
+    }
+    const char *start = path + end;
+    while (start > path + root_length + 1U && start[-1] != '/') {
+        start--;
+    }
+    copy_name(dst, start, path + end);
+}
+
+
+/*
+ * Fields the file's tags lack come from its name ("Artist_-_Album_-_NN_Title")
+ * or, failing that, its parent and grandparent directories. 'path' is the
+ * file's full path; its directory is the first 'dir_length' bytes.
+ */
+typedef struct {
+    char title[SCAN_NAME_MAX];
+    char album[SCAN_NAME_MAX];
+    char artist[SCAN_NAME_MAX];
+    uint16_t track_number;
+    uint16_t disc_number;
+} FileNames;
+
+static void names_from_path(FileNames *names, const char *path, size_t dir_length,
+                            size_t root_length, const char *name) {
+    const char *stem_end = strrchr(name, '.');
+    names->track_number = 0U;
+    names->disc_number = 0U;
+    const char *first = find_separator(name, stem_end);
+    const char *second = first ? find_separator(first + 3, stem_end) : NULL;
+    if (second) {
+        copy_name(names->artist, name, first);
+        copy_name(names->album, first + 3, second);
+        copy_name(names->title,
+                  split_track_number(second + 3, stem_end, &names->track_number,
+                                     &names->disc_number),
+                  stem_end);
+        return;
+    }
+    copy_name(names->title,
+              split_track_number(name, stem_end, &names->track_number, &names->disc_number),
+              stem_end);
+    directory_name(names->album, path, dir_length, root_length);
+    size_t parent = dir_length;
+    while (parent > root_length && path[parent - 1U] != '/') {
+        parent--;
+    }
+    directory_name(names->artist, path, parent > root_length ? parent - 1U : parent, root_length);
+}
+
+#ifdef LIBRARY_SCANNER_HAVE_DIRENT
+
+/*
+ * The walk runs on a work-stealing pool. Tasks are "read this directory" and
+ * "stat and tag these (up to SCAN_BATCH_ENTRIES) entries of a directory
+ * already read"; running one can queue more. Each worker pushes and pops at
+ * the back of its own deque (depth first, so its paths stay warm) and, when
+ * that is empty, steals the oldest task from another worker's front.
+ *
+ * Workers never touch the catalog. Each keeps its tracks in its own result
+ * array and string arena, so nothing is shared but the deques and two
+ * counters; once the pool drains, the caller sorts every worker's results
+ * into the order a serial walk visits them and adds them to the catalog, so
+ * the catalog and the database are the same for any thread count.
+ */
+
+typedef struct ArenaBlock {
+    struct ArenaBlock *next;
+    size_t used;
+    char data[];
+} ArenaBlock;
+
+/* A directory: 'names' is NULL until it has been read. Its entry batches
+ * share it; the one that finishes last frees it. */
+typedef struct {
+    char *path;  // full path
+    size_t length;
+    unsigned depth;
+    uint32_t mtime;
+    char **names;
+    size_t count;
+    atomic_size_t batches_left;
+} ScanListing;
+
+typedef struct {
+    ScanListing *listing;
+    size_t start;  // entry batch, when the listing has been read
+    size_t count;
+} ScanTask;
+
+typedef struct {
+    const char *filename;  // relative to the root
+    const char *title;
+    const char *album;
+    const char *artist;
+    uint32_t duration_seconds;
+    uint16_t track_number;
+    uint16_t disc_number;
+    uint32_t file_size;
+    uint32_t file_mtime;
+    bool tagged;
+} ScanResult;
+
+typedef struct {
+    const char *path;  // relative to the root; "" for the root
+    uint32_t mtime;
+} ScanDirectory;
+
+/* Tasks [top, bottom) of a growable array; the owner works at the bottom,
+ * thieves at the top. */
+typedef struct {
+    pthread_mutex_t lock;
+    ScanTask *tasks;
+    size_t top;
+    size_t bottom;
+    size_t capacity;
+} ScanDeque;
+
+struct ScanPool;
+
+typedef struct {
+    struct ScanPool *pool;
+    unsigned index;
+    pthread_t thread;
+    bool started;
+    ScanDeque deque;
+    LibraryScanStats stats;
+    ScanResult *results;
+    size_t result_count;
+    size_t result_capacity;
+    ScanDirectory *directories;
+    size_t directory_count;
+    size_t directory_capacity;
+    ArenaBlock *arena;
+    char path[PATH_MAX];
+    TrackTags tags;
+    uint8_t buffer[TAG_READER_BUDGET_BYTES];  // tag reads
+} ScanWorker;
+
+typedef struct ScanPool {
+    ScanWorker *workers;
+    unsigned count;
+    size_t root_length;
+    atomic_size_t pending;  // tasks queued or running
+    atomic_bool out_of_memory;
+} ScanPool;
+
+static void run_task(ScanWorker *worker, const ScanTask *task);
+
+static char *arena_copy(ScanWorker *worker, const char *text) {
+    size_t length = strlen(text) + 1U;
+    ArenaBlock *block = worker->arena;
+    if (!block || SCAN_ARENA_BLOCK - block->used < length) {
+        size_t size = length > SCAN_ARENA_BLOCK ? length : SCAN_ARENA_BLOCK;
+        block = (ArenaBlock *)malloc(sizeof(ArenaBlock) + size);
+        if (!block) {
+            return NULL;
+        }
+        block->next = worker->arena;
+        block->used = 0U;
+        worker->arena = block;
+    }
+    char *copy = block->data + block->used;
+    memcpy(copy, text, length);
+    block->used += length;
+    return copy;
+}
+
+static void free_listing(ScanListing *listing) {
+    for (size_t i = 0; i < listing->count; i++) {
+        free(listing->names[i]);
+    }
+    free(listing->names);
+    free(listing->path);
+    free(listing);
+}
+
+/* Queues 'task' on 'worker'; runs it at once if the deque cannot grow. */
+static void push_task(ScanWorker *worker, ScanTask task) {
+    ScanDeque *deque = &worker->deque;
+    pthread_mutex_lock(&deque->lock);
+    if (deque->bottom == deque->capacity && deque->top > 0U) {
+        memmove(deque->tasks, deque->tasks + deque->top,
+                (deque->bottom - deque->top) * sizeof(*deque->tasks));
+        deque->bottom -= deque->top;
+        deque->top = 0U;
+    }
+    if (deque->bottom == deque->capacity) {
+        size_t grown = deque->capacity ? deque->capacity * 2U : 64U;
+        ScanTask *resized = (ScanTask *)realloc(deque->tasks, grown * sizeof(*resized));
+        if (!resized) {
+            pthread_mutex_unlock(&deque->lock);
+            run_task(worker, &task);
+            return;
+        }
+        deque->tasks = resized;
+        deque->capacity = grown;
+    }
+    atomic_fetch_add(&worker->pool->pending, 1U);
+    deque->tasks[deque->bottom++] = task;
+    pthread_mutex_unlock(&deque->lock);
+}
+
+static bool take_task(ScanDeque *deque, ScanTask *task, bool steal) {
+    pthread_mutex_lock(&deque->lock);
+    bool found = deque->top < deque->bottom;
+    if (found) {
+        *task = steal ? deque->tasks[deque->top++] : deque->tasks[--deque->bottom];
+        if (deque->top == deque->bottom) {
+            deque->top = 0U;
+            deque->bottom = 0U;
+        }
+    }
+    pthread_mutex_unlock(&deque->lock);
+    return found;
+}
+
+static void add_result(ScanWorker *worker, size_t dir_length, const char *name,
+                       const struct stat *st) {
+    const TrackTags *tags = &worker->tags;
+    FileNames names;
+    names_from_path(&names, worker->path, dir_length, worker->pool->root_length, name);
+
+    if (worker->result_count == worker->result_capacity) {
+        size_t grown = worker->result_capacity ? worker->result_capacity * 2U : 256U;
+        ScanResult *resized =
+            (ScanResult *)realloc(worker->results, grown * sizeof(*resized));
+        if (!resized) {
+            atomic_store(&worker->pool->out_of_memory, true);
+            return;
+        }
+        worker->results = resized;
+        worker->result_capacity = grown;
+    }
+    ScanResult *result = &worker->results[worker->result_count];
+    result->filename = arena_copy(worker, worker->path + worker->pool->root_length + 1U);
+    result->title = arena_copy(worker, tags->title[0] ? tags->title : names.title);
+    result->album = arena_copy(worker, tags->album[0]  ? tags->album
+                                       : names.album[0] ? names.album
+                                                        : "Unknown Album");
+    result->artist = arena_copy(worker, tags->artist[0]  ? tags->artist
+                                        : names.artist[0] ? names.artist
+                                                          : "Unknown Artist");
+    if (!result->filename || !result->title || !result->album || !result->artist) {
+        atomic_store(&worker->pool->out_of_memory, true);
+        return;
+    }
+    result->duration_seconds = tags->duration_seconds;
+    result->track_number = tags->track_number ? tags->track_number : names.track_number;
+    result->disc_number = tags->disc_number ? tags->disc_number : names.disc_number;
+    result->file_size = (uint32_t)st->st_size;
+    result->file_mtime = (uint32_t)st->st_mtime;
+    result->tagged = tags->title[0] != '\0';
+    worker->result_count++;
+}
+
+/* Records a directory that has been read, for the rescan's journal. */
+static void add_directory(ScanWorker *worker, const ScanListing *listing) {
+    size_t root_length = worker->pool->root_length;
+    const char *relative = (listing->length > root_length) ? listing->path + root_length + 1U : "";
+    if (worker->directory_count == worker->directory_capacity) {
+        size_t grown = worker->directory_capacity ? worker->directory_capacity * 2U : 32U;
+        ScanDirectory *resized =
+            (ScanDirectory *)realloc(worker->directories, grown * sizeof(*resized));
+        if (!resized) {
+            atomic_store(&worker->pool->out_of_memory, true);
+            return;
+        }
+        worker->directories = resized;
+        worker->directory_capacity = grown;
+    }
+    ScanDirectory *directory = &worker->directories[worker->directory_count];
+    directory->path = arena_copy(worker, relative);
+    directory->mtime = listing->mtime;
+    if (!directory->path) {
+        atomic_store(&worker->pool->out_of_memory, true);
+        return;
+    }
+    worker->directory_count++;
+}
+
+/* Reads the listing's entries and queues them in batches. */
+static void read_directory(ScanWorker *worker, ScanListing *listing) {
+    DIR *dir = opendir(listing->path);
+    if (!dir) {
+        free_listing(listing);
+        return;
+    }
+    worker->stats.directories++;
+    add_directory(worker, listing);
+
+    size_t capacity = 0U;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;  // ".", ".." and hidden entries
+        }
+        if (listing->count == capacity) {
+            size_t grown = capacity ? capacity * 2U : 32U;
+            char **resized = (char **)realloc(listing->names, grown * sizeof(*resized));
+            if (!resized) {
+                atomic_store(&worker->pool->out_of_memory, true);
+                break;
+            }
+            listing->names = resized;
+            capacity = grown;
+        }
+        size_t length = strlen(entry->d_name) + 1U;
+        char *copy = (char *)malloc(length);
+        if (!copy) {
+            atomic_store(&worker->pool->out_of_memory, true);
+            break;
+        }
+        memcpy(copy, entry->d_name, length);
+        listing->names[listing->count++] = copy;
+    }
+    closedir(dir);
+
+    size_t batches = (listing->count + SCAN_BATCH_ENTRIES - 1U) / SCAN_BATCH_ENTRIES;
+    if (batches == 0U) {
+        free_listing(listing);
+        return;
+    }
+    atomic_store(&listing->batches_left, batches);
+    // Last batch first, so this worker pops the first one next
+    for (size_t batch = batches; batch-- > 0U;) {
+        size_t start = batch * SCAN_BATCH_ENTRIES;
+        size_t count = listing->count - start;
+        ScanTask task = { listing, start, count < SCAN_BATCH_ENTRIES ? count : SCAN_BATCH_ENTRIES };
+        push_task(worker, task);
+    }
+}
+
+static void scan_entries(ScanWorker *worker, ScanListing *listing, size_t start, size_t count) {
+    ScanPool *pool = worker->pool;
+    memcpy(worker->path, listing->path, listing->length);
+    for (size_t i = start; i < start + count && !atomic_load(&pool->out_of_memory); i++) {
+        const char *name = listing->names[i];
+        size_t length = strlen(name);
+        if (listing->length + 1U + length >= sizeof(worker->path)) {
+            continue;
+        }
+        worker->path[listing->length] = '/';
+        memcpy(worker->path + listing->length + 1U, name, length + 1U);
+
+        struct stat st;
+        if (stat(worker->path, &st) != 0) {
+            continue;
+        }
+        if (S_ISDIR(st.st_mode)) {
+            if (listing->depth >= LIBRARY_SCAN_MAX_DEPTH) {
+                continue;
+            }
+            ScanListing *child = (ScanListing *)calloc(1U, sizeof(*child));
+            char *path = (char *)malloc(listing->length + 1U + length + 1U);
+            if (!child || !path) {
+                free(child);
+                free(path);
+                atomic_store(&pool->out_of_memory, true);
+                continue;
+            }
+            memcpy(path, worker->path, listing->length + 1U + length + 1U);
+            child->path = path;
+            child->length = listing->length + 1U + length;
+            child->depth = listing->depth + 1U;
+            child->mtime = (uint32_t)st.st_mtime;
+            ScanTask task = { child, 0U, 0U };
+            push_task(worker, task);
+        } else if (S_ISREG(st.st_mode)) {
+            worker->stats.files++;
+            if (has_audio_extension(name)) {
+                if (TagReader_ReadFile(worker->path, worker->buffer, sizeof(worker->buffer),
+                                       &worker->tags)) {
+                    add_result(worker, listing->length, name, &st);
+                } else {
+                    worker->stats.rejected++;
+                }
+            }
+        }
+    }
+    if (atomic_fetch_sub(&listing->batches_left, 1U) == 1U) {
+        free_listing(listing);
+    }
+}
+
+static void run_task(ScanWorker *worker, const ScanTask *task) {
+    if (task->count == 0U) {  // a directory to read
+        if (atomic_load(&worker->pool->out_of_memory)) {
+            free_listing(task->listing);
+        } else {
+            read_directory(worker, task->listing);
+        }
+    } else {
+        scan_entries(worker, task->listing, task->start, task->count);
+    }
+}
+
+static void *worker_main(void *arg) {
+    ScanWorker *worker = (ScanWorker *)arg;
+    ScanPool *pool = worker->pool;
+    unsigned idle = 0U;
+    while (atomic_load(&pool->pending) > 0U) {
+        ScanTask task;
+        bool found = take_task(&worker->deque, &task, false);
+        for (unsigned i = 1U; !found && i < pool->count; i++) {
+            ScanWorker *victim = &pool->workers[(worker->index + i) % pool->count];
+            if (take_task(&victim->deque, &task, true)) {
+                found = true;
+                worker->stats.steals++;
+            }
+        }
+        if (found) {
+            idle = 0U;
+            run_task(worker, &task);
+            atomic_fetch_sub(&pool->pending, 1U);
+        } else if (++idle < SCAN_IDLE_SPINS) {
+            sched_yield();
+        } else {
+            const struct timespec nap = { 0, 100000L };  // others are still walking
+            nanosleep(&nap, NULL);
+        }
+    }
+    return NULL;
+}
+
+/* Orders relative paths as a serial walk visits them: component by
+ * component, each in strcmp order (a component ending sorts first). */
+static int compare_paths(const char *a, const char *b) {
+    const unsigned char *p = (const unsigned char *)a;
+    const unsigned char *q = (const unsigned char *)b;
+    while (*p && *p == *q) {
+        p++;
+        q++;
+    }
+    int left = (*p == '/') ? 1 : (*p ? *p + 1 : 0);
+    int right = (*q == '/') ? 1 : (*q ? *q + 1 : 0);
+    return left - right;
+}
+
+static int compare_results(const void *a, const void *b) {
+    return compare_paths((*(const ScanResult *const *)a)->filename,
+                         (*(const ScanResult *const *)b)->filename);
+}
+
+static int compare_directories(const void *a, const void *b) {
+    return compare_paths(((const ScanDirectory *)a)->path, ((const ScanDirectory *)b)->path);
+}
+
+/* Adds every worker's results to the catalog in walk order. */
+static void merge_results(ScanPool *pool, LibraryScanStats *stats) {
+    size_t total = 0U;
+    for (unsigned i = 0; i < pool->count; i++) {
+        total += pool->workers[i].result_count;
+    }
+    ScanResult **sorted = (ScanResult **)malloc((total ? total : 1U) * sizeof(*sorted));
+    if (!sorted) {
+        atomic_store(&pool->out_of_memory, true);
+        return;
+    }
+    size_t n = 0U;
+    for (unsigned i = 0; i < pool->count; i++) {
+        for (size_t j = 0; j < pool->workers[i].result_count; j++) {
+            sorted[n++] = &pool->workers[i].results[j];
+        }
+    }
+    qsort(sorted, total, sizeof(*sorted), compare_results);
+
+    for (size_t i = 0; i < total; i++) {
+        const ScanResult *result = sorted[i];
+        MusicLibraryTrack track = {
+            .title = result->title,
+            .album = result->album,
+            .artist = result->artist,
+            .filename = result->filename,
+            .duration_seconds = result->duration_seconds,
+            .track_number = result->track_number,
+            .disc_number = result->disc_number,
+            .file_size = result->file_size,
+            .file_mtime = result->file_mtime,
+        };
+        if (!MusicCatalog_AddTrack(&track)) {
+            atomic_store(&pool->out_of_memory, true);
+            break;
+        }
+        stats->tracks++;
+        if (result->tagged) {
+            stats->tagged++;
+        }
+    }
+    free(sorted);
+
+    // The directory journal, in walk order too
+    size_t directory_total = 0U;
+    for (unsigned i = 0; i < pool->count; i++) {
+        directory_total += pool->workers[i].directory_count;
+    }
+    ScanDirectory *directories =
+        (ScanDirectory *)malloc((directory_total ? directory_total : 1U) * sizeof(*directories));
+    if (!directories) {
+        atomic_store(&pool->out_of_memory, true);
+        return;
+    }
+    n = 0U;
+    for (unsigned i = 0; i < pool->count; i++) {
+        memcpy(directories + n, pool->workers[i].directories,
+               pool->workers[i].directory_count * sizeof(*directories));
+        n += pool->workers[i].directory_count;
+    }
+    qsort(directories, directory_total, sizeof(*directories), compare_directories);
+    for (size_t i = 0; i < directory_total; i++) {
+        if (!MusicCatalog_AddDirectory(directories[i].path, directories[i].mtime)) {
+            atomic_store(&pool->out_of_memory, true);
+            break;
+        }
+    }
+    free(directories);
+}
+
+/* Walks the 'length'-byte 'root' on 'threads' workers, the caller's thread
+ * being one of them. Returns false when memory ran out. */
+static bool scan_tree(const char *root, size_t length, unsigned threads, LibraryScanStats *stats) {
+    ScanPool pool;
+    memset(&pool, 0, sizeof(pool));
+    atomic_init(&pool.pending, 0U);
+    atomic_init(&pool.out_of_memory, false);
+    pool.root_length = length;
+    pool.workers = (ScanWorker *)calloc(threads, sizeof(*pool.workers));
+    ScanListing *top = (ScanListing *)calloc(1U, sizeof(*top));
+    char *path = (char *)malloc(length + 1U);
+    if (!pool.workers || !top || !path) {
+        free(pool.workers);
+        free(top);
+        free(path);
+        return false;
+    }
+    pool.count = threads;
+    for (unsigned i = 0; i < threads; i++) {
+        pool.workers[i].pool = &pool;
+        pool.workers[i].index = i;
+        pthread_mutex_init(&pool.workers[i].deque.lock, NULL);
+    }
+    memcpy(path, root, length);
+    path[length] = '\0';
+    top->path = path;
+    top->length = length;
+    struct stat st;
+    top->mtime = (stat(path, &st) == 0) ? (uint32_t)st.st_mtime : 0U;
+    ScanTask task = { top, 0U, 0U };
+    push_task(&pool.workers[0], task);
+
+    for (unsigned i = 1; i < threads; i++) {
+        pool.workers[i].started =
+            pthread_create(&pool.workers[i].thread, NULL, worker_main, &pool.workers[i]) == 0;
+    }
+    worker_main(&pool.workers[0]);
+
+    stats->threads = 1U;
+    for (unsigned i = 0; i < threads; i++) {
+        ScanWorker *worker = &pool.workers[i];
+        if (i > 0U && worker->started) {
+            pthread_join(worker->thread, NULL);
+            stats->threads++;
+        }
+        stats->directories += worker->stats.directories;
+        stats->files += worker->stats.files;
+        stats->rejected += worker->stats.rejected;
+        stats->steals += worker->stats.steals;
+    }
+    merge_results(&pool, stats);  // after running out of memory too: keep what was found
+
+    for (unsigned i = 0; i < threads; i++) {
+        ScanWorker *worker = &pool.workers[i];
+        while (worker->arena) {
+            ArenaBlock *next = worker->arena->next;
+            free(worker->arena);
+            worker->arena = next;
+        }
+        free(worker->results);
+        free(worker->directories);
+        free(worker->deque.tasks);
+        pthread_mutex_destroy(&worker->deque.lock);
+    }
+    bool ok = !atomic_load(&pool.out_of_memory);
+    free(pool.workers);
+    return ok;
+}
+
+// ---------------------------------------------------------------------------
+// Incremental refresh
+// ---------------------------------------------------------------------------
+
+/*
+ * The journal a scan leaves in the catalog (each directory's mtime, each
+ * track's file size and mtime) is checked against the tree a budget at a
+ * time:
+ *
+ *   checking    every known directory is stat'ed. One whose mtime moved is
+ *               listed again: entries the catalog lacks are queued as new
+ *               (new directories are walked whole) and its known files are
+ *               compared as they are met; known files it no longer lists are
+ *               gone. The files of an unchanged directory are only stat'ed,
+ *               those of a vanished one are gone without a stat.
+ *   probing     the tag reader runs on the new and changed files alone.
+ *   committing  the catalog is rebuilt with the changes applied and
+ *               re-indexed (see MusicCatalog_BeginRebuild()). Gone tracks
+ *               become tombstones, so no index moves; new tracks follow the
+ *               existing ones, in walk order.
+ *
+ * A refresh that finds nothing does not touch the catalog. Past the stat
+ * calls, the work scales with the change rather than the library.
+ */
+
+enum { REFRESH_DIR_UNCHANGED, REFRESH_DIR_CHANGED, REFRESH_DIR_REMOVED, REFRESH_DIR_NEW };
+enum { REFRESH_FILE_UNCHECKED, REFRESH_FILE_KEPT, REFRESH_FILE_CHANGED, REFRESH_FILE_REMOVED };
+
+#define REFRESH_NEW_TRACK UINT32_MAX
+
+typedef struct {
+    char *path;  // relative to the root; "" for the root
+    uint32_t mtime;
+    uint8_t state;
+} RefreshDirectory;
+
+typedef struct {
+    const char *filename;  // the catalog's, valid until the commit
+    size_t dir_length;     // of the directory part, without the '/'
+    uint32_t index;
+    uint32_t size;
+    uint32_t mtime;
+    uint32_t probe;        // when changed
+    uint8_t state;
+} RefreshFile;
+
+typedef struct {
+    char *path;      // relative
+    uint32_t index;  // the entry it replaces, or REFRESH_NEW_TRACK
+    uint32_t size;
+    uint32_t mtime;
+    bool recognised;
+    char *title;
+    char *album;
+    char *artist;
+    uint32_t duration_seconds;
+    uint16_t track_number;
+    uint16_t disc_number;
+} RefreshProbe;
+
+static struct {
+    bool active;
+    char root[PATH_MAX];
+    size_t root_length;
+    LibraryRefreshProgress progress;
+    RefreshDirectory *directories;  // the known ones sorted (compare_keys), new ones after
+    size_t known_directories;
+    size_t directory_count;
+    size_t directory_capacity;
+    RefreshFile *files;             // sorted by directory, then name
+    size_t file_count;
+    RefreshProbe *probes;
+    size_t probe_count;
+    size_t probe_capacity;
+    char **pending;                 // new directories still to walk
+    size_t pending_count;
+    size_t pending_capacity;
+    size_t directory_cursor;
+    size_t file_cursor;
+    size_t probe_cursor;
+    size_t cached_directory;        // check_file()'s last lookup
+    char path[PATH_MAX];
+    TrackTags tags;
+    uint8_t buffer[TAG_READER_BUDGET_BYTES];
+} g_refresh;
+
+/* strcmp() order for strings given with their lengths. */
+static int compare_keys(const char *a, size_t a_length, const char *b, size_t b_length) {
+    int order = memcmp(a, b, a_length < b_length ? a_length : b_length);
+    if (order != 0) {
+        return order;
+    }
+    return (a_length < b_length) ? -1 : (a_length > b_length) ? 1 : 0;
+}
+
+static const char *file_name(const RefreshFile *file) {
+    return file->filename + (file->dir_length ? file->dir_length + 1U : 0U);
+}
+
+static int compare_refresh_files(const void *pa, const void *pb) {
+    const RefreshFile *a = (const RefreshFile *)pa;
+    const RefreshFile *b = (const RefreshFile *)pb;
+    int order = compare_keys(a->filename, a->dir_length, b->filename, b->dir_length);
+    return (order != 0) ? order : strcmp(file_name(a), file_name(b));
+}
+
+static int compare_refresh_directories(const void *pa, const void *pb) {
+    return strcmp(((const RefreshDirectory *)pa)->path, ((const RefreshDirectory *)pb)->path);
+}
+
+static int compare_probes(const void *pa, const void *pb) {
+    return compare_paths((*(const RefreshProbe *const *)pa)->path,
+                         (*(const RefreshProbe *const *)pb)->path);
+}
+
+/* Known directory 'path' ('length' bytes); SIZE_MAX when not in the journal. */
+static size_t find_known_directory(const char *path, size_t length) {
+    size_t low = 0U;
+    size_t high = g_refresh.known_directories;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2U;
+        const char *known = g_refresh.directories[mid].path;
+        int order = compare_keys(known, strlen(known), path, length);
+        if (order == 0) {
+            return mid;
+        }
+        if (order < 0) {
+            low = mid + 1U;
+        } else {
+            high = mid;
+        }
+    }
+    return SIZE_MAX;
+}
+
+/* Known file 'name' in directory 'dir' ('dir_length' bytes); NULL if none. */
+static RefreshFile *find_known_file(const char *dir, size_t dir_length, const char *name) {
+    size_t low = 0U;
+    size_t high = g_refresh.file_count;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2U;
+        const RefreshFile *file = &g_refresh.files[mid];
+        int order = compare_keys(file->filename, file->dir_length, dir, dir_length);
+        if (order == 0) {
+            order = strcmp(file_name(file), name);
+        }
+        if (order == 0) {
+            return &g_refresh.files[mid];
+        }
+        if (order < 0) {
+            low = mid + 1U;
+        } else {
+            high = mid;
+        }
+    }
+    return NULL;
+}
+
+/* Full path of 'relative' in g_refresh.path. */
+static bool refresh_path(const char *relative) {
+    int written = snprintf(g_refresh.path, sizeof(g_refresh.path), "%.*s%s%s",
+                           (int)g_refresh.root_length, g_refresh.root, relative[0] ? "/" : "",
+                           relative);
+    return written > 0 && (size_t)written < sizeof(g_refresh.path);
+}
+
+static bool queue_probe(const char *relative, uint32_t index, const struct stat *st) {
+    if (g_refresh.probe_count == g_refresh.probe_capacity) {
+        size_t grown = g_refresh.probe_capacity ? g_refresh.probe_capacity * 2U : 32U;
+        RefreshProbe *resized =
+            (RefreshProbe *)realloc(g_refresh.probes, grown * sizeof(*resized));
+        if (!resized) {
+            return false;
+        }
+        g_refresh.probes = resized;
+        g_refresh.probe_capacity = grown;
+    }
+    RefreshProbe *probe = &g_refresh.probes[g_refresh.probe_count];
+    memset(probe, 0, sizeof(*probe));
+    probe->path = strdup(relative);
+    if (!probe->path) {
+        return false;
+    }
+    probe->index = index;
+    probe->size = (uint32_t)st->st_size;
+    probe->mtime = (uint32_t)st->st_mtime;
+    g_refresh.probe_count++;
+    g_refresh.progress.probes_total++;
+    return true;
+}
+
+/* Compares a known file's stamp with 'st', queueing a probe if it moved. */
+static bool compare_stamp(RefreshFile *file, const struct stat *st) {
+    if (file->size == (uint32_t)st->st_size && file->mtime == (uint32_t)st->st_mtime) {
+        file->state = REFRESH_FILE_KEPT;
+        return true;
+    }
+    file->state = REFRESH_FILE_CHANGED;
+    file->probe = (uint32_t)g_refresh.probe_count;
+    return queue_probe(file->filename, file->index, st);
+}
+
+static bool push_pending(const char *relative) {
+    if (g_refresh.pending_count == g_refresh.pending_capacity) {
+        size_t grown = g_refresh.pending_capacity ? g_refresh.pending_capacity * 2U : 16U;
+        char **resized = (char **)realloc(g_refresh.pending, grown * sizeof(*resized));
+        if (!resized) {
+            return false;
+        }
+        g_refresh.pending = resized;
+        g_refresh.pending_capacity = grown;
+    }
+    char *copy = strdup(relative);
+    if (!copy) {
+        return false;
+    }
+    g_refresh.pending[g_refresh.pending_count++] = copy;
+    return true;
+}
+
+static unsigned path_depth(const char *relative) {
+    unsigned depth = relative[0] ? 1U : 0U;
+    for (const char *p = relative; *p; p++) {
+        depth += (*p == '/') ? 1U : 0U;
+    }
+    return depth;
+}
+
+/*
+ * Lists directory 'relative' again: new subdirectories are queued for a walk
+ * (when 'is_new', every one of them), audio files the catalog lacks are queued
+ * for probing and known ones compared. Returns the entries seen, or -1 when
+ * out of memory; *listed is false when it cannot be opened.
+ */
+static long list_directory(const char *relative, bool is_new, bool *listed) {
+    *listed = false;
+    if (!refresh_path(relative)) {
+        return 0;
+    }
+    DIR *dir = opendir(g_refresh.path);
+    if (!dir) {
+        return 0;
+    }
+    *listed = true;
+    size_t relative_length = strlen(relative);
+    unsigned depth = path_depth(relative);
+    char child[PATH_MAX];
+    long entries = 0;
+    bool ok = true;
+    struct dirent *entry;
+    while (ok && (entry = readdir(dir)) != NULL) {
+        if (entry->d_name[0] == '.') {
+            continue;  // ".", ".." and hidden entries, as in a full scan
+        }
+        entries++;
+        int written = snprintf(child, sizeof(child), "%s%s%s", relative, relative[0] ? "/" : "",
+                               entry->d_name);
+        struct stat st;
+        if (written <= 0 || (size_t)written >= sizeof(child) || !refresh_path(child) ||
+            stat(g_refresh.path, &st) != 0) {
+            continue;
+        }
+        if (S_ISDIR(st.st_mode)) {
+            if (depth < LIBRARY_SCAN_MAX_DEPTH &&
+                (is_new || find_known_directory(child, (size_t)written) == SIZE_MAX)) {
+                ok = push_pending(child);
+            }
+        } else if (S_ISREG(st.st_mode) && has_audio_extension(entry->d_name)) {
+            RefreshFile *known =
+                is_new ? NULL : find_known_file(relative, relative_length, entry->d_name);
+            ok = known ? compare_stamp(known, &st) : queue_probe(child, REFRESH_NEW_TRACK, &st);
+        }
+    }
+    closedir(dir);
+    return ok ? entries : -1;
+}
+
+static bool check_directory(RefreshDirectory *directory, unsigned *cost) {
+    struct stat st;
+    g_refresh.progress.directories++;
+    if (!refresh_path(directory->path) || stat(g_refresh.path, &st) != 0 ||
+        !S_ISDIR(st.st_mode)) {
+        directory->state = REFRESH_DIR_REMOVED;
+        g_refresh.progress.directories_removed++;
+        return true;
+    }
+    if ((uint32_t)st.st_mtime == directory->mtime) {
+        return true;
+    }
+    directory->mtime = (uint32_t)st.st_mtime;
+    bool listed;
+    long entries = list_directory(directory->path, false, &listed);
+    if (entries < 0) {
+        return false;
+    }
+    *cost += (unsigned)entries;
+    directory->state = listed ? REFRESH_DIR_CHANGED : REFRESH_DIR_REMOVED;
+    if (listed) {
+        g_refresh.progress.listed++;
+    } else {
+        g_refresh.progress.directories_removed++;
+    }
+    return true;
+}
+
+static bool walk_new_directory(char *relative, unsigned *cost) {
+    struct stat st;
+    bool ok = true;
+    if (refresh_path(relative) && stat(g_refresh.path, &st) == 0) {
+        bool listed;
+        long entries = list_directory(relative, true, &listed);
+        ok = entries >= 0;
+        if (ok && listed) {
+            *cost += (unsigned)entries;
+            if (g_refresh.directory_count == g_refresh.directory_capacity) {
+                size_t grown = g_refresh.directory_capacity * 2U + 16U;
+                RefreshDirectory *resized = (RefreshDirectory *)realloc(
+                    g_refresh.directories, grown * sizeof(*resized));
+                ok = resized != NULL;
+                if (ok) {
+                    g_refresh.directories = resized;
+                    g_refresh.directory_capacity = grown;
+                }
+            }
+            if (ok) {
+                RefreshDirectory *directory = &g_refresh.directories[g_refresh.directory_count++];
+                directory->path = relative;
+                directory->mtime = (uint32_t)st.st_mtime;
+                directory->state = REFRESH_DIR_NEW;
+                g_refresh.progress.directories_total++;
+                g_refresh.progress.directories++;
+                g_refresh.progress.listed++;
+                return true;
+            }
+        }
+    }
+    free(relative);
+    return ok;
+}
+
+static void check_file(RefreshFile *file) {
+    g_refresh.progress.files++;
+    if (file->state != REFRESH_FILE_UNCHECKED) {
+        return;  // compared while its directory was listed
+    }
+    size_t cached = g_refresh.cached_directory;
+    const char *cached_path = (cached < g_refresh.known_directories)
+                                  ? g_refresh.directories[cached].path
+                                  : NULL;
+    if (!cached_path ||
+        compare_keys(cached_path, strlen(cached_path), file->filename, file->dir_length) != 0) {
+        cached = find_known_directory(file->filename, file->dir_length);
+        g_refresh.cached_directory = cached;
+    }
+    uint8_t state = (cached < g_refresh.known_directories) ? g_refresh.directories[cached].state
+                                                           : REFRESH_DIR_UNCHANGED;
+    struct stat st;
+    if (state == REFRESH_DIR_UNCHANGED && refresh_path(file->filename) &&
+        stat(g_refresh.path, &st) == 0 && S_ISREG(st.st_mode)) {
+        if (!compare_stamp(file, &st)) {
+            file->state = REFRESH_FILE_KEPT;  // out of memory: keep the old entry
+        }
+        return;
+    }
+    // Gone, or not listed by its directory any more
+    file->state = REFRESH_FILE_REMOVED;
+    g_refresh.progress.removed++;
+}
+
+static char *copy_or_default(const char *text, const char *fallback) {
+    return strdup(text[0] ? text : fallback);
+}
+
+static void probe_file(RefreshProbe *probe) {
+    g_refresh.progress.probes++;
+    if (!refresh_path(probe->path) ||
+        !TagReader_ReadFile(g_refresh.path, g_refresh.buffer, sizeof(g_refresh.buffer),
+                            &g_refresh.tags)) {
+        return;
+    }
+    const TrackTags *tags = &g_refresh.tags;
+    const char *name = strrchr(g_refresh.path, '/');
+    size_t dir_length = (size_t)(name - g_refresh.path);
+    FileNames names;
+    names_from_path(&names, g_refresh.path, dir_length, g_refresh.root_length, name + 1);
+    probe->title = strdup(tags->title[0] ? tags->title : names.title);
+    probe->album = copy_or_default(tags->album[0] ? tags->album : names.album, "Unknown Album");
+    probe->artist =
+        copy_or_default(tags->artist[0] ? tags->artist : names.artist, "Unknown Artist");
+    probe->duration_seconds = tags->duration_seconds;
+    probe->track_number = tags->track_number ? tags->track_number : names.track_number;
+    probe->disc_number = tags->disc_number ? tags->disc_number : names.disc_number;
+    probe->recognised = probe->title && probe->album && probe->artist;
+}
+
+static bool add_probe(const RefreshProbe *probe) {
+    MusicLibraryTrack track = {
+        .title = probe->title,
+        .album = probe->album,
+        .artist = probe->artist,
+        .filename = probe->path,
+        .duration_seconds = probe->duration_seconds,
+        .track_number = probe->track_number,
+        .disc_number = probe->disc_number,
+        .file_size = probe->size,
+        .file_mtime = probe->mtime,
+    };
+    return MusicCatalog_AddTrack(&track);
+}
+
+/* Rebuilds the catalog with the changes found; false when out of memory (the
+ * catalog is then as it was). */
+static bool commit_changes(void) {
+    LibraryRefreshProgress *progress = &g_refresh.progress;
+    size_t count = MusicCatalog_GetCount();
+    RefreshProbe **added =
+        (RefreshProbe **)malloc((g_refresh.probe_count ? g_refresh.probe_count : 1U) *
+                                sizeof(*added));
+    uint32_t *fates = (uint32_t *)malloc((count ? count : 1U) * sizeof(*fates));
+    if (!added || !fates) {
+        free(added);
+        free(fates);
+        return false;
+    }
+    // Per entry: REFRESH_NEW_TRACK to keep it, a probe to replace it with, or
+    // the probe count to drop it
+    uint32_t drop = (uint32_t)g_refresh.probe_count;
+    for (size_t i = 0; i < count; i++) {
+        fates[i] = REFRESH_NEW_TRACK;
+    }
+    for (size_t i = 0; i < g_refresh.file_count; i++) {
+        const RefreshFile *file = &g_refresh.files[i];
+        if (file->state == REFRESH_FILE_REMOVED) {
+            fates[file->index] = drop;
+        } else if (file->state == REFRESH_FILE_CHANGED) {
+            const RefreshProbe *probe = &g_refresh.probes[file->probe];
+            fates[file->index] = probe->recognised ? file->probe : drop;
+            if (probe->recognised) {
+                progress->updated++;
+            } else {
+                progress->removed++;
+                progress->rejected++;
+            }
+        }
+    }
+    size_t added_count = 0U;
+    for (size_t i = 0; i < g_refresh.probe_count; i++) {
+        RefreshProbe *probe = &g_refresh.probes[i];
+        if (probe->index != REFRESH_NEW_TRACK) {
+            continue;
+        }
+        if (probe->recognised) {
+            added[added_count++] = probe;
+        } else {
+            progress->rejected++;
+        }
+    }
+    qsort(added, added_count, sizeof(*added), compare_probes);
+
+    bool ok = MusicCatalog_BeginRebuild();
+    for (size_t i = 0; ok && i < count; i++) {
+        MusicLibraryTrack track;
+        if (fates[i] == drop || !MusicCatalog_GetTrack(i, &track)) {
+            ok = MusicCatalog_AddRemovedTrack();
+        } else if (fates[i] != REFRESH_NEW_TRACK) {
+            ok = add_probe(&g_refresh.probes[fates[i]]);
+        } else {
+            ok = MusicCatalog_AddTrack(&track);
+        }
+    }
+    for (size_t i = 0; ok && i < added_count; i++) {
+        ok = add_probe(added[i]);
+    }
+    for (size_t i = 0; ok && i < g_refresh.directory_count; i++) {
+        const RefreshDirectory *directory = &g_refresh.directories[i];
+        if (directory->state != REFRESH_DIR_REMOVED) {
+            ok = MusicCatalog_AddDirectory(directory->path, directory->mtime);
+        }
+    }
+    free(added);
+    free(fates);
+    if (!ok) {
+        MusicCatalog_AbortRebuild();
+        return false;
+    }
+    MusicCatalog_EndRebuild();
+    progress->added = (uint32_t)added_count;
+    progress->committed = true;
+    return MusicCatalog_BuildIndex();
+}
+
+static bool refresh_found_changes(void) {
+    const LibraryRefreshProgress *progress = &g_refresh.progress;
+    return g_refresh.probe_count > 0U || progress->removed > 0U || progress->listed > 0U ||
+           progress->directories_removed > 0U;
+}
+
+static void refresh_free(void) {
+    for (size_t i = 0; i < g_refresh.directory_count; i++) {
+        free(g_refresh.directories[i].path);
+    }
+    for (size_t i = 0; i < g_refresh.probe_count; i++) {
+        RefreshProbe *probe = &g_refresh.probes[i];
+        free(probe->path);
+        free(probe->title);
+        free(probe->album);
+        free(probe->artist);
+    }
+    for (size_t i = 0; i < g_refresh.pending_count; i++) {
+        free(g_refresh.pending[i]);
+    }
+    free(g_refresh.directories);
+    free(g_refresh.files);
+    free(g_refresh.probes);
+    free(g_refresh.pending);
+    g_refresh.directories = NULL;
+    g_refresh.files = NULL;
+    g_refresh.probes = NULL;
+    g_refresh.pending = NULL;
+    g_refresh.directory_count = g_refresh.directory_capacity = 0U;
+    g_refresh.known_directories = 0U;
+    g_refresh.file_count = 0U;
+    g_refresh.probe_count = g_refresh.probe_capacity = 0U;
+    g_refresh.pending_count = g_refresh.pending_capacity = 0U;
+    g_refresh.active = false;
+}
+
+/* Copies the journal out of the catalog: the directories, and the live
+ * tracks with their stamps. */
+static bool refresh_load_journal(void) {
+    size_t directories = MusicCatalog_GetDirectoryCount();
+    size_t count = MusicCatalog_GetCount();
+    g_refresh.directories =
+        (RefreshDirectory *)calloc(directories ? directories : 1U, sizeof(RefreshDirectory));
+    g_refresh.files = (RefreshFile *)calloc(count ? count : 1U, sizeof(RefreshFile));
+    if (!g_refresh.directories || !g_refresh.files) {
+        return false;
+    }
+    g_refresh.directory_capacity = directories;
+    for (size_t i = 0; i < directories; i++) {
+        RefreshDirectory *directory = &g_refresh.directories[i];
+        directory->path = strdup(MusicCatalog_GetDirectory(i, &directory->mtime));
+        if (!directory->path) {
+            return false;
+        }
+        g_refresh.directory_count++;
+    }
+    qsort(g_refresh.directories, directories, sizeof(RefreshDirectory),
+          compare_refresh_directories);
+    g_refresh.known_directories = directories;
+
+    for (size_t i = 0; i < count; i++) {
+        MusicLibraryTrack track;
+        if (!MusicCatalog_GetTrack(i, &track)) {
+            continue;  // already a tombstone
+        }
+        RefreshFile *file = &g_refresh.files[g_refresh.file_count++];
+        const char *slash = strrchr(track.filename, '/');
+        file->filename = track.filename;
+        file->dir_length = slash ? (size_t)(slash - track.filename) : 0U;
+        file->index = (uint32_t)i;
+        file->size = track.file_size;
+        file->mtime = track.file_mtime;
+    }
+    qsort(g_refresh.files, g_refresh.file_count, sizeof(RefreshFile), compare_refresh_files);
+    g_refresh.cached_directory = SIZE_MAX;
+    g_refresh.progress.directories_total = (uint32_t)directories;
+    g_refresh.progress.files_total = (uint32_t)g_refresh.file_count;
+    return true;
+}
+
+/* Runs the refresh for about 'budget' stats and tag reads (0: to the end).
+ * Returns false once it is finished or has failed. */
+static bool refresh_step(unsigned budget) {
+    LibraryRefreshProgress *progress = &g_refresh.progress;
+    unsigned done = 0U;
+    bool ok = true;
+    while (ok && (budget == 0U || done < budget)) {
+        unsigned cost = 1U;
+        if (progress->phase == LIBRARY_REFRESH_CHECKING) {
+            if (g_refresh.directory_cursor < g_refresh.known_directories) {
+                ok = check_directory(&g_refresh.directories[g_refresh.directory_cursor++], &cost);
+            } else if (g_refresh.pending_count > 0U) {
+                ok = walk_new_directory(g_refresh.pending[--g_refresh.pending_count], &cost);
+            } else if (g_refresh.file_cursor < g_refresh.file_count) {
+                check_file(&g_refresh.files[g_refresh.file_cursor++]);
+            } else {
+                progress->phase = LIBRARY_REFRESH_PROBING;
+            }
+        } else if (progress->phase == LIBRARY_REFRESH_PROBING) {
+            if (g_refresh.probe_cursor < g_refresh.probe_count) {
+                probe_file(&g_refresh.probes[g_refresh.probe_cursor++]);
+            } else {
+                progress->phase = LIBRARY_REFRESH_COMMITTING;
+            }
+        } else {
+            // Committing: one step, however long
+            if (refresh_found_changes()) {
+                ok = commit_changes();
+            }
+            if (ok) {
+                progress->phase = LIBRARY_REFRESH_DONE;
+                refresh_free();
+                return false;
+            }
+        }
+        done += cost;
+    }
+    if (!ok) {
+        printf("LibraryScanner: refresh of %s ran out of memory\n", g_refresh.root);
+        progress->phase = LIBRARY_REFRESH_FAILED;
+        refresh_free();
+        return false;
+    }
+    return true;
+}
+
+#endif /* LIBRARY_SCANNER_HAVE_DIRENT */
+
+void LibraryScanner_SetThreadCount(unsigned threads) {
+    g_thread_count = threads < LIBRARY_SCAN_MAX_THREADS ? threads : LIBRARY_SCAN_MAX_THREADS;
+}
+
+unsigned LibraryScanner_GetThreadCount(void) {
+    if (g_thread_count > 0U) {
+        return g_thread_count;
+    }
+#ifdef LIBRARY_SCANNER_HAVE_DIRENT
+    long cores = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cores > (long)LIBRARY_SCAN_MAX_THREADS) {
+        return LIBRARY_SCAN_MAX_THREADS;
+    }
+    return cores > 1L ? (unsigned)cores : 1U;
+#else
+    return 1U;
+#endif
+}
+
+bool LibraryScanner_Scan(const char *root, LibraryScanStats *stats) {
+    LibraryScanner_CancelRefresh();  // it points into the catalog
+    MusicCatalog_Clear();
+    LibraryScanStats local;
+    if (!stats) {
+        stats = &local;
+    }
+    memset(stats, 0, sizeof(*stats));
+    if (!root) {
+        return false;
+    }
+#ifdef LIBRARY_SCANNER_HAVE_DIRENT
+    size_t length = strlen(root);
+    while (length > 1U && root[length - 1U] == '/') {
+        length--;
+    }
+    if (length == 0U || length >= PATH_MAX) {
+        return false;
+    }
+
+    bool ok = scan_tree(root, length, LibraryScanner_GetThreadCount(), stats);
+    if (ok && !MusicCatalog_BuildIndex()) {
+        ok = false;
+    }
+    if (!ok) {
+        printf("LibraryScanner: out of memory after %u tracks\n", (unsigned)stats->tracks);
+        return false;
+    }
+    return stats->directories > 0U;
+#else
+    printf("LibraryScanner: no directory walker on this platform\n");
+    return false;
+#endif
+}
+
+bool LibraryScanner_BeginRefresh(const char *root) {
+    LibraryScanner_CancelRefresh();
+#ifdef LIBRARY_SCANNER_HAVE_DIRENT
+    memset(&g_refresh.progress, 0, sizeof(g_refresh.progress));
+    size_t length = root ? strlen(root) : 0U;
+    while (length > 1U && root[length - 1U] == '/') {
+        length--;
+    }
+    if (length == 0U || length >= sizeof(g_refresh.root) ||
+        MusicCatalog_GetDirectoryCount() == 0U) {
+        return false;  // nothing to compare against: scan instead
+    }
+    memcpy(g_refresh.root, root, length);
+    g_refresh.root[length] = '\0';
+    g_refresh.root_length = length;
+    g_refresh.directory_cursor = 0U;
+    g_refresh.file_cursor = 0U;
+    g_refresh.probe_cursor = 0U;
+    g_refresh.active = true;
+    if (!refresh_load_journal()) {
+        refresh_free();
+        return false;
+    }
+    g_refresh.progress.phase = LIBRARY_REFRESH_CHECKING;
+    return true;
+#else
+    (void)root;
+    return false;
+#endif
+}
+
+bool LibraryScanner_RefreshStep(unsigned budget) {
+#ifdef LIBRARY_SCANNER_HAVE_DIRENT
+    return g_refresh.active && refresh_step(budget);
+#else
+    (void)budget;
+    return false;
+#endif
+}
+
+void LibraryScanner_GetRefreshProgress(LibraryRefreshProgress *progress) {
+    if (!progress) {
+        return;
+    }
+#ifdef LIBRARY_SCANNER_HAVE_DIRENT
+    *progress = g_refresh.progress;
+#else
+    memset(progress, 0, sizeof(*progress));
+#endif
+}
+
+void LibraryScanner_CancelRefresh(void) {
+#ifdef LIBRARY_SCANNER_HAVE_DIRENT
+    if (g_refresh.active) {
+        refresh_free();
+        g_refresh.progress.phase = LIBRARY_REFRESH_IDLE;
+    }
+#endif
+}
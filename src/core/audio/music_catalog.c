@@ -1,36 +1,1025 @@
 #include "nuno/music_catalog.h"
 
-const MusicLibraryTrack g_music_library_tracks[] = {
-    {
-        .title = "Aria",
-        .album = "Open Goldberg Variations",
-        .artist = "Kimiko Ishizaka",
-        .filename = "bach/open-goldberg-variations/Kimiko_Ishizaka_-_Open_Goldberg_Variations_-_01_Aria.mp3",
-        .duration_seconds = 0U
-    },
-    {
-        .title = "Variatio 1",
-        .album = "Open Goldberg Variations",
-        .artist = "Kimiko Ishizaka",
-        .filename = "bach/open-goldberg-variations/Kimiko_Ishizaka_-_Open_Goldberg_Variations_-_02_Variatio_1.mp3",
-        .duration_seconds = 0U
-    },
-    {
-        .title = "Variatio 2",
-        .album = "Open Goldberg Variations",
-        .artist = "Kimiko Ishizaka",
-        .filename = "bach/open-goldberg-variations/Kimiko_Ishizaka_-_Open_Goldberg_Variations_-_03_Variatio_2.mp3",
-        .duration_seconds = 0U
-    },
-    {
-        .title = "Aria (FLAC test)",
-        .album = "Open Goldberg Variations",
-        .artist = "Kimiko Ishizaka",
-        // Drop the FLAC file under assets/music/ to enable this entry.
-        .filename = "bach/open-goldberg-variations/Kimiko_Ishizaka_-_Open_Goldberg_Variations_-_01_Aria.flac",
-        .duration_seconds = 0U
-    }
-};
-
-const size_t g_music_library_track_count = sizeof(g_music_library_tracks) /
-                                          sizeof(g_music_library_tracks[0]);
+#include "nuno/byte_source.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define CATALOG_INITIAL_TRACKS 64U
+#define CATALOG_INITIAL_POOL_BYTES (16U * 1024U)
+#define CATALOG_INITIAL_INTERNS 64U
+#define CATALOG_INITIAL_DIRECTORIES 16U
+
+_Static_assert(sizeof(MusicCatalogDbHeader) == 72U, "database header layout");
+_Static_assert(sizeof(MusicCatalogRecord) == 36U, "database record layout");
+_Static_assert(sizeof(MusicCatalogDirectory) == 8U, "database directory layout");
+_Static_assert(sizeof(MusicCatalogArtist) == 16U && sizeof(MusicCatalogAlbum) == 16U,
+               "database index layout");
+
+/* Browse index. The five tables sit back to back in one block, in the order
+ * the database stores them, so a database read fills them with one read. */
+typedef struct {
+    const MusicCatalogArtist *artists;
+    const MusicCatalogAlbum *albums;
+    const uint32_t *album_tracks;  // one per listed (not removed) track
+    const uint32_t *songs;         // one per listed track
+    const uint32_t *album_order;   // one per album
+    size_t artist_count;
+    size_t album_count;
+    size_t listed;                 // tracks in the lists
+    void *heap;                    // the block, unless it is mapped
+    size_t heap_bytes;
+    bool present;
+} CatalogIndex;
+
+typedef struct {
+    // The tables: the heap arrays below, or a mapped database
+    const MusicCatalogRecord *records;
+    const char *strings;
+    size_t count;
+    size_t string_bytes;
+    size_t removed_count;
+    const MusicCatalogDirectory *directories;
+    size_t directory_count;
+
+    MusicCatalogRecord *heap_records;
+    size_t record_capacity;
+    char *heap_strings;
+    size_t string_capacity;
+    MusicCatalogDirectory *heap_directories;
+    size_t directory_capacity;
+
+    // Open-addressing set of pool offsets, keyed by the string's contents.
+    // 0 marks a free slot (offset 0 is "", which is never interned).
+    uint32_t *interns;
+    size_t intern_count;
+    size_t intern_capacity;  // power of two
+    bool interned;           // table covers the whole pool
+
+    CatalogIndex index;
+
+    ByteSource map;  // open while a mapped database is in use
+} CatalogState;
+
+/* What GetCount() / GetTrack() read, published as a whole so that a reader
+ * on another thread never pairs one table with another's count. */
+typedef struct {
+    const MusicCatalogRecord *records;
+    const char *strings;
+    size_t count;
+    size_t string_bytes;
+} CatalogView;
+
+static CatalogState g_catalog;
+// The tables a rebuild took over: served to readers until it ends, freed when
+// the next one begins
+static CatalogState g_retired;
+static bool g_rebuilding;
+
+static CatalogView g_views[2];
+static _Atomic(const CatalogView *) g_view;
+
+static void index_drop(void) {
+    free(g_catalog.index.heap);
+    memset(&g_catalog.index, 0, sizeof(g_catalog.index));
+}
+
+static void state_free(CatalogState *state) {
+    free(state->index.heap);
+    ByteSource_Close(&state->map);
+    free(state->heap_records);
+    free(state->heap_strings);
+    free(state->heap_directories);
+    free(state->interns);
+    memset(state, 0, sizeof(*state));
+}
+
+/* Points readers at the catalog's current tables, through the view slot they
+ * are not using. Held back during a rebuild. */
+static void publish(void) {
+    if (g_rebuilding) {
+        return;
+    }
+    const CatalogView *current = atomic_load_explicit(&g_view, memory_order_relaxed);
+    CatalogView *next = (current == &g_views[0]) ? &g_views[1] : &g_views[0];
+    next->records = g_catalog.records;
+    next->strings = g_catalog.strings;
+    next->count = g_catalog.count;
+    next->string_bytes = g_catalog.string_bytes;
+    atomic_store_explicit(&g_view, next, memory_order_release);
+}
+
+void MusicCatalog_Clear(void) {
+    atomic_store_explicit(&g_view, NULL, memory_order_release);
+    state_free(&g_catalog);
+    state_free(&g_retired);
+    g_rebuilding = false;
+}
+
+static uint32_t hash_string(const char *text, size_t length) {
+    uint32_t hash = 2166136261U;  // FNV-1a
+    for (size_t i = 0; i < length; i++) {
+        hash = (hash ^ (uint8_t)text[i]) * 16777619U;
+    }
+    return hash;
+}
+
+static void interns_insert(uint32_t *table, size_t capacity, uint32_t offset) {
+    const char *text = g_catalog.heap_strings + offset;
+    size_t slot = hash_string(text, strlen(text)) & (capacity - 1U);
+    while (table[slot] != 0U) {
+        slot = (slot + 1U) & (capacity - 1U);
+    }
+    table[slot] = offset;
+}
+
+static bool interns_reserve(size_t count) {
+    // Keep the table at most 3/4 full
+    if (count * 4U <= g_catalog.intern_capacity * 3U) {
+        return true;
+    }
+    size_t capacity = g_catalog.intern_capacity ? g_catalog.intern_capacity : CATALOG_INITIAL_INTERNS;
+    while (count * 4U > capacity * 3U) {
+        capacity *= 2U;
+    }
+    uint32_t *table = (uint32_t *)calloc(capacity, sizeof(*table));
+    if (!table) {
+        return false;
+    }
+    for (size_t i = 0; i < g_catalog.intern_capacity; i++) {
+        if (g_catalog.interns[i] != 0U) {
+            interns_insert(table, capacity, g_catalog.interns[i]);
+        }
+    }
+    free(g_catalog.interns);
+    g_catalog.interns = table;
+    g_catalog.intern_capacity = capacity;
+    return true;
+}
+
+/*
+ * Gets the catalog ready for appends: a loaded database is copied to the
+ * heap and its pool indexed, since every string in it is distinct already.
+ */
+static bool make_writable(void) {
+    if (ByteSource_IsOpen(&g_catalog.map)) {
+        size_t record_bytes = g_catalog.count * sizeof(MusicCatalogRecord);
+        MusicCatalogRecord *records = (MusicCatalogRecord *)malloc(record_bytes ? record_bytes : 1U);
+        char *strings = (char *)malloc(g_catalog.string_bytes);
+        if (!records || !strings) {
+            free(records);
+            free(strings);
+            return false;
+        }
+        size_t directory_bytes = g_catalog.directory_count * sizeof(MusicCatalogDirectory);
+        MusicCatalogDirectory *directories =
+            (MusicCatalogDirectory *)malloc(directory_bytes ? directory_bytes : 1U);
+        if (!directories) {
+            free(records);
+            free(strings);
+            return false;
+        }
+        memcpy(records, g_catalog.records, record_bytes);
+        memcpy(strings, g_catalog.strings, g_catalog.string_bytes);
+        memcpy(directories, g_catalog.directories, directory_bytes);
+        ByteSource_Close(&g_catalog.map);
+        g_catalog.heap_records = records;
+        g_catalog.record_capacity = g_catalog.count;
+        g_catalog.heap_strings = strings;
+        g_catalog.string_capacity = g_catalog.string_bytes;
+        g_catalog.heap_directories = directories;
+        g_catalog.directory_capacity = g_catalog.directory_count;
+        g_catalog.records = records;
+        g_catalog.strings = strings;
+        g_catalog.directories = directories;
+    }
+    if (!g_catalog.heap_strings) {
+        g_catalog.heap_strings = (char *)malloc(CATALOG_INITIAL_POOL_BYTES);
+        if (!g_catalog.heap_strings) {
+            return false;
+        }
+        g_catalog.heap_strings[0] = '\0';
+        g_catalog.string_capacity = CATALOG_INITIAL_POOL_BYTES;
+        g_catalog.string_bytes = 1U;
+        g_catalog.strings = g_catalog.heap_strings;
+        g_catalog.interned = true;
+    }
+    if (!g_catalog.interned) {
+        for (size_t offset = 1U; offset < g_catalog.string_bytes;) {
+            size_t length = strlen(g_catalog.heap_strings + offset);
+            if (!interns_reserve(g_catalog.intern_count + 1U)) {
+                return false;
+            }
+            interns_insert(g_catalog.interns, g_catalog.intern_capacity, (uint32_t)offset);
+            g_catalog.intern_count++;
+            offset += length + 1U;
+        }
+        g_catalog.interned = true;
+    }
+    return true;
+}
+
+/* Pool offset of 'text', adding it on first sight; false when out of memory. */
+static bool pool_intern(const char *text, uint32_t *offset) {
+    size_t length = text ? strlen(text) : 0U;
+    if (length == 0U) {
+        *offset = 0U;
+        return true;
+    }
+    if (!interns_reserve(g_catalog.intern_count + 1U)) {
+        return false;
+    }
+    size_t mask = g_catalog.intern_capacity - 1U;
+    size_t slot = hash_string(text, length) & mask;
+    while (g_catalog.interns[slot] != 0U) {
+        const char *existing = g_catalog.heap_strings + g_catalog.interns[slot];
+        if (strncmp(existing, text, length) == 0 && existing[length] == '\0') {
+            *offset = g_catalog.interns[slot];
+            return true;
+        }
+        slot = (slot + 1U) & mask;
+    }
+
+    size_t needed = g_catalog.string_bytes + length + 1U;
+    if (needed > UINT32_MAX) {
+        return false;
+    }
+    if (needed > g_catalog.string_capacity) {
+        size_t capacity = g_catalog.string_capacity * 2U;
+        while (capacity < needed) {
+            capacity *= 2U;
+        }
+        char *strings = (char *)realloc(g_catalog.heap_strings, capacity);
+        if (!strings) {
+            return false;
+        }
+        g_catalog.heap_strings = strings;
+        g_catalog.strings = strings;
+        g_catalog.string_capacity = capacity;
+    }
+    *offset = (uint32_t)g_catalog.string_bytes;
+    memcpy(g_catalog.heap_strings + g_catalog.string_bytes, text, length + 1U);
+    g_catalog.string_bytes = needed;
+    g_catalog.interns[slot] = *offset;
+    g_catalog.intern_count++;
+    return true;
+}
+
+/* Room for one more record; the index is dropped first, since
+ * make_writable() may unmap what it points into. */
+static bool reserve_record(void) {
+    index_drop();
+    if (!make_writable()) {
+        return false;
+    }
+    if (g_catalog.count == g_catalog.record_capacity) {
+        size_t capacity = g_catalog.record_capacity ? g_catalog.record_capacity * 2U
+                                                    : CATALOG_INITIAL_TRACKS;
+        MusicCatalogRecord *records =
+            (MusicCatalogRecord *)realloc(g_catalog.heap_records, capacity * sizeof(*records));
+        if (!records) {
+            return false;
+        }
+        g_catalog.heap_records = records;
+        g_catalog.records = records;
+        g_catalog.record_capacity = capacity;
+    }
+    return true;
+}
+
+static bool add_record(const MusicLibraryTrack *track) {
+    if (!reserve_record()) {
+        return false;
+    }
+    // Strings interned before a failure stay in the pool until a clear
+    MusicCatalogRecord record;
+    if (!pool_intern(track->title, &record.title) || !pool_intern(track->album, &record.album) ||
+        !pool_intern(track->artist, &record.artist) ||
+        !pool_intern(track->filename, &record.filename)) {
+        return false;
+    }
+    record.duration_seconds = track->duration_seconds;
+    record.track_number = track->track_number;
+    record.disc_number = track->disc_number;
+    record.file_size = track->file_size;
+    record.file_mtime = track->file_mtime;
+    record.flags = 0U;
+    g_catalog.heap_records[g_catalog.count++] = record;
+    return true;
+}
+
+bool MusicCatalog_AddTrack(const MusicLibraryTrack *track) {
+    if (!track) {
+        return false;
+    }
+    bool ok = add_record(track);
+    publish();
+    return ok;
+}
+
+bool MusicCatalog_AddRemovedTrack(void) {
+    bool ok = reserve_record();
+    if (ok) {
+        MusicCatalogRecord record;
+        memset(&record, 0, sizeof(record));
+        record.flags = MUSIC_CATALOG_REMOVED;
+        g_catalog.heap_records[g_catalog.count++] = record;
+        g_catalog.removed_count++;
+    }
+    publish();
+    return ok;
+}
+
+size_t MusicCatalog_GetCount(void) {
+    const CatalogView *view = atomic_load_explicit(&g_view, memory_order_acquire);
+    return view ? view->count : 0U;
+}
+
+static const char *pool_string(uint32_t offset) {
+    return (offset < g_catalog.string_bytes) ? g_catalog.strings + offset : "";
+}
+
+static const char *view_string(const CatalogView *view, uint32_t offset) {
+    return (offset < view->string_bytes) ? view->strings + offset : "";
+}
+
+bool MusicCatalog_GetTrack(size_t index, MusicLibraryTrack *track) {
+    const CatalogView *view = atomic_load_explicit(&g_view, memory_order_acquire);
+    if (!track || !view || index >= view->count) {
+        return false;
+    }
+    const MusicCatalogRecord *record = &view->records[index];
+    if (record->flags & MUSIC_CATALOG_REMOVED) {
+        return false;
+    }
+    track->title = view_string(view, record->title);
+    track->album = view_string(view, record->album);
+    track->artist = view_string(view, record->artist);
+    track->filename = view_string(view, record->filename);
+    track->duration_seconds = record->duration_seconds;
+    track->track_number = record->track_number;
+    track->disc_number = record->disc_number;
+    track->file_size = record->file_size;
+    track->file_mtime = record->file_mtime;
+    return true;
+}
+
+bool MusicCatalog_IsRemoved(size_t index) {
+    const CatalogView *view = atomic_load_explicit(&g_view, memory_order_acquire);
+    return view && index < view->count && (view->records[index].flags & MUSIC_CATALOG_REMOVED);
+}
+
+size_t MusicCatalog_GetRemovedCount(void) {
+    return g_catalog.removed_count;
+}
+
+size_t MusicCatalog_GetMemoryUsage(void) {
+    return g_catalog.record_capacity * sizeof(MusicCatalogRecord) + g_catalog.string_capacity +
+           g_catalog.intern_capacity * sizeof(*g_catalog.interns) +
+           g_catalog.directory_capacity * sizeof(MusicCatalogDirectory) +
+           g_catalog.index.heap_bytes;
+}
+
+// ---------------------------------------------------------------------------
+// Directories
+// ---------------------------------------------------------------------------
+
+bool MusicCatalog_AddDirectory(const char *path, uint32_t mtime) {
+    bool ok = make_writable();
+    publish();  // make_writable() may have moved the records
+    if (!ok) {
+        return false;
+    }
+    if (g_catalog.directory_count == g_catalog.directory_capacity) {
+        size_t capacity = g_catalog.directory_capacity ? g_catalog.directory_capacity * 2U
+                                                       : CATALOG_INITIAL_DIRECTORIES;
+        MusicCatalogDirectory *directories = (MusicCatalogDirectory *)realloc(
+            g_catalog.heap_directories, capacity * sizeof(*directories));
+        if (!directories) {
+            return false;
+        }
+        g_catalog.heap_directories = directories;
+        g_catalog.directories = directories;
+        g_catalog.directory_capacity = capacity;
+    }
+    MusicCatalogDirectory directory = { .mtime = mtime };
+    if (!pool_intern(path, &directory.path)) {
+        return false;
+    }
+    g_catalog.heap_directories[g_catalog.directory_count++] = directory;
+    return true;
+}
+
+size_t MusicCatalog_GetDirectoryCount(void) {
+    return g_catalog.directory_count;
+}
+
+const char *MusicCatalog_GetDirectory(size_t index, uint32_t *mtime) {
+    if (index >= g_catalog.directory_count) {
+        return NULL;
+    }
+    if (mtime) {
+        *mtime = g_catalog.directories[index].mtime;
+    }
+    return pool_string(g_catalog.directories[index].path);
+}
+
+// ---------------------------------------------------------------------------
+// Rebuilds
+// ---------------------------------------------------------------------------
+
+bool MusicCatalog_BeginRebuild(void) {
+    if (g_rebuilding) {
+        return false;
+    }
+    publish();
+    // Readers left the previous rebuild's tables when it ended
+    state_free(&g_retired);
+    g_retired = g_catalog;
+    memset(&g_catalog, 0, sizeof(g_catalog));
+    g_rebuilding = true;
+    return true;
+}
+
+void MusicCatalog_EndRebuild(void) {
+    if (!g_rebuilding) {
+        return;
+    }
+    g_rebuilding = false;
+    publish();
+}
+
+void MusicCatalog_AbortRebuild(void) {
+    if (!g_rebuilding) {
+        return;
+    }
+    state_free(&g_catalog);
+    g_catalog = g_retired;
+    memset(&g_retired, 0, sizeof(g_retired));
+    g_rebuilding = false;
+    publish();
+}
+
+bool MusicCatalog_Compact(size_t *track) {
+    if (g_catalog.removed_count == 0U) {
+        return MusicCatalog_BuildIndex();
+    }
+    if (!MusicCatalog_BeginRebuild()) {
+        return false;
+    }
+    const CatalogState *old = &g_retired;
+    size_t carried = SIZE_MAX;
+    size_t kept = 0U;
+    bool ok = true;
+    for (size_t i = 0; ok && i < old->count; i++) {
+        if (track && i == *track) {
+            carried = kept ? kept - 1U : SIZE_MAX;
+        }
+        MusicLibraryTrack entry;
+        if (!MusicCatalog_GetTrack(i, &entry)) {
+            continue;  // removed
+        }
+        if (track && i == *track) {
+            carried = kept;
+        }
+        ok = add_record(&entry);
+        kept++;
+    }
+    for (size_t i = 0; ok && i < old->directory_count; i++) {
+        const MusicCatalogDirectory *directory = &old->directories[i];
+        const char *path = (directory->path < old->string_bytes) ? old->strings + directory->path
+                                                                 : "";
+        ok = MusicCatalog_AddDirectory(path, directory->mtime);
+    }
+    if (!ok) {
+        MusicCatalog_AbortRebuild();
+        return false;
+    }
+    MusicCatalog_EndRebuild();
+    if (track) {
+        *track = carried;
+    }
+    return MusicCatalog_BuildIndex();
+}
+
+// ---------------------------------------------------------------------------
+// Browse index
+// ---------------------------------------------------------------------------
+
+static int fold(char c) {
+    unsigned char u = (unsigned char)c;
+    return (u >= 'A' && u <= 'Z') ? u + ('a' - 'A') : u;
+}
+
+/* strcmp() with ASCII case folded: the order of every sorted list. */
+static int compare_folded(const char *a, const char *b) {
+    for (;; a++, b++) {
+        int fa = fold(*a);
+        int fb = fold(*b);
+        if (fa != fb || fa == 0) {
+            return fa - fb;
+        }
+    }
+}
+
+static int compare_offsets(uint32_t a, uint32_t b) {
+    int order = compare_folded(pool_string(a), pool_string(b));
+    if (order == 0 && a != b) {
+        order = (a < b) ? -1 : 1;  // same name in another case: keep them apart
+    }
+    return order;
+}
+
+static int compare_numbers(uint32_t a, uint32_t b) {
+    return (a < b) ? -1 : (a > b) ? 1 : 0;
+}
+
+/* Artist, album, disc, track number, title: the album-track order. */
+static int compare_by_album(const void *pa, const void *pb) {
+    uint32_t ia = *(const uint32_t *)pa;
+    uint32_t ib = *(const uint32_t *)pb;
+    const MusicCatalogRecord *a = &g_catalog.records[ia];
+    const MusicCatalogRecord *b = &g_catalog.records[ib];
+    int order = compare_offsets(a->artist, b->artist);
+    if (order == 0) {
+        order = compare_offsets(a->album, b->album);
+    }
+    if (order == 0) {
+        order = compare_numbers(a->disc_number, b->disc_number);
+    }
+    if (order == 0) {
+        order = compare_numbers(a->track_number, b->track_number);
+    }
+    if (order == 0) {
+        order = compare_folded(pool_string(a->title), pool_string(b->title));
+    }
+    return (order != 0) ? order : compare_numbers(ia, ib);
+}
+
+static int compare_by_title(const void *pa, const void *pb) {
+    uint32_t ia = *(const uint32_t *)pa;
+    uint32_t ib = *(const uint32_t *)pb;
+    const MusicCatalogRecord *a = &g_catalog.records[ia];
+    const MusicCatalogRecord *b = &g_catalog.records[ib];
+    int order = compare_folded(pool_string(a->title), pool_string(b->title));
+    if (order == 0) {
+        order = compare_folded(pool_string(a->artist), pool_string(b->artist));
+    }
+    if (order == 0) {
+        order = compare_folded(pool_string(a->album), pool_string(b->album));
+    }
+    return (order != 0) ? order : compare_numbers(ia, ib);
+}
+
+// Albums under construction, for compare_by_album_name()
+static const MusicCatalogAlbum *s_sort_albums;
+static const MusicCatalogArtist *s_sort_artists;
+
+static int compare_by_album_name(const void *pa, const void *pb) {
+    uint32_t ia = *(const uint32_t *)pa;
+    uint32_t ib = *(const uint32_t *)pb;
+    const MusicCatalogAlbum *a = &s_sort_albums[ia];
+    const MusicCatalogAlbum *b = &s_sort_albums[ib];
+    int order = compare_folded(pool_string(a->name), pool_string(b->name));
+    if (order == 0) {
+        order = compare_folded(pool_string(s_sort_artists[a->artist].name),
+                               pool_string(s_sort_artists[b->artist].name));
+    }
+    return (order != 0) ? order : compare_numbers(ia, ib);
+}
+
+/* 'tracks' counts the listed ones: removed records are in no list. */
+static size_t index_block_bytes(size_t tracks, size_t artists, size_t albums) {
+    return artists * sizeof(MusicCatalogArtist) + albums * sizeof(MusicCatalogAlbum) +
+           (2U * tracks + albums) * sizeof(uint32_t);
+}
+
+/* Points the index tables into 'block', laid out as index_block_bytes() says. */
+static void index_attach(const void *block, size_t listed, size_t artists, size_t albums) {
+    const uint8_t *at = (const uint8_t *)block;
+    CatalogIndex *index = &g_catalog.index;
+    index->artists = (const MusicCatalogArtist *)(const void *)at;
+    at += artists * sizeof(MusicCatalogArtist);
+    index->albums = (const MusicCatalogAlbum *)(const void *)at;
+    at += albums * sizeof(MusicCatalogAlbum);
+    index->album_tracks = (const uint32_t *)(const void *)at;
+    at += listed * sizeof(uint32_t);
+    index->songs = (const uint32_t *)(const void *)at;
+    at += listed * sizeof(uint32_t);
+    index->album_order = (const uint32_t *)(const void *)at;
+    index->artist_count = artists;
+    index->album_count = albums;
+    index->listed = listed;
+    index->present = true;
+}
+
+bool MusicCatalog_BuildIndex(void) {
+    if (g_catalog.index.present) {
+        return true;
+    }
+    size_t count = g_catalog.count - g_catalog.removed_count;  // listed tracks
+    uint32_t *order = (uint32_t *)malloc((count ? count : 1U) * sizeof(*order));
+    if (!order) {
+        return false;
+    }
+    for (size_t i = 0, n = 0; n < count; i++) {
+        if (!(g_catalog.records[i].flags & MUSIC_CATALOG_REMOVED)) {
+            order[n++] = (uint32_t)i;
+        }
+    }
+    qsort(order, count, sizeof(*order), compare_by_album);
+
+    // Equal artists and albums are adjacent now; count the runs
+    size_t artists = 0U;
+    size_t albums = 0U;
+    for (size_t i = 0; i < count; i++) {
+        const MusicCatalogRecord *record = &g_catalog.records[order[i]];
+        const MusicCatalogRecord *previous = i ? &g_catalog.records[order[i - 1U]] : NULL;
+        bool new_artist = !previous || previous->artist != record->artist;
+        artists += new_artist ? 1U : 0U;
+        albums += (new_artist || previous->album != record->album) ? 1U : 0U;
+    }
+
+    size_t bytes = index_block_bytes(count, artists, albums);
+    uint8_t *block = (uint8_t *)malloc(bytes ? bytes : 1U);
+    if (!block) {
+        free(order);
+        return false;
+    }
+    MusicCatalogArtist *artist_table = (MusicCatalogArtist *)(void *)block;
+    MusicCatalogAlbum *album_table = (MusicCatalogAlbum *)(void *)(artist_table + artists);
+    uint32_t *album_tracks = (uint32_t *)(void *)(album_table + albums);
+    uint32_t *songs = album_tracks + count;
+    uint32_t *album_order = songs + count;
+
+    size_t artist = 0U;  // slots filled so far
+    size_t album = 0U;
+    for (size_t i = 0; i < count; i++) {
+        const MusicCatalogRecord *record = &g_catalog.records[order[i]];
+        const MusicCatalogRecord *previous = i ? &g_catalog.records[order[i - 1U]] : NULL;
+        bool new_artist = !previous || previous->artist != record->artist;
+        if (new_artist || previous->album != record->album) {
+            if (new_artist) {
+                artist_table[artist++] = (MusicCatalogArtist){
+                    .name = record->artist, .first_album = (uint32_t)album,
+                };
+            }
+            album_table[album++] = (MusicCatalogAlbum){
+                .name = record->album, .artist = (uint32_t)(artist - 1U), .first_track = (uint32_t)i,
+            };
+            artist_table[artist - 1U].album_count++;
+        }
+        artist_table[artist - 1U].track_count++;
+        album_table[album - 1U].track_count++;
+        album_tracks[i] = order[i];
+        songs[i] = order[i];
+    }
+    free(order);
+    qsort(songs, count, sizeof(*songs), compare_by_title);
+
+    for (size_t i = 0; i < albums; i++) {
+        album_order[i] = (uint32_t)i;
+    }
+    s_sort_albums = album_table;
+    s_sort_artists = artist_table;
+    qsort(album_order, albums, sizeof(*album_order), compare_by_album_name);
+
+    index_attach(block, count, artists, albums);
+    g_catalog.index.heap = block;
+    g_catalog.index.heap_bytes = bytes;
+    return true;
+}
+
+bool MusicCatalog_HasIndex(void) {
+    return g_catalog.index.present;
+}
+
+size_t MusicCatalog_GetArtistCount(void) {
+    return g_catalog.index.artist_count;
+}
+
+size_t MusicCatalog_GetAlbumCount(void) {
+    return g_catalog.index.album_count;
+}
+
+const char *MusicCatalog_GetArtistName(uint32_t artist, uint32_t *album_count,
+                                       uint32_t *track_count) {
+    if (artist >= g_catalog.index.artist_count) {
+        return NULL;
+    }
+    const MusicCatalogArtist *entry = &g_catalog.index.artists[artist];
+    if (album_count) {
+        *album_count = entry->album_count;
+    }
+    if (track_count) {
+        *track_count = entry->track_count;
+    }
+    return pool_string(entry->name);
+}
+
+const char *MusicCatalog_GetAlbumName(uint32_t album, uint32_t *artist, uint32_t *track_count) {
+    if (album >= g_catalog.index.album_count) {
+        return NULL;
+    }
+    const MusicCatalogAlbum *entry = &g_catalog.index.albums[album];
+    if (artist) {
+        *artist = entry->artist;
+    }
+    if (track_count) {
+        *track_count = entry->track_count;
+    }
+    return pool_string(entry->name);
+}
+
+uint32_t MusicCatalog_ArtistAlbumAt(uint32_t artist, size_t row) {
+    if (artist >= g_catalog.index.artist_count ||
+        row >= g_catalog.index.artists[artist].album_count) {
+        return MUSIC_CATALOG_NONE;
+    }
+    size_t album = (size_t)g_catalog.index.artists[artist].first_album + row;
+    return (album < g_catalog.index.album_count) ? (uint32_t)album : MUSIC_CATALOG_NONE;
+}
+
+uint32_t MusicCatalog_AlbumTrackAt(uint32_t album, size_t row) {
+    if (album >= g_catalog.index.album_count ||
+        row >= g_catalog.index.albums[album].track_count) {
+        return MUSIC_CATALOG_NONE;
+    }
+    size_t position = (size_t)g_catalog.index.albums[album].first_track + row;
+    return (position < g_catalog.index.listed) ? g_catalog.index.album_tracks[position]
+                                               : MUSIC_CATALOG_NONE;
+}
+
+uint32_t MusicCatalog_AlbumAt(size_t row) {
+    return (row < g_catalog.index.album_count) ? g_catalog.index.album_order[row]
+                                               : MUSIC_CATALOG_NONE;
+}
+
+uint32_t MusicCatalog_SongAt(size_t row) {
+    return (row < g_catalog.index.listed) ? g_catalog.index.songs[row] : MUSIC_CATALOG_NONE;
+}
+
+/* Lower bound of 'prefix' in a list of 'rows' names. */
+static size_t find_row(size_t rows, const char *(*name_at)(size_t row), const char *prefix) {
+    size_t low = 0U;
+    size_t high = rows;
+    while (low < high) {
+        size_t mid = low + (high - low) / 2U;
+        if (compare_folded(name_at(mid), prefix ? prefix : "") < 0) {
+            low = mid + 1U;
+        } else {
+            high = mid;
+        }
+    }
+    return low;
+}
+
+static const char *artist_name_at(size_t row) {
+    return pool_string(g_catalog.index.artists[row].name);
+}
+
+static const char *album_name_at(size_t row) {
+    uint32_t album = g_catalog.index.album_order[row];
+    return (album < g_catalog.index.album_count) ? pool_string(g_catalog.index.albums[album].name)
+                                                 : "";
+}
+
+static const char *song_title_at(size_t row) {
+    uint32_t track = g_catalog.index.songs[row];
+    return (track < g_catalog.count) ? pool_string(g_catalog.records[track].title) : "";
+}
+
+size_t MusicCatalog_FindArtist(const char *prefix) {
+    return find_row(g_catalog.index.artist_count, artist_name_at, prefix);
+}
+
+size_t MusicCatalog_FindAlbum(const char *prefix) {
+    return find_row(g_catalog.index.album_count, album_name_at, prefix);
+}
+
+size_t MusicCatalog_FindSong(const char *prefix) {
+    return find_row(g_catalog.index.listed, song_title_at, prefix);
+}
+
+// ---------------------------------------------------------------------------
+// Library database
+// ---------------------------------------------------------------------------
+
+/*
+ * Fills in the header's counts and offsets for a database holding these
+ * tables back to back: records, the index block, directories, pool, root.
+ * Loads compare a file's header against the same layout. False past 4 GB.
+ */
+static bool db_layout(MusicCatalogDbHeader *header, size_t tracks, size_t removed, size_t artists,
+                      size_t albums, size_t directories, size_t string_bytes, size_t root_bytes) {
+    uint64_t at = sizeof(*header);
+    size_t listed = tracks - removed;
+    header->track_count = (uint32_t)tracks;
+    header->removed_count = (uint32_t)removed;
+    header->artist_count = (uint32_t)artists;
+    header->album_count = (uint32_t)albums;
+    header->directory_count = (uint32_t)directories;
+    header->records_offset = (uint32_t)at;
+    at += (uint64_t)tracks * sizeof(MusicCatalogRecord);
+    header->artists_offset = (uint32_t)at;
+    at += (uint64_t)artists * sizeof(MusicCatalogArtist);
+    header->albums_offset = (uint32_t)at;
+    at += (uint64_t)albums * sizeof(MusicCatalogAlbum);
+    header->album_tracks_offset = (uint32_t)at;
+    at += (uint64_t)listed * sizeof(uint32_t);
+    header->songs_offset = (uint32_t)at;
+    at += (uint64_t)listed * sizeof(uint32_t);
+    header->album_order_offset = (uint32_t)at;
+    at += (uint64_t)albums * sizeof(uint32_t);
+    header->directories_offset = (uint32_t)at;
+    at += (uint64_t)directories * sizeof(MusicCatalogDirectory);
+    header->strings_offset = (uint32_t)at;
+    header->string_bytes = (uint32_t)string_bytes;
+    at += string_bytes;
+    header->root_offset = (uint32_t)at;
+    header->root_bytes = (uint32_t)root_bytes;
+    at += root_bytes;
+    return tracks <= UINT32_MAX && removed <= tracks && directories <= UINT32_MAX &&
+           at <= UINT32_MAX;
+}
+
+static bool write_all(FILE *file, const void *data, size_t bytes) {
+    return bytes == 0U || fwrite(data, 1, bytes, file) == bytes;
+}
+
+bool MusicCatalog_Save(const char *path, const char *root) {
+    if (!path || !root || !MusicCatalog_BuildIndex()) {
+        return false;
+    }
+    static const char k_empty_pool[1] = { '\0' };
+    const char *strings = g_catalog.string_bytes ? g_catalog.strings : k_empty_pool;
+    size_t string_bytes = g_catalog.string_bytes ? g_catalog.string_bytes : 1U;
+    const CatalogIndex *index = &g_catalog.index;
+
+    MusicCatalogDbHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MUSIC_CATALOG_DB_MAGIC, sizeof(header.magic));
+    header.version = MUSIC_CATALOG_DB_VERSION;
+    header.record_bytes = (uint16_t)sizeof(MusicCatalogRecord);
+    if (!db_layout(&header, g_catalog.count, g_catalog.removed_count, index->artist_count,
+                   index->album_count, g_catalog.directory_count, string_bytes,
+                   strlen(root) + 1U)) {
+        return false;
+    }
+
+    size_t path_length = strlen(path);
+    char *temp_path = (char *)malloc(path_length + 5U);
+    if (!temp_path) {
+        return false;
+    }
+    memcpy(temp_path, path, path_length);
+    memcpy(temp_path + path_length, ".tmp", 5U);
+
+    size_t count = g_catalog.count;
+    size_t listed = index->listed;
+    FILE *file = fopen(temp_path, "wb");
+    bool ok = file != NULL;
+    if (ok) {
+        ok = write_all(file, &header, sizeof(header)) &&
+             write_all(file, g_catalog.records, count * sizeof(MusicCatalogRecord)) &&
+             write_all(file, index->artists, index->artist_count * sizeof(MusicCatalogArtist)) &&
+             write_all(file, index->albums, index->album_count * sizeof(MusicCatalogAlbum)) &&
+             write_all(file, index->album_tracks, listed * sizeof(uint32_t)) &&
+             write_all(file, index->songs, listed * sizeof(uint32_t)) &&
+             write_all(file, index->album_order, index->album_count * sizeof(uint32_t)) &&
+             write_all(file, g_catalog.directories,
+                       g_catalog.directory_count * sizeof(MusicCatalogDirectory)) &&
+             write_all(file, strings, string_bytes) &&
+             write_all(file, root, header.root_bytes);
+        ok = (fclose(file) == 0) && ok;
+    }
+    ok = ok && rename(temp_path, path) == 0;
+    if (!ok) {
+        remove(temp_path);
+    }
+    free(temp_path);
+    return ok;
+}
+
+static bool header_is_valid(const MusicCatalogDbHeader *header, uint64_t file_size) {
+    if (memcmp(header->magic, MUSIC_CATALOG_DB_MAGIC, sizeof(header->magic)) != 0 ||
+        header->version != MUSIC_CATALOG_DB_VERSION ||
+        header->record_bytes != sizeof(MusicCatalogRecord) || header->string_bytes == 0U ||
+        header->root_bytes == 0U) {
+        return false;
+    }
+    MusicCatalogDbHeader expected = *header;
+    return db_layout(&expected, header->track_count, header->removed_count,
+                     header->artist_count, header->album_count, header->directory_count,
+                     header->string_bytes, header->root_bytes) &&
+           memcmp(&expected, header, sizeof(expected)) == 0 &&
+           (uint64_t)header->root_offset + header->root_bytes <= file_size;
+}
+
+/* Pool and root checks shared by both load paths. */
+static bool contents_are_valid(const char *strings, size_t string_bytes, const char *stored_root,
+                               size_t root_bytes, const char *root) {
+    return strings[0] == '\0' && strings[string_bytes - 1U] == '\0' &&
+           stored_root[root_bytes - 1U] == '\0' && strcmp(stored_root, root) == 0;
+}
+
+static void install_tables(const MusicCatalogDbHeader *header, const void *records,
+                           const void *index_block, const void *directories,
+                           const char *strings) {
+    g_catalog.records = (const MusicCatalogRecord *)records;
+    g_catalog.strings = strings;
+    g_catalog.count = header->track_count;
+    g_catalog.removed_count = header->removed_count;
+    g_catalog.string_bytes = header->string_bytes;
+    g_catalog.directories = (const MusicCatalogDirectory *)directories;
+    g_catalog.directory_count = header->directory_count;
+    index_attach(index_block, header->track_count - header->removed_count, header->artist_count,
+                 header->album_count);
+    publish();
+}
+
+/* Where mmap is unavailable: the records, index, directories and pool are
+ * read into the heap with one read each, so the catalog needs no per-track
+ * work either way. */
+static bool load_by_reading(ByteSource *source, const char *root) {
+    MusicCatalogDbHeader header;
+    if (ByteSource_Read(source, &header, sizeof(header)) != sizeof(header) ||
+        !header_is_valid(&header, ByteSource_Size(source))) {
+        return false;
+    }
+    size_t record_bytes = header.artists_offset - header.records_offset;
+    size_t index_bytes = header.directories_offset - header.artists_offset;
+    size_t directory_bytes = header.strings_offset - header.directories_offset;
+    MusicCatalogRecord *records = (MusicCatalogRecord *)malloc(record_bytes ? record_bytes : 1U);
+    void *index_block = malloc(index_bytes ? index_bytes : 1U);
+    MusicCatalogDirectory *directories =
+        (MusicCatalogDirectory *)malloc(directory_bytes ? directory_bytes : 1U);
+    char *strings = (char *)malloc(header.string_bytes);
+    char *stored_root = (char *)malloc(header.root_bytes);
+    // The tables are contiguous, so the reads simply follow the header
+    bool ok = records && index_block && directories && strings && stored_root &&
+              ByteSource_Read(source, records, record_bytes) == record_bytes &&
+              ByteSource_Read(source, index_block, index_bytes) == index_bytes &&
+              ByteSource_Read(source, directories, directory_bytes) == directory_bytes &&
+              ByteSource_Read(source, strings, header.string_bytes) == header.string_bytes &&
+              ByteSource_Read(source, stored_root, header.root_bytes) == header.root_bytes &&
+              contents_are_valid(strings, header.string_bytes, stored_root, header.root_bytes, root);
+    free(stored_root);
+    if (!ok) {
+        free(records);
+        free(index_block);
+        free(directories);
+        free(strings);
+        return false;
+    }
+    g_catalog.heap_records = records;
+    g_catalog.record_capacity = header.track_count;
+    g_catalog.heap_strings = strings;
+    g_catalog.string_capacity = header.string_bytes;
+    g_catalog.heap_directories = directories;
+    g_catalog.directory_capacity = header.directory_count;
+    install_tables(&header, records, index_block, directories, strings);
+    g_catalog.index.heap = index_block;
+    g_catalog.index.heap_bytes = index_bytes;
+    return true;
+}
+
+bool MusicCatalog_Load(const char *path, const char *root) {
+    MusicCatalog_Clear();
+    if (!path || !root) {
+        return false;
+    }
+
+    ByteSource source;
+    if (ByteSource_OpenMapped(&source, path)) {
+        size_t size = 0U;
+        const uint8_t *base = ByteSource_Map(&source, 0U, &size);
+        MusicCatalogDbHeader header;
+        bool ok = base && size >= sizeof(header);
+        if (ok) {
+            memcpy(&header, base, sizeof(header));
+            ok = header_is_valid(&header, size) &&
+                 contents_are_valid((const char *)base + header.strings_offset, header.string_bytes,
+                                    (const char *)base + header.root_offset, header.root_bytes,
+                                    root);
+        }
+        if (!ok) {
+            ByteSource_Close(&source);
+            return false;
+        }
+        g_catalog.map = source;
+        install_tables(&header, base + header.records_offset, base + header.artists_offset,
+                       base + header.directories_offset,
+                       (const char *)base + header.strings_offset);
+        return true;
+    }
+
+    if (!ByteSource_OpenFile(&source, path)) {
+        return false;
+    }
+    bool ok = load_by_reading(&source, root);
+    ByteSource_Close(&source);
+    return ok;
+}
@@ -1,6 +1,7 @@
 #include "nuno/music_library.h"
 
 #include "nuno/filesystem.h"
+#include "nuno/library_scanner.h"
 
 #include <limits.h>
 #include <stdbool.h>
@@ -17,6 +18,11 @@ typedef struct {
     char root[PATH_MAX];
     size_t current_index;
     bool initialised;
+    // Refresh
+    bool refreshing;
+    LibraryRefreshProgress progress;
+    MusicLibraryRefreshCallback callback;
+    void *callback_context;
 } MusicLibraryState;
 
 static MusicLibraryState g_library = {
@@ -25,8 +31,24 @@ static MusicLibraryState g_library = {
     .initialised = false
 };
 
+/* Drops the tombstones once they are a sizeable part of the catalog; true
+ * when it did. Called from Init only, before any track is playing or looked
+ * ahead to: compaction renumbers entries and frees the tables the producer
+ * reads through GetTrack(). */
+static bool compact_if_worthwhile(void) {
+    size_t removed = MusicCatalog_GetRemovedCount();
+    if (removed == 0U || removed * MUSIC_LIBRARY_COMPACT_RATIO <= MusicCatalog_GetCount()) {
+        return false;
+    }
+    if (!MusicCatalog_Compact(NULL)) {
+        printf("MusicLibrary: out of memory compacting; tombstones kept\n");
+        return false;
+    }
+    return true;
+}
+
 static bool resolve_track_path(size_t index, char *buffer, size_t size) {
-    if (!buffer || size == 0U || index >= g_music_library_track_count) {
+    if (!buffer || size == 0U || index >= MusicCatalog_GetCount()) {
         return false;
     }
 
@@ -34,7 +56,12 @@ static bool resolve_track_path(size_t index, char *buffer, size_t size) {
         return false;
     }
 
-    int written = snprintf(buffer, size, "%s/%s", g_library.root, g_music_library_tracks[index].filename);
+    MusicLibraryTrack track;
+    if (!MusicCatalog_GetTrack(index, &track)) {
+        return false;
+    }
+
+    int written = snprintf(buffer, size, "%s/%s", g_library.root, track.filename);
     if (written <= 0) {
         return false;
     }
@@ -50,11 +77,47 @@ bool MusicLibrary_Init(const char *library_root) {
         return false;
     }
 
+    LibraryScanner_CancelRefresh();
     memset(&g_library, 0, sizeof(g_library));
     strncpy(g_library.root, root, sizeof(g_library.root) - 1U);
     g_library.initialised = true;
     g_library.current_index = (size_t)-1;
 
+    // The database from the last scan makes startup independent of library
+    // size: only what changed since is read again. Scan only when it is
+    // missing or stale.
+    if (MusicCatalog_Load(NUNO_LIBRARY_DB_PATH, g_library.root) &&
+        MusicLibrary_StartRefresh(NULL, NULL)) {
+        while (MusicLibrary_RefreshStep()) {
+        }
+        // Nothing plays yet, so tombstones left by refreshes can go now
+        if (compact_if_worthwhile() && !MusicCatalog_Save(NUNO_LIBRARY_DB_PATH, g_library.root)) {
+            printf("MusicLibrary: cannot write %s\n", NUNO_LIBRARY_DB_PATH);
+        }
+        const LibraryRefreshProgress *progress = &g_library.progress;
+        printf("MusicLibrary: %zu tracks from %s (%u added, %u updated, %u removed; "
+               "%u of %u directories listed)\n",
+               MusicCatalog_GetCount() - MusicCatalog_GetRemovedCount(), NUNO_LIBRARY_DB_PATH,
+               (unsigned)progress->added, (unsigned)progress->updated,
+               (unsigned)progress->removed, (unsigned)progress->listed,
+               (unsigned)progress->directories_total);
+        return true;
+    }
+
+    // An unreadable root still leaves an (empty) library to browse.
+    LibraryScanStats stats;
+    if (!LibraryScanner_Scan(g_library.root, &stats)) {
+        printf("MusicLibrary: cannot scan %s\n", g_library.root);
+        return true;
+    }
+    printf("MusicLibrary: %zu tracks in %u directories (%u files, %u tagged, %u rejected), "
+           "%zu bytes\n",
+           MusicCatalog_GetCount(), (unsigned)stats.directories, (unsigned)stats.files,
+           (unsigned)stats.tagged, (unsigned)stats.rejected, MusicCatalog_GetMemoryUsage());
+    if (!MusicCatalog_Save(NUNO_LIBRARY_DB_PATH, g_library.root)) {
+        printf("MusicLibrary: cannot write %s; the next start scans again\n", NUNO_LIBRARY_DB_PATH);
+    }
+
     return true;
 }
 
@@ -63,21 +126,15 @@ const char *MusicLibrary_GetRoot(void) {
 }
 
 size_t MusicLibrary_GetTrackCount(void) {
-    return g_music_library_track_count;
+    return MusicCatalog_GetCount();
 }
 
-const MusicLibraryTrack *MusicLibrary_GetTrack(size_t index) {
-    if (!g_library.initialised || index >= g_music_library_track_count) {
-        return NULL;
-    }
-    return &g_music_library_tracks[index];
+bool MusicLibrary_GetTrack(size_t index, MusicLibraryTrack *track) {
+    return g_library.initialised && MusicCatalog_GetTrack(index, track);
 }
 
-const MusicLibraryTrack *MusicLibrary_GetCurrentTrack(void) {
-    if (!g_library.initialised || g_library.current_index >= g_music_library_track_count) {
-        return NULL;
-    }
-    return &g_music_library_tracks[g_library.current_index];
+bool MusicLibrary_GetCurrentTrack(MusicLibraryTrack *track) {
+    return MusicLibrary_GetTrack(g_library.current_index, track);
 }
 
 size_t MusicLibrary_GetCurrentIndex(void) {
@@ -86,13 +143,13 @@ size_t MusicLibrary_GetCurrentIndex(void) {
 
 bool MusicLibrary_OpenTrack(size_t index) {
     printf("MusicLibrary_OpenTrack called with index %zu\n", index);
-    if (!g_library.initialised || index >= g_music_library_track_count) {
+    if (!g_library.initialised || index >= MusicCatalog_GetCount()) {
         printf("Library not initialized or invalid index\n");
         return false;
     }
 
     printf("Library root: %s\n", g_library.root);
-    printf("Track count: %zu\n", g_music_library_track_count);
+    printf("Track count: %zu\n", MusicCatalog_GetCount());
 
     char path[PATH_MAX];
     if (!resolve_track_path(index, path, sizeof(path))) {
@@ -114,13 +171,29 @@ bool MusicLibrary_OpenTrack(size_t index) {
     return true;
 }
 
-bool MusicLibrary_OpenNextTrack(void) {
-    if (!g_library.initialised) {
+bool MusicLibrary_SelectTrack(size_t index) {
+    if (!g_library.initialised || index >= MusicCatalog_GetCount()) {
         return false;
     }
+    g_library.current_index = index;
+    return true;
+}
+
+size_t MusicLibrary_GetNextIndex(void) {
+    if (!g_library.initialised) {
+        return SIZE_MAX;
+    }
 
     size_t next_index = (g_library.current_index == (size_t)-1) ? 0U : g_library.current_index + 1U;
-    if (next_index >= g_music_library_track_count) {
+    while (next_index < MusicCatalog_GetCount() && MusicCatalog_IsRemoved(next_index)) {
+        next_index++;  // a tombstone left by a refresh
+    }
+    return (next_index < MusicCatalog_GetCount()) ? next_index : SIZE_MAX;
+}
+
+bool MusicLibrary_OpenNextTrack(void) {
+    size_t next_index = MusicLibrary_GetNextIndex();
+    if (next_index == SIZE_MAX) {
         return false;
     }
 
@@ -139,6 +212,9 @@ bool MusicLibrary_OpenPreviousTrack(void) {
     size_t prev_index = (g_library.current_index == 0U)
         ? (size_t)-1
         : (g_library.current_index - 1U);
+    while (prev_index != (size_t)-1 && MusicCatalog_IsRemoved(prev_index)) {
+        prev_index--;
+    }
 
     if (prev_index == (size_t)-1) {
         return false; // no previous track before 0
@@ -151,19 +227,99 @@ bool MusicLibrary_HasPreviousTrack(void) {
     if (!g_library.initialised || g_library.current_index == (size_t)-1) {
         return false;
     }
-    return g_library.current_index > 0U;
+    size_t prev_index = g_library.current_index;
+    while (prev_index > 0U) {
+        prev_index--;
+        if (!MusicCatalog_IsRemoved(prev_index)) {
+            return true;
+        }
+    }
+    return false;
 }
 
 bool MusicLibrary_HasNextTrack(void) {
-    if (!g_library.initialised || g_library.current_index == (size_t)-1) {
-        return g_music_library_track_count > 0U;
-    }
-    return (g_library.current_index + 1U) < g_music_library_track_count;
+    return MusicLibrary_GetNextIndex() != SIZE_MAX;
 }
 
 size_t MusicLibrary_GetRemainingTracks(void) {
-    if (!g_library.initialised || g_library.current_index >= g_music_library_track_count) {
-        return g_music_library_track_count;
+    size_t count = MusicCatalog_GetCount();
+    size_t index = (!g_library.initialised || g_library.current_index >= count)
+        ? 0U
+        : g_library.current_index + 1U;
+    size_t remaining = 0U;
+    for (; index < count; index++) {
+        if (!MusicCatalog_IsRemoved(index)) {
+            remaining++;  // tombstones left by a refresh are not tracks
+        }
+    }
+    return remaining;
+}
+
+size_t MusicLibrary_GetSongCount(void) {
+    if (!MusicCatalog_HasIndex()) {
+        return MusicCatalog_GetCount();
+    }
+    return MusicCatalog_GetCount() - MusicCatalog_GetRemovedCount();
+}
+
+size_t MusicLibrary_SongAt(size_t row) {
+    // Without the browse index the list is the catalog in scan order
+    if (!MusicCatalog_HasIndex()) {
+        return (row < MusicCatalog_GetCount()) ? row : SIZE_MAX;
+    }
+    uint32_t track = MusicCatalog_SongAt(row);
+    return (track == MUSIC_CATALOG_NONE) ? SIZE_MAX : (size_t)track;
+}
+
+bool MusicLibrary_StartRefresh(MusicLibraryRefreshCallback callback, void *context) {
+    if (!g_library.initialised || g_library.refreshing) {
+        return false;
+    }
+    if (!LibraryScanner_BeginRefresh(g_library.root)) {
+        return false;
+    }
+    g_library.refreshing = true;
+    g_library.callback = callback;
+    g_library.callback_context = context;
+    LibraryScanner_GetRefreshProgress(&g_library.progress);
+    return true;
+}
+
+
+bool MusicLibrary_RefreshStep(void) {
+    if (!g_library.refreshing) {
+        return false;
+    }
+    LibraryRefreshProgress *progress = &g_library.progress;
+    bool more = false;
+    if (progress->phase == LIBRARY_REFRESH_SAVING) {
+        // A step of its own, after the commit. No compaction here: playback
+        // may hold track indices and read the tables the commit published.
+        progress->phase = LIBRARY_REFRESH_DONE;
+        if (!MusicCatalog_Save(NUNO_LIBRARY_DB_PATH, g_library.root)) {
+            printf("MusicLibrary: cannot write %s\n", NUNO_LIBRARY_DB_PATH);
+        }
+    } else {
+        more = LibraryScanner_RefreshStep(MUSIC_LIBRARY_REFRESH_BUDGET);
+        LibraryScanner_GetRefreshProgress(progress);
+        if (!more && progress->phase == LIBRARY_REFRESH_DONE && progress->committed) {
+            progress->phase = LIBRARY_REFRESH_SAVING;
+            more = true;
+        }
+    }
+    g_library.refreshing = more;
+    if (g_library.callback) {
+        g_library.callback(progress, g_library.callback_context);
+    }
+    return more;
+}
+
+bool MusicLibrary_IsRefreshing(void) {
+    return g_library.refreshing;
+}
+
+void MusicLibrary_GetRefreshProgress(LibraryRefreshProgress *progress) {
+    if (progress) {
+        *progress = g_library.progress;
     }
-    return g_music_library_track_count - g_library.current_index - 1U;
 }
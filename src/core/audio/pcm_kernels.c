@@ -0,0 +1,334 @@
+#include "nuno/pcm_kernels.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+/*
+ * Variant selection is compile-time per ISA plus a runtime check for AVX2.
+ * See pcm_kernels.h for the shared semantics; any change to the scalar
+ * reference must be mirrored in every variant (the equivalence test compares
+ * them bit-for-bit).
+ */
+#if defined(__SSE2__) && (defined(__x86_64__) || defined(__i386__))
+#define PCM_KERNELS_HAVE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PCM_KERNELS_HAVE_AVX2 1
+#include <immintrin.h>
+#endif
+
+#if defined(__ARM_FEATURE_DSP) && defined(__ARM_FEATURE_SAT) && !defined(__ARM_BIG_ENDIAN)
+#define PCM_KERNELS_HAVE_ARM_DSP 1
+#include <arm_acle.h>
+#endif
+
+#define S16_SCALE 32767.0f
+
+/* Clamp/quantise one gained sample exactly as the reference does. */
+static inline int16_t quantise_sample(float sample, float gain) {
+    float v = sample * gain;
+    if (v > 1.0f) v = 1.0f;
+    if (v < -1.0f) v = -1.0f;
+    return (int16_t)(v * S16_SCALE);
+}
+
+/* Q15 gains outside [0, unity) are either a no-op or silence. Returns false
+ * when the samples should be left alone. */
+static inline bool normalise_gain_q15(int32_t *gain_q15) {
+    if (*gain_q15 >= PCM_Q15_UNITY) {
+        return false;
+    }
+    if (*gain_q15 < 0) {
+        *gain_q15 = 0;
+    }
+    return true;
+}
+
+// ---------------------------------------------------------------------------
+// Scalar reference
+// ---------------------------------------------------------------------------
+
+static void scalar_downmix_to_stereo(const float *in, uint32_t channels,
+                                     float *out, size_t frames, float gain) {
+    if (channels == 1U) {
+        for (size_t i = 0; i < frames; i++) {
+            float v = in[i] * gain;
+            out[i * 2U] = v;
+            out[i * 2U + 1U] = v;
+        }
+    } else if (channels == 2U) {
+        for (size_t i = 0; i < frames * 2U; i++) {
+            out[i] = in[i] * gain;
+        }
+    } else {
+        const float scale = 1.0f / (float)channels;
+        for (size_t i = 0; i < frames; i++) {
+            const float *frame = &in[i * channels];
+            float left = frame[0];
+            float right = frame[1];
+            for (uint32_t ch = 2U; ch < channels; ch++) {
+                left += frame[ch];
+                right += frame[ch];
+            }
+            out[i * 2U] = (left * scale) * gain;
+            out[i * 2U + 1U] = (right * scale) * gain;
+        }
+    }
+}
+
+static void scalar_f32_to_s16(const float *in, int16_t *out, size_t samples, float gain) {
+    for (size_t i = 0; i < samples; i++) {
+        out[i] = quantise_sample(in[i], gain);
+    }
+}
+
+static void scalar_s16_gain_q15(int16_t *samples, size_t count, int32_t gain_q15) {
+    if (!normalise_gain_q15(&gain_q15)) {
+        return;
+    }
+    for (size_t i = 0; i < count; i++) {
+        int32_t v = ((int32_t)samples[i] * gain_q15 + (1 << 14)) >> 15;
+        if (v > INT16_MAX) v = INT16_MAX;
+        if (v < INT16_MIN) v = INT16_MIN;
+        samples[i] = (int16_t)v;
+    }
+}
+
+static const PcmKernels k_scalar = {
+    .name              = "scalar",
+    .downmix_to_stereo = scalar_downmix_to_stereo,
+    .f32_to_s16        = scalar_f32_to_s16,
+    .s16_gain_q15      = scalar_s16_gain_q15,
+};
+
+// ---------------------------------------------------------------------------
+// SSE2 (host sim baseline)
+// ---------------------------------------------------------------------------
+
+#ifdef PCM_KERNELS_HAVE_SSE2
+/* Layouts wider than stereo are rare (multichannel FLAC) and gather badly, so
+ * they share the scalar loop; mono and stereo are vectorised. */
+static void sse2_downmix_to_stereo(const float *in, uint32_t channels,
+                                   float *out, size_t frames, float gain) {
+    const __m128 g = _mm_set1_ps(gain);
+    size_t i = 0;
+    if (channels == 1U) {
+        for (; i + 4U <= frames; i += 4U) {
+            __m128 m = _mm_mul_ps(_mm_loadu_ps(&in[i]), g);
+            _mm_storeu_ps(&out[i * 2U], _mm_unpacklo_ps(m, m));
+            _mm_storeu_ps(&out[i * 2U + 4U], _mm_unpackhi_ps(m, m));
+        }
+    } else if (channels == 2U) {
+        for (; i + 2U <= frames; i += 2U) {
+            _mm_storeu_ps(&out[i * 2U], _mm_mul_ps(_mm_loadu_ps(&in[i * 2U]), g));
+        }
+    }
+    scalar_downmix_to_stereo(&in[i * channels], channels, &out[i * 2U], frames - i, gain);
+}
+
+static void sse2_f32_to_s16(const float *in, int16_t *out, size_t samples, float gain) {
+    const __m128 g = _mm_set1_ps(gain);
+    const __m128 hi = _mm_set1_ps(1.0f);
+    const __m128 lo = _mm_set1_ps(-1.0f);
+    const __m128 scale = _mm_set1_ps(S16_SCALE);
+    size_t i = 0;
+    for (; i + 8U <= samples; i += 8U) {
+        __m128 a = _mm_mul_ps(_mm_loadu_ps(&in[i]), g);
+        __m128 b = _mm_mul_ps(_mm_loadu_ps(&in[i + 4U]), g);
+        a = _mm_mul_ps(_mm_min_ps(_mm_max_ps(a, lo), hi), scale);
+        b = _mm_mul_ps(_mm_min_ps(_mm_max_ps(b, lo), hi), scale);
+        __m128i packed = _mm_packs_epi32(_mm_cvttps_epi32(a), _mm_cvttps_epi32(b));
+        _mm_storeu_si128((__m128i *)&out[i], packed);
+    }
+    scalar_f32_to_s16(&in[i], &out[i], samples - i, gain);
+}
+
+static void sse2_s16_gain_q15(int16_t *samples, size_t count, int32_t gain_q15) {
+    if (!normalise_gain_q15(&gain_q15)) {
+        return;
+    }
+    /* SSE2 has no rounding high multiply, so widen to 32-bit products. */
+    const __m128i g = _mm_set1_epi16((int16_t)gain_q15);
+    const __m128i round = _mm_set1_epi32(1 << 14);
+    size_t i = 0;
+    for (; i + 8U <= count; i += 8U) {
+        __m128i s = _mm_loadu_si128((const __m128i *)&samples[i]);
+        __m128i lo = _mm_mullo_epi16(s, g);
+        __m128i hi = _mm_mulhi_epi16(s, g);
+        __m128i p0 = _mm_srai_epi32(_mm_add_epi32(_mm_unpacklo_epi16(lo, hi), round), 15);
+        __m128i p1 = _mm_srai_epi32(_mm_add_epi32(_mm_unpackhi_epi16(lo, hi), round), 15);
+        _mm_storeu_si128((__m128i *)&samples[i], _mm_packs_epi32(p0, p1));
+    }
+    scalar_s16_gain_q15(&samples[i], count - i, gain_q15);
+}
+
+static const PcmKernels k_sse2 = {
+    .name              = "sse2",
+    .downmix_to_stereo = sse2_downmix_to_stereo,
+    .f32_to_s16        = sse2_f32_to_s16,
+    .s16_gain_q15      = sse2_s16_gain_q15,
+};
+#endif /* PCM_KERNELS_HAVE_SSE2 */
+
+// ---------------------------------------------------------------------------
+// AVX2 (host sim, runtime-detected)
+// ---------------------------------------------------------------------------
+
+#ifdef PCM_KERNELS_HAVE_AVX2
+#define PCM_AVX2 __attribute__((target("avx2")))
+
+PCM_AVX2 static void avx2_downmix_to_stereo(const float *in, uint32_t channels,
+                                            float *out, size_t frames, float gain) {
+    const __m256 g = _mm256_set1_ps(gain);
+    size_t i = 0;
+    if (channels == 1U) {
+        for (; i + 8U <= frames; i += 8U) {
+            __m256 m = _mm256_mul_ps(_mm256_loadu_ps(&in[i]), g);
+            /* unpack works per 128-bit lane; permute the halves back in order. */
+            __m256 lo = _mm256_unpacklo_ps(m, m);
+            __m256 hi = _mm256_unpackhi_ps(m, m);
+            _mm256_storeu_ps(&out[i * 2U], _mm256_permute2f128_ps(lo, hi, 0x20));
+            _mm256_storeu_ps(&out[i * 2U + 8U], _mm256_permute2f128_ps(lo, hi, 0x31));
+        }
+    } else if (channels == 2U) {
+        for (; i + 4U <= frames; i += 4U) {
+            _mm256_storeu_ps(&out[i * 2U], _mm256_mul_ps(_mm256_loadu_ps(&in[i * 2U]), g));
+        }
+    }
+    scalar_downmix_to_stereo(&in[i * channels], channels, &out[i * 2U], frames - i, gain);
+}
+
+PCM_AVX2 static void avx2_f32_to_s16(const float *in, int16_t *out, size_t samples, float gain) {
+    const __m256 g = _mm256_set1_ps(gain);
+    const __m256 hi = _mm256_set1_ps(1.0f);
+    const __m256 lo = _mm256_set1_ps(-1.0f);
+    const __m256 scale = _mm256_set1_ps(S16_SCALE);
+    size_t i = 0;
+    for (; i + 16U <= samples; i += 16U) {
+        __m256 a = _mm256_mul_ps(_mm256_loadu_ps(&in[i]), g);
+        __m256 b = _mm256_mul_ps(_mm256_loadu_ps(&in[i + 8U]), g);
+        a = _mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(a, lo), hi), scale);
+        b = _mm256_mul_ps(_mm256_min_ps(_mm256_max_ps(b, lo), hi), scale);
+        __m256i packed = _mm256_packs_epi32(_mm256_cvttps_epi32(a), _mm256_cvttps_epi32(b));
+        /* packs interleaves the 128-bit lanes (a0 b0 a1 b1); restore order. */
+        packed = _mm256_permute4x64_epi64(packed, 0xD8);
+        _mm256_storeu_si256((__m256i *)&out[i], packed);
+    }
+    scalar_f32_to_s16(&in[i], &out[i], samples - i, gain);
+}
+
+PCM_AVX2 static void avx2_s16_gain_q15(int16_t *samples, size_t count, int32_t gain_q15) {
+    if (!normalise_gain_q15(&gain_q15)) {
+        return;
+    }
+    /* mulhrs computes (a * b + 0x4000) >> 15, the reference rounding; with
+     * the gain below unity it cannot overflow. */
+    const __m256i g = _mm256_set1_epi16((int16_t)gain_q15);
+    size_t i = 0;
+    for (; i + 16U <= count; i += 16U) {
+        __m256i s = _mm256_loadu_si256((const __m256i *)&samples[i]);
+        _mm256_storeu_si256((__m256i *)&samples[i], _mm256_mulhrs_epi16(s, g));
+    }
+    scalar_s16_gain_q15(&samples[i], count - i, gain_q15);
+}
+
+static const PcmKernels k_avx2 = {
+    .name              = "avx2",
+    .downmix_to_stereo = avx2_downmix_to_stereo,
+    .f32_to_s16        = avx2_f32_to_s16,
+    .s16_gain_q15      = avx2_s16_gain_q15,
+};
+
+static bool cpu_has_avx2(void) {
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2") != 0;
+}
+#endif /* PCM_KERNELS_HAVE_AVX2 */
+
+// ---------------------------------------------------------------------------
+// Cortex-M7 DSP extension (firmware)
+// ---------------------------------------------------------------------------
+
+#ifdef PCM_KERNELS_HAVE_ARM_DSP
+/* Two samples per 32-bit word: one load/store per stereo frame. memcpy keeps
+ * the word access free of aliasing/alignment UB and compiles to LDR/STR. */
+static inline uint32_t load_pair(const int16_t *p) {
+    uint32_t w;
+    memcpy(&w, p, sizeof(w));
+    return w;
+}
+
+static inline void store_pair(int16_t *p, int32_t bottom, int32_t top) {
+    uint32_t w = ((uint32_t)bottom & 0xFFFFU) | ((uint32_t)top << 16);
+    memcpy(p, &w, sizeof(w));
+}
+
+static void arm_dsp_f32_to_s16(const float *in, int16_t *out, size_t samples, float gain) {
+    size_t i = 0;
+    for (; i + 2U <= samples; i += 2U) {
+        store_pair(&out[i], quantise_sample(in[i], gain), quantise_sample(in[i + 1U], gain));
+    }
+    scalar_f32_to_s16(&in[i], &out[i], samples - i, gain);
+}
+
+static void arm_dsp_s16_gain_q15(int16_t *samples, size_t count, int32_t gain_q15) {
+    if (!normalise_gain_q15(&gain_q15)) {
+        return;
+    }
+    /* SMLABB/SMLATB: 16x16 multiply of the bottom/top halfword plus the
+     * rounding constant in one instruction each; SSAT saturates. */
+    size_t i = 0;
+    for (; i + 2U <= count; i += 2U) {
+        int32_t pair = (int32_t)load_pair(&samples[i]);
+        int32_t bottom = __ssat(__smlabb(pair, gain_q15, 1 << 14) >> 15, 16);
+        int32_t top = __ssat(__smlatb(pair, gain_q15, 1 << 14) >> 15, 16);
+        store_pair(&samples[i], bottom, top);
+    }
+    scalar_s16_gain_q15(&samples[i], count - i, gain_q15);
+}
+
+static const PcmKernels k_arm_dsp = {
+    .name              = "arm-dsp",
+    .downmix_to_stereo = scalar_downmix_to_stereo,
+    .f32_to_s16        = arm_dsp_f32_to_s16,
+    .s16_gain_q15      = arm_dsp_s16_gain_q15,
+};
+#endif /* PCM_KERNELS_HAVE_ARM_DSP */
+
+const PcmKernels *PcmKernels_Get(PcmKernelsVariant variant) {
+    switch (variant) {
+        case PCM_KERNELS_SCALAR:
+            return &k_scalar;
+#ifdef PCM_KERNELS_HAVE_SSE2
+        case PCM_KERNELS_SSE2:
+            return &k_sse2;
+#endif
+#ifdef PCM_KERNELS_HAVE_AVX2
+        case PCM_KERNELS_AVX2:
+            return cpu_has_avx2() ? &k_avx2 : NULL;
+#endif
+#ifdef PCM_KERNELS_HAVE_ARM_DSP
+        case PCM_KERNELS_ARM_DSP:
+            return &k_arm_dsp;
+#endif
+        default:
+            return NULL;
+    }
+}
+
+const PcmKernels *PcmKernels_Best(void) {
+    static const PcmKernelsVariant preference[] = {
+        PCM_KERNELS_AVX2,
+        PCM_KERNELS_SSE2,
+        PCM_KERNELS_ARM_DSP,
+    };
+    for (size_t i = 0; i < sizeof(preference) / sizeof(preference[0]); i++) {
+        const PcmKernels *kernels = PcmKernels_Get(preference[i]);
+        if (kernels) {
+            return kernels;
+        }
+    }
+    return &k_scalar;
+}
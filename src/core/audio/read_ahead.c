@@ -0,0 +1,541 @@
+#include "nuno/read_ahead.h"
+
+#include <stdatomic.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Stream window contract (single consumer, single servicer per stream):
+ *
+ *   The ring holds file bytes [fill_start, fill_end); byte 'o' lives at
+ *   ring[o % window]. Only the servicer (the I/O thread, or a starved reader
+ *   servicing inline) writes the ring, fill_start and fill_end, and it does so
+ *   only while it holds the slot in STREAM_BUSY. Only the reader (the decoder
+ *   that owns the ByteSource) writes read_pos and request_gen.
+ *
+ *   The servicer never writes past read_pos + window - history, so the bytes
+ *   from read_pos onwards, and 'history' bytes behind the furthest read_pos
+ *   it can have seen (high_pos), stay intact while the reader copies them.
+ *   That lets a decoder step back a little (header probes, libFLAC's seek
+ *   search) without a restart.
+ *
+ *   A seek outside the window stores the new read_pos and bumps request_gen.
+ *   The servicer answers by emptying the window at read_pos and publishing
+ *   serviced_gen; until the two match the reader treats the window as empty.
+ *
+ * One ReadAhead_Service() call runs at a time (s_servicing), so the burst
+ * bookkeeping and the storage hooks have a single caller.
+ *
+ * Offsets are 32-bit so the shared ones stay lock-free on the Cortex-M7;
+ * larger files (beyond FAT32 anyway) are left to ByteSource_OpenFile().
+ */
+
+enum {
+    STREAM_FREE = 0,
+    STREAM_ACTIVE,
+    STREAM_BUSY,     // opening, or being serviced
+    STREAM_CLOSING,
+};
+
+typedef struct ReadAheadStream {
+    _Atomic int state;
+    atomic_bool close_requested;
+
+    // Servicer side
+    FILE *file;
+    uint8_t *ring;
+    size_t ring_capacity;  // allocated bytes, kept across opens
+    uint32_t window;
+    uint32_t history;
+    uint32_t size;
+    uint32_t low_water;  // refill once fewer bytes than this are buffered
+    _Atomic uint32_t fill_start;
+    _Atomic uint32_t fill_end;
+    _Atomic uint32_t serviced_gen;
+    atomic_bool io_error;
+
+    // Reader side
+    _Atomic uint32_t read_pos;
+    _Atomic uint32_t request_gen;
+    uint32_t high_pos;  // furthest read_pos since the window (re)started
+    uint32_t woken_at;  // fill_end at the last wake, so a low window wakes once
+} ReadAheadStream;
+
+static ReadAheadStream s_streams[READ_AHEAD_STREAMS];
+static atomic_size_t s_window_bytes;
+
+static atomic_uint s_low_water_percent = 50U;
+
+static void (*_Atomic s_io_wake)(void);
+static void (*_Atomic s_io_wait)(void);
+
+static atomic_flag s_servicing = ATOMIC_FLAG_INIT;
+static ReadAheadStorageHooks s_storage;
+static uint32_t s_idle_since_ms;
+
+/* Counters are atomics so any thread can read them mid-burst. */
+static struct {
+    atomic_uint bursts;
+    atomic_uint kib_read;
+    atomic_uint last_burst_bytes;
+    atomic_uint active_ms;
+    atomic_uint idle_ms;
+    atomic_uint last_idle_ms;
+    atomic_uint stalls;
+} s_stats;
+
+void ReadAhead_SetWindowBytes(size_t bytes) {
+    if (bytes > 0U && bytes < READ_AHEAD_MIN_WINDOW) {
+        bytes = READ_AHEAD_MIN_WINDOW;
+    } else if (bytes > READ_AHEAD_MAX_WINDOW) {
+        bytes = READ_AHEAD_MAX_WINDOW;
+    }
+    atomic_store(&s_window_bytes, bytes);
+}
+
+size_t ReadAhead_GetWindowBytes(void) {
+    return atomic_load(&s_window_bytes);
+}
+
+void ReadAhead_SetLowWatermarkPercent(unsigned percent) {
+    if (percent < 10U) {
+        percent = 10U;
+    } else if (percent > 90U) {
+        percent = 90U;
+    }
+    atomic_store(&s_low_water_percent, percent);
+}
+
+unsigned ReadAhead_GetLowWatermarkPercent(void) {
+    return atomic_load(&s_low_water_percent);
+}
+
+void ReadAhead_SetStorageHooks(const ReadAheadStorageHooks *hooks) {
+    if (hooks) {
+        s_storage = *hooks;
+    } else {
+        memset(&s_storage, 0, sizeof(s_storage));
+    }
+}
+
+void ReadAhead_GetStats(ReadAheadStats *stats) {
+    if (!stats) {
+        return;
+    }
+    stats->bursts = atomic_load(&s_stats.bursts);
+    stats->kib_read = atomic_load(&s_stats.kib_read);
+    stats->last_burst_bytes = atomic_load(&s_stats.last_burst_bytes);
+    stats->active_ms = atomic_load(&s_stats.active_ms);
+    stats->idle_ms = atomic_load(&s_stats.idle_ms);
+    stats->last_idle_ms = atomic_load(&s_stats.last_idle_ms);
+    stats->stalls = atomic_load(&s_stats.stalls);
+}
+
+void ReadAhead_ResetStats(void) {
+    atomic_store(&s_stats.bursts, 0U);
+    atomic_store(&s_stats.kib_read, 0U);
+    atomic_store(&s_stats.last_burst_bytes, 0U);
+    atomic_store(&s_stats.active_ms, 0U);
+    atomic_store(&s_stats.idle_ms, 0U);
+    atomic_store(&s_stats.last_idle_ms, 0U);
+    atomic_store(&s_stats.stalls, 0U);
+}
+
+void ReadAhead_SetIoHooks(void (*wake)(void), void (*wait)(void)) {
+    atomic_store(&s_io_wait, wait);
+    atomic_store(&s_io_wake, wake);
+}
+
+/* Without an I/O thread the reader does its work on the spot. */
+static void wake_io(void) {
+    void (*wake)(void) = atomic_load(&s_io_wake);
+    if (wake) {
+        wake();
+    } else {
+        ReadAhead_Service();
+    }
+}
+
+// ---------------------------------------------------------------------------
+// Slot ownership
+// ---------------------------------------------------------------------------
+
+static void stream_release_file(ReadAheadStream *stream) {
+    if (stream->file) {
+        fclose(stream->file);
+        stream->file = NULL;
+    }
+    atomic_store(&stream->state, STREAM_FREE);
+}
+
+/* Closes the stream if a close was requested and nobody is servicing it.
+ * The reader and the servicer both call this; the CAS picks one closer. */
+static void stream_try_close(ReadAheadStream *stream) {
+    if (!atomic_load(&stream->close_requested)) {
+        return;
+    }
+    int expected = STREAM_ACTIVE;
+    if (atomic_compare_exchange_strong(&stream->state, &expected, STREAM_CLOSING)) {
+        stream_release_file(stream);
+    }
+}
+
+static bool stream_acquire(ReadAheadStream *stream) {
+    int expected = STREAM_ACTIVE;
+    return atomic_compare_exchange_strong(&stream->state, &expected, STREAM_BUSY);
+}
+
+static void stream_release(ReadAheadStream *stream) {
+    atomic_store(&stream->state, STREAM_ACTIVE);
+    stream_try_close(stream);
+}
+
+// ---------------------------------------------------------------------------
+// Servicer
+// ---------------------------------------------------------------------------
+
+static bool restart_pending(const ReadAheadStream *stream) {
+    return atomic_load_explicit(&stream->request_gen, memory_order_acquire) !=
+           atomic_load_explicit(&stream->serviced_gen, memory_order_acquire);
+}
+
+/* Bytes the servicer may read next (0 when the window is full), capped at
+ * the contiguous run to the end of the ring. */
+static uint32_t stream_room(const ReadAheadStream *stream) {
+    uint32_t pos = atomic_load_explicit(&stream->read_pos, memory_order_acquire);
+    uint32_t end = atomic_load_explicit(&stream->fill_end, memory_order_relaxed);
+    uint64_t limit = (uint64_t)pos + stream->window - stream->history;
+    if (limit > stream->size) {
+        limit = stream->size;
+    }
+    if (end >= limit || atomic_load_explicit(&stream->io_error, memory_order_relaxed)) {
+        return 0U;
+    }
+    uint32_t room = (uint32_t)(limit - end);
+    // Only large reads, except to finish the file
+    if (room < READ_AHEAD_BURST_BYTES && limit != stream->size) {
+        return 0U;
+    }
+    uint32_t contiguous = stream->window - (end % stream->window);
+    return (room < contiguous) ? room : contiguous;
+}
+
+/* One restart or one read on a stream the caller holds in STREAM_BUSY;
+ * returns the bytes read. */
+static uint32_t stream_service(ReadAheadStream *stream) {
+    uint32_t gen = atomic_load_explicit(&stream->request_gen, memory_order_acquire);
+    if (gen != atomic_load_explicit(&stream->serviced_gen, memory_order_relaxed)) {
+        uint32_t pos = atomic_load_explicit(&stream->read_pos, memory_order_acquire);
+        bool ok = fseek(stream->file, (long)pos, SEEK_SET) == 0;
+        atomic_store_explicit(&stream->io_error, !ok, memory_order_relaxed);
+        atomic_store_explicit(&stream->fill_start, pos, memory_order_relaxed);
+        atomic_store_explicit(&stream->fill_end, pos, memory_order_relaxed);
+        atomic_store_explicit(&stream->serviced_gen, gen, memory_order_release);
+        return 0U;
+    }
+
+    uint32_t chunk = stream_room(stream);
+    if (chunk == 0U) {
+        return 0U;
+    }
+    uint32_t start = atomic_load_explicit(&stream->fill_start, memory_order_relaxed);
+    uint32_t end = atomic_load_explicit(&stream->fill_end, memory_order_relaxed);
+    if (end == start && chunk > READ_AHEAD_BURST_BYTES) {
+        chunk = READ_AHEAD_BURST_BYTES;  // a fresh window: get the reader going first
+    }
+    // The bytes about to be overwritten leave the window first
+    if (end + chunk > start + stream->window) {
+        atomic_store_explicit(&stream->fill_start, end + chunk - stream->window,
+                              memory_order_release);
+    }
+    size_t got = fread(stream->ring + (end % stream->window), 1, chunk, stream->file);
+    if (got < chunk) {
+        atomic_store_explicit(&stream->io_error, true, memory_order_relaxed);
+    }
+    atomic_store_explicit(&stream->fill_end, end + (uint32_t)got, memory_order_release);
+    if (s_storage.on_read) {
+        s_storage.on_read(chunk);
+    }
+    return (uint32_t)got;
+}
+
+static uint32_t stream_buffered(const ReadAheadStream *stream) {
+    uint32_t pos = atomic_load_explicit(&stream->read_pos, memory_order_relaxed);
+    uint32_t end = atomic_load_explicit(&stream->fill_end, memory_order_relaxed);
+    return (end > pos) ? end - pos : 0U;
+}
+
+static uint32_t storage_now_ms(void) {
+    return s_storage.now_ms ? s_storage.now_ms() : 0U;
+}
+
+static uint32_t burst_begin(void) {
+    uint32_t now = storage_now_ms();
+    if (atomic_load(&s_stats.bursts) > 0U) {
+        uint32_t idle = now - s_idle_since_ms;
+        atomic_store(&s_stats.last_idle_ms, idle);
+        atomic_fetch_add(&s_stats.idle_ms, idle);
+    }
+    if (s_storage.power_up) {
+        s_storage.power_up();
+    }
+    return now;
+}
+
+static void burst_end(uint32_t started_ms, uint32_t bytes) {
+    if (s_storage.power_down) {
+        s_storage.power_down();
+    }
+    s_idle_since_ms = storage_now_ms();
+    atomic_fetch_add(&s_stats.active_ms, s_idle_since_ms - started_ms);
+    atomic_fetch_add(&s_stats.kib_read, (bytes + 512U) / 1024U);
+    atomic_store(&s_stats.last_burst_bytes, bytes);
+    atomic_fetch_add(&s_stats.bursts, 1U);
+}
+
+void ReadAhead_Service(void) {
+    if (atomic_flag_test_and_set(&s_servicing)) {
+        return;  // the other servicer is on it
+    }
+    bool bursting = false;
+    uint32_t started_ms = 0U;
+    uint32_t burst_bytes = 0U;
+    for (;;) {
+        // Restarts first (a reader is waiting on them), then the emptiest
+        // window. Until a burst is under way only windows below their low
+        // watermark count; once storage is up, every window is topped up.
+        // Each stream is held while it is ranked, so it cannot be closed and
+        // reopened under the scan.
+        ReadAheadStream *next = NULL;
+        uint32_t next_rank = UINT32_MAX;
+        for (size_t i = 0; i < READ_AHEAD_STREAMS; i++) {
+            ReadAheadStream *stream = &s_streams[i];
+            if (!stream_acquire(stream)) {
+                continue;
+            }
+            uint32_t rank = UINT32_MAX;
+            uint32_t buffered = stream_buffered(stream);
+            if (restart_pending(stream)) {
+                rank = 0U;
+            } else if (stream_room(stream) > 0U && (bursting || buffered < stream->low_water)) {
+                rank = buffered + 1U;
+            }
+            stream_release(stream);
+            if (rank < next_rank) {
+                next = stream;
+                next_rank = rank;
+            }
+        }
+        if (!next) {
+            break;
+        }
+        if (!bursting) {
+            started_ms = burst_begin();
+            bursting = true;
+        }
+        if (stream_acquire(next)) {
+            burst_bytes += stream_service(next);  // re-checks: it may have been reopened
+            stream_release(next);
+        }
+    }
+    if (bursting) {
+        burst_end(started_ms, burst_bytes);
+    }
+    atomic_flag_clear(&s_servicing);
+}
+
+// ---------------------------------------------------------------------------
+// Reader (ByteSource ops)
+// ---------------------------------------------------------------------------
+
+/* Blocks until the I/O thread has made progress, or services inline (which
+ * returns at once if the I/O thread is mid-burst; the caller retries). */
+static void stream_wait(ReadAheadStream *stream) {
+    void (*wait)(void) = atomic_load(&s_io_wait);
+    stream->woken_at = atomic_load_explicit(&stream->fill_end, memory_order_relaxed);
+    wake_io();
+    if (wait && atomic_load(&s_io_wake)) {
+        wait();
+    }
+}
+
+/* Wakes the I/O thread once the window has drained below its low watermark. */
+static void stream_maybe_wake(ReadAheadStream *stream) {
+    uint32_t end = atomic_load_explicit(&stream->fill_end, memory_order_acquire);
+    if (end == stream->woken_at || end == stream->size) {
+        return;
+    }
+    if (stream_buffered(stream) < stream->low_water) {
+        stream->woken_at = end;
+        wake_io();
+    }
+}
+
+static size_t ra_read(ByteSource *source, void *dst, size_t bytes) {
+    ReadAheadStream *stream = source->u.read_ahead.stream;
+    uint8_t *out = (uint8_t *)dst;
+    uint32_t pos = atomic_load_explicit(&stream->read_pos, memory_order_relaxed);
+    size_t total = 0U;
+    bool stalled = false;
+
+    while (total < bytes && pos < stream->size) {
+        uint32_t end = atomic_load_explicit(&stream->fill_end, memory_order_acquire);
+        if (restart_pending(stream) || end <= pos) {
+            if (!restart_pending(stream) &&
+                atomic_load_explicit(&stream->io_error, memory_order_relaxed)) {
+                break;  // storage gave up short of the end
+            }
+            if (!stalled) {
+                stalled = true;
+                atomic_fetch_add(&s_stats.stalls, 1U);
+            }
+            stream_wait(stream);
+            continue;
+        }
+        uint32_t offset = pos % stream->window;
+        size_t chunk = end - pos;
+        if (chunk > stream->window - offset) {
+            chunk = stream->window - offset;
+        }
+        if (chunk > bytes - total) {
+            chunk = bytes - total;
+        }
+        memcpy(out + total, stream->ring + offset, chunk);
+        total += chunk;
+        pos += (uint32_t)chunk;
+        atomic_store_explicit(&stream->read_pos, pos, memory_order_release);
+        if (pos > stream->high_pos) {
+            stream->high_pos = pos;
+        }
+    }
+    stream_maybe_wake(stream);
+    return total;
+}
+
+static bool ra_seek(ByteSource *source, uint64_t offset) {
+    ReadAheadStream *stream = source->u.read_ahead.stream;
+    if (offset > stream->size) {
+        return false;
+    }
+    uint32_t target = (uint32_t)offset;
+    uint32_t pos = atomic_load_explicit(&stream->read_pos, memory_order_relaxed);
+    if (target == pos) {
+        return true;
+    }
+
+    if (!restart_pending(stream)) {
+        uint32_t start = atomic_load_explicit(&stream->fill_start, memory_order_acquire);
+        uint32_t end = atomic_load_explicit(&stream->fill_end, memory_order_acquire);
+        uint32_t high = stream->high_pos;
+        uint32_t floor = (high > stream->history) ? high - stream->history : 0U;
+        // Forward into the window, or back within the kept history
+        if (target >= start && target <= end && target >= floor) {
+            atomic_store_explicit(&stream->read_pos, target, memory_order_release);
+            if (target > high) {
+                stream->high_pos = target;
+            }
+            stream_maybe_wake(stream);
+            return true;
+        }
+    }
+
+    atomic_store_explicit(&stream->read_pos, target, memory_order_release);
+    atomic_fetch_add_explicit(&stream->request_gen, 1U, memory_order_release);
+    stream->high_pos = target;
+    stream->woken_at = UINT32_MAX;
+    wake_io();
+    return true;
+}
+
+static uint64_t ra_tell(const ByteSource *source) {
+    return atomic_load_explicit(&source->u.read_ahead.stream->read_pos, memory_order_relaxed);
+}
+
+static uint64_t ra_size(const ByteSource *source) {
+    return source->u.read_ahead.stream->size;
+}
+
+static void ra_close(ByteSource *source) {
+    ReadAheadStream *stream = source->u.read_ahead.stream;
+    source->u.read_ahead.stream = NULL;
+    // The I/O thread may be mid-burst; whoever sees the stream idle closes it
+    atomic_store(&stream->close_requested, true);
+    stream_try_close(stream);
+}
+
+static const ByteSourceOps k_read_ahead_ops = {
+    .read = ra_read,
+    .seek = ra_seek,
+    .tell = ra_tell,
+    .size = ra_size,
+    .map = NULL,
+    .close = ra_close,
+};
+
+bool ByteSource_OpenReadAhead(ByteSource *source, const char *path) {
+    if (!source || !path) {
+        return false;
+    }
+    source->ops = NULL;
+    size_t window = atomic_load(&s_window_bytes);
+    if (window == 0U) {
+        return false;
+    }
+
+    ReadAheadStream *stream = NULL;
+    for (size_t i = 0; i < READ_AHEAD_STREAMS && !stream; i++) {
+        int expected = STREAM_FREE;
+        if (atomic_compare_exchange_strong(&s_streams[i].state, &expected, STREAM_BUSY)) {
+            stream = &s_streams[i];
+        }
+    }
+    if (!stream) {
+        return false;
+    }
+
+    stream->file = fopen(path, "rb");
+    long size = -1;
+    if (stream->file && fseek(stream->file, 0, SEEK_END) == 0) {
+        size = ftell(stream->file);
+    }
+    if (size < 0 || (unsigned long)size > UINT32_MAX - READ_AHEAD_MAX_WINDOW ||
+        fseek(stream->file, 0, SEEK_SET) != 0) {
+        stream_release_file(stream);
+        return false;
+    }
+    if (stream->ring_capacity != window) {
+        free(stream->ring);
+        stream->ring = (uint8_t *)malloc(window);
+        stream->ring_capacity = stream->ring ? window : 0U;
+        if (!stream->ring) {
+            stream_release_file(stream);
+            return false;
+        }
+    }
+
+    stream->window = (uint32_t)window;
+    stream->history = (uint32_t)(window / 8U);
+    // Keep a burst's worth of room above the watermark, or a wake could find
+    // nothing worth reading
+    uint32_t low_water = (uint32_t)(window * atomic_load(&s_low_water_percent) / 100U);
+    uint32_t low_water_max = stream->window - stream->history - READ_AHEAD_BURST_BYTES;
+    stream->low_water = (low_water < low_water_max) ? low_water : low_water_max;
+    stream->size = (uint32_t)size;
+    atomic_store(&stream->close_requested, false);
+    atomic_store(&stream->io_error, false);
+    atomic_store(&stream->fill_start, 0U);
+    atomic_store(&stream->fill_end, 0U);
+    atomic_store(&stream->read_pos, 0U);
+    atomic_store(&stream->request_gen, 0U);
+    atomic_store(&stream->serviced_gen, 0U);
+    stream->high_pos = 0U;
+    stream->woken_at = UINT32_MAX;
+    atomic_store(&stream->state, STREAM_ACTIVE);
+
+    source->u.read_ahead.stream = stream;
+    source->ops = &k_read_ahead_ops;
+    wake_io();  // start filling before the decoder's first read
+    return true;
+}
@@ -0,0 +1,262 @@
+#include "nuno/resampler.h"
+
+#include <math.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/*
+ * Tier parameters. 'rolloff' places the -6 dB point of the prototype as a
+ * fraction of the lower Nyquist frequency so the Kaiser transition band
+ * (which narrows as taps grow) ends close to Nyquist.
+ */
+typedef struct {
+    uint32_t taps;
+    double beta;
+    double rolloff;
+} ResamplerTier;
+
+static const ResamplerTier k_tiers[RESAMPLER_QUALITY_COUNT] = {
+    [RESAMPLER_QUALITY_LOW]    = { 16U, 6.0, 0.85 },
+    [RESAMPLER_QUALITY_MEDIUM] = { 32U, 8.0, 0.90 },
+    [RESAMPLER_QUALITY_HIGH]   = { 64U, 10.0, 0.94 },
+};
+
+/* Per-frame work on the M7 beyond the dot product (phase step, stores). */
+#define M7_FRAME_OVERHEAD_CYCLES 20U
+
+static uint32_t gcd_u32(uint32_t a, uint32_t b) {
+    while (b != 0U) {
+        uint32_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+/* Zeroth-order modified Bessel function, for the Kaiser window. */
+static double bessel_i0(double x) {
+    double sum = 1.0;
+    double term = 1.0;
+    double half_x = x * 0.5;
+    for (int k = 1; k < 64; k++) {
+        term *= (half_x / (double)k) * (half_x / (double)k);
+        sum += term;
+        if (term < sum * 1e-12) {
+            break;
+        }
+    }
+    return sum;
+}
+
+/* Resolves L, M and taps for a tier. Returns false if the ratio is invalid. */
+static bool plan(ResamplerQuality quality, uint32_t in_rate, uint32_t out_rate,
+                 uint32_t *phases, uint32_t *step, uint32_t *taps) {
+    if (in_rate == 0U || out_rate == 0U || quality >= RESAMPLER_QUALITY_COUNT) {
+        return false;
+    }
+    uint32_t g = gcd_u32(in_rate, out_rate);
+    uint32_t l = out_rate / g;
+    uint32_t m = in_rate / g;
+    uint32_t decimation = (m + l - 1U) / l;
+    if (decimation == 0U) {
+        decimation = 1U;
+    }
+    uint32_t t = k_tiers[quality].taps * decimation;
+    if (t > RESAMPLER_MAX_TAPS || (uint64_t)l * t > RESAMPLER_MAX_COEFFS) {
+        return false;
+    }
+    *phases = l;
+    *step = m;
+    *taps = t;
+    return true;
+}
+
+bool Resampler_IsSupported(uint32_t in_rate, uint32_t out_rate) {
+    uint32_t l;
+    uint32_t m;
+    uint32_t t;
+    return plan(RESAMPLER_QUALITY_LOW, in_rate, out_rate, &l, &m, &t);
+}
+
+/*
+ * Designs the L * taps prototype and stores it phase-major with each phase
+ * reversed, so the coefficient for window slot j (oldest first) of phase p is
+ * coeffs[p * taps + j]. Each phase is normalised to unity DC gain, which also
+ * removes the small per-phase gain ripple of a truncated sinc.
+ */
+static void design(Resampler *rs, const ResamplerTier *tier) {
+    const uint32_t l = rs->phases;
+    const uint32_t taps = rs->taps;
+    const uint32_t length = l * taps;
+    const double centre = (double)(length - 1U) * 0.5;
+    const uint32_t wider = (rs->phases > rs->step) ? rs->phases : rs->step;
+    const double cutoff = 0.5 / (double)wider * tier->rolloff;  // cycles per upsampled sample
+    const double window_norm = 1.0 / bessel_i0(tier->beta);
+
+    for (uint32_t p = 0; p < l; p++) {
+        double sum = 0.0;
+        float *phase = &rs->coeffs[p * taps];
+        for (uint32_t k = 0; k < taps; k++) {
+            uint32_t n = k * l + p;
+            double x = (double)n - centre;
+            double sinc = (fabs(x) < 1e-9) ? 2.0 * cutoff
+                                           : sin(2.0 * M_PI * cutoff * x) / (M_PI * x);
+            double r = x / (centre + 0.5);
+            double w = (fabs(r) >= 1.0) ? 0.0
+                                        : bessel_i0(tier->beta * sqrt(1.0 - r * r)) * window_norm;
+            double h = sinc * w;
+            phase[taps - 1U - k] = (float)h;
+            sum += h;
+        }
+        if (sum != 0.0) {
+            float scale = (float)(1.0 / sum);
+            for (uint32_t j = 0; j < taps; j++) {
+                phase[j] *= scale;
+            }
+        }
+    }
+}
+
+bool Resampler_Configure(Resampler *rs, uint32_t in_rate, uint32_t out_rate,
+                         ResamplerQuality quality) {
+    if (!rs) {
+        return false;
+    }
+    rs->in_rate = 0U;
+    rs->out_rate = 0U;
+    rs->phases = 0U;
+    if (quality >= RESAMPLER_QUALITY_COUNT) {
+        quality = RESAMPLER_QUALITY_HIGH;
+    }
+
+    /* Step down a tier at a time until the coefficient table fits. */
+    for (int q = (int)quality; q >= 0; q--) {
+        uint32_t l;
+        uint32_t m;
+        uint32_t t;
+        if (!plan((ResamplerQuality)q, in_rate, out_rate, &l, &m, &t)) {
+            continue;
+        }
+        rs->quality = (ResamplerQuality)q;
+        rs->phases = l;
+        rs->step = m;
+        rs->taps = t;
+        design(rs, &k_tiers[q]);
+        rs->in_rate = in_rate;
+        rs->out_rate = out_rate;
+        Resampler_Reset(rs);
+        return true;
+    }
+    return false;
+}
+
+void Resampler_Reset(Resampler *rs) {
+    /* Half a window of leading silence centres the first output on the first
+     * input frame, cancelling the filter's group delay. */
+    rs->phase = 0U;
+    rs->pos = 0U;
+    rs->frames = rs->taps / 2U;
+    memset(rs->input, 0, rs->frames * 2U * sizeof(float));
+}
+
+float *Resampler_InputSpace(Resampler *rs, size_t *frames_free) {
+    if (rs->pos > 0U) {
+        size_t drop = (rs->pos < rs->frames) ? rs->pos : rs->frames;
+        memmove(rs->input, &rs->input[drop * 2U],
+                (rs->frames - drop) * 2U * sizeof(float));
+        rs->frames -= drop;
+        rs->pos -= drop;
+    }
+    size_t capacity = RESAMPLER_MAX_TAPS + RESAMPLER_INPUT_FRAMES;
+    if (frames_free) {
+        *frames_free = capacity - rs->frames;
+    }
+    return &rs->input[rs->frames * 2U];
+}
+
+void Resampler_CommitInput(Resampler *rs, size_t frames) {
+    size_t capacity = RESAMPLER_MAX_TAPS + RESAMPLER_INPUT_FRAMES;
+    rs->frames += frames;
+    if (rs->frames > capacity) {
+        rs->frames = capacity;
+    }
+}
+
+size_t Resampler_InputFramesFor(const Resampler *rs, size_t out_frames) {
+    if (out_frames == 0U || rs->phases == 0U) {
+        return 0U;
+    }
+    /* The last requested output needs its window's newest frame buffered. */
+    uint64_t advance = ((uint64_t)rs->phase + (uint64_t)(out_frames - 1U) * rs->step) / rs->phases;
+    uint64_t needed = (uint64_t)rs->pos + advance + rs->taps;
+    return (needed > rs->frames) ? (size_t)(needed - rs->frames) : 0U;
+}
+
+size_t Resampler_Pull(Resampler *rs, float *out, size_t max_frames) {
+    if (rs->phases == 0U) {
+        return 0U;  // not configured
+    }
+
+    const uint32_t taps = rs->taps;
+    const uint32_t l = rs->phases;
+    const uint32_t int_step = rs->step / l;
+    const uint32_t frac_step = rs->step % l;
+    size_t produced = 0U;
+
+    while (produced < max_frames && rs->pos + taps <= rs->frames) {
+        const float *c = &rs->coeffs[rs->phase * taps];
+        const float *x = &rs->input[rs->pos * 2U];
+        /* Two accumulators per channel break the add dependency chain; taps
+         * is always a multiple of the 16-tap base tier. */
+        float left0 = 0.0f;
+        float right0 = 0.0f;
+        float left1 = 0.0f;
+        float right1 = 0.0f;
+        for (uint32_t k = 0; k < taps; k += 2U) {
+            left0 += c[k] * x[k * 2U];
+            right0 += c[k] * x[k * 2U + 1U];
+            left1 += c[k + 1U] * x[k * 2U + 2U];
+            right1 += c[k + 1U] * x[k * 2U + 3U];
+        }
+        out[produced * 2U] = left0 + left1;
+        out[produced * 2U + 1U] = right0 + right1;
+        produced++;
+
+        rs->pos += int_step;
+        rs->phase += frac_step;
+        if (rs->phase >= l) {
+            rs->phase -= l;
+            rs->pos++;
+        }
+    }
+    return produced;
+}
+
+static void fill_cost(uint32_t taps, uint32_t phases, ResamplerCost *cost) {
+    cost->taps = taps;
+    cost->phases = phases;
+    cost->macs_per_frame = taps * 2U;
+    cost->est_cycles_per_frame = taps * 2U + M7_FRAME_OVERHEAD_CYCLES;
+}
+
+void Resampler_GetCost(const Resampler *rs, ResamplerCost *cost) {
+    if (!rs || !cost) {
+        return;
+    }
+    fill_cost(rs->taps, rs->phases, cost);
+}
+
+bool Resampler_EstimateCost(ResamplerQuality quality, uint32_t in_rate,
+                            uint32_t out_rate, ResamplerCost *cost) {
+    uint32_t l;
+    uint32_t m;
+    uint32_t t;
+    if (!cost || !plan(quality, in_rate, out_rate, &l, &m, &t)) {
+        return false;
+    }
+    fill_cost(t, l, cost);
+    return true;
+}
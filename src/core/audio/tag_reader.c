@@ -0,0 +1,495 @@
+#include "nuno/tag_reader.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#define ID3V2_HEADER_BYTES 10U
+
+/* Bytes past the start of the audio searched for the first MPEG frame, for
+ * taggers that leave padding or junk after the tag. */
+#define MP3_SYNC_WINDOW 1024U
+
+#define FLAC_STREAMINFO_BYTES 34U
+
+static uint32_t read_be32(const uint8_t *p) {
+    return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+}
+
+static uint32_t read_be24(const uint8_t *p) {
+    return ((uint32_t)p[0] << 16) | ((uint32_t)p[1] << 8) | p[2];
+}
+
+static uint32_t read_le32(const uint8_t *p) {
+    return ((uint32_t)p[3] << 24) | ((uint32_t)p[2] << 16) | ((uint32_t)p[1] << 8) | p[0];
+}
+
+/* 28-bit ID3v2 "syncsafe" integer: 7 bits per byte. */
+static uint32_t read_syncsafe(const uint8_t *p) {
+    return ((uint32_t)(p[0] & 0x7FU) << 21) | ((uint32_t)(p[1] & 0x7FU) << 14) |
+           ((uint32_t)(p[2] & 0x7FU) << 7) | (uint32_t)(p[3] & 0x7FU);
+}
+
+/* Appends code point 'cp' as UTF-8; false (nothing written) if it does not fit. */
+static bool put_utf8(char *dst, size_t *used, uint32_t cp) {
+    uint8_t bytes[4];
+    size_t n;
+    if (cp < 0x80U) {
+        bytes[0] = (uint8_t)cp;
+        n = 1U;
+    } else if (cp < 0x800U) {
+        bytes[0] = (uint8_t)(0xC0U | (cp >> 6));
+        bytes[1] = (uint8_t)(0x80U | (cp & 0x3FU));
+        n = 2U;
+    } else if (cp < 0x10000U) {
+        bytes[0] = (uint8_t)(0xE0U | (cp >> 12));
+        bytes[1] = (uint8_t)(0x80U | ((cp >> 6) & 0x3FU));
+        bytes[2] = (uint8_t)(0x80U | (cp & 0x3FU));
+        n = 3U;
+    } else {
+        bytes[0] = (uint8_t)(0xF0U | (cp >> 18));
+        bytes[1] = (uint8_t)(0x80U | ((cp >> 12) & 0x3FU));
+        bytes[2] = (uint8_t)(0x80U | ((cp >> 6) & 0x3FU));
+        bytes[3] = (uint8_t)(0x80U | (cp & 0x3FU));
+        n = 4U;
+    }
+    if (*used + n >= TAG_READER_TEXT_MAX) {
+        return false;
+    }
+    memcpy(dst + *used, bytes, n);
+    *used += n;
+    return true;
+}
+
+enum {
+    TEXT_LATIN1 = 0,
+    TEXT_UTF16 = 1,     // with a byte-order mark
+    TEXT_UTF16BE = 2,
+    TEXT_UTF8 = 3,
+};
+
+/*
+ * Copies the first string of 'text' ('length' bytes in ID3v2 'encoding') to
+ * 'dst' as UTF-8, stopping at a NUL (ID3v2.4 separates multiple values with
+ * one), and trims trailing blanks. Leaves 'dst' alone when it is already set.
+ */
+static void copy_text(char *dst, const uint8_t *text, size_t length, unsigned encoding) {
+    if (dst[0] != '\0') {
+        return;
+    }
+    size_t used = 0U;
+    if (encoding == TEXT_UTF16 || encoding == TEXT_UTF16BE) {
+        bool big_endian = (encoding == TEXT_UTF16BE);
+        if (encoding == TEXT_UTF16 && length >= 2U) {
+            if (text[0] == 0xFEU && text[1] == 0xFFU) {
+                big_endian = true;
+                text += 2;
+                length -= 2U;
+            } else if (text[0] == 0xFFU && text[1] == 0xFEU) {
+                text += 2;
+                length -= 2U;
+            }
+        }
+        for (size_t i = 0; i + 1U < length; i += 2U) {
+            uint32_t unit = big_endian ? ((uint32_t)text[i] << 8 | text[i + 1U])
+                                       : ((uint32_t)text[i + 1U] << 8 | text[i]);
+            if (unit == 0U) {
+                break;
+            }
+            if (unit >= 0xD800U && unit < 0xDC00U && i + 3U < length) {
+                uint32_t low = big_endian ? ((uint32_t)text[i + 2U] << 8 | text[i + 3U])
+                                          : ((uint32_t)text[i + 3U] << 8 | text[i + 2U]);
+                if (low >= 0xDC00U && low < 0xE000U) {
+                    unit = 0x10000U + ((unit - 0xD800U) << 10) + (low - 0xDC00U);
+                    i += 2U;
+                }
+            }
+            if (!put_utf8(dst, &used, unit)) {
+                break;
+            }
+        }
+    } else if (encoding == TEXT_UTF8) {
+        while (used < length && used < TAG_READER_TEXT_MAX - 1U && text[used] != 0U) {
+            dst[used] = (char)text[used];
+            used++;
+        }
+        if (used < length && text[used] != 0U) {
+            // Cut short: drop a partial multi-byte sequence
+            while (used > 0U && ((uint8_t)dst[used - 1U] & 0xC0U) == 0x80U) {
+                used--;
+            }
+            if (used > 0U && ((uint8_t)dst[used - 1U] & 0x80U) != 0U) {
+                used--;
+            }
+        }
+    } else {
+        for (size_t i = 0; i < length && text[i] != 0U; i++) {
+            if (!put_utf8(dst, &used, text[i])) {
+                break;
+            }
+        }
+    }
+    while (used > 0U && (dst[used - 1U] == ' ' || dst[used - 1U] == '\t')) {
+        used--;
+    }
+    dst[used] = '\0';
+}
+
+/* Leading number of "3", "03" or "3/12"; 0 when there is none. */
+static uint16_t parse_number(const uint8_t *text, size_t length) {
+    size_t i = 0U;
+    while (i < length && text[i] == ' ') {
+        i++;
+    }
+    uint32_t value = 0U;
+    for (; i < length && text[i] >= '0' && text[i] <= '9'; i++) {
+        value = value * 10U + (uint32_t)(text[i] - '0');
+        if (value > UINT16_MAX) {
+            return 0U;
+        }
+    }
+    return (uint16_t)value;
+}
+
+static void set_number(uint16_t *dst, const uint8_t *text, size_t length, unsigned encoding) {
+    if (*dst != 0U) {
+        return;
+    }
+    char digits[TAG_READER_TEXT_MAX] = "";
+    copy_text(digits, text, length, encoding);
+    *dst = parse_number((const uint8_t *)digits, strlen(digits));
+}
+
+/*
+ * Reads the text frames of the ID3v2 tag at the start of 'data' from the
+ * 'length' bytes available. Returns the tag's total size (header, body and
+ * footer), which may exceed 'length'; 0 when there is no tag.
+ */
+static size_t read_id3v2(const uint8_t *data, size_t length, TrackTags *tags) {
+    if (length < ID3V2_HEADER_BYTES || memcmp(data, "ID3", 3) != 0 || data[3] < 2U ||
+        data[3] > 4U || ((data[6] | data[7] | data[8] | data[9]) & 0x80U) != 0U) {
+        return 0U;
+    }
+    const unsigned version = data[3];
+    const uint8_t flags = data[5];
+    size_t tag_bytes = ID3V2_HEADER_BYTES + read_syncsafe(data + 6);
+    const size_t total = tag_bytes + ((flags & 0x10U) ? ID3V2_HEADER_BYTES : 0U);
+    const size_t end = tag_bytes < length ? tag_bytes : length;
+
+    size_t pos = ID3V2_HEADER_BYTES;
+    if (flags & 0x40U) {
+        if (version == 2U || pos + 4U > end) {
+            return total;  // v2.2 uses this bit for compression
+        }
+        size_t extended = (version == 3U) ? 4U + (size_t)read_be32(data + pos)
+                                          : (size_t)read_syncsafe(data + pos);
+        if (extended > end - pos) {
+            return total;
+        }
+        pos += extended;
+    }
+
+    const size_t header_bytes = (version == 2U) ? 6U : 10U;
+    const size_t id_bytes = (version == 2U) ? 3U : 4U;
+    while (pos + header_bytes <= end && data[pos] != 0U) {  // a NUL id starts the padding
+        const uint8_t *id = data + pos;
+        size_t size;
+        uint16_t frame_flags = 0U;
+        if (version == 2U) {
+            size = read_be24(id + 3);
+        } else {
+            // Some v2.4 writers still store plain v2.3 sizes
+            size = (version == 4U && ((id[4] | id[5] | id[6] | id[7]) & 0x80U) == 0U)
+                       ? read_syncsafe(id + 4)
+                       : read_be32(id + 4);
+            frame_flags = (uint16_t)(((uint16_t)id[8] << 8) | id[9]);
+        }
+        const uint8_t *body = id + header_bytes;
+        pos += header_bytes;
+        if (size > end - pos) {
+            break;  // runs past the tag or past what was read
+        }
+        pos += size;
+
+        if (version == 3U && (frame_flags & 0x00C0U)) {
+            continue;  // compressed or encrypted
+        }
+        if (version == 4U) {
+            if (frame_flags & 0x000CU) {
+                continue;
+            }
+            if (frame_flags & 0x0001U) {  // data length indicator
+                if (size < 4U) {
+                    continue;
+                }
+                body += 4;
+                size -= 4U;
+            }
+        }
+        if (size < 2U || id[0] != 'T') {
+            continue;
+        }
+        const unsigned encoding = body[0];
+        const uint8_t *text = body + 1;
+        const size_t text_length = size - 1U;
+        const char *name = (const char *)id + 1;
+        if (memcmp(name, id_bytes == 3U ? "T2" : "IT2", id_bytes - 1U) == 0) {
+            copy_text(tags->title, text, text_length, encoding);
+        } else if (memcmp(name, id_bytes == 3U ? "P1" : "PE1", id_bytes - 1U) == 0) {
+            copy_text(tags->artist, text, text_length, encoding);
+        } else if (memcmp(name, id_bytes == 3U ? "AL" : "ALB", id_bytes - 1U) == 0) {
+            copy_text(tags->album, text, text_length, encoding);
+        } else if (memcmp(name, id_bytes == 3U ? "RK" : "RCK", id_bytes - 1U) == 0) {
+            set_number(&tags->track_number, text, text_length, encoding);
+        } else if (memcmp(name, id_bytes == 3U ? "PA" : "POS", id_bytes - 1U) == 0) {
+            set_number(&tags->disc_number, text, text_length, encoding);
+        }
+    }
+    return total;
+}
+
+typedef struct {
+    uint32_t sample_rate;
+    uint32_t bitrate;        // bits per second
+    uint32_t frame_bytes;
+    uint32_t frame_samples;  // per channel
+    uint8_t channels;
+    bool mpeg1;
+} MpegFrame;
+
+/* Decodes the MPEG audio frame header at 'p'; false if it is not one. */
+static bool read_mpeg_header(const uint8_t *p, MpegFrame *frame) {
+    static const uint16_t k_bitrates[2][3][15] = {
+        {   // MPEG-2 and 2.5: layer III, II, I
+            { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 },
+            { 0, 8, 16, 24, 32, 40, 48, 56, 64, 80, 96, 112, 128, 144, 160 },
+            { 0, 32, 48, 56, 64, 80, 96, 112, 128, 144, 160, 176, 192, 224, 256 },
+        },
+        {   // MPEG-1
+            { 0, 32, 40, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320 },
+            { 0, 32, 48, 56, 64, 80, 96, 112, 128, 160, 192, 224, 256, 320, 384 },
+            { 0, 32, 64, 96, 128, 160, 192, 224, 256, 288, 320, 352, 384, 416, 448 },
+        },
+    };
+    static const uint16_t k_sample_rates[3] = { 44100U, 48000U, 32000U };
+
+    if (p[0] != 0xFFU || (p[1] & 0xE0U) != 0xE0U) {
+        return false;
+    }
+    const unsigned version = (p[1] >> 3) & 3U;  // 0: 2.5, 1: reserved, 2: 2, 3: 1
+    const unsigned layer = (p[1] >> 1) & 3U;    // 1: III, 2: II, 3: I
+    const unsigned bitrate_index = p[2] >> 4;
+    const unsigned rate_index = (p[2] >> 2) & 3U;
+    if (version == 1U || layer == 0U || bitrate_index == 0U || bitrate_index == 15U ||
+        rate_index == 3U) {
+        return false;  // reserved values; free-format streams are not timed
+    }
+    frame->mpeg1 = (version == 3U);
+    frame->bitrate = k_bitrates[frame->mpeg1][layer - 1U][bitrate_index] * 1000U;
+    frame->sample_rate = k_sample_rates[rate_index] >> (version == 3U ? 0 : version == 2U ? 1 : 2);
+    frame->channels = ((p[3] >> 6) == 3U) ? 1U : 2U;
+    const unsigned padding = (p[2] >> 1) & 1U;
+    if (layer == 3U) {
+        frame->frame_samples = 384U;
+        frame->frame_bytes = (12U * frame->bitrate / frame->sample_rate + padding) * 4U;
+    } else {
+        frame->frame_samples = (layer == 2U || frame->mpeg1) ? 1152U : 576U;
+        frame->frame_bytes = frame->frame_samples / 8U * frame->bitrate / frame->sample_rate + padding;
+    }
+    return true;
+}
+
+/* Frame count from a Xing/Info or VBRI header in 'frame'; 0 if there is none. */
+static uint32_t read_vbr_frame_count(const uint8_t *frame, size_t length, const MpegFrame *header) {
+    const bool mono = header->channels == 1U;
+    size_t offset = 4U + (header->mpeg1 ? (mono ? 17U : 32U) : (mono ? 9U : 17U));
+    if (offset + 12U <= length &&
+        (memcmp(frame + offset, "Xing", 4) == 0 || memcmp(frame + offset, "Info", 4) == 0)) {
+        return (read_be32(frame + offset + 4U) & 0x1U) ? read_be32(frame + offset + 8U) : 0U;
+    }
+    offset = 4U + 32U;
+    if (offset + 18U <= length && memcmp(frame + offset, "VBRI", 4) == 0) {
+        return read_be32(frame + offset + 14U);
+    }
+    return 0U;
+}
+
+/*
+ * Finds the first MPEG frame in 'data' (which sits at 'data_offset' in a file
+ * of 'file_size' bytes) and times the stream. A candidate counts when the
+ * frame after it, if already read, starts with a matching header too.
+ */
+static bool parse_mp3(const uint8_t *data, size_t length, uint64_t data_offset,
+                      uint64_t file_size, TrackTags *tags) {
+    size_t limit = length < MP3_SYNC_WINDOW ? length : MP3_SYNC_WINDOW;
+    for (size_t i = 0; i + 4U <= limit; i++) {
+        MpegFrame frame;
+        if (!read_mpeg_header(data + i, &frame)) {
+            continue;
+        }
+        size_t next = i + frame.frame_bytes;
+        if (next + 4U <= length) {
+            MpegFrame follower;
+            if (!read_mpeg_header(data + next, &follower) ||
+                (data[next + 1U] & 0xFEU) != (data[i + 1U] & 0xFEU) ||
+                follower.sample_rate != frame.sample_rate) {
+                continue;
+            }
+        }
+
+        tags->format = AUDIO_FORMAT_MP3;
+        tags->sample_rate = frame.sample_rate;
+        tags->channels = frame.channels;
+        size_t frame_length = length - i < frame.frame_bytes ? length - i : frame.frame_bytes;
+        uint32_t frames = read_vbr_frame_count(data + i, frame_length, &frame);
+        if (frames > 0U) {
+            uint64_t samples = (uint64_t)frames * frame.frame_samples;
+            tags->duration_seconds = (uint32_t)((samples + frame.sample_rate / 2U) / frame.sample_rate);
+        } else if (file_size > data_offset + i) {
+            uint64_t audio_bytes = file_size - data_offset - i;
+            tags->duration_estimated = true;
+            tags->duration_seconds =
+                (uint32_t)((audio_bytes * 8U + frame.bitrate / 2U) / frame.bitrate);
+        }
+        return true;
+    }
+    return false;
+}
+
+static bool key_is(const uint8_t *entry, size_t key_length, const char *key) {
+    if (strlen(key) != key_length) {
+        return false;
+    }
+    for (size_t i = 0; i < key_length; i++) {
+        uint8_t c = entry[i];
+        if (c >= 'a' && c <= 'z') {
+            c = (uint8_t)(c - ('a' - 'A'));
+        }
+        if (c != (uint8_t)key[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void read_vorbis_comments(const uint8_t *block, size_t length, TrackTags *tags) {
+    if (length < 8U) {
+        return;
+    }
+    size_t pos = 4U + (size_t)read_le32(block);  // vendor string
+    if (pos > length - 4U) {
+        return;
+    }
+    uint32_t count = read_le32(block + pos);
+    pos += 4U;
+    for (uint32_t i = 0; i < count && pos + 4U <= length; i++) {
+        size_t entry_length = read_le32(block + pos);
+        pos += 4U;
+        if (entry_length > length - pos) {
+            return;
+        }
+        const uint8_t *entry = block + pos;
+        pos += entry_length;
+        const uint8_t *equals = memchr(entry, '=', entry_length);
+        if (!equals) {
+            continue;
+        }
+        size_t key_length = (size_t)(equals - entry);
+        const uint8_t *value = equals + 1;
+        size_t value_length = entry_length - key_length - 1U;
+        if (key_is(entry, key_length, "TITLE")) {
+            copy_text(tags->title, value, value_length, TEXT_UTF8);
+        } else if (key_is(entry, key_length, "ARTIST")) {
+            copy_text(tags->artist, value, value_length, TEXT_UTF8);
+        } else if (key_is(entry, key_length, "ALBUM")) {
+            copy_text(tags->album, value, value_length, TEXT_UTF8);
+        } else if (key_is(entry, key_length, "TRACKNUMBER") && tags->track_number == 0U) {
+            tags->track_number = parse_number(value, value_length);
+        } else if (key_is(entry, key_length, "DISCNUMBER") && tags->disc_number == 0U) {
+            tags->disc_number = parse_number(value, value_length);
+        }
+    }
+}
+
+/* Walks the metadata blocks after "fLaC" that lie within 'length'. */
+static void parse_flac(const uint8_t *data, size_t length, TrackTags *tags) {
+    tags->format = AUDIO_FORMAT_FLAC;
+    size_t pos = 4U;
+    while (pos + 4U <= length) {
+        const uint8_t type = data[pos] & 0x7FU;
+        const bool last = (data[pos] & 0x80U) != 0U;
+        const size_t size = read_be24(data + pos + 1U);
+        const uint8_t *body = data + pos + 4U;
+        pos += 4U;
+        if (size > length - pos) {
+            break;
+        }
+        pos += size;
+        if (type == 0U && size >= FLAC_STREAMINFO_BYTES) {
+            uint32_t rate = ((uint32_t)body[10] << 12) | ((uint32_t)body[11] << 4) | (body[12] >> 4);
+            uint64_t samples = ((uint64_t)(body[13] & 0x0FU) << 32) | read_be32(body + 14);
+            tags->sample_rate = rate;
+            tags->channels = (uint8_t)(((body[12] >> 1) & 7U) + 1U);
+            if (rate > 0U) {
+                tags->duration_seconds = (uint32_t)((samples + rate / 2U) / rate);
+            }
+        } else if (type == 4U) {
+            read_vorbis_comments(body, size, tags);
+        }
+        if (last) {
+            break;
+        }
+    }
+}
+
+/* 'data' starts where the audio stream should: "fLaC" or MPEG frames. */
+static bool parse_stream(const uint8_t *data, size_t length, uint64_t data_offset,
+                         uint64_t file_size, TrackTags *tags) {
+    if (length >= 4U && memcmp(data, "fLaC", 4) == 0) {
+        parse_flac(data, length, tags);
+        return true;
+    }
+    return parse_mp3(data, length, data_offset, file_size, tags);
+}
+
+bool TagReader_Parse(const uint8_t *data, size_t length, uint64_t file_size, TrackTags *tags) {
+    if (!data || !tags) {
+        return false;
+    }
+    memset(tags, 0, sizeof(*tags));
+    size_t start = read_id3v2(data, length, tags);
+    if (start >= length) {
+        return false;
+    }
+    return parse_stream(data + start, length - start, start, file_size, tags);
+}
+
+bool TagReader_ReadFile(const char *path, uint8_t *buffer, size_t capacity, TrackTags *tags) {
+    if (!path || !buffer || !tags || capacity < TAG_READER_FRAME_BYTES) {
+        return false;
+    }
+    memset(tags, 0, sizeof(*tags));
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        return false;
+    }
+    size_t got = fread(buffer, 1, capacity, file);
+    uint64_t file_size = got;
+    if (got == capacity && fseek(file, 0, SEEK_END) == 0) {
+        long end = ftell(file);
+        file_size = end > 0 ? (uint64_t)end : 0U;
+    }
+    tags->bytes_read = (uint32_t)got;
+
+    size_t start = read_id3v2(buffer, got, tags);
+    bool ok = false;
+    if (got < capacity || start + TAG_READER_FRAME_BYTES <= got) {
+        // The whole file, or enough past the tag to see the first frame
+        ok = start < got && parse_stream(buffer + start, got - start, start, file_size, tags);
+    } else if (start < file_size && fseek(file, (long)start, SEEK_SET) == 0) {
+        size_t more = fread(buffer, 1, TAG_READER_FRAME_BYTES, file);
+        tags->bytes_read += (uint32_t)more;
+        ok = parse_stream(buffer, more, start, file_size, tags);
+    }
+    fclose(file);
+    return ok;
+}
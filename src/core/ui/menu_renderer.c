@@ -2,6 +2,7 @@
 #include "ui_state.h"
 #include "menu_items.h"
 
+#include <ctype.h>
 #include <math.h>
 #include <string.h>
 #include <stdio.h>
@@ -13,6 +14,8 @@
 #define PROGRESS_BAR_MARGIN_X 8
 #define BATTERY_ICON_WIDTH 15
 #define BATTERY_ICON_HEIGHT 8
+#define INDEX_OVERLAY_DURATION_MS 600
+#define MAX_DIRTY_RECTS 4
 
 typedef struct {
     float currentScrollOffset;
@@ -30,8 +33,35 @@ typedef struct {
     bool isActive;
 } TransitionState;
 
+typedef struct {
+    uint32_t hideTime;
+    bool isVisible;
+} IndexOverlayState;
+
+/* What the panel shows, so the next frame redraws only what changed. */
+typedef struct {
+    bool valid;
+    const DeviceProfile *profile;
+    MenuType menuType;
+    char title[MAX_TITLE_LENGTH];
+    uint32_t itemCount;
+    uint32_t selectedIndex;
+    float scrollOffset;
+    bool overlayVisible;
+    uint8_t batteryLevel;
+    uint16_t currentTrackTime;
+    uint16_t totalTrackTime;
+    bool isPlaying;
+    char trackTitle[MAX_TITLE_LENGTH];
+    char artist[MAX_TITLE_LENGTH];
+} ScreenRecord;
+
 static ScrollState scrollState = {0};
 static TransitionState transitionState = {0};
+static IndexOverlayState indexOverlay = {0};
+static ScreenRecord drawn = {0};
+static DisplayRect dirtyRects[MAX_DIRTY_RECTS];
+static size_t dirtyCount = 0;
 
 // Helper function for smooth easing
 static float easeOutQuad(float t) {
@@ -55,12 +85,59 @@ static void updateScrollAnimation(uint32_t currentTime) {
         (scrollState.targetScrollOffset - scrollState.startScrollOffset) * progress;
 }
 
+/* An accelerated wheel moves hundreds of rows a tick; sliding through all of
+ * them would be a blur, so a jump longer than the screen animates only its
+ * last screenful. */
+static void animateScrollTo(float targetOffset, uint32_t currentTime) {
+    float span = (float)(DISPLAY_HEIGHT - TITLE_BAR_HEIGHT);
+    if (targetOffset - scrollState.currentScrollOffset > span) {
+        scrollState.currentScrollOffset = targetOffset - span;
+    } else if (scrollState.currentScrollOffset - targetOffset > span) {
+        scrollState.currentScrollOffset = targetOffset + span;
+    }
+
+    scrollState.animationStartTime = currentTime;
+    scrollState.startScrollOffset = scrollState.currentScrollOffset;
+    scrollState.targetScrollOffset = targetOffset;
+    scrollState.isAnimating = true;
+}
+
+/* Adds a region, clipped to the screen, to this frame's push. */
+static void markDirty(int x, int y, int width, int height) {
+    if (x < 0) { width += x; x = 0; }
+    if (y < 0) { height += y; y = 0; }
+    if (x + width > DISPLAY_WIDTH) width = DISPLAY_WIDTH - x;
+    if (y + height > DISPLAY_HEIGHT) height = DISPLAY_HEIGHT - y;
+    if (width <= 0 || height <= 0) {
+        return;
+    }
+
+    if (dirtyCount == MAX_DIRTY_RECTS) {
+        // Out of slots: grow the last region to cover this one too
+        DisplayRect *last = &dirtyRects[MAX_DIRTY_RECTS - 1];
+        int right = (last->x + last->width > x + width) ? last->x + last->width : x + width;
+        int bottom = (last->y + last->height > y + height) ? last->y + last->height : y + height;
+        last->x = (last->x < x) ? last->x : x;
+        last->y = (last->y < y) ? last->y : y;
+        last->width = right - last->x;
+        last->height = bottom - last->y;
+        return;
+    }
+    dirtyRects[dirtyCount++] = (DisplayRect){ x, y, width, height };
+}
+
 bool MenuRenderer_Init(void) {
     memset(&scrollState, 0, sizeof(scrollState));
     memset(&transitionState, 0, sizeof(transitionState));
+    memset(&indexOverlay, 0, sizeof(indexOverlay));
+    memset(&drawn, 0, sizeof(drawn));
     return true;
 }
 
+void MenuRenderer_Invalidate(void) {
+    drawn.valid = false;
+}
+
 void MenuRenderer_StartScroll(float targetOffset, uint32_t currentTime) {
     if (fabsf(scrollState.currentScrollOffset - targetOffset) < 0.5f) {
         scrollState.currentScrollOffset = targetOffset;
@@ -68,10 +145,12 @@ void MenuRenderer_StartScroll(float targetOffset, uint32_t currentTime) {
         return;
     }
 
-    scrollState.animationStartTime = currentTime;
-    scrollState.startScrollOffset = scrollState.currentScrollOffset;
-    scrollState.targetScrollOffset = targetOffset;
-    scrollState.isAnimating = true;
+    animateScrollTo(targetOffset, currentTime);
+}
+
+void MenuRenderer_ShowIndexOverlay(uint32_t currentTime) {
+    indexOverlay.hideTime = currentTime + INDEX_OVERLAY_DURATION_MS;
+    indexOverlay.isVisible = true;
 }
 
 void MenuRenderer_StartTransition(MenuType from, MenuType to, uint32_t currentTime) {
@@ -89,8 +168,8 @@ static bool itemDrillsIn(const MenuItem* item) {
     return item->submenu != MENU_NOW_PLAYING;
 }
 
-static void renderMenuItem(const MenuItem* item, uint8_t index, bool selected) {
-    int y = TITLE_BAR_HEIGHT + (index * ITEM_HEIGHT) - (int)scrollState.currentScrollOffset;
+static void renderMenuItem(const MenuItem* item, uint32_t index, bool selected) {
+    int y = TITLE_BAR_HEIGHT + (int)(index * (uint32_t)ITEM_HEIGHT) - (int)scrollState.currentScrollOffset;
 
     if ((y + ITEM_HEIGHT) <= TITLE_BAR_HEIGHT || y >= DISPLAY_HEIGHT) {
         return;
@@ -111,6 +190,24 @@ static void renderMenuItem(const MenuItem* item, uint8_t index, bool selected) {
     }
 }
 
+/* The selected row's initial in a box mid-screen, so a fast scroll shows
+ * where in the alphabet it is. */
+static void renderIndexOverlay(const Menu* menu) {
+    MenuItem item;
+    if (!getMenuItem(menu, menu->selectedIndex, &item)) {
+        return;
+    }
+
+    unsigned char initial = (unsigned char)item.text[0];
+    char letter[2] = { isalpha(initial) ? (char)toupper(initial) : '#', '\0' };
+    int box = TEXT_HEIGHT * 3;
+    int x = (DISPLAY_WIDTH - box) / 2;
+    int y = TITLE_BAR_HEIGHT + (DISPLAY_HEIGHT - TITLE_BAR_HEIGHT - box) / 2;
+    Display_FillSelection(x, y, box, box);
+    Display_DrawText(letter, x + (box - Display_MeasureText(letter)) / 2,
+                     y + (box - TEXT_HEIGHT) / 2, SELECTED_TEXT_COLOR);
+}
+
 static void renderProgressBar(uint16_t current, uint16_t total) {
     if (total == 0) {
         return;
@@ -153,46 +250,42 @@ static void renderBatteryIndicator(uint8_t percentage) {
     }
 }
 
-static void renderNowPlayingView(const UIState* state, uint32_t currentTime) {
-    // Clear background
-    Display_FillRect(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT, 0);
-
-    // Draw title bar
-    Display_FillTitleBar(0, 0, DISPLAY_WIDTH, TITLE_BAR_HEIGHT);
-    Display_DrawText("Now Playing", TEXT_MARGIN,
-                     (TITLE_BAR_HEIGHT - TEXT_HEIGHT) / 2, TITLE_TEXT_COLOR);
-
-    // Battery indicator
-    renderBatteryIndicator(state->batteryLevel);
-
-    // Track title (centered, prominent display - iPod mini style)
-    const char* trackTitle = state->currentTrackTitle;
-    if (strlen(trackTitle) == 0) {
-        trackTitle = "Unknown Track";
-    }
-
-    // Centered, measured against the active font scale.
-    int titleWidth = Display_MeasureText(trackTitle);
-    int titleX = (DISPLAY_WIDTH - titleWidth) / 2;
-    int titleY = TITLE_BAR_HEIGHT + DISPLAY_HEIGHT / 6; // proportional to screen
-
-    Display_DrawText(trackTitle, titleX, titleY, NORMAL_TEXT_COLOR);
-
-    // Artist name (centered, below track title)
-    const char* artist = state->currentArtist;
-    if (strlen(artist) == 0) {
-        artist = "Unknown Artist";
-    }
+typedef struct {
+    int titleY;
+    int artistY;
+    int playStateX;
+    int playStateY;
+    int progressBarY;
+    int timeY;
+} NowPlayingLayout;
+
+static NowPlayingLayout nowPlayingLayout(void) {
+    NowPlayingLayout layout;
+    layout.titleY = TITLE_BAR_HEIGHT + DISPLAY_HEIGHT / 6; // proportional to screen
+    layout.artistY = layout.titleY + TEXT_HEIGHT + 6;
+    layout.timeY = DISPLAY_HEIGHT - TEXT_HEIGHT - 2;
+    layout.progressBarY = layout.timeY - (PROGRESS_BAR_HEIGHT + 6);
+    layout.playStateX = (DISPLAY_WIDTH - 6) / 2; // approx width of symbol
+    layout.playStateY = layout.progressBarY - 10;
+    if (layout.playStateY < TITLE_BAR_HEIGHT + 2) layout.playStateY = TITLE_BAR_HEIGHT + 2;
+    return layout;
+}
 
-    int artistWidth = Display_MeasureText(artist);
-    int artistX = (DISPLAY_WIDTH - artistWidth) / 2;
-    int artistY = titleY + TEXT_HEIGHT + 6;
+/* Top of the band that changes as a track plays: play state, bar, times. */
+static int transportTop(const NowPlayingLayout* layout) {
+    return (layout->playStateY < layout->progressBarY - 1) ? layout->playStateY
+                                                           : layout->progressBarY - 1;
+}
 
-    Display_DrawText(artist, artistX, artistY, NORMAL_TEXT_COLOR);
+/* Play state, progress bar and times, over a cleared band, so a playback
+ * tick can redraw them alone. */
+static void renderTransport(const UIState* state, const NowPlayingLayout* layout) {
+    int top = transportTop(layout);
+    Display_FillRect(0, top, DISPLAY_WIDTH, DISPLAY_HEIGHT - top, 0);
 
     // Progress bar and timestamps near the bottom, like iPod mini
-    int timeY = DISPLAY_HEIGHT - TEXT_HEIGHT - 2;
-    int progressBarY = timeY - (PROGRESS_BAR_HEIGHT + 6);
+    int timeY = layout->timeY;
+    int progressBarY = layout->progressBarY;
     int barX = PROGRESS_BAR_MARGIN_X;
     int barW = DISPLAY_WIDTH - (PROGRESS_BAR_MARGIN_X * 2);
     if (barW < 0) barW = 0;
@@ -235,16 +328,130 @@ static void renderNowPlayingView(const UIState* state, uint32_t currentTime) {
 
     // Play/Pause indicator (position above the bar to avoid bottom overlap)
     const char* playState = state->isPlaying ? "▶" : "⏸";
-    int playStateX = (DISPLAY_WIDTH - 6) / 2; // approx width of symbol
-    int playStateY = progressBarY - 10;
-    if (playStateY < TITLE_BAR_HEIGHT + 2) playStateY = TITLE_BAR_HEIGHT + 2;
-    Display_DrawText(playState, playStateX, playStateY, NORMAL_TEXT_COLOR);
+    Display_DrawText(playState, layout->playStateX, layout->playStateY, NORMAL_TEXT_COLOR);
 
     // Bottom instructions removed for cleaner iPod mini look
 }
 
+static void renderNowPlayingView(const UIState* state, uint32_t currentTime) {
+    (void)currentTime;
+    NowPlayingLayout layout = nowPlayingLayout();
+
+    // Clear background
+    Display_FillRect(0, 0, DISPLAY_WIDTH, DISPLAY_HEIGHT, 0);
+
+    // Draw title bar
+    Display_FillTitleBar(0, 0, DISPLAY_WIDTH, TITLE_BAR_HEIGHT);
+    Display_DrawText("Now Playing", TEXT_MARGIN,
+                     (TITLE_BAR_HEIGHT - TEXT_HEIGHT) / 2, TITLE_TEXT_COLOR);
+
+    // Battery indicator
+    renderBatteryIndicator(state->batteryLevel);
+
+    // Track title (centered, prominent display - iPod mini style)
+    const char* trackTitle = state->currentTrackTitle;
+    if (strlen(trackTitle) == 0) {
+        trackTitle = "Unknown Track";
+    }
+
+    // Centered, measured against the active font scale.
+    int titleWidth = Display_MeasureText(trackTitle);
+    int titleX = (DISPLAY_WIDTH - titleWidth) / 2;
+    Display_DrawText(trackTitle, titleX, layout.titleY, NORMAL_TEXT_COLOR);
+
+    // Artist name (centered, below track title)
+    const char* artist = state->currentArtist;
+    if (strlen(artist) == 0) {
+        artist = "Unknown Artist";
+    }
+
+    int artistWidth = Display_MeasureText(artist);
+    int artistX = (DISPLAY_WIDTH - artistWidth) / 2;
+    Display_DrawText(artist, artistX, layout.artistY, NORMAL_TEXT_COLOR);
+
+    renderTransport(state, &layout);
+}
+
+/* The battery icon alone, over its slice of the title bar. */
+static void redrawBattery(uint8_t percentage) {
+    int x = DISPLAY_WIDTH - BATTERY_ICON_WIDTH - 5;
+    Display_FillTitleBar(x, 0, BATTERY_ICON_WIDTH + 2, TITLE_BAR_HEIGHT);
+    renderBatteryIndicator(percentage);
+    markDirty(x, 0, BATTERY_ICON_WIDTH + 2, TITLE_BAR_HEIGHT);
+}
+
+/* One list row alone; only while the list is at rest, when rows sit whole
+ * below the title bar. */
+static void redrawRow(const Menu* menu, uint32_t row) {
+    int y = TITLE_BAR_HEIGHT + (int)(row * (uint32_t)ITEM_HEIGHT) - (int)scrollState.currentScrollOffset;
+    Display_FillRect(0, y, DISPLAY_WIDTH, ITEM_HEIGHT, 0);
+    MenuItem item;
+    if (getMenuItem(menu, row, &item)) {
+        renderMenuItem(&item, row, row == menu->selectedIndex);
+    }
+    markDirty(0, y, DISPLAY_WIDTH, ITEM_HEIGHT);
+}
+
+/* Whether the panel must be redrawn whole: the view, its layout or its
+ * scroll position changed, or something moves that is not a single region. */
+static bool needsFullFrame(const UIState* state) {
+    if (!drawn.valid || drawn.profile != Display_GetActiveProfile() ||
+        drawn.menuType != state->currentMenuType || transitionState.isActive) {
+        return true;
+    }
+    if (state->currentMenuType == MENU_NOW_PLAYING) {
+        // On short screens the transport band reaches up into the artist line
+        NowPlayingLayout layout = nowPlayingLayout();
+        return strcmp(drawn.trackTitle, state->currentTrackTitle) != 0 ||
+               strcmp(drawn.artist, state->currentArtist) != 0 ||
+               transportTop(&layout) < layout.artistY + TEXT_HEIGHT;
+    }
+    return scrollState.isAnimating || indexOverlay.isVisible || drawn.overlayVisible ||
+           drawn.scrollOffset != scrollState.currentScrollOffset ||
+           drawn.itemCount != state->currentMenu.itemCount ||
+           strcmp(drawn.title, state->currentMenu.title) != 0;
+}
+
+/* Redraws what changed since the last frame, noting each region. */
+static void renderChanges(const UIState* state) {
+    if (state->currentMenuType == MENU_NOW_PLAYING) {
+        if (drawn.currentTrackTime != state->currentTrackTime ||
+            drawn.totalTrackTime != state->totalTrackTime ||
+            drawn.isPlaying != state->isPlaying) {
+            NowPlayingLayout layout = nowPlayingLayout();
+            renderTransport(state, &layout);
+            int top = transportTop(&layout);
+            markDirty(0, top, DISPLAY_WIDTH, DISPLAY_HEIGHT - top);
+        }
+    } else if (drawn.selectedIndex != state->currentMenu.selectedIndex) {
+        redrawRow(&state->currentMenu, drawn.selectedIndex);
+        redrawRow(&state->currentMenu, state->currentMenu.selectedIndex);
+    }
+
+    if (drawn.batteryLevel != state->batteryLevel) {
+        redrawBattery(state->batteryLevel);
+    }
+}
+
+static void recordFrame(const UIState* state) {
+    drawn.valid = true;
+    drawn.profile = Display_GetActiveProfile();
+    drawn.menuType = state->currentMenuType;
+    memcpy(drawn.title, state->currentMenu.title, sizeof(drawn.title));
+    drawn.itemCount = state->currentMenu.itemCount;
+    drawn.selectedIndex = state->currentMenu.selectedIndex;
+    drawn.scrollOffset = scrollState.currentScrollOffset;
+    drawn.overlayVisible = indexOverlay.isVisible;
+    drawn.batteryLevel = state->batteryLevel;
+    drawn.currentTrackTime = state->currentTrackTime;
+    drawn.totalTrackTime = state->totalTrackTime;
+    drawn.isPlaying = state->isPlaying;
+    memcpy(drawn.trackTitle, state->currentTrackTitle, sizeof(drawn.trackTitle));
+    memcpy(drawn.artist, state->currentArtist, sizeof(drawn.artist));
+}
+
 bool MenuRenderer_IsAnimating(void) {
-    return scrollState.isAnimating || transitionState.isActive;
+    return scrollState.isAnimating || transitionState.isActive || indexOverlay.isVisible;
 }
 
 void MenuRenderer_SetBrightness(uint8_t brightness) {
@@ -255,6 +462,7 @@ void MenuRenderer_FinishAnimations(void) {
     scrollState.currentScrollOffset = scrollState.targetScrollOffset;
     scrollState.isAnimating = false;
     transitionState.isActive = false;
+    indexOverlay.isVisible = false;
 }
 
 void MenuRenderer_Render(const UIState* state, uint32_t currentTime) {
@@ -266,12 +474,22 @@ void MenuRenderer_Render(const UIState* state, uint32_t currentTime) {
     if (!scrollState.isAnimating) {
         scrollState.currentScrollOffset = targetOffset;
     } else if (fabsf(scrollState.targetScrollOffset - targetOffset) > 0.1f) {
-        scrollState.startScrollOffset = scrollState.currentScrollOffset;
-        scrollState.targetScrollOffset = targetOffset;
-        scrollState.animationStartTime = currentTime;
+        animateScrollTo(targetOffset, currentTime);
     }
 
     updateScrollAnimation(currentTime);
+    if (indexOverlay.isVisible && (int32_t)(currentTime - indexOverlay.hideTime) >= 0) {
+        indexOverlay.isVisible = false;
+    }
+
+    // Most frames change a row, the progress bar or nothing: push just that
+    if (!needsFullFrame(state)) {
+        dirtyCount = 0;
+        renderChanges(state);
+        recordFrame(state);
+        Display_UpdateRects(dirtyRects, dirtyCount);
+        return;
+    }
 
     Display_Clear();
 
@@ -279,10 +497,24 @@ void MenuRenderer_Render(const UIState* state, uint32_t currentTime) {
     if (state->currentMenuType == MENU_NOW_PLAYING) {
         renderNowPlayingView(state, currentTime);
     } else {
-        // Standard menu rendering
-        for (int i = 0; i < state->currentMenu.itemCount; ++i) {
-            renderMenuItem(&state->currentMenu.items[i], i,
-                           i == state->currentMenu.selectedIndex);
+        // Standard menu rendering: only the rows in the window, fetched one
+        // at a time, so a long list costs what a short one does
+        const Menu *menu = &state->currentMenu;
+        float offset = scrollState.currentScrollOffset > 0.0f ? scrollState.currentScrollOffset : 0.0f;
+        uint32_t first = (uint32_t)(offset / (float)ITEM_HEIGHT);
+        uint32_t end = first + getVisibleMenuRows() + 1U;  // a part row while scrolling
+        if (end > menu->itemCount || end < first) {
+            end = menu->itemCount;
+        }
+        for (uint32_t i = first; i < end; ++i) {
+            MenuItem item;
+            if (getMenuItem(menu, i, &item)) {
+                renderMenuItem(&item, i, i == menu->selectedIndex);
+            }
+        }
+
+        if (indexOverlay.isVisible) {
+            renderIndexOverlay(menu);
         }
 
         Display_FillTitleBar(0, 0, DISPLAY_WIDTH, TITLE_BAR_HEIGHT);
@@ -296,5 +528,6 @@ void MenuRenderer_Render(const UIState* state, uint32_t currentTime) {
         renderBatteryIndicator(state->batteryLevel);
     }
 
+    recordFrame(state);
     Display_Update();
 }
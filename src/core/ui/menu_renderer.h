@@ -18,6 +18,13 @@ bool MenuRenderer_Init(void);
  */
 void MenuRenderer_StartScroll(float targetOffset, uint32_t currentTime);
 
+/**
+ * @brief Show the selected row's initial over the list, as fast scrolling
+ *        does; it hides itself once this has not been called for a while
+ * @param currentTime Current system time in milliseconds
+ */
+void MenuRenderer_ShowIndexOverlay(uint32_t currentTime);
+
 /**
  * @brief Start a transition animation between menus
  * @param from Source menu type
@@ -33,6 +40,14 @@ void MenuRenderer_StartTransition(MenuType from, MenuType to, uint32_t currentTi
  */
 void MenuRenderer_Render(const UIState* state, uint32_t currentTime);
 
+/**
+ * @brief Redraw the whole screen on the next render. Frames otherwise redraw
+ *        only what changed in the UI state (a row, the battery icon, the
+ *        progress bar); call this when something else on screen changed,
+ *        such as the rows of a list after a library refresh
+ */
+void MenuRenderer_Invalidate(void);
+
 /**
  * @brief Check if any animations are currently active
  * @return true if animations are in progress, false otherwise
@@ -1,7 +1,7 @@
 #include "ui_state.h"
 #include "menu_items.h"
 
-#include "nuno/music_catalog.h"
+#include "nuno/music_library.h"
 
 #include <string.h>
 #include <stdio.h>
@@ -14,11 +14,12 @@ typedef struct {
 
 static void populateMenu(UIState *state, MenuType type);
 static void pushMenu(UIState *state, MenuType type);
+static void keepSelectionVisible(Menu *menu);
 
 /* Append one entry to a menu being built, respecting MAX_MENU_ITEMS. */
 static void addMenuItem(UIState *state, const char *text,
                         bool selectable, MenuType submenu) {
-    uint8_t i = state->currentMenu.itemCount;
+    uint32_t i = state->currentMenu.itemCount;
     if (i >= MAX_MENU_ITEMS) {
         return;
     }
@@ -26,7 +27,41 @@ static void addMenuItem(UIState *state, const char *text,
     state->currentMenu.items[i].text[MAX_ITEM_LENGTH - 1] = '\0';
     state->currentMenu.items[i].selectable = selectable;
     state->currentMenu.items[i].submenu = submenu;
-    state->currentMenu.itemCount = (uint8_t)(i + 1);
+    state->currentMenu.itemCount = i + 1U;
+}
+
+/* Songs list row: the title of the track at that row of the title index. */
+static bool songRow(size_t row, MenuItem *item) {
+    MusicLibraryTrack track;
+    size_t index = MusicLibrary_SongAt(row);
+    if (index == SIZE_MAX || !MusicLibrary_GetTrack(index, &track)) {
+        return false;
+    }
+    strncpy(item->text, track.title[0] ? track.title : "Unknown", MAX_ITEM_LENGTH - 1);
+    item->text[MAX_ITEM_LENGTH - 1] = '\0';
+    item->selectable = true;
+    item->submenu = MENU_NOW_PLAYING;
+    return true;
+}
+
+bool getMenuItem(const Menu *menu, uint32_t row, MenuItem *item) {
+    if (!menu || !item || row >= menu->itemCount) {
+        return false;
+    }
+    if (menu->rowSource) {
+        return menu->rowSource(row, item);
+    }
+    if (row >= MAX_MENU_ITEMS) {
+        return false;
+    }
+    *item = menu->items[row];
+    return true;
+}
+
+/* Whole rows that fit below the title bar; at least one. */
+uint32_t getVisibleMenuRows(void) {
+    int rows = (DISPLAY_HEIGHT - TITLE_BAR_HEIGHT) / ITEM_HEIGHT;
+    return (rows > 0) ? (uint32_t)rows : 1U;
 }
 
 void UIState_SetPlaybackHandler(UIState *state,
@@ -49,11 +84,11 @@ void initUIState(UIState *state) {
     state->batteryLevel = 85;
     state->volume = 50;
     state->totalTrackTime = 300;
-    if (g_music_library_track_count > 0U) {
-        const MusicLibraryTrack *initialTrack = &g_music_library_tracks[0];
-        strncpy(state->currentTrackTitle, initialTrack->title, MAX_TITLE_LENGTH - 1);
-        strncpy(state->currentArtist, initialTrack->artist, MAX_TITLE_LENGTH - 1);
-        strncpy(state->currentAlbum, initialTrack->album, MAX_TITLE_LENGTH - 1);
+    MusicLibraryTrack initialTrack;
+    if (MusicLibrary_GetTrack(0U, &initialTrack)) {
+        strncpy(state->currentTrackTitle, initialTrack.title, MAX_TITLE_LENGTH - 1);
+        strncpy(state->currentArtist, initialTrack.artist, MAX_TITLE_LENGTH - 1);
+        strncpy(state->currentAlbum, initialTrack.album, MAX_TITLE_LENGTH - 1);
     } else {
         strncpy(state->currentTrackTitle, "Now Playing", MAX_TITLE_LENGTH - 1);
         strncpy(state->currentArtist, "Artist", MAX_TITLE_LENGTH - 1);
@@ -67,15 +102,20 @@ void initUIState(UIState *state) {
 }
 
 void selectMenuItem(UIState *state) {
-    printf("selectMenuItem called, menuType=%d, selectedIndex=%d\n",
-           state->currentMenuType, state->currentMenu.selectedIndex);
-
     if (!state || state->currentMenu.itemCount == 0) {
         printf("Early return: invalid state or empty menu\n");
         return;
     }
 
-    MenuItem *item = &state->currentMenu.items[state->currentMenu.selectedIndex];
+    printf("selectMenuItem called, menuType=%d, selectedIndex=%u\n",
+           state->currentMenuType, (unsigned)state->currentMenu.selectedIndex);
+
+    MenuItem selected;
+    const MenuItem *item = &selected;
+    if (!getMenuItem(&state->currentMenu, state->currentMenu.selectedIndex, &selected)) {
+        printf("Item not available\n");
+        return;
+    }
     if (!item->selectable) {
         printf("Item not selectable\n");
         return;
@@ -84,23 +124,26 @@ void selectMenuItem(UIState *state) {
     bool playback_started = false;
 
     if (state->currentMenuType == MENU_SONGS) {
-        printf("In MENU_SONGS, selectedIndex=%d, track_count=%zu\n",
-               state->currentMenu.selectedIndex, g_music_library_track_count);
+        printf("In MENU_SONGS, selectedIndex=%u, track_count=%zu\n",
+               (unsigned)state->currentMenu.selectedIndex, MusicLibrary_GetTrackCount());
 
-        size_t selectedIndex = state->currentMenu.selectedIndex;
-        if (selectedIndex < g_music_library_track_count) {
-            const MusicLibraryTrack *track = &g_music_library_tracks[selectedIndex];
-            printf("Selected track: %s by %s\n", track->title, track->artist);
+        // Rows are in title order; play the track the row shows
+        size_t selectedIndex = MusicLibrary_SongAt(state->currentMenu.selectedIndex);
+        MusicLibraryTrack track;
+        if (MusicLibrary_GetTrack(selectedIndex, &track)) {
+            printf("Selected track: %s by %s\n", track.title, track.artist);
 
-            strncpy(state->currentTrackTitle, track->title, MAX_TITLE_LENGTH - 1);
+            strncpy(state->currentTrackTitle, track.title, MAX_TITLE_LENGTH - 1);
             state->currentTrackTitle[MAX_TITLE_LENGTH - 1] = '\0';
-            strncpy(state->currentArtist, track->artist, MAX_TITLE_LENGTH - 1);
+            strncpy(state->currentArtist, track.artist, MAX_TITLE_LENGTH - 1);
             state->currentArtist[MAX_TITLE_LENGTH - 1] = '\0';
-            strncpy(state->currentAlbum, track->album, MAX_TITLE_LENGTH - 1);
+            strncpy(state->currentAlbum, track.album, MAX_TITLE_LENGTH - 1);
             state->currentAlbum[MAX_TITLE_LENGTH - 1] = '\0';
         }
 
-        if (state->playTrackHandler) {
+        if (selectedIndex == SIZE_MAX) {
+            printf("Row no longer in the library\n");
+        } else if (state->playTrackHandler) {
             printf("Calling playTrackHandler with index %zu\n", selectedIndex);
             playback_started = state->playTrackHandler(state->playTrackContext, selectedIndex);
             printf("Playback started: %s\n", playback_started ? "YES" : "NO");
@@ -121,33 +164,57 @@ void selectMenuItem(UIState *state) {
 }
 
 void scrollUp(UIState *state) {
-    if (!state || state->currentMenu.itemCount == 0) {
+    scrollBy(state, -1);
+}
+
+void scrollDown(UIState *state) {
+    scrollBy(state, 1);
+}
+
+void scrollBy(UIState *state, int32_t rows) {
+    if (!state || state->currentMenu.itemCount == 0 || rows == 0) {
         return;
     }
 
-    if (state->currentMenu.selectedIndex > 0) {
-        state->currentMenu.selectedIndex--;
+    Menu *menu = &state->currentMenu;
+    uint32_t last = menu->itemCount - 1U;
+    if (rows < 0) {
+        uint32_t up = (uint32_t)(-(int64_t)rows);
+        menu->selectedIndex = (menu->selectedIndex > up) ? menu->selectedIndex - up : 0U;
+    } else {
+        uint32_t down = (uint32_t)rows;
+        menu->selectedIndex = (last - menu->selectedIndex > down) ? menu->selectedIndex + down : last;
     }
 
-    if (state->currentMenu.selectedIndex < state->currentMenu.scrollOffset) {
-        state->currentMenu.scrollOffset = state->currentMenu.selectedIndex;
-    }
+    keepSelectionVisible(menu);
 }
 
-void scrollDown(UIState *state) {
-    if (!state || state->currentMenu.itemCount == 0) {
-        return;
+/* Scrolls just far enough to put the selection on screen. */
+static void keepSelectionVisible(Menu *menu) {
+    uint32_t visibleSlots = getVisibleMenuRows();
+    if (menu->selectedIndex < menu->scrollOffset) {
+        menu->scrollOffset = menu->selectedIndex;
+    } else if (menu->selectedIndex > menu->scrollOffset + visibleSlots - 1U) {
+        menu->scrollOffset = menu->selectedIndex - visibleSlots + 1U;
     }
+}
 
-    if (state->currentMenu.selectedIndex + 1 < state->currentMenu.itemCount) {
-        state->currentMenu.selectedIndex++;
+void refreshSongsMenu(UIState *state) {
+    if (!state || state->currentMenuType != MENU_SONGS) {
+        return;
     }
 
-    uint8_t visibleSlots = (DISPLAY_HEIGHT - TITLE_BAR_HEIGHT) / ITEM_HEIGHT;
-    uint8_t bottomVisible = state->currentMenu.scrollOffset + (visibleSlots ? visibleSlots : 1) - 1;
-    if (state->currentMenu.selectedIndex > bottomVisible) {
-        state->currentMenu.scrollOffset = state->currentMenu.selectedIndex - (DISPLAY_HEIGHT / ITEM_HEIGHT) + 1;
-    }
+    // Rebuild from the new song count, keeping the place where it still exists
+    Menu *menu = &state->currentMenu;
+    uint32_t selected = menu->selectedIndex;
+    uint32_t scroll = menu->scrollOffset;
+    populateMenu(state, MENU_SONGS);
+    uint32_t last = menu->itemCount - 1U;
+    uint32_t visibleSlots = getVisibleMenuRows();
+    uint32_t lastScroll = (menu->itemCount > visibleSlots) ? menu->itemCount - visibleSlots : 0U;
+    menu->selectedIndex = (selected < last) ? selected : last;
+    menu->scrollOffset = (scroll < lastScroll) ? scroll : lastScroll;
+    keepSelectionVisible(menu);
 }
 
 void goBack(UIState *state) {
@@ -188,6 +255,7 @@ static void populateMenu(UIState *state, MenuType type) {
     state->currentMenu.selectedIndex = 0;
     state->currentMenu.scrollOffset = 0;
     state->currentMenu.itemCount = 0;
+    state->currentMenu.rowSource = NULL;
 
     const char *title = "Menu";
 
@@ -228,7 +296,7 @@ static void populateMenu(UIState *state, MenuType type) {
                 strncpy(state->currentMenu.items[i].text, MUSIC_MENU_ITEMS[i], MAX_ITEM_LENGTH - 1);
                 state->currentMenu.items[i].text[MAX_ITEM_LENGTH - 1] = '\0';
                 bool isSongs = (i == 3U);
-                state->currentMenu.items[i].selectable = isSongs && (g_music_library_track_count > 0U);
+                state->currentMenu.items[i].selectable = isSongs && (MusicLibrary_GetSongCount() > 0U);
                 state->currentMenu.items[i].submenu = isSongs ? MENU_SONGS : MENU_MUSIC;
             }
             break;
@@ -302,7 +370,7 @@ static void populateMenu(UIState *state, MenuType type) {
             break;
         case MENU_SONGS:
             title = "Songs";
-            if (g_music_library_track_count == 0U) {
+            if (MusicLibrary_GetSongCount() == 0U) {
                 state->currentMenu.itemCount = 1U;
                 strncpy(state->currentMenu.items[0].text,
                         "No tracks found",
@@ -313,20 +381,10 @@ static void populateMenu(UIState *state, MenuType type) {
                 break;
             }
 
-            size_t trackCount = g_music_library_track_count;
-            if (trackCount > MAX_MENU_ITEMS) {
-                trackCount = MAX_MENU_ITEMS;
-            }
-
-            state->currentMenu.itemCount = (uint8_t)trackCount;
-            for (uint8_t i = 0; i < state->currentMenu.itemCount; ++i) {
-                const MusicLibraryTrack *track = &g_music_library_tracks[i];
-                const char *titleText = (track && track->title) ? track->title : "Unknown";
-                strncpy(state->currentMenu.items[i].text, titleText, MAX_ITEM_LENGTH - 1);
-                state->currentMenu.items[i].text[MAX_ITEM_LENGTH - 1] = '\0';
-                state->currentMenu.items[i].selectable = true;
-                state->currentMenu.items[i].submenu = MENU_NOW_PLAYING;
-            }
+            // Windowed: the renderer fetches the rows it shows from the index
+            size_t songCount = MusicLibrary_GetSongCount();
+            state->currentMenu.itemCount = (songCount < UINT32_MAX) ? (uint32_t)songCount : UINT32_MAX;
+            state->currentMenu.rowSource = songRow;
             break;
     }
 
@@ -43,12 +43,22 @@ typedef struct MenuItem {
     MenuType submenu;  // Which menu to load if selected
 } MenuItem;
 
+/* Fills 'item' with row 'row' of a list too long to hold in items[] (the
+ * Songs list); false when there is no such row. */
+typedef bool (*MenuRowSource)(size_t row, MenuItem *item);
+
+/*
+ * A list of itemCount rows. Short menus keep their rows in items[]; long ones
+ * set rowSource and are windowed: only the rows on screen are fetched, so a
+ * list costs the same to show and scroll at any length.
+ */
 typedef struct Menu {
     char title[MAX_TITLE_LENGTH];
     MenuItem items[MAX_MENU_ITEMS];
-    uint8_t itemCount;
-    uint8_t selectedIndex;
-    uint8_t scrollOffset;  // For scrolling when more items than can fit on screen
+    MenuRowSource rowSource;  // NULL: the rows are items[]
+    uint32_t itemCount;
+    uint32_t selectedIndex;
+    uint32_t scrollOffset;  // For scrolling when more items than can fit on screen
 } Menu;
 
 typedef bool (*PlayTrackHandler)(void *context, size_t track_index);
@@ -75,11 +85,16 @@ void initUIState(UIState* state);
 void selectMenuItem(UIState* state);
 void scrollUp(UIState* state);
 void scrollDown(UIState* state);
+void scrollBy(UIState* state, int32_t rows);  // clamped to the list
 void goBack(UIState* state);
 void navigateToMenu(UIState* state, MenuType menuType);
 void UIState_SetPlaybackHandler(UIState *state,
                                 PlayTrackHandler handler,
                                 void *context);
 void refreshNowPlayingView(UIState* state);
+// Re-reads the Songs list after a library refresh; a no-op in other menus
+void refreshSongsMenu(UIState* state);
+bool getMenuItem(const Menu* menu, uint32_t row, MenuItem* item);
+uint32_t getVisibleMenuRows(void);
 
 #endif /* UI_STATE_H */
@@ -6,6 +6,7 @@
 #include "nuno/music_library.h"
 #include "nuno/audio_buffer.h"
 #include "nuno/dma.h"
+#include "nuno/format_decoder.h"
 
 #include <string.h>
 
@@ -35,6 +36,17 @@ static struct {
     uint8_t tail;
 } eventQueue = {0};
 
+/* Timestamps of the latest ticks in one direction, newest at 'next' - 1. */
+#define UI_WHEEL_HISTORY 16U
+
+static struct {
+    uint32_t ticks[UI_WHEEL_HISTORY];
+    uint8_t next;
+    uint8_t count;
+    int8_t direction;
+    uint32_t lastStep;  // rows the previous tick moved
+} wheelHistory = {0};
+
 static void enqueueEvent(UIEvent event) {
     uint8_t nextHead = (uint8_t)((eventQueue.head + 1) % UI_EVENT_QUEUE_CAPACITY);
     if (nextHead == eventQueue.tail) {
@@ -62,7 +74,7 @@ static bool applyButtonEvent(UIState *state, uint8_t button) {
     switch (button) {
         case BUTTON_CENTER: {
             MenuType previousMenu = state->currentMenuType;
-            uint8_t previousIndex = state->currentMenu.selectedIndex;
+            uint32_t previousIndex = state->currentMenu.selectedIndex;
             selectMenuItem(state);
             changed = (state->currentMenuType != previousMenu) ||
                       (state->currentMenu.selectedIndex != previousIndex);
@@ -94,9 +106,9 @@ static bool applyButtonEvent(UIState *state, uint8_t button) {
         case BUTTON_NEXT: {
             bool skipped = AudioPipeline_Skip();
             if (skipped) {
-                const MusicLibraryTrack *track = MusicLibrary_GetCurrentTrack();
-                if (track) {
-                    updateTrackInfo(state, track->title, track->artist, track->album);
+                MusicLibraryTrack track;
+                if (MusicLibrary_GetCurrentTrack(&track)) {
+                    updateTrackInfo(state, track.title, track.artist, track.album);
                 }
                 state->isPlaying = (AudioPipeline_GetState() == PIPELINE_STATE_PLAYING);
             }
@@ -109,9 +121,9 @@ static bool applyButtonEvent(UIState *state, uint8_t button) {
         case BUTTON_PREV: {
             bool went_prev = AudioPipeline_Previous();
             if (went_prev) {
-                const MusicLibraryTrack *track = MusicLibrary_GetCurrentTrack();
-                if (track) {
-                    updateTrackInfo(state, track->title, track->artist, track->album);
+                MusicLibraryTrack track;
+                if (MusicLibrary_GetCurrentTrack(&track)) {
+                    updateTrackInfo(state, track.title, track.artist, track.album);
                 }
                 state->isPlaying = (AudioPipeline_GetState() == PIPELINE_STATE_PLAYING);
             }
@@ -127,6 +139,55 @@ static bool applyButtonEvent(UIState *state, uint8_t button) {
     return changed;
 }
 
+/* Records a tick and returns the wheel's speed in ticks per second, counting
+ * only ticks in the current direction within UI_WHEEL_WINDOW_MS. */
+static uint32_t wheelSpeed(int8_t direction, uint32_t timestamp) {
+    if ((direction > 0) != (wheelHistory.direction > 0)) {
+        wheelHistory.count = 0U;  // reversing starts again from single rows
+        wheelHistory.direction = direction;
+    }
+    if (wheelHistory.count > 0U) {
+        uint8_t newest = (uint8_t)((wheelHistory.next + UI_WHEEL_HISTORY - 1U) % UI_WHEEL_HISTORY);
+        if (timestamp - wheelHistory.ticks[newest] >= UI_WHEEL_WINDOW_MS) {
+            wheelHistory.count = 0U;  // and so does a pause
+        }
+    }
+    if (wheelHistory.count == 0U) {
+        wheelHistory.lastStep = 0U;
+    }
+    wheelHistory.ticks[wheelHistory.next] = timestamp;
+    wheelHistory.next = (uint8_t)((wheelHistory.next + 1U) % UI_WHEEL_HISTORY);
+    if (wheelHistory.count < UI_WHEEL_HISTORY) {
+        wheelHistory.count++;
+    }
+
+    uint32_t recent = 0U;
+    for (uint8_t i = 0; i < wheelHistory.count; ++i) {
+        uint8_t slot = (uint8_t)((wheelHistory.next + UI_WHEEL_HISTORY - 1U - i) % UI_WHEEL_HISTORY);
+        if (timestamp - wheelHistory.ticks[slot] >= UI_WHEEL_WINDOW_MS) {
+            break;
+        }
+        recent++;
+    }
+    return recent * 1000U / UI_WHEEL_WINDOW_MS;
+}
+
+/* Rows one tick moves at 'speed' ticks per second in a list of 'rows'. */
+static uint32_t wheelStep(uint32_t speed, uint32_t rows) {
+    uint32_t maxStep = rows / UI_WHEEL_FULL_LIST_TICKS;
+    if (speed >= UI_WHEEL_ACCEL_FULL_TPS) {
+        return (maxStep > 1U) ? maxStep : 1U;
+    }
+    if (speed <= UI_WHEEL_ACCEL_START_TPS) {
+        return 1U;
+    }
+    // Each window tick below full speed divides the step by four
+    uint32_t ticksShort = (UI_WHEEL_ACCEL_FULL_TPS - speed) * UI_WHEEL_WINDOW_MS / 1000U;
+    uint32_t shift = 2U * ticksShort;
+    uint32_t step = (shift < 32U) ? (maxStep >> shift) : 0U;
+    return (step > 1U) ? step : 1U;
+}
+
 static bool applyRotationEvent(UIState *state, int8_t direction, uint32_t timestamp) {
     if (!state || direction == 0) {
         return false;
@@ -147,14 +208,17 @@ static bool applyRotationEvent(UIState *state, int8_t direction, uint32_t timest
         return true;
     }
 
-    uint8_t previousIndex = state->currentMenu.selectedIndex;
-    uint8_t previousOffset = state->currentMenu.scrollOffset;
+    uint32_t previousIndex = state->currentMenu.selectedIndex;
+    uint32_t previousOffset = state->currentMenu.scrollOffset;
 
-    if (direction > 0) {
-        scrollDown(state);
-    } else {
-        scrollUp(state);
+    uint32_t step = wheelStep(wheelSpeed(direction, timestamp), state->currentMenu.itemCount);
+    // Ramp up at most twofold per tick, so speeding up never lurches past
+    // the row being aimed for
+    if (step > 2U * wheelHistory.lastStep) {
+        step = (wheelHistory.lastStep > 0U) ? 2U * wheelHistory.lastStep : 1U;
     }
+    wheelHistory.lastStep = step;
+    scrollBy(state, (direction > 0) ? (int32_t)step : -(int32_t)step);
 
     bool changed = (state->currentMenu.selectedIndex != previousIndex) ||
                    (state->currentMenu.scrollOffset != previousOffset);
@@ -162,6 +226,9 @@ static bool applyRotationEvent(UIState *state, int8_t direction, uint32_t timest
     if (changed) {
         float targetOffset = (float)(state->currentMenu.scrollOffset * ITEM_HEIGHT);
         MenuRenderer_StartScroll(targetOffset, timestamp);
+        if (step > 1U) {
+            MenuRenderer_ShowIndexOverlay(timestamp);
+        }
     }
 
     return changed;
@@ -177,9 +244,9 @@ bool processUIEvents(UIState* state, uint32_t currentTime) {
     // Gapless playback advances the library on the audio thread; reflect the
     // new track in the UI when the pipeline signals a transition.
     if (AudioPipeline_ConsumeTrackChanged()) {
-        const MusicLibraryTrack *track = MusicLibrary_GetCurrentTrack();
-        if (track) {
-            updateTrackInfo(state, track->title, track->artist, track->album);
+        MusicLibraryTrack track;
+        if (MusicLibrary_GetCurrentTrack(&track)) {
+            updateTrackInfo(state, track.title, track.artist, track.album);
         }
         changed = true;
     }
@@ -223,6 +290,55 @@ void updatePlaybackInfo(UIState* state,
     }
 }
 
+/* Milliseconds of the current track played out, timed at the output clock (a
+ * resampled track's native rate would drift); false when no rate is known. */
+static bool playbackPositionMs(uint64_t* positionMs) {
+    AudioBufferStats stats = {0};
+    AudioBuffer_GetBufferStats(&stats);
+    uint32_t sampleRate = 0U;
+    AudioBuffer_GetSampleRateConfig(NULL, &sampleRate, NULL, NULL);
+    FormatDecoder* decoder = AudioBuffer_GetDecoder();
+    if (sampleRate == 0U && decoder) {
+        sampleRate = format_decoder_get_sample_rate(decoder);
+    }
+    if (sampleRate == 0U) {
+        return false;
+    }
+    *positionMs = (uint64_t)stats.track_frames_played * 1000U / sampleRate;
+    return true;
+}
+
+bool syncPlaybackInfo(UIState* state) {
+    if (!state) {
+        return false;
+    }
+
+    bool isPlaying = (AudioPipeline_GetState() == PIPELINE_STATE_PLAYING);
+    uint64_t positionMs = 0U;
+    uint16_t seconds = playbackPositionMs(&positionMs) ? (uint16_t)(positionMs / 1000U) : 0U;
+    bool changed = (state->currentTrackTime != seconds) || (state->isPlaying != isPlaying);
+
+    // Total time 0 keeps the value the track info set
+    updatePlaybackInfo(state, seconds, 0, isPlaying);
+    return changed;
+}
+
+uint32_t getUIWaitMs(const UIState* state) {
+    if (MenuRenderer_IsAnimating()) {
+        return UI_FRAME_MS;
+    }
+    if (state && state->currentMenuType == MENU_NOW_PLAYING &&
+        AudioPipeline_GetState() == PIPELINE_STATE_PLAYING) {
+        // Wake as the shown time ticks over
+        uint64_t positionMs = 0U;
+        if (!playbackPositionMs(&positionMs)) {
+            return 1000U;
+        }
+        return 1000U - (uint32_t)(positionMs % 1000U);
+    }
+    return UI_WAIT_FOREVER;
+}
+
 void updateTrackInfo(UIState* state,
                      const char* trackTitle,
                      const char* artistName,
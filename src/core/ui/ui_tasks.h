@@ -25,6 +25,27 @@ void updatePlaybackInfo(UIState* state,
                        uint16_t totalTime, 
                        bool isPlaying);
 
+/**
+ * @brief Bring the playback time and play state up to date with the audio pipeline
+ * @param state Pointer to UI state
+ * @return true if the shown time or play state changed
+ */
+bool syncPlaybackInfo(UIState* state);
+
+/**
+ * @brief How long the UI loop may block waiting for input or a track change
+ *        before it has a frame of its own to draw: UI_FRAME_MS while the
+ *        renderer animates, the time to the next second of playback while
+ *        Now Playing shows it, UI_WAIT_FOREVER otherwise
+ * @param state Pointer to UI state
+ * @return Milliseconds to wait
+ */
+uint32_t getUIWaitMs(const UIState* state);
+
+// Frame interval while animating, and the wait when nothing is due
+#define UI_FRAME_MS      16U
+#define UI_WAIT_FOREVER  UINT32_MAX
+
 /**
  * @brief Update track information in UI state
  * @param state Pointer to UI state
@@ -66,4 +87,20 @@ void handleButtonPress(UIState* state, uint8_t button, uint32_t currentTime);
 #define BUTTON_PREV      0x08
 #define BUTTON_NEXT      0x10
 
+/*
+ * Click wheel acceleration. The wheel's speed is the number of same-direction
+ * ticks in the last UI_WHEEL_WINDOW_MS, per second. Up to
+ * UI_WHEEL_ACCEL_START_TPS a tick moves one row; each tick more per window
+ * above that quadruples the step, until at UI_WHEEL_ACCEL_FULL_TPS a tick
+ * moves 1/UI_WHEEL_FULL_LIST_TICKS of the list. The step at most doubles
+ * from one tick to the next, and a reversal or a pause of a window starts
+ * again from one row. Any row of any list is then a bounded spin away
+ * (nuno-sim --scroll-bench checks it), and slowing down gives back
+ * single-row steps.
+ */
+#define UI_WHEEL_WINDOW_MS        250U
+#define UI_WHEEL_ACCEL_START_TPS  8U
+#define UI_WHEEL_ACCEL_FULL_TPS   40U
+#define UI_WHEEL_FULL_LIST_TICKS  200U
+
 #endif // UI_TASKS_H
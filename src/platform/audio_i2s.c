@@ -4,6 +4,7 @@
 #include "nuno/board_config.h"
 #include "nuno/platform.h"
 
+#include <stdio.h>
 #include <string.h>
 
 /*
@@ -17,25 +18,48 @@
 static I2S_HandleTypeDef g_i2s_handle;
 static bool g_i2s_ready = false;
 
+/* Returns 0 for a rate the I2S PLL has no setting for. Callers must not fall
+ * back to another clock: audio would silently play at the wrong speed. Tracks
+ * at other rates are resampled in the buffer producer instead. */
 static uint32_t map_audio_freq(uint32_t sample_rate) {
     switch (sample_rate) {
+        case 8000u:
+            return I2S_AUDIOFREQ_8K;
+        case 11025u:
+            return I2S_AUDIOFREQ_11K;
+        case 16000u:
+            return I2S_AUDIOFREQ_16K;
+        case 22050u:
+            return I2S_AUDIOFREQ_22K;
+        case 32000u:
+            return I2S_AUDIOFREQ_32K;
         case 44100u:
             return I2S_AUDIOFREQ_44K;
         case 48000u:
             return I2S_AUDIOFREQ_48K;
+        case 96000u:
+            return I2S_AUDIOFREQ_96K;
+        case 192000u:
+            return I2S_AUDIOFREQ_192K;
         default:
-            return I2S_AUDIOFREQ_44K;
+            return 0u;
     }
 }
 
 bool AudioI2S_Init(uint32_t sample_rate, uint8_t bit_depth) {
+    uint32_t audio_freq = map_audio_freq(sample_rate);
+    if (audio_freq == 0u) {
+        printf("I2S: unsupported sample rate %lu Hz\n", (unsigned long)sample_rate);
+        return false;
+    }
+
     memset(&g_i2s_handle, 0, sizeof(g_i2s_handle));
     g_i2s_handle.Instance = NUNO_I2S_INSTANCE;
     g_i2s_handle.Init.Mode = I2S_MODE_MASTER_TX;
     g_i2s_handle.Init.Standard = I2S_STANDARD_PHILIPS;
     g_i2s_handle.Init.DataFormat = (bit_depth >= 24U) ? I2S_DATAFORMAT_24B : I2S_DATAFORMAT_16B;
     g_i2s_handle.Init.MCLKOutput = I2S_MCLKOUTPUT_ENABLE;
-    g_i2s_handle.Init.AudioFreq = map_audio_freq(sample_rate);
+    g_i2s_handle.Init.AudioFreq = audio_freq;
     g_i2s_handle.Init.CPOL = I2S_CPOL_LOW;
     g_i2s_handle.Init.ClockSource = I2S_CLOCK_PLL;
     g_i2s_handle.Init.FullDuplexMode = I2S_FULLDUPLEXMODE_DISABLE;
@@ -1,5 +1,6 @@
 #include "nuno/audio_task.h"
 #include "nuno/audio_buffer.h"
+#include "nuno/read_ahead.h"
 
 #include "FreeRTOS.h"
 #include "task.h"
@@ -14,9 +15,13 @@
 
 #define AUDIO_PRODUCER_STACK_SIZE (configMINIMAL_STACK_SIZE * 4)
 #define AUDIO_PRODUCER_PRIORITY   (tskIDLE_PRIORITY + 3)  /* above the audio kick + UI */
+#define READ_AHEAD_STACK_SIZE     (configMINIMAL_STACK_SIZE * 2)
+#define READ_AHEAD_PRIORITY       (tskIDLE_PRIORITY + 2)  /* below the producer it feeds */
 
 static TaskHandle_t s_task = NULL;
 static SemaphoreHandle_t s_sem = NULL;
+static TaskHandle_t s_io_task = NULL;
+static SemaphoreHandle_t s_io_sem = NULL;
 
 /*
  * Registered as the AudioBuffer producer wake. Runs in the DMA transfer-complete
@@ -44,6 +49,50 @@ static void audio_producer_task(void *parameters) {
     }
 }
 
+/*
+ * Read-ahead wake, called from the producer task when a decoder's window has
+ * drained to half or it sought out of it. Binary semaphore: repeated wakes
+ * before the I/O task runs collapse into one service pass.
+ */
+static void read_ahead_wake(void) {
+    if (s_io_sem) {
+        xSemaphoreGive(s_io_sem);
+    }
+}
+
+/* A decoder that ran dry sleeps a tick, letting the lower-priority I/O task
+ * land its burst. */
+static void read_ahead_wait(void) {
+    vTaskDelay(1);
+}
+
+static void read_ahead_task(void *parameters) {
+    (void)parameters;
+    for (;;) {
+        /* Storage stays idle until a window needs refilling; then every
+         * window is topped up in large reads before blocking again. */
+        if (xSemaphoreTake(s_io_sem, portMAX_DELAY) == pdTRUE) {
+            ReadAhead_Service();
+        }
+    }
+}
+
+/* Without the task, decoders refill their windows inline (see read_ahead.h),
+ * so a failure here costs latency, not playback. */
+static void read_ahead_start(void) {
+    s_io_sem = xSemaphoreCreateBinary();
+    if (s_io_sem == NULL) {
+        return;
+    }
+    if (xTaskCreate(read_ahead_task, "ReadAhead", READ_AHEAD_STACK_SIZE, NULL,
+                    READ_AHEAD_PRIORITY, &s_io_task) != pdPASS) {
+        vSemaphoreDelete(s_io_sem);
+        s_io_sem = NULL;
+        return;
+    }
+    ReadAhead_SetIoHooks(read_ahead_wake, read_ahead_wait);
+}
+
 bool AudioTask_Start(void) {
     if (s_task != NULL) {
         return true;  /* already started */
@@ -70,5 +119,6 @@ bool AudioTask_Start(void) {
         s_sem = NULL;
         return false;
     }
+    read_ahead_start();
     return true;
 }
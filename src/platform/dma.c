@@ -3,6 +3,7 @@
 #include "nuno/audio_buffer.h"
 #include "nuno/audio_i2s.h"
 #include "nuno/audio_task.h"
+#include "nuno/board_config.h"
 
 #include <stdbool.h>
 
@@ -11,6 +12,11 @@ DMA_HandleTypeDef hdma_i2s_tx;
 volatile bool dma_transfer_complete = false;
 static bool dma_active = false;
 
+#if NUNO_CROSSFADE_REGION_FRAMES > 0
+// Crossfade tail storage, handed to the audio buffer in DMA_Init()
+static int16_t crossfade_region[NUNO_CROSSFADE_REGION_FRAMES * AUDIO_OUT_CHANNELS];
+#endif
+
 // Initialize DMA for audio streaming
 bool DMA_Init(void) {
     if (!AudioI2S_Init(44100U, 16U)) {
@@ -48,10 +54,18 @@ bool DMA_Init(void) {
     HAL_NVIC_SetPriority(DMA1_Stream0_IRQn, 5, 0);
     HAL_NVIC_EnableIRQ(DMA1_Stream0_IRQn);
 
+    /* The stream is circular over one region, so run the buffer in ping-pong
+     * mode: HT and TC each hand one half back to the producer. Set before
+     * AudioBuffer_Init() (main) so the ring is laid out as two halves. */
+    AudioBuffer_SetOutputMode(AUDIO_BUFFER_MODE_PING_PONG);
+#if NUNO_CROSSFADE_REGION_FRAMES > 0
+    AudioBuffer_SetCrossfadeRegion(crossfade_region, sizeof(crossfade_region));
+#endif
+
     /* Start the audio producer task and register its ISR-safe wake. After this,
-     * the transfer-complete ISR's AudioBuffer_Done() only flips the buffer and
-     * wakes the producer (no decode/filesystem in the ISR); the producer task
-     * does the decode via AudioBuffer_Service(). */
+     * the HT/TC ISRs' AudioBuffer_HalfDone()/Done() only release the drained
+     * half and wake the producer (no decode/filesystem in the ISR); the
+     * producer task does the decode via AudioBuffer_Service(). */
     if (!AudioTask_Start()) {
         return false;
     }
@@ -110,21 +124,22 @@ void DMA1_Stream0_IRQHandler(void) {
     HAL_DMA_IRQHandler(&hdma_i2s_tx);
 }
 
-// I2S Transfer Complete Callback (CONSUMER signal: a buffer finished playing).
+// I2S Transfer Complete Callback (CONSUMER signal: second half finished playing).
 void HAL_I2S_TxCpltCallback(I2S_HandleTypeDef *hi2s) {
     if (hi2s && hi2s->Instance == SPI2) {
-        /* AudioBuffer_Done() flips the active buffer and wakes the audio
-         * producer task to refill the freed one. It does NOT decode here - a
-         * producer wake was registered in DMA_Init (AudioTask_Start), so the
-         * decode/filesystem work runs in the task, not this interrupt. */
+        /* AudioBuffer_Done() releases the second half and wakes the audio
+         * producer task to refill it while the DMA wraps to the first. It does
+         * NOT decode here - a producer wake was registered in DMA_Init
+         * (AudioTask_Start), so the decode/filesystem work runs in the task,
+         * not this interrupt. */
         AudioBuffer_Done();
     }
 }
 
-// I2S Half Transfer Complete Callback
+// I2S Half Transfer Complete Callback (CONSUMER signal: first half finished playing).
 void HAL_I2S_TxHalfCpltCallback(I2S_HandleTypeDef *hi2s) {
     if (hi2s && hi2s->Instance == SPI2) {
-        // Notify audio buffer that half of the DMA buffer has been transferred
+        /* Same contract as above for the first half of the ping-pong region. */
         AudioBuffer_HalfDone();
     }
 }
@@ -150,9 +165,10 @@ void DMA_PauseTransfer(void) {
 
 // Start Audio Streaming
 bool DMA_StartAudioStreaming(void) {
-    // Get initial buffer data
-    uint16_t *buffer = AudioBuffer_GetBuffer();
+    // Whole ping-pong region (both halves)
+    size_t samples = 0U;
+    uint16_t *region = AudioBuffer_GetDmaRegion(&samples);
 
     // Start DMA transfer
-    return DMA_StartTransfer(buffer, AUDIO_BUFFER_SIZE);
+    return DMA_StartTransfer(region, samples);
 }
@@ -1,6 +1,7 @@
 #include "nuno/gpio.h"
 #include "nuno/platform.h"
 #include "nuno/audio_buffer.h"
+#include "nuno/audio_pipeline.h"
 #include "nuno/dma.h"
 #include "nuno/trackpad.h"
 #include "FreeRTOS.h"
@@ -10,6 +11,9 @@
 #include "ui_state.h"       // UI state and menu definitions
 #include "menu_renderer.h"  // UI renderer interface
 #include "nuno/input_mapper.h"
+#include "nuno/input.h"
+
+#include <stdio.h>
 
 // Error handler function prototype
 static void Error_Handler(void);
@@ -27,6 +31,11 @@ static void InputTask(void *parameters);
 #define INPUT_TASK_STACK_SIZE     (configMINIMAL_STACK_SIZE * 2)
 #define INPUT_TASK_PRIORITY       (tskIDLE_PRIORITY + 2)
 
+// How often the UI task prints the CPU idle share
+#define UI_IDLE_REPORT_MS         10000U
+
+static TaskHandle_t uiTaskHandle = NULL;
+
 int main(void) {
     // Initialize HAL Library
     if (HAL_Init() != HAL_OK) {
@@ -79,7 +88,6 @@ int main(void) {
     }
 
     // Create the UI task that handles UI events and rendering
-    TaskHandle_t uiTaskHandle;
     xReturned = xTaskCreate(
         UITask,
         "UI_Task",
@@ -126,14 +134,64 @@ static void AudioProcessingTask(void *parameters) {
      * call AudioBuffer_ProcessComplete()/Done() (that would double-advance the
      * buffer the ISR already flips, and re-introduce decode off the producer).
      */
-    if (!DMA_StartTransfer(AudioBuffer_GetBuffer(), AUDIO_BUFFER_SIZE)) {
+    size_t dma_samples = 0U;
+    uint16_t *dma_region = AudioBuffer_GetDmaRegion(&dma_samples);
+    if (!DMA_StartTransfer(dma_region, dma_samples)) {
         Error_Handler();
     }
 
     vTaskSuspend(NULL);  // playback is driven by the ISR + audio producer task
 }
 
-// The UI task integrates UI event processing and renders the UI at a fixed interval.
+// Wakes the UI task: from the input task when events are queued, and from the
+// audio producer after a gapless track change. Never called from an ISR.
+static void UI_Wake(void) {
+    if (uiTaskHandle) {
+        xTaskNotifyGive(uiTaskHandle);
+    }
+}
+
+/*
+ * CPU idle share since the last report, printed every UI_IDLE_REPORT_MS. With
+ * run-time stats configured it is the idle task's share of the run-time
+ * counter; otherwise the UI task's time blocked waiting stands in for it.
+ */
+typedef struct {
+    TickType_t start;
+    TickType_t uiWaited;
+#if (configGENERATE_RUN_TIME_STATS == 1) && (INCLUDE_xTaskGetIdleTaskHandle == 1)
+    uint32_t idleRunTime;
+    uint32_t totalRunTime;
+#endif
+} IdleReport;
+
+static void reportIdleTime(IdleReport *report, TickType_t now) {
+    TickType_t elapsed = now - report->start;
+    if (elapsed < pdMS_TO_TICKS(UI_IDLE_REPORT_MS)) {
+        return;
+    }
+#if (configGENERATE_RUN_TIME_STATS == 1) && (INCLUDE_xTaskGetIdleTaskHandle == 1)
+    uint32_t idleRunTime = (uint32_t)ulTaskGetIdleRunTimeCounter();
+    uint32_t totalRunTime = (uint32_t)portGET_RUN_TIME_COUNTER_VALUE();
+    uint32_t idle = idleRunTime - report->idleRunTime;
+    uint32_t total = totalRunTime - report->totalRunTime;
+    report->idleRunTime = idleRunTime;
+    report->totalRunTime = totalRunTime;
+    printf("CPU idle: %lu%% over the last %lu ms\n",
+           (unsigned long)(total ? (uint64_t)idle * 100U / total : 0U),
+           (unsigned long)(elapsed * (1000 / configTICK_RATE_HZ)));
+#else
+    printf("UI idle: %lu%% over the last %lu ms\n",
+           (unsigned long)((uint64_t)report->uiWaited * 100U / elapsed),
+           (unsigned long)(elapsed * (1000 / configTICK_RATE_HZ)));
+#endif
+    report->start = now;
+    report->uiWaited = 0;
+}
+
+// The UI task sleeps until input, a track change or a frame of its own is due
+// (an animation step, the playback clock ticking over), and renders only when
+// processUIEvents or the renderer says the screen changed.
 static void UITask(void *parameters) {
     (void)parameters; // Prevent unused parameter warning
 
@@ -143,22 +201,47 @@ static void UITask(void *parameters) {
 
     // Optional: Initialize additional UI components (e.g., track info, volume) here.
 
+    AudioPipeline_SetTrackChangeWake(UI_Wake);
+
+    uint32_t waitMs = 0U;
+    bool redraw = true;
+    bool idleBusy = false;
+    IdleReport idleReport = { .start = xTaskGetTickCount() };
+
     for (;;) {
+        TickType_t waitTicks = (waitMs == UI_WAIT_FOREVER) ? portMAX_DELAY : pdMS_TO_TICKS(waitMs);
+        TickType_t waitStart = xTaskGetTickCount();
+        (void)ulTaskNotifyTake(pdTRUE, waitTicks);
+        idleReport.uiWaited += xTaskGetTickCount() - waitStart;
+
         // Get the current time (in milliseconds) from the FreeRTOS tick count
         // Adjust with your tick frequency (if configTICK_RATE_HZ is not 1000)
         uint32_t currentTime = xTaskGetTickCount() * (1000 / configTICK_RATE_HZ);
 
         InputMapper_ProcessEvents(&uiState, currentTime);
 
-        // Process any UI events (from buttons, rotation, etc.)
-        // In a real application, events might come from an ISR or queue.
-        processUIEvents(&uiState, currentTime);
-
-        // Render the UI with the current state and animations
-        MenuRenderer_Render(&uiState, currentTime);
-
-        // Delay to limit the refresh rate. Adjust delay as needed for smooth animations.
-        vTaskDelay(pdMS_TO_TICKS(16)); // ~60 FPS refresh rate
+        // Apply queued input and any track change, then the playback clock
+        redraw |= processUIEvents(&uiState, currentTime);
+        redraw |= syncPlaybackInfo(&uiState);
+        redraw |= MenuRenderer_IsAnimating();
+
+        if (redraw) {
+            MenuRenderer_Render(&uiState, currentTime);
+            redraw = false;
+        }
+
+        // Write back seek indexes and step a library refresh; a refresh keeps
+        // the task awake until it ends, then an open Songs list is re-read
+        bool busy = AudioPipeline_ServiceIdle();
+        if (idleBusy && !busy) {
+            refreshSongsMenu(&uiState);
+            MenuRenderer_Invalidate();
+            redraw = true;
+        }
+        idleBusy = busy;
+        waitMs = (busy || redraw) ? 0U : getUIWaitMs(&uiState);
+
+        reportIdleTime(&idleReport, xTaskGetTickCount());
     }
 }
 
@@ -171,6 +254,9 @@ static void InputTask(void *parameters) {
 
     for (;;) {
         Trackpad_Poll();
+        if (Input_GetPendingCount() > 0U) {
+            UI_Wake();
+        }
         vTaskDelay(pdMS_TO_TICKS(10)); // 100 Hz polling
     }
 }
@@ -9,6 +9,12 @@
 
 static bool g_audio_initialised = false;
 
+/* Crossfade tail storage: the longest fade the UI offers (4 s) at 48 kHz,
+ * S16 stereo. The host has RAM to spare; firmware registers its own, smaller
+ * region (see dma.c). */
+#define SIM_CROSSFADE_REGION_FRAMES (4U * 48000U)
+static int16_t g_crossfade_region[SIM_CROSSFADE_REGION_FRAMES * AUDIO_OUT_CHANNELS];
+
 bool SimAudio_Init(void) {
     printf("SimAudio_Init called\n");
     if (g_audio_initialised) {
@@ -17,6 +23,7 @@ bool SimAudio_Init(void) {
     }
 
     printf("Initializing audio pipeline...\n");
+    AudioBuffer_SetCrossfadeRegion(g_crossfade_region, sizeof(g_crossfade_region));
     if (!AudioPipeline_Init()) {
         printf("AudioPipeline_Init failed\n");
         return false;
@@ -29,6 +36,7 @@ bool SimAudio_Init(void) {
     }
 
     printf("Audio pipeline initialized successfully\n");
+    AudioBuffer_PrintMemoryReport();
     g_audio_initialised = true;
     return true;
 }
@@ -48,7 +56,9 @@ bool SimAudio_PlayTrack(void *context, size_t track_index) {
     }
 
     // Start streaming to the audio device
-    if (!DMA_StartTransfer(AudioBuffer_GetBuffer(), AUDIO_BUFFER_SIZE)) {
+    size_t dma_samples = 0U;
+    uint16_t *dma_region = AudioBuffer_GetDmaRegion(&dma_samples);
+    if (!DMA_StartTransfer(dma_region, dma_samples)) {
         printf("DMA_StartTransfer failed\n");
         return false;
     }
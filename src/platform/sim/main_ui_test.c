@@ -4,16 +4,18 @@
 #include "nuno/display.h"
 #include "nuno/device_profile.h"
 #include "platform/sim/audio_controller.h"
+#include "platform/sim/scroll_bench.h"
 
 #include "nuno/audio_pipeline.h"
 #include "nuno/audio_buffer.h"
-#include "nuno/format_decoder.h"
+#include "nuno/music_library.h"
 
 #include <SDL2/SDL.h>
 
 #include <math.h>
 #include <stdbool.h>
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 typedef struct {
@@ -36,6 +38,17 @@ typedef struct {
     uint32_t downTime;
 } TrackpadInteraction;
 
+/* Where the UI loop's time goes: blocked waiting for an event, or working. */
+typedef struct {
+    Uint64 start;
+    Uint64 waiting;
+    uint32_t wakes;
+    uint32_t frames;
+} LoopStats;
+
+static LoopStats g_loopStats = {0};
+static Uint32 g_trackChangeEvent = (Uint32)-1;
+
 #define TRACKPAD_TAP_MAX_MS 180U
 #define TRACKPAD_TAP_MAX_MOVE 10
 #define TRACKPAD_SCROLL_STEP 12.0f
@@ -156,6 +169,56 @@ static void handleKeyEvent(SDL_Keysym keysym, UIState *state, uint32_t currentTi
     }
 }
 
+/* Prints a library refresh's progress as it goes, and its outcome; 'context'
+ * is the UIState whose Songs list the result re-reads. */
+static void onLibraryRefresh(const LibraryRefreshProgress *progress, void *context) {
+    if (progress->phase == LIBRARY_REFRESH_DONE || progress->phase == LIBRARY_REFRESH_FAILED) {
+        printf("Library refresh %s: %u added, %u updated, %u removed (%u of %u directories "
+               "listed, %u tag reads)\n",
+               progress->phase == LIBRARY_REFRESH_DONE ? "done" : "failed",
+               (unsigned)progress->added, (unsigned)progress->updated,
+               (unsigned)progress->removed, (unsigned)progress->listed,
+               (unsigned)progress->directories_total, (unsigned)progress->probes);
+        // Rows changed under the renderer's feet; its next frame starts over
+        refreshSongsMenu((UIState *)context);
+        MenuRenderer_Invalidate();
+    } else if (progress->phase == LIBRARY_REFRESH_CHECKING && progress->files_total > 0U &&
+               progress->files % 1000U == 0U && progress->files > 0U) {
+        printf("Library refresh: %u of %u files checked\n", (unsigned)progress->files,
+               (unsigned)progress->files_total);
+    }
+}
+
+/* Prints what the renderer has sent the panel, against full-frame pushes. */
+static void printDisplayStats(void) {
+    DisplayStats stats;
+    Display_GetStats(&stats);
+    uint64_t full = (uint64_t)stats.fullFrameBytes * stats.frames;
+    printf("Display: %u frames (%u skipped, %u partial), %.1f bytes per frame against %u for "
+           "a full frame (%.1f%% of full-frame traffic)\n",
+           (unsigned)stats.frames, (unsigned)stats.framesSkipped, (unsigned)stats.framesPartial,
+           stats.frames ? (double)stats.bytesPushed / stats.frames : 0.0,
+           (unsigned)stats.fullFrameBytes,
+           full ? 100.0 * (double)stats.bytesPushed / (double)full : 0.0);
+}
+
+static void printIdleStats(void) {
+    Uint64 elapsed = SDL_GetPerformanceCounter() - g_loopStats.start;
+    double seconds = (double)elapsed / (double)SDL_GetPerformanceFrequency();
+    printf("UI loop: %.1f%% idle over %.1f s, %u wakes, %u frames drawn\n",
+           elapsed ? 100.0 * (double)g_loopStats.waiting / (double)elapsed : 0.0, seconds,
+           (unsigned)g_loopStats.wakes, (unsigned)g_loopStats.frames);
+}
+
+/* Track change wake: runs on the audio producer thread, so it only posts an
+ * event for the UI loop's wait to return with. */
+static void pushTrackChangeEvent(void) {
+    SDL_Event event;
+    memset(&event, 0, sizeof(event));
+    event.type = g_trackChangeEvent;
+    (void)SDL_PushEvent(&event);
+}
+
 static float pointAngle(int x, int y) {
     const WheelLayout *w = wheel();
     float dx = (float)x - (float)w->centerX;
@@ -418,12 +481,25 @@ static void switchDevice(size_t index, WheelInteraction *wheelState, TrackpadInt
 int main(int argc, char **argv) {
     const DeviceProfile *startProfile = DeviceProfiles_Default();
     const char *shotPath = NULL;
+    uint32_t scrollBenchRows = 0U;
 
     for (int i = 1; i < argc; ++i) {
         if (strcmp(argv[i], "--list") == 0) {
             printDeviceList();
             return 0;
         }
+        if (strcmp(argv[i], "--ping-pong") == 0) {
+            // Model the firmware's half-transfer DMA output instead of the block ring.
+            AudioBuffer_SetOutputMode(AUDIO_BUFFER_MODE_PING_PONG);
+            continue;
+        }
+        if (strcmp(argv[i], "--scroll-bench") == 0) {
+            scrollBenchRows = 100000U;
+            if (i + 1 < argc && argv[i + 1][0] != '-') {
+                scrollBenchRows = (uint32_t)strtoul(argv[++i], NULL, 10);
+            }
+            continue;
+        }
         if (strcmp(argv[i], "--shot") == 0 && i + 1 < argc) {
             shotPath = argv[++i];
             continue;
@@ -476,6 +552,15 @@ int main(int argc, char **argv) {
         return ok ? 0 : 1;
     }
 
+    // Scripted wheel input through a long synthetic list, then exit.
+    if (scrollBenchRows > 0U) {
+        bool ok = SimScrollBench_Run(scrollBenchRows);
+        printDisplayStats();
+        Display_Shutdown();
+        SDL_Quit();
+        return ok ? 0 : 1;
+    }
+
     bool audio_ready = SimAudio_Init();
     printf("Audio initialization: %s\n", audio_ready ? "SUCCESS" : "FAILED");
 
@@ -497,10 +582,30 @@ int main(int argc, char **argv) {
     bool trackpad_mode = false;
     size_t deviceIndex = indexOfProfile(startProfile);
 
+    // Gapless track changes come from the audio producer as an SDL event
+    g_trackChangeEvent = SDL_RegisterEvents(1);
+    if (g_trackChangeEvent != (Uint32)-1) {
+        AudioPipeline_SetTrackChangeWake(pushTrackChangeEvent);
+    }
+
+    // Sleep until input, a track change or the next frame that is due (an
+    // animation step, the playback clock ticking over), and draw only then.
+    uint32_t waitMs = 0U;
+    bool redraw = true;
+    bool idleBusy = false;
+    g_loopStats.start = SDL_GetPerformanceCounter();
+
     while (running) {
+        Uint64 waitStart = SDL_GetPerformanceCounter();
+        int pending = (waitMs == UI_WAIT_FOREVER) ? SDL_WaitEvent(&event)
+                                                  : SDL_WaitEventTimeout(&event, (int)waitMs);
+        g_loopStats.waiting += SDL_GetPerformanceCounter() - waitStart;
+        g_loopStats.wakes++;
         uint32_t currentTime = SDL_GetTicks();
 
-        while (SDL_PollEvent(&event)) {
+        for (; pending; pending = SDL_PollEvent(&event)) {
+            // Anything from the window may have changed what it shows
+            redraw = true;
             switch (event.type) {
                 case SDL_QUIT:
                     running = false;
@@ -519,6 +624,14 @@ int main(int argc, char **argv) {
                         } else if (sym == SDLK_LEFTBRACKET) {
                             deviceIndex = (deviceIndex + DeviceProfiles_Count() - 1) % DeviceProfiles_Count();
                             switchDevice(deviceIndex, &wheelState, &trackpad);
+                        } else if (sym == SDLK_r) {
+                            // Stepped from AudioPipeline_ServiceIdle() below
+                            if (!MusicLibrary_StartRefresh(onLibraryRefresh, &uiState)) {
+                                printf("Library refresh unavailable\n");
+                            }
+                        } else if (sym == SDLK_d) {
+                            printDisplayStats();
+                            printIdleStats();
                         } else {
                             handleKeyEvent(event.key.keysym, &uiState, currentTime);
                         }
@@ -557,29 +670,29 @@ int main(int argc, char **argv) {
             }
         }
 
-        processUIEvents(&uiState, currentTime);
-
-        // Update playback time/progress once per frame
-        {
-            bool isPlaying = (AudioPipeline_GetState() == PIPELINE_STATE_PLAYING);
-            AudioBufferStats stats = {0};
-            AudioBuffer_GetBufferStats(&stats);
-            FormatDecoder *dec = AudioBuffer_GetDecoder();
-            uint32_t sr = dec ? format_decoder_get_sample_rate(dec) : 0U;
-            uint16_t seconds = 0;
-            if (sr > 0U) {
-                seconds = (uint16_t)(stats.total_samples / sr);
-            }
-            // Pass totalTime as 0 to keep existing value in UI
-            updatePlaybackInfo(&uiState, seconds, 0, isPlaying);
+        redraw |= processUIEvents(&uiState, currentTime);
+        redraw |= syncPlaybackInfo(&uiState);
+        redraw |= MenuRenderer_IsAnimating();
+
+        if (redraw) {
+            Display_RenderBackground();
+            MenuRenderer_Render(&uiState, currentTime);
+            Display_RenderClickWheel(wheelState.leftDown ? wheelState.activeButton : 0);
+            Display_Present();
+            g_loopStats.frames++;
+            redraw = false;
         }
-        Display_RenderBackground();
-        MenuRenderer_Render(&uiState, currentTime);
-        Display_RenderClickWheel(wheelState.leftDown ? wheelState.activeButton : 0);
-        Display_Present();
-        SDL_Delay(16);
+
+        // A library refresh steps on every pass until it ends, then shows
+        bool busy = AudioPipeline_ServiceIdle();
+        redraw = idleBusy && !busy;
+        idleBusy = busy;
+        waitMs = (busy || redraw) ? 0U : getUIWaitMs(&uiState);
     }
 
+    AudioPipeline_SetTrackChangeWake(NULL);
+    printDisplayStats();
+    printIdleStats();
     Display_Shutdown();
     SimAudio_Shutdown();
     SDL_Quit();
@@ -1,6 +1,8 @@
 #include "nuno/platform.h"
 #include "nuno/dma.h"
 #include "nuno/audio_buffer.h"
+#include "nuno/read_ahead.h"
+#include "platform/sim/sim_block_device.h"
 #include <SDL2/SDL.h>
 #include <string.h>
 #include <stdio.h>
@@ -67,6 +69,71 @@ static void stop_producer(void) {
     }
 }
 
+/*
+ * Read-ahead I/O thread. The decoders on the producer thread read their input
+ * from RAM windows; this thread refills them in bursts (ReadAhead_Service())
+ * when a window drains to half or a seek leaves it, while a starved decoder
+ * naps a millisecond at a time. Same shape as the firmware's read-ahead task.
+ * Storage is the fake SD card in sim_block_device.c, which reports what the
+ * burst policy would cost a real card when the thread stops.
+ */
+static SDL_Thread *g_io_thread = NULL;
+static SDL_sem *g_io_sem = NULL;
+static volatile bool g_io_running = false;
+
+static void io_wake(void) {
+    if (g_io_sem) {
+        SDL_SemPost(g_io_sem);
+    }
+}
+
+static void io_wait(void) {
+    SDL_Delay(1);
+}
+
+static uint64_t io_now_us(void) {
+    return (uint64_t)SDL_GetTicks() * 1000U;
+}
+
+static int io_thread_main(void* arg) {
+    (void)arg;
+    while (g_io_running) {
+        SDL_SemWait(g_io_sem);
+        if (!g_io_running) {
+            break;
+        }
+        ReadAhead_Service();
+    }
+    return 0;
+}
+
+static void start_io_thread(void) {
+    if (g_io_thread) {
+        return;
+    }
+    SimBlockDevice_Attach(NULL, io_now_us);
+    g_io_sem = SDL_CreateSemaphore(0);
+    g_io_running = true;
+    g_io_thread = SDL_CreateThread(io_thread_main, "nuno-read-ahead", NULL);
+    ReadAhead_SetIoHooks(io_wake, io_wait);
+}
+
+static void stop_io_thread(void) {
+    if (!g_io_thread) {
+        return;
+    }
+    ReadAhead_SetIoHooks(NULL, NULL);  // decoders service inline from here
+    g_io_running = false;
+    SDL_SemPost(g_io_sem);
+    SDL_WaitThread(g_io_thread, NULL);
+    g_io_thread = NULL;
+    if (g_io_sem) {
+        SDL_DestroySemaphore(g_io_sem);
+        g_io_sem = NULL;
+    }
+    SimBlockDevice_PrintReport();
+}
+
 static bool open_audio_device(uint32_t sample_rate) {
     SDL_AudioSpec want, have;
 
@@ -82,7 +149,11 @@ static bool open_audio_device(uint32_t sample_rate) {
     want.freq = (int)sample_rate;
     want.format = AUDIO_S16SYS;
     want.channels = 2;
-    want.samples = 2048;
+    /* In ping-pong mode ask for a quarter of the DMA region per callback so
+     * the HT/TC events arrive at roughly the cadence the hardware sees. */
+    want.samples = (AudioBuffer_GetOutputMode() == AUDIO_BUFFER_MODE_PING_PONG)
+                       ? (Uint16)(AUDIO_BUFFER_FRAMES / 4U)
+                       : 2048;
     want.callback = audio_callback;
     want.userdata = NULL;
 
@@ -101,6 +172,40 @@ static bool open_audio_device(uint32_t sample_rate) {
     return true;
 }
 
+/*
+ * Ping-pong mode: model the hardware's circular DMA. The callback walks the
+ * whole region continuously (it never substitutes silence, exactly like the
+ * DMA) and raises the half-transfer / transfer-complete events as the read
+ * position crosses the middle and the end, so the HT/TC path can be exercised
+ * on the host.
+ */
+static void audio_callback_ping_pong(int16_t* out, int samples_needed) {
+    size_t region_samples = 0;
+    const uint16_t* region = AudioBuffer_GetDmaRegion(&region_samples);
+    size_t half_samples = region_samples / 2U;
+    int written = 0;
+
+    while (written < samples_needed) {
+        size_t boundary = (g_buffer_offset_samples < half_samples) ? half_samples
+                                                                   : region_samples;
+        int to_copy = samples_needed - written;
+        if ((size_t)to_copy > boundary - g_buffer_offset_samples) {
+            to_copy = (int)(boundary - g_buffer_offset_samples);
+        }
+
+        memcpy(&out[written], &region[g_buffer_offset_samples], (size_t)to_copy * sizeof(int16_t));
+        written += to_copy;
+        g_buffer_offset_samples += (size_t)to_copy;
+
+        if (g_buffer_offset_samples == half_samples) {
+            AudioBuffer_HalfDone();  // HT: first half drained
+        } else if (g_buffer_offset_samples >= region_samples) {
+            (void)AudioBuffer_Done();  // TC: second half drained, wrap
+            g_buffer_offset_samples = 0;
+        }
+    }
+}
+
 static void audio_callback(void* userdata, Uint8* stream, int len) {
     (void)userdata;
 
@@ -108,6 +213,13 @@ static void audio_callback(void* userdata, Uint8* stream, int len) {
     int samples_needed = len / (int)sizeof(int16_t);
     int written = 0;
 
+    if (AudioBuffer_GetOutputMode() == AUDIO_BUFFER_MODE_PING_PONG) {
+        audio_callback_ping_pong(out, samples_needed);
+        return;
+    }
+
+    const size_t block_samples = AudioBuffer_GetBlockSamples();
+
     while (written < samples_needed) {
         uint16_t* cur = AudioBuffer_GetBuffer();
         if (!cur) {
@@ -116,8 +228,8 @@ static void audio_callback(void* userdata, Uint8* stream, int len) {
             break;
         }
 
-        size_t available_in_buffer = (AUDIO_BUFFER_SIZE > g_buffer_offset_samples)
-            ? (AUDIO_BUFFER_SIZE - g_buffer_offset_samples)
+        size_t available_in_buffer = (block_samples > g_buffer_offset_samples)
+            ? (block_samples - g_buffer_offset_samples)
             : 0;
 
         if (available_in_buffer == 0) {
@@ -140,7 +252,7 @@ static void audio_callback(void* userdata, Uint8* stream, int len) {
         written += to_copy;
         g_buffer_offset_samples += (size_t)to_copy;
 
-        if (g_buffer_offset_samples >= AUDIO_BUFFER_SIZE) {
+        if (g_buffer_offset_samples >= block_samples) {
             if (!AudioBuffer_Done()) {
                 // End of stream after consuming this buffer; fill remaining with silence
                 if (written < samples_needed) {
@@ -175,6 +287,7 @@ bool DMA_Init(void) {
         return false;
     }
     start_producer();
+    start_io_thread();
     return true;
 }
 
@@ -249,4 +362,5 @@ void platform_audio_cleanup(void) {
         g_audio_initialised = false;
     }
     stop_producer();
+    stop_io_thread();
 }
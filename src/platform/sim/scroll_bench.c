@@ -0,0 +1,98 @@
+#include "platform/sim/scroll_bench.h"
+
+#include "menu_renderer.h"
+#include "ui_state.h"
+#include "ui_tasks.h"
+
+#include <stdio.h>
+
+/* Tick spacing of the scripted user, fastest first. */
+static const uint32_t k_tick_ms[] = { 25U, 50U, 75U, 100U, 150U };
+#define BENCH_SPEEDS (sizeof(k_tick_ms) / sizeof(k_tick_ms[0]))
+
+static uint32_t g_rows;
+static uint64_t g_fetches;
+
+/* Synthetic titles in alphabetical order, so the index overlay moves through
+ * the letters as a real Songs list would. */
+static bool benchRow(size_t row, MenuItem *item) {
+    if (row >= g_rows) {
+        return false;
+    }
+    g_fetches++;
+    snprintf(item->text, MAX_ITEM_LENGTH, "%c Song %06u",
+             (char)('A' + (uint32_t)((uint64_t)row * 26U / g_rows)), (unsigned)row);
+    item->selectable = true;
+    item->submenu = MENU_NOW_PLAYING;
+    return true;
+}
+
+/* Spins from the current row to 'target' and returns the simulated ms taken.
+ * Like a user watching the list, it speeds up while each tick covers little
+ * of the way left and slows down once a tick would cover half of it. */
+static uint32_t spinTo(UIState *state, uint32_t target, uint32_t *clock, uint32_t *ticks) {
+    uint32_t start = *clock;
+    size_t speed = BENCH_SPEEDS - 1U;
+    uint32_t lastStep = 1U;
+    *ticks = 0U;
+    while (state->currentMenu.selectedIndex != target &&
+           *clock - start <= SIM_SCROLL_BENCH_LIMIT_MS) {
+        uint32_t selected = state->currentMenu.selectedIndex;
+        uint32_t distance = (target > selected) ? target - selected : selected - target;
+        if (lastStep * 2U > distance && speed + 1U < BENCH_SPEEDS) {
+            speed++;
+        } else if (lastStep * 8U < distance && speed > 0U) {
+            speed--;
+        }
+        *clock += k_tick_ms[speed];
+        handleRotation(state, (target > selected) ? 1 : -1, *clock);
+        processUIEvents(state, *clock);
+        MenuRenderer_Render(state, *clock);
+        uint32_t now = state->currentMenu.selectedIndex;
+        lastStep = (now > selected) ? now - selected : selected - now;
+        (*ticks)++;
+    }
+    return *clock - start;
+}
+
+bool SimScrollBench_Run(uint32_t rows) {
+    if (rows == 0U) {
+        return false;
+    }
+
+    UIState state;
+    initUIState(&state);
+    navigateToMenu(&state, MENU_SONGS);
+    g_rows = rows;
+    g_fetches = 0U;
+    state.currentMenu.itemCount = rows;
+    state.currentMenu.rowSource = benchRow;
+    state.currentMenu.selectedIndex = 0U;
+    state.currentMenu.scrollOffset = 0U;
+
+    const uint32_t targets[] = {
+        rows - 1U, rows / 2U, 0U, rows * 2U / 5U, (rows / 3U + 17U) % rows, 17U % rows,
+        rows - 1U, rows / 7U,
+    };
+    uint32_t clock = 0U;
+    uint32_t worst = 0U;
+    uint32_t frames = 0U;
+    bool ok = true;
+    printf("Scroll bench: %u rows, limit %u ms per target\n", (unsigned)rows,
+           (unsigned)SIM_SCROLL_BENCH_LIMIT_MS);
+    for (size_t i = 0; i < sizeof(targets) / sizeof(targets[0]); ++i) {
+        uint32_t from = state.currentMenu.selectedIndex;
+        uint32_t ticks = 0U;
+        uint32_t elapsed = spinTo(&state, targets[i], &clock, &ticks);
+        bool reached = (state.currentMenu.selectedIndex == targets[i]);
+        printf("  %7u -> %7u: %6u ms, %4u ticks%s\n", (unsigned)from, (unsigned)targets[i],
+               (unsigned)elapsed, (unsigned)ticks, reached ? "" : " (NOT REACHED)");
+        ok = ok && reached;
+        worst = (elapsed > worst) ? elapsed : worst;
+        frames += ticks;
+    }
+    printf("Scroll bench: worst %u ms, %.1f rows fetched per frame over %u frames: %s\n",
+           (unsigned)worst, frames ? (double)g_fetches / frames : 0.0, (unsigned)frames,
+           ok ? "PASS" : "FAIL");
+    return ok;
+}
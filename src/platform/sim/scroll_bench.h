@@ -0,0 +1,20 @@
+#ifndef NUNO_SIM_SCROLL_BENCH_H
+#define NUNO_SIM_SCROLL_BENCH_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/* Longest a scripted spin to any row may take, in simulated milliseconds. */
+#define SIM_SCROLL_BENCH_LIMIT_MS 10000U
+
+/*
+ * Scripted click-wheel benchmark (nuno-sim --scroll-bench [rows]): spins the
+ * wheel through a synthetic list of 'rows' rows to a series of targets the way
+ * a user would, fast while far off and slowing to single ticks near the row,
+ * feeding each tick through handleRotation() and rendering a frame after it.
+ * Prints the simulated time and ticks each target took and the rows fetched
+ * per frame; false when a target took longer than SIM_SCROLL_BENCH_LIMIT_MS.
+ */
+bool SimScrollBench_Run(uint32_t rows);
+
+#endif /* NUNO_SIM_SCROLL_BENCH_H */
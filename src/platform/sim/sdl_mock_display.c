@@ -328,10 +328,44 @@ static void crDrawChassisTextEmboss(CRCanvas *cv, const char *text,
 /* Screen drawing primitives (UI core target)                        */
 /* ------------------------------------------------------------------ */
 
+/*
+ * The UI draws into g_screenTex, which stands in for the panel's own memory: it
+ * keeps whatever was drawn last, so a partial update leaves the rest of the
+ * screen as it was. Display_Update/UpdateRects count what a real panel would be
+ * sent and blit the texture into the bezel, which the simulator loop repaints
+ * every frame. Without render-target support the UI draws straight onto the
+ * canvas, and only full frames look right.
+ */
+static SDL_Texture *g_screenTex = NULL;
+static DisplayStats g_stats = {0};
+
+static void releaseScreenTexture(void) {
+    if (g_screenTex) {
+        SDL_DestroyTexture(g_screenTex);
+        g_screenTex = NULL;
+    }
+}
+
+static void createScreenTexture(void) {
+    const DeviceProfile *p = Display_GetActiveProfile();
+    if (!SDL_RenderTargetSupported(renderer)) {
+        return;
+    }
+    g_screenTex = SDL_CreateTexture(renderer, SDL_PIXELFORMAT_ARGB8888, SDL_TEXTUREACCESS_TARGET,
+                                    p->screen.width, p->screen.height);
+    if (g_screenTex) {
+        SDL_SetTextureBlendMode(g_screenTex, SDL_BLENDMODE_NONE);
+    }
+}
+
 static void beginDisplayDraw(void) {
     if (!renderer) return;
     SDL_Rect rect = screenRect();
-    SDL_RenderSetViewport(renderer, &rect);
+    if (g_screenTex) {
+        SDL_SetRenderTarget(renderer, g_screenTex);
+    } else {
+        SDL_RenderSetViewport(renderer, &rect);
+    }
     SDL_Rect clip = { 0, 0, rect.w, rect.h };
     SDL_RenderSetClipRect(renderer, &clip);
 }
@@ -339,7 +373,45 @@ static void beginDisplayDraw(void) {
 static void endDisplayDraw(void) {
     if (!renderer) return;
     SDL_RenderSetClipRect(renderer, NULL);
-    SDL_RenderSetViewport(renderer, NULL);
+    if (g_screenTex) {
+        SDL_SetRenderTarget(renderer, NULL);
+    } else {
+        SDL_RenderSetViewport(renderer, NULL);
+    }
+}
+
+/* Bytes the panel is sent for a region at the profile's colour depth; rows
+ * are whole bytes wide, as a controller's RAM window is. */
+static uint32_t panelBytes(int width, int height) {
+    int bits = 16;
+    switch (Display_GetActiveProfile()->screen.colorModel) {
+        case DISPLAY_COLOR_MONO_1BIT: bits = 1; break;
+        case DISPLAY_COLOR_GRAY_2BIT: bits = 2; break;
+        case DISPLAY_COLOR_RGB:       bits = 16; break;
+    }
+    if (width <= 0 || height <= 0) {
+        return 0;
+    }
+    return (uint32_t)height * (uint32_t)((width * bits + 7) / 8);
+}
+
+/* Puts the panel's contents on the canvas, inside the bezel. */
+static void compositeScreen(void) {
+    if (!renderer || !g_screenTex) return;
+    SDL_Rect dst = screenRect();
+    SDL_RenderCopy(renderer, g_screenTex, NULL, &dst);
+}
+
+static void countFrame(uint32_t bytes, bool partial) {
+    g_stats.frames++;
+    if (bytes == 0) {
+        g_stats.framesSkipped++;
+    } else if (partial) {
+        g_stats.framesPartial++;
+    }
+    g_stats.bytesPushed += bytes;
+    g_stats.lastFrameBytes = bytes;
+    g_stats.fullFrameBytes = panelBytes(Display_GetWidth(), Display_GetHeight());
 }
 
 void Display_Clear(void) {
@@ -353,7 +425,24 @@ void Display_Clear(void) {
 }
 
 void Display_Update(void) {
-    // Compositing handled by the simulator entry point.
+    countFrame(panelBytes(Display_GetWidth(), Display_GetHeight()), false);
+    compositeScreen();
+}
+
+void Display_UpdateRects(const DisplayRect *rects, size_t count) {
+    uint32_t bytes = 0;
+    for (size_t i = 0; rects && i < count; ++i) {
+        bytes += panelBytes(rects[i].width, rects[i].height);
+    }
+    countFrame(bytes, true);
+    // The bezel was repainted over the screen this frame, so put it all back
+    compositeScreen();
+}
+
+void Display_GetStats(DisplayStats *stats) {
+    if (stats) {
+        *stats = g_stats;
+    }
 }
 
 void Display_DrawText(const char *text, int x, int y, uint8_t color) {
@@ -755,7 +844,8 @@ static bool createWindow(const char *title) {
         return false;
     }
 
-    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC);
+    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED | SDL_RENDERER_PRESENTVSYNC |
+                                              SDL_RENDERER_TARGETTEXTURE);
     if (!renderer) {
         fprintf(stderr, "SDL_CreateRenderer Error: %s\n", SDL_GetError());
         SDL_DestroyWindow(window);
@@ -766,6 +856,7 @@ static bool createWindow(const char *title) {
     SDL_RenderSetLogicalSize(renderer, p->chassis.canvasWidth, p->chassis.canvasHeight);
     SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "nearest");
     SDL_SetRenderDrawBlendMode(renderer, SDL_BLENDMODE_BLEND);
+    createScreenTexture();
     return true;
 }
 
@@ -777,6 +868,7 @@ bool Display_Init(const char *title, const DeviceProfile *profile) {
         }
     }
     g_profile = profile ? profile : DeviceProfiles_Default();
+    memset(&g_stats, 0, sizeof(g_stats));
     if (!title) {
         title = "NUNO Player";
     }
@@ -800,9 +892,11 @@ bool Display_SwitchProfile(const DeviceProfile *profile) {
     char title[128];
     snprintf(title, sizeof(title), "NUNO Simulator — %s", profile->displayName);
 
-    /* The faceplate + chassis textures belong to the renderer being torn down. */
+    /* The faceplate, chassis and screen textures belong to the renderer being
+     * torn down. */
     releaseFaceplate();
     releaseChassisLayers();
+    releaseScreenTexture();
     if (renderer) {
         SDL_DestroyRenderer(renderer);
         renderer = NULL;
@@ -818,6 +912,7 @@ bool Display_SwitchProfile(const DeviceProfile *profile) {
 void Display_Shutdown(void) {
     releaseFaceplate();
     releaseChassisLayers();
+    releaseScreenTexture();
     if (renderer) {
         SDL_DestroyRenderer(renderer);
         renderer = NULL;
@@ -0,0 +1,96 @@
+#include "platform/sim/sim_block_device.h"
+
+#include "nuno/read_ahead.h"
+
+#include <stdatomic.h>
+#include <stdio.h>
+
+const SimBlockDeviceModel k_sim_sd_card = {
+    .wake_us = 1000U,
+    .command_us = 300U,
+    .kib_per_s = 12000U,
+    .active_mw = 200U,
+    .sleep_uw = 500U,
+};
+
+static SimBlockDeviceModel s_model;
+static uint64_t (*s_now_us)(void);
+static uint64_t s_attached_us;
+
+// Written by the I/O thread, read by whoever reports
+static atomic_uint s_wakeups;
+static atomic_uint s_reads;
+static _Atomic uint64_t s_bytes;
+static _Atomic uint64_t s_active_us;
+
+static void device_power_up(void) {
+    atomic_fetch_add(&s_wakeups, 1U);
+    atomic_fetch_add(&s_active_us, s_model.wake_us);
+}
+
+static void device_on_read(size_t bytes) {
+    uint64_t transfer_us = (uint64_t)bytes * 1000000U / ((uint64_t)s_model.kib_per_s * 1024U);
+    atomic_fetch_add(&s_reads, 1U);
+    atomic_fetch_add(&s_bytes, bytes);
+    atomic_fetch_add(&s_active_us, s_model.command_us + transfer_us);
+}
+
+static uint32_t device_now_ms(void) {
+    return (uint32_t)(s_now_us() / 1000U);
+}
+
+void SimBlockDevice_Attach(const SimBlockDeviceModel *model, uint64_t (*now_us)(void)) {
+    s_model = model ? *model : k_sim_sd_card;
+    s_now_us = now_us;
+    s_attached_us = now_us ? now_us() : 0U;
+    atomic_store(&s_wakeups, 0U);
+    atomic_store(&s_reads, 0U);
+    atomic_store(&s_bytes, 0U);
+    atomic_store(&s_active_us, 0U);
+
+    // Sleeping between bursts is implied: idle is whatever was not charged
+    ReadAheadStorageHooks hooks = {
+        .power_up = device_power_up,
+        .power_down = NULL,
+        .on_read = device_on_read,
+        .now_ms = now_us ? device_now_ms : NULL,
+    };
+    ReadAhead_SetStorageHooks(&hooks);
+    ReadAhead_ResetStats();
+}
+
+void SimBlockDevice_GetStats(SimBlockDeviceStats *stats) {
+    if (!stats) {
+        return;
+    }
+    stats->wakeups = atomic_load(&s_wakeups);
+    stats->reads = atomic_load(&s_reads);
+    stats->bytes = atomic_load(&s_bytes);
+    stats->active_us = atomic_load(&s_active_us);
+
+    uint64_t elapsed = s_now_us ? s_now_us() - s_attached_us : 0U;
+    stats->idle_us = (elapsed > stats->active_us) ? elapsed - stats->active_us : 0U;
+    uint64_t total = stats->active_us + stats->idle_us;
+    stats->average_uw = (total > 0U)
+        ? (uint32_t)((stats->active_us * s_model.active_mw * 1000U +
+                      stats->idle_us * s_model.sleep_uw) / total)
+        : 0U;
+}
+
+void SimBlockDevice_PrintReport(void) {
+    SimBlockDeviceStats device;
+    ReadAheadStats read_ahead;
+    SimBlockDevice_GetStats(&device);
+    ReadAhead_GetStats(&read_ahead);
+
+    uint64_t total = device.active_us + device.idle_us;
+    printf("Storage: %u bursts, %u KiB/burst, %u ms idle between bursts, %u stalls\n",
+           read_ahead.bursts,
+           read_ahead.bursts ? read_ahead.kib_read / read_ahead.bursts : 0U,
+           (read_ahead.bursts > 1U) ? read_ahead.idle_ms / (read_ahead.bursts - 1U) : 0U,
+           read_ahead.stalls);
+    printf("Storage model: %u wakeups, %u reads, active %.2f%% of %.1f s, average %.2f mW\n",
+           device.wakeups, device.reads,
+           total ? 100.0 * (double)device.active_us / (double)total : 0.0,
+           (double)total / 1e6, (double)device.average_uw / 1000.0);
+}
@@ -0,0 +1,50 @@
+#ifndef NUNO_SIM_BLOCK_DEVICE_H
+#define NUNO_SIM_BLOCK_DEVICE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/*
+ * Fake SD card for tuning the read-ahead burst policy on the host.
+ *
+ * It stores nothing (reads still come from the host file system); it sits on
+ * the read-ahead storage hooks and charges every burst what a card would
+ * take: a wake from sleep, a command overhead per read and the transfer at
+ * the card's sustained rate. Whatever clock time is not charged counts as
+ * idle, at sleep current. The clock is the caller's, so a benchmark can run
+ * it on simulated playback time rather than wall time.
+ */
+
+typedef struct {
+    uint32_t wake_us;      // sleep -> ready for the first command
+    uint32_t command_us;   // per read command
+    uint32_t kib_per_s;    // sustained read rate
+    uint32_t active_mw;    // draw while awake
+    uint32_t sleep_uw;     // draw while asleep
+} SimBlockDeviceModel;
+
+typedef struct {
+    uint32_t wakeups;
+    uint32_t reads;
+    uint64_t bytes;
+    uint64_t active_us;    // modelled: wakes + commands + transfers
+    uint64_t idle_us;      // the rest of the clock time since attach
+    uint32_t average_uw;   // mean draw over active + idle
+} SimBlockDeviceStats;
+
+/* A microSD card on a 4-bit SDMMC bus at 25 MHz, clock gated when idle. */
+extern const SimBlockDeviceModel k_sim_sd_card;
+
+/*
+ * Installs the model as the read-ahead storage hooks and zeroes the
+ * counters. Call before the I/O thread starts. 'model' NULL means
+ * k_sim_sd_card; 'now_us' is the clock (monotonic microseconds).
+ */
+void SimBlockDevice_Attach(const SimBlockDeviceModel *model, uint64_t (*now_us)(void));
+
+void SimBlockDevice_GetStats(SimBlockDeviceStats *stats);
+
+/* Prints the device figures next to the read-ahead duty-cycle statistics. */
+void SimBlockDevice_PrintReport(void);
+
+#endif /* NUNO_SIM_BLOCK_DEVICE_H */
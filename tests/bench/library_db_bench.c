@@ -0,0 +1,163 @@
+#define _POSIX_C_SOURCE 200809L  // mkstemp, clock_gettime
+
+#include "nuno/music_catalog.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/*
+ * Host benchmark for starting from the library database. Builds a synthetic
+ * catalog of 1k, 10k and 100k tracks (10 per album, 10 albums per artist),
+ * sorts its browse index ("index ms") and saves it, then times what a start
+ * does: MusicCatalog_Load() of the file ("load ms") and, including the load,
+ * the first Songs menu ("1st menu": the first MENU_ROWS rows of the title
+ * index copied out as the windowed Songs list fetches them) and opening Artists at a letter ("artists": a load,
+ * a prefix search and a page of names from the stored index). "walk all"
+ * touches every record and title once, for comparison. Times are in ms. The
+ * file was just written, so the figures are for a warm cache;
+ * library_scan_bench shows the cost the database replaces. Pass track counts
+ * on the command line to override the defaults. Build with
+ * -DBUILD_BENCHMARKS=ON.
+ */
+
+#define TRACKS_PER_ALBUM 10U
+#define ALBUMS_PER_ARTIST 10U
+#define MENU_ROWS 10U        // about a screenful of the windowed Songs list
+#define MENU_ITEM_LENGTH 32U // MAX_ITEM_LENGTH
+
+static const size_t k_default_counts[] = { 1000U, 10000U, 100000U };
+
+static char menu_items[MENU_ROWS][MENU_ITEM_LENGTH];
+static volatile size_t sink;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+static bool build_catalog(size_t tracks) {
+    char title[48];
+    char album[32];
+    char artist[32];
+    char filename[160];
+    for (size_t i = 0; i < tracks; i++) {
+        size_t album_index = i / TRACKS_PER_ALBUM;
+        size_t artist_index = album_index / ALBUMS_PER_ARTIST;
+        snprintf(title, sizeof(title), "Track %zu", i);
+        snprintf(album, sizeof(album), "Album %06zu", album_index);
+        snprintf(artist, sizeof(artist), "Artist %05zu", artist_index);
+        snprintf(filename, sizeof(filename),
+                 "Artist_%05zu/Album_%06zu/Artist_%05zu_-_Album_%06zu_-_%02zu_Track_%zu.mp3",
+                 artist_index, album_index, artist_index, album_index,
+                 i % TRACKS_PER_ALBUM + 1U, i);
+        MusicLibraryTrack track = {
+            .title = title, .album = album, .artist = artist, .filename = filename,
+            .track_number = (uint16_t)(i % TRACKS_PER_ALBUM + 1U),
+        };
+        if (!MusicCatalog_AddTrack(&track)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void bench_count(size_t tracks, const char *path) {
+    MusicCatalog_Clear();
+    if (!build_catalog(tracks)) {
+        printf("%10zu (out of memory)\n", tracks);
+        return;
+    }
+    double start = now_ms();
+    bool indexed = MusicCatalog_BuildIndex();
+    double index_ms = now_ms() - start;
+    size_t heap = MusicCatalog_GetMemoryUsage();
+    start = now_ms();
+    bool saved = MusicCatalog_Save(path, "/bench");
+    double save_ms = now_ms() - start;
+    MusicCatalog_Clear();
+    FILE *file = fopen(path, "rb");
+    long file_bytes = -1;
+    if (file && fseek(file, 0, SEEK_END) == 0) {
+        file_bytes = ftell(file);
+    }
+    if (file) {
+        fclose(file);
+    }
+    if (!indexed || !saved) {
+        printf("%10zu (cannot save %s)\n", tracks, path);
+        return;
+    }
+
+    start = now_ms();
+    bool loaded = MusicCatalog_Load(path, "/bench");
+    double load_ms = now_ms() - start;
+    MusicLibraryTrack track;
+    for (size_t row = 0; loaded && row < MENU_ROWS; row++) {
+        if (MusicCatalog_GetTrack(MusicCatalog_SongAt(row), &track)) {
+            strncpy(menu_items[row], track.title, MENU_ITEM_LENGTH - 1U);
+            menu_items[row][MENU_ITEM_LENGTH - 1U] = '\0';
+        }
+    }
+    double menu_ms = now_ms() - start;
+    if (!loaded || MusicCatalog_GetCount() != tracks) {
+        printf("%10zu (load failed)\n", tracks);
+        return;
+    }
+
+    MusicCatalog_Clear();
+    start = now_ms();
+    loaded = MusicCatalog_Load(path, "/bench");
+    size_t first = MusicCatalog_FindArtist("artist 5");
+    for (size_t row = 0; loaded && row < MENU_ROWS; row++) {
+        const char *name = MusicCatalog_GetArtistName((uint32_t)(first + row), NULL, NULL);
+        if (name) {
+            strncpy(menu_items[row], name, MENU_ITEM_LENGTH - 1U);
+            menu_items[row][MENU_ITEM_LENGTH - 1U] = '\0';
+        }
+    }
+    double artists_ms = now_ms() - start;
+
+    start = now_ms();
+    size_t total = 0U;
+    for (size_t i = 0; i < tracks; i++) {
+        if (MusicCatalog_GetTrack(i, &track)) {
+            total += strlen(track.title);
+        }
+    }
+    double walk_ms = now_ms() - start;
+    sink = total + (size_t)menu_items[0][0];
+
+    printf("%10zu %12ld %8.1f %10zu %10.2f %10.2f %10.3f %10.3f %10.3f %10.2f\n", tracks,
+           file_bytes, (double)file_bytes / (double)tracks, heap, index_ms, save_ms, load_ms,
+           menu_ms, artists_ms, walk_ms);
+}
+
+int main(int argc, char **argv) {
+    char path[] = "/tmp/nuno-db-bench-XXXXXX";
+    int fd = mkstemp(path);
+    if (fd < 0) {
+        printf("cannot create a temporary file\n");
+        return 1;
+    }
+    close(fd);
+
+    printf("%10s %12s %8s %10s %10s %10s %10s %10s %10s %10s\n", "tracks", "db bytes",
+           "B/track", "heap B", "index ms", "save ms", "load ms", "1st menu", "artists",
+           "walk all");
+    if (argc > 1) {
+        for (int i = 1; i < argc; i++) {
+            bench_count((size_t)strtoul(argv[i], NULL, 10), path);
+        }
+    } else {
+        for (size_t i = 0; i < sizeof(k_default_counts) / sizeof(k_default_counts[0]); i++) {
+            bench_count(k_default_counts[i], path);
+        }
+    }
+    MusicCatalog_Clear();
+    remove(path);
+    return 0;
+}
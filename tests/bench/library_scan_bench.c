@@ -0,0 +1,132 @@
+#define _POSIX_C_SOURCE 200809L  // mkdtemp, clock_gettime
+
+#include "nuno/library_scanner.h"
+#include "nuno/music_catalog.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+
+/*
+ * Host benchmark for the startup library scan. Builds a synthetic library of
+ * 1k, 10k and 100k tiny MP3 files (10 tracks per album, 10 albums per artist,
+ * "Artist_-_Album_-_NN_Title.mp3" names) in a temporary directory and scans
+ * it with LibraryScanner_Scan() on 1, 2, 4, ... worker threads, up to the
+ * core count (at least 4). Each row gives the scan time, the time per file,
+ * the speedup over one thread, the tasks stolen between workers and the
+ * catalog's heap use per track. The files are freshly written, so the
+ * figures are for a warm cache; storage latency comes on top on a device.
+ * Pass track counts on the command line to override the defaults, and
+ * "-t N" to sweep up to N threads. Build with -DBUILD_BENCHMARKS=ON.
+ */
+
+#define TRACKS_PER_ALBUM 10U
+#define ALBUMS_PER_ARTIST 10U
+
+static const size_t k_default_counts[] = { 1000U, 10000U, 100000U };
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+static bool build_tree(const char *root, size_t tracks) {
+    static const unsigned char frame[] = { 0xFF, 0xFB, 0x94, 0x64, 0, 0, 0, 0 };
+    char path[512];
+    for (size_t i = 0; i < tracks; i++) {
+        size_t album = i / TRACKS_PER_ALBUM;
+        size_t artist = album / ALBUMS_PER_ARTIST;
+        if (i % (TRACKS_PER_ALBUM * ALBUMS_PER_ARTIST) == 0U) {
+            snprintf(path, sizeof(path), "%s/Artist_%05zu", root, artist);
+            if (mkdir(path, 0755) != 0) {
+                return false;
+            }
+        }
+        if (i % TRACKS_PER_ALBUM == 0U) {
+            snprintf(path, sizeof(path), "%s/Artist_%05zu/Album_%06zu", root, artist, album);
+            if (mkdir(path, 0755) != 0) {
+                return false;
+            }
+        }
+        snprintf(path, sizeof(path),
+                 "%s/Artist_%05zu/Album_%06zu/Artist_%05zu_-_Album_%06zu_-_%02zu_Track_%zu.mp3",
+                 root, artist, album, artist, album, i % TRACKS_PER_ALBUM + 1U, i);
+        FILE *file = fopen(path, "wb");
+        if (!file) {
+            return false;
+        }
+        fwrite(frame, 1, sizeof(frame), file);
+        fclose(file);
+    }
+    return true;
+}
+
+static void bench_count(size_t tracks, unsigned max_threads) {
+    char root[] = "/tmp/nuno-scan-bench-XXXXXX";
+    if (!mkdtemp(root)) {
+        printf("%10zu (cannot create a temporary directory)\n", tracks);
+        return;
+    }
+    if (build_tree(root, tracks)) {
+        double serial_ms = 0.0;
+        for (unsigned threads = 1U; threads <= max_threads; threads *= 2U) {
+            LibraryScanStats stats;
+            LibraryScanner_SetThreadCount(threads);
+            double start = now_ms();
+            bool ok = LibraryScanner_Scan(root, &stats);
+            double elapsed = now_ms() - start;
+            size_t bytes = MusicCatalog_GetMemoryUsage();
+            size_t found = MusicCatalog_GetCount();
+            if (threads == 1U) {
+                serial_ms = elapsed;
+            }
+            if (ok && found > 0U) {
+                printf("%10zu %8u %10zu %10.1f %10.2f %8.2f %8u %12zu %10.1f\n", tracks,
+                       (unsigned)stats.threads, found, elapsed,
+                       elapsed * 1e3 / (double)stats.files, serial_ms / elapsed,
+                       (unsigned)stats.steals, bytes, (double)bytes / (double)found);
+            } else {
+                printf("%10zu %8u (scan failed)\n", tracks, threads);
+            }
+            MusicCatalog_Clear();
+        }
+    } else {
+        printf("%10zu (cannot build the library)\n", tracks);
+    }
+
+    char command[64];
+    snprintf(command, sizeof(command), "rm -rf '%s'", root);
+    if (system(command) != 0) {
+        printf("could not remove %s\n", root);
+    }
+}
+
+int main(int argc, char **argv) {
+    LibraryScanner_SetThreadCount(0U);
+    unsigned max_threads = LibraryScanner_GetThreadCount();
+    if (max_threads < 4U) {
+        max_threads = 4U;
+    }
+    int first = 1;
+    if (argc > 2 && strcmp(argv[1], "-t") == 0) {
+        max_threads = (unsigned)strtoul(argv[2], NULL, 10);
+        max_threads = max_threads ? max_threads : 1U;
+        first = 3;
+    }
+
+    printf("%10s %8s %10s %10s %10s %8s %8s %12s %10s\n", "files", "threads", "tracks",
+           "scan ms", "us/file", "speedup", "steals", "catalog B", "B/track");
+    if (argc > first) {
+        for (int i = first; i < argc; i++) {
+            bench_count((size_t)strtoul(argv[i], NULL, 10), max_threads);
+        }
+        return 0;
+    }
+    for (size_t i = 0; i < sizeof(k_default_counts) / sizeof(k_default_counts[0]); i++) {
+        bench_count(k_default_counts[i], max_threads);
+    }
+    return 0;
+}
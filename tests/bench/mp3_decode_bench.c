@@ -0,0 +1,141 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include "nuno/audio_buffer.h"
+#include "nuno/byte_source.h"
+#include "nuno/format_decoder.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Host benchmark for MP3 decode throughput. Decodes each file end to end
+ * through format_decoder_read_s16() (the producer's fast path) and
+ * format_decoder_read() (float), in producer-sized reads, and prints ns per
+ * frame and the multiple of real time. The "mem" rows decode the same file
+ * from a memory ByteSource, which the MP3 backend parses in place, so they
+ * leave file I/O out of the figure. Configure with
+ * -DNUNO_MP3_FLOAT_OUTPUT=ON to compare minimp3's float-output build. Pass
+ * MP3 paths on the command line; without arguments the bundled tracks are
+ * used. Build with -DBUILD_BENCHMARKS=ON.
+ */
+
+#define BENCH_READ_FRAMES AUDIO_BUFFER_FRAMES
+
+#ifdef NUNO_DEFAULT_LIBRARY_PATH
+#define BENCH_TRACK(name) NUNO_DEFAULT_LIBRARY_PATH "/bach/open-goldberg-variations/" name
+static const char *const k_default_files[] = {
+    BENCH_TRACK("Kimiko_Ishizaka_-_Open_Goldberg_Variations_-_02_Variatio_1.mp3"),
+    BENCH_TRACK("Kimiko_Ishizaka_-_Open_Goldberg_Variations_-_03_Variatio_2.mp3"),
+};
+#endif
+
+static int16_t s16_out[BENCH_READ_FRAMES * 2U];
+static float f32_out[BENCH_READ_FRAMES * 2U];
+static volatile float sink;
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+/* Decodes 'path' (or its bytes, when 'data' is set) to the end; returns the
+ * frames produced (0 on failure). */
+static size_t decode_file(const char *path, const uint8_t *data, size_t size, bool s16,
+                          double *elapsed_ns, uint32_t *rate) {
+    FormatDecoder *decoder = format_decoder_create();
+    bool opened = false;
+    if (decoder && data) {
+        ByteSource source;
+        ByteSource_InitMemory(&source, data, size);
+        opened = format_decoder_open_source(decoder, &source);
+    } else if (decoder) {
+        opened = format_decoder_open(decoder, path);
+    }
+    if (!opened || format_decoder_get_channels(decoder) > 2U) {
+        format_decoder_destroy(decoder);
+        return 0U;
+    }
+    *rate = format_decoder_get_sample_rate(decoder);
+
+    size_t frames = 0U;
+    size_t got;
+    double start = now_ns();
+    do {
+        got = s16 ? format_decoder_read_s16(decoder, s16_out, BENCH_READ_FRAMES)
+                  : format_decoder_read(decoder, f32_out, BENCH_READ_FRAMES);
+        frames += got;
+    } while (got > 0U);
+    *elapsed_ns = now_ns() - start;
+    sink = s16 ? (float)s16_out[0] : f32_out[0];
+
+    format_decoder_destroy(decoder);
+    return frames;
+}
+
+static void bench_file(const char *path) {
+    const char *name = strrchr(path, '/');
+    name = name ? name + 1 : path;
+    if (strlen(name) > 28U) {
+        name += strlen(name) - 28U;  // keep the distinguishing tail
+    }
+
+    // Whole file in memory for the "mem" rows.
+    uint8_t *data = NULL;
+    size_t size = 0U;
+    FILE *file = fopen(path, "rb");
+    if (file && fseek(file, 0, SEEK_END) == 0) {
+        long length = ftell(file);
+        if (length > 0 && fseek(file, 0, SEEK_SET) == 0 && (data = malloc((size_t)length)) != NULL) {
+            size = fread(data, 1, (size_t)length, file);
+        }
+    }
+    if (file) {
+        fclose(file);
+    }
+
+    static const char *const modes[] = { "s16", "f32", "s16 mem", "f32 mem" };
+    for (int mode = 0; mode < 4; mode++) {
+        bool s16 = (mode % 2) == 0;
+        bool in_memory = mode >= 2;
+        if (in_memory && !data) {
+            break;
+        }
+        double elapsed = 0.0;
+        uint32_t rate = 0U;
+        size_t frames = decode_file(path, in_memory ? data : NULL, size, s16, &elapsed, &rate);
+        if (frames == 0U || rate == 0U) {
+            printf("%-28.28s (cannot decode)\n", name);
+            break;
+        }
+        double realtime = ((double)frames / (double)rate) / (elapsed / 1e9);
+        printf("%-28.28s %-7s %10zu %10.2f %10.1f\n", name, modes[mode], frames,
+               elapsed / (double)frames, realtime);
+    }
+    free(data);
+}
+
+int main(int argc, char **argv) {
+#ifdef MINIMP3_FLOAT_OUTPUT
+    printf("minimp3 output: float\n");
+#else
+    printf("minimp3 output: int16\n");
+#endif
+    printf("%-28s %-7s %10s %10s %10s\n", "file", "read", "frames", "ns/frame", "x realtime");
+    if (argc > 1) {
+        for (int i = 1; i < argc; i++) {
+            bench_file(argv[i]);
+        }
+        return 0;
+    }
+#ifdef NUNO_DEFAULT_LIBRARY_PATH
+    for (size_t i = 0; i < sizeof(k_default_files) / sizeof(k_default_files[0]); i++) {
+        bench_file(k_default_files[i]);
+    }
+#else
+    printf("usage: %s file.mp3...\n", argv[0]);
+#endif
+    return 0;
+}
@@ -0,0 +1,122 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include "nuno/format_decoder.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Host benchmark for MP3 seek latency. For each file it times:
+ *   cold   - the first exact seek to 90% on a fresh decoder (walks frame
+ *            headers from the start and builds the index on the way)
+ *   warm   - exact seeks to random points once the index covers them
+ *   coarse - SEEK_FAST seeks on a fresh decoder (Xing/VBRI TOC, no walk)
+ * Each seek primes the target frame, so the numbers include one frame decode
+ * (plus the predecode frames for exact seeks). Pass MP3 paths on the command
+ * line (e.g. a CBR encode); without arguments the bundled VBR tracks are used.
+ * Build with -DBUILD_BENCHMARKS=ON.
+ */
+
+#define BENCH_SEEKS 200U
+
+#ifdef NUNO_DEFAULT_LIBRARY_PATH
+#define BENCH_TRACK(name) NUNO_DEFAULT_LIBRARY_PATH "/bach/open-goldberg-variations/" name
+static const char *const k_default_files[] = {
+    BENCH_TRACK("Kimiko_Ishizaka_-_Open_Goldberg_Variations_-_02_Variatio_1.mp3"),
+    BENCH_TRACK("Kimiko_Ishizaka_-_Open_Goldberg_Variations_-_03_Variatio_2.mp3"),
+};
+#endif
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static FormatDecoder *open_file(const char *path, enum SeekingBehavior behavior) {
+    FormatDecoder *decoder = format_decoder_create();
+    if (!decoder || !format_decoder_open(decoder, path)) {
+        format_decoder_destroy(decoder);
+        return NULL;
+    }
+    DecoderConfig config;
+    format_decoder_get_config(decoder, &config);
+    config.seeking_behavior = behavior;
+    format_decoder_configure(decoder, &config);
+    return decoder;
+}
+
+static void print_row(const char *name, const char *mode, unsigned seeks, double total_ns,
+                      double max_ns) {
+    printf("%-28.28s %-7s %6u %10.3f %10.3f\n", name, mode, seeks, total_ns / seeks / 1e6,
+           max_ns / 1e6);
+}
+
+/* Times 'seeks' seeks to pseudo-random points below 'limit'. */
+static void bench_random(FormatDecoder *decoder, const char *name, const char *mode,
+                         size_t limit) {
+    uint32_t seed = 1U;
+    double total = 0.0;
+    double worst = 0.0;
+    for (unsigned i = 0; i < BENCH_SEEKS; i++) {
+        seed = seed * 1664525U + 1013904223U;
+        size_t target = (size_t)(((uint64_t)seed * limit) >> 32);
+        double start = now_ns();
+        format_decoder_seek(decoder, target);
+        double elapsed = now_ns() - start;
+        total += elapsed;
+        if (elapsed > worst) {
+            worst = elapsed;
+        }
+    }
+    print_row(name, mode, BENCH_SEEKS, total, worst);
+}
+
+static void bench_file(const char *path) {
+    const char *name = strrchr(path, '/');
+    name = name ? name + 1 : path;
+    if (strlen(name) > 28U) {
+        name += strlen(name) - 28U;  // keep the distinguishing tail
+    }
+
+    FormatDecoder *decoder = open_file(path, SEEK_ACCURATE);
+    if (!decoder) {
+        printf("%-28.28s (cannot open)\n", name);
+        return;
+    }
+    size_t limit = format_decoder_get_total_frames(decoder) / 10U * 9U;
+
+    double start = now_ns();
+    format_decoder_seek(decoder, limit);
+    double cold = now_ns() - start;
+    print_row(name, "cold", 1U, cold, cold);
+
+    bench_random(decoder, name, "warm", limit);
+    format_decoder_destroy(decoder);
+
+    decoder = open_file(path, SEEK_FAST);
+    if (decoder) {
+        bench_random(decoder, name, "coarse", limit);
+        format_decoder_destroy(decoder);
+    }
+}
+
+int main(int argc, char **argv) {
+    printf("%-28s %-7s %6s %10s %10s\n", "file", "mode", "seeks", "mean ms", "max ms");
+    if (argc > 1) {
+        for (int i = 1; i < argc; i++) {
+            bench_file(argv[i]);
+        }
+        return 0;
+    }
+#ifdef NUNO_DEFAULT_LIBRARY_PATH
+    for (size_t i = 0; i < sizeof(k_default_files) / sizeof(k_default_files[0]); i++) {
+        bench_file(k_default_files[i]);
+    }
+#else
+    printf("usage: %s file.mp3...\n", argv[0]);
+#endif
+    return 0;
+}
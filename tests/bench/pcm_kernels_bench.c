@@ -0,0 +1,81 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include "nuno/audio_buffer.h"
+#include "nuno/pcm_kernels.h"
+
+#include <stdio.h>
+#include <time.h>
+
+/*
+ * Host micro-benchmark for the producer kernels. Runs each kernel of each
+ * variant available on this CPU over one AUDIO_BUFFER_FRAMES block many times
+ * and prints ns per output frame. Build with -DBUILD_BENCHMARKS=ON.
+ */
+
+#define BENCH_FRAMES AUDIO_BUFFER_FRAMES
+#define BENCH_ITERATIONS 20000U
+
+static float input[BENCH_FRAMES * 8U];
+static float stereo[BENCH_FRAMES * AUDIO_OUT_CHANNELS];
+static int16_t output[BENCH_FRAMES * AUDIO_OUT_CHANNELS];
+static volatile int16_t sink;
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static double bench_downmix(const PcmKernels *k, uint32_t channels) {
+    double start = now_ns();
+    for (unsigned it = 0; it < BENCH_ITERATIONS; it++) {
+        k->downmix_to_stereo(input, channels, stereo, BENCH_FRAMES, 0.8f);
+    }
+    double elapsed = now_ns() - start;
+    sink = (int16_t)stereo[0];
+    return elapsed / ((double)BENCH_ITERATIONS * BENCH_FRAMES);
+}
+
+static double bench_f32_to_s16(const PcmKernels *k) {
+    double start = now_ns();
+    for (unsigned it = 0; it < BENCH_ITERATIONS; it++) {
+        k->f32_to_s16(input, output, BENCH_FRAMES * AUDIO_OUT_CHANNELS, 0.8f);
+    }
+    double elapsed = now_ns() - start;
+    sink = output[0];
+    return elapsed / ((double)BENCH_ITERATIONS * BENCH_FRAMES);
+}
+
+static double bench_q15(const PcmKernels *k) {
+    double start = now_ns();
+    for (unsigned it = 0; it < BENCH_ITERATIONS; it++) {
+        k->s16_gain_q15(output, BENCH_FRAMES * AUDIO_OUT_CHANNELS, 32000);
+    }
+    double elapsed = now_ns() - start;
+    sink = output[0];
+    return elapsed / ((double)BENCH_ITERATIONS * BENCH_FRAMES);
+}
+
+int main(void) {
+    for (size_t i = 0; i < sizeof(input) / sizeof(input[0]); i++) {
+        input[i] = (float)((int)(i * 7919U % 2001U) - 1000) / 900.0f;
+    }
+    for (size_t i = 0; i < sizeof(output) / sizeof(output[0]); i++) {
+        output[i] = (int16_t)(i * 31U);
+    }
+
+    printf("%-8s %12s %12s %12s %12s %12s\n", "variant", "mono->st", "stereo",
+           "6ch->st", "f32->s16", "q15 gain");
+    for (int v = 0; v < PCM_KERNELS_VARIANT_COUNT; v++) {
+        const PcmKernels *k = PcmKernels_Get((PcmKernelsVariant)v);
+        if (!k) {
+            continue;
+        }
+        printf("%-8s %12.3f %12.3f %12.3f %12.3f %12.3f\n", k->name,
+               bench_downmix(k, 1U), bench_downmix(k, 2U), bench_downmix(k, 6U),
+               bench_f32_to_s16(k), bench_q15(k));
+    }
+    printf("(ns per output frame, %u frames x %u iterations)\n",
+           (unsigned)BENCH_FRAMES, BENCH_ITERATIONS);
+    return 0;
+}
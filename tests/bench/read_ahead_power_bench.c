@@ -0,0 +1,101 @@
+#include "nuno/audio_buffer.h"
+#include "nuno/format_decoder.h"
+#include "nuno/read_ahead.h"
+#include "platform/sim/sim_block_device.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * Storage duty cycle of the read-ahead burst policy, per window size and low
+ * watermark. Each row plays one file through a decoder on a simulated clock
+ * (decoded frames at the stream's rate) with the fake SD card from
+ * src/platform/sim/sim_block_device.c on the storage hooks, and prints the
+ * burst size, the idle time between bursts, the share of time the card is
+ * awake and its mean draw. No I/O thread: refills run inline where the
+ * thread would be woken, which schedules the same bursts. Pass an audio path
+ * on the command line; without one the first bundled track is used. Build
+ * with -DBUILD_BENCHMARKS=ON.
+ */
+
+#define BENCH_READ_FRAMES AUDIO_BUFFER_FRAMES
+
+#ifdef NUNO_DEFAULT_LIBRARY_PATH
+#define BENCH_TRACK(name) NUNO_DEFAULT_LIBRARY_PATH "/bach/open-goldberg-variations/" name
+static const char *const k_default_file =
+    BENCH_TRACK("Kimiko_Ishizaka_-_Open_Goldberg_Variations_-_02_Variatio_1.mp3");
+#endif
+
+static const size_t k_windows[] = { 128U * 1024U, 256U * 1024U, 512U * 1024U, 1024U * 1024U,
+                                    2048U * 1024U };
+static const unsigned k_watermarks[] = { 25U, 50U, 75U };
+
+static float pcm[BENCH_READ_FRAMES * 8U];
+static uint64_t s_clock_us;
+
+static uint64_t bench_now_us(void) {
+    return s_clock_us;
+}
+
+/* Plays 'path' to the end on the simulated clock; false if it cannot open. */
+static bool play_file(const char *path) {
+    FormatDecoder *decoder = format_decoder_create();
+    if (!decoder || !format_decoder_open(decoder, path)) {
+        format_decoder_destroy(decoder);
+        return false;
+    }
+    uint32_t rate = format_decoder_get_sample_rate(decoder);
+    uint64_t frames = 0U;
+    size_t got;
+    while ((got = format_decoder_read(decoder, pcm, BENCH_READ_FRAMES)) > 0U) {
+        frames += got;
+        s_clock_us = frames * 1000000U / rate;
+    }
+    format_decoder_destroy(decoder);
+    return true;
+}
+
+static void bench_file(const char *path) {
+    printf("%s\n", path);
+    printf("%8s %5s %7s %10s %9s %8s %8s %7s\n", "window", "low", "bursts", "KiB/burst",
+           "idle ms", "awake %", "avg mW", "stalls");
+    for (size_t w = 0; w < sizeof(k_windows) / sizeof(k_windows[0]); w++) {
+        for (size_t l = 0; l < sizeof(k_watermarks) / sizeof(k_watermarks[0]); l++) {
+            ReadAhead_SetWindowBytes(k_windows[w]);
+            ReadAhead_SetLowWatermarkPercent(k_watermarks[l]);
+            s_clock_us = 0U;
+            SimBlockDevice_Attach(NULL, bench_now_us);
+            if (!play_file(path)) {
+                printf("(cannot open)\n");
+                return;
+            }
+
+            ReadAheadStats stats;
+            SimBlockDeviceStats device;
+            ReadAhead_GetStats(&stats);
+            SimBlockDevice_GetStats(&device);
+            uint64_t total = device.active_us + device.idle_us;
+            printf("%7zuK %4u%% %7u %10u %9u %8.3f %8.3f %7u\n", k_windows[w] / 1024U,
+                   ReadAhead_GetLowWatermarkPercent(), stats.bursts,
+                   stats.bursts ? stats.kib_read / stats.bursts : 0U,
+                   (stats.bursts > 1U) ? stats.idle_ms / (stats.bursts - 1U) : 0U,
+                   total ? 100.0 * (double)device.active_us / (double)total : 0.0,
+                   (double)device.average_uw / 1000.0, stats.stalls);
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    if (argc > 1) {
+        for (int i = 1; i < argc; i++) {
+            bench_file(argv[i]);
+        }
+        return 0;
+    }
+#ifdef NUNO_DEFAULT_LIBRARY_PATH
+    bench_file(k_default_file);
+#else
+    printf("usage: %s file...\n", argv[0]);
+#endif
+    return 0;
+}
@@ -0,0 +1,109 @@
+#define _POSIX_C_SOURCE 199309L
+
+#include "nuno/resampler.h"
+
+#include <stdio.h>
+#include <time.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define BENCH_HAVE_TSC 1
+#endif
+
+/*
+ * Host micro-benchmark for the sample-rate converter. Streams a block of
+ * input through each quality tier for the common ratios and prints the
+ * measured ns (and TSC cycles on x86) per output frame next to the Cortex-M7
+ * estimate from Resampler_GetCost(). Build with -DBUILD_BENCHMARKS=ON.
+ */
+
+#define BENCH_OUTPUT_FRAMES 2000000U
+#define BENCH_CHUNK_FRAMES 512U
+
+static Resampler rs;
+static float output[BENCH_CHUNK_FRAMES * 2U];
+static volatile float sink;
+
+static const struct {
+    uint32_t in_rate;
+    uint32_t out_rate;
+} k_ratios[] = {
+    { 48000U, 44100U },
+    { 44100U, 48000U },
+    { 96000U, 44100U },
+    { 22050U, 44100U },
+};
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e9 + (double)ts.tv_nsec;
+}
+
+static void stream(size_t out_frames) {
+    size_t produced = 0U;
+    uint32_t seed = 1U;
+    while (produced < out_frames) {
+        size_t want = out_frames - produced;
+        if (want > BENCH_CHUNK_FRAMES) {
+            want = BENCH_CHUNK_FRAMES;
+        }
+        size_t n = Resampler_Pull(&rs, output, want);
+        if (n > 0U) {
+            produced += n;
+            continue;
+        }
+        size_t space = 0U;
+        float *in = Resampler_InputSpace(&rs, &space);
+        size_t frames = Resampler_InputFramesFor(&rs, want);
+        if (frames > space) {
+            frames = space;
+        }
+        for (size_t i = 0; i < frames * 2U; i++) {
+            seed = seed * 1664525U + 1013904223U;
+            in[i] = (float)(int32_t)seed / 2147483648.0f;
+        }
+        Resampler_CommitInput(&rs, frames);
+    }
+    sink = output[0];
+}
+
+int main(void) {
+    static const char *const names[RESAMPLER_QUALITY_COUNT] = { "low", "medium", "high" };
+
+    printf("%-15s %-7s %6s %10s %12s %12s\n", "ratio", "tier", "taps",
+           "ns/frame", "cycles/frame", "M7 estimate");
+    for (size_t r = 0; r < sizeof(k_ratios) / sizeof(k_ratios[0]); r++) {
+        for (int q = 0; q < RESAMPLER_QUALITY_COUNT; q++) {
+            if (!Resampler_Configure(&rs, k_ratios[r].in_rate, k_ratios[r].out_rate,
+                                     (ResamplerQuality)q) ||
+                rs.quality != (ResamplerQuality)q) {
+                continue;  // tier does not fit RESAMPLER_MAX_COEFFS for this ratio
+            }
+            ResamplerCost cost;
+            Resampler_GetCost(&rs, &cost);
+
+            stream(BENCH_CHUNK_FRAMES);  // warm up caches and the branch predictor
+            double start = now_ns();
+#ifdef BENCH_HAVE_TSC
+            unsigned long long tsc_start = __rdtsc();
+#endif
+            stream(BENCH_OUTPUT_FRAMES);
+#ifdef BENCH_HAVE_TSC
+            double cycles = (double)(__rdtsc() - tsc_start) / BENCH_OUTPUT_FRAMES;
+#else
+            double cycles = 0.0;
+#endif
+            double ns = (now_ns() - start) / BENCH_OUTPUT_FRAMES;
+
+            char ratio[24];
+            snprintf(ratio, sizeof(ratio), "%u->%u", (unsigned)k_ratios[r].in_rate,
+                     (unsigned)k_ratios[r].out_rate);
+            printf("%-15s %-7s %6u %10.2f %12.1f %12u\n", ratio, names[q],
+                   (unsigned)cost.taps, ns, cycles, (unsigned)cost.est_cycles_per_frame);
+        }
+    }
+    printf("(%u output frames per row; cycles are TSC ticks, 0 where unavailable)\n",
+           BENCH_OUTPUT_FRAMES);
+    return 0;
+}
@@ -0,0 +1,266 @@
+#define _POSIX_C_SOURCE 200809L  // mkdtemp, clock_gettime
+
+#include "nuno/format_decoder.h"
+#include "nuno/tag_reader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/*
+ * Host benchmark for the tag reader. Writes a synthetic corpus of 1k and 10k
+ * files to a temporary directory, in a fixed mix per ten files:
+ *
+ *   4  MP3, ID3v2.3 text frames and 1 KB of padding, Xing header
+ *   2  MP3, as above with 48 KB of cover art ahead of the audio
+ *   3  FLAC, STREAMINFO, VORBIS_COMMENT and 4 KB of PADDING
+ *   1  MP3, no tag, no Xing header (CBR estimate)
+ *
+ * with 24 KB of audio after the headers. It then times TagReader_ReadFile()
+ * over every file ("tags": files/s, mean and largest bytes read per file)
+ * and, for comparison, opening each file with the format decoder, the other
+ * way to a duration ("opened", "open ms"; the synthetic FLAC files carry no
+ * audio frames, so only the MP3s open). The corpus was just written, so the
+ * figures are for a warm cache. Pass file counts on the command line to
+ * override the defaults. Build with -DBUILD_BENCHMARKS=ON.
+ */
+
+#define AUDIO_BYTES (24U * 1024U)
+#define ART_BYTES (48U * 1024U)
+#define MP3_FRAME_BYTES 417U  // MPEG-1 layer III, 128 kbit/s, 44.1 kHz
+
+static const size_t k_default_counts[] = { 1000U, 10000U };
+
+static uint8_t file_data[ART_BYTES + AUDIO_BYTES + 8192U];
+static uint8_t read_buffer[TAG_READER_BUDGET_BYTES];
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec * 1e3 + (double)ts.tv_nsec / 1e6;
+}
+
+static void put_be32(uint8_t *p, uint32_t value) {
+    p[0] = (uint8_t)(value >> 24);
+    p[1] = (uint8_t)(value >> 16);
+    p[2] = (uint8_t)(value >> 8);
+    p[3] = (uint8_t)value;
+}
+
+static void put_le32(uint8_t *p, uint32_t value) {
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+    p[2] = (uint8_t)(value >> 16);
+    p[3] = (uint8_t)(value >> 24);
+}
+
+static size_t id3_text_frame(uint8_t *p, const char *id, const char *text) {
+    size_t length = strlen(text);
+    memcpy(p, id, 4);
+    put_be32(p + 4, (uint32_t)(length + 1U));
+    p[8] = 0;
+    p[9] = 0;
+    p[10] = 3;  // UTF-8
+    memcpy(p + 11, text, length);
+    return 11U + length;
+}
+
+/* ID3v2.3 tag with title/artist/album/track and 'art' bytes of APIC. */
+static size_t write_id3(uint8_t *p, size_t index, size_t art) {
+    char text[64];
+    size_t n = 10U;
+    snprintf(text, sizeof(text), "Track %zu", index);
+    n += id3_text_frame(p + n, "TIT2", text);
+    snprintf(text, sizeof(text), "Artist %zu", index / 100U);
+    n += id3_text_frame(p + n, "TPE1", text);
+    snprintf(text, sizeof(text), "Album %zu", index / 10U);
+    n += id3_text_frame(p + n, "TALB", text);
+    snprintf(text, sizeof(text), "%zu/10", index % 10U + 1U);
+    n += id3_text_frame(p + n, "TRCK", text);
+    if (art > 0U) {
+        memcpy(p + n, "APIC", 4);
+        put_be32(p + n + 4, (uint32_t)art);
+        memset(p + n + 8, 0, 2U + art);
+        n += 10U + art;
+    }
+    memset(p + n, 0, 1024U);  // padding
+    n += 1024U;
+    size_t body = n - 10U;
+    const uint8_t header[10] = { 'I', 'D', '3', 3, 0, 0, (uint8_t)((body >> 21) & 0x7FU),
+                                 (uint8_t)((body >> 14) & 0x7FU), (uint8_t)((body >> 7) & 0x7FU),
+                                 (uint8_t)(body & 0x7FU) };
+    memcpy(p, header, sizeof(header));
+    return n;
+}
+
+/* AUDIO_BYTES of silent MP3 frames, the first carrying a Xing header. */
+static size_t write_mp3_audio(uint8_t *p, bool xing) {
+    static const uint8_t header[4] = { 0xFF, 0xFB, 0x90, 0x64 };
+    size_t frames = AUDIO_BYTES / MP3_FRAME_BYTES;
+    memset(p, 0, frames * MP3_FRAME_BYTES);
+    for (size_t i = 0; i < frames; i++) {
+        memcpy(p + i * MP3_FRAME_BYTES, header, sizeof(header));
+    }
+    if (xing) {
+        memcpy(p + 36, "Xing", 4);
+        put_be32(p + 40, 1U);
+        put_be32(p + 44, (uint32_t)frames - 1U);
+    }
+    return frames * MP3_FRAME_BYTES;
+}
+
+static size_t write_flac(uint8_t *p, size_t index) {
+    memcpy(p, "fLaC", 4);
+    p[4] = 0;  // STREAMINFO
+    p[5] = 0;
+    p[6] = 0;
+    p[7] = 34;
+    uint8_t *info = p + 8;
+    memset(info, 0, 34U);
+    info[0] = 0x10;  // 4096-sample blocks
+    info[2] = 0x10;
+    // 44.1 kHz, 2 channels, 16 bits, 60 s
+    const uint8_t fields[8] = { 0x0A, 0xC4, 0x42, 0xF0, 0x00, 0x28, 0x5C, 0xE0 };
+    memcpy(info + 10, fields, sizeof(fields));
+
+    size_t n = 8U + 34U;
+    size_t block = n;
+    n += 4U;
+    put_le32(p + n, 5U);
+    memcpy(p + n + 4, "bench", 5);
+    n += 9U;
+    put_le32(p + n, 4U);
+    n += 4U;
+    char comments[4][48];
+    snprintf(comments[0], sizeof(comments[0]), "TITLE=Track %zu", index);
+    snprintf(comments[1], sizeof(comments[1]), "ARTIST=Artist %zu", index / 100U);
+    snprintf(comments[2], sizeof(comments[2]), "ALBUM=Album %zu", index / 10U);
+    snprintf(comments[3], sizeof(comments[3]), "TRACKNUMBER=%zu", index % 10U + 1U);
+    for (size_t i = 0; i < 4U; i++) {
+        size_t length = strlen(comments[i]);
+        put_le32(p + n, (uint32_t)length);
+        memcpy(p + n + 4, comments[i], length);
+        n += 4U + length;
+    }
+    size_t size = n - block - 4U;
+    p[block] = 4;  // VORBIS_COMMENT
+    p[block + 1] = (uint8_t)(size >> 16);
+    p[block + 2] = (uint8_t)(size >> 8);
+    p[block + 3] = (uint8_t)size;
+
+    p[n] = 0x81;  // last block: PADDING
+    p[n + 1] = 0;
+    p[n + 2] = 0x10;
+    p[n + 3] = 0;
+    memset(p + n + 4, 0, 4096U);
+    n += 4U + 4096U;
+    memset(p + n, 0x5A, AUDIO_BYTES);  // frames are not parsed
+    return n + AUDIO_BYTES;
+}
+
+static bool build_corpus(const char *root, size_t files, size_t *total_bytes) {
+    char path[256];
+    *total_bytes = 0U;
+    for (size_t i = 0; i < files; i++) {
+        size_t kind = i % 10U;
+        size_t n;
+        const char *extension = "mp3";
+        if (kind < 4U) {
+            n = write_id3(file_data, i, 0U);
+            n += write_mp3_audio(file_data + n, true);
+        } else if (kind < 6U) {
+            n = write_id3(file_data, i, ART_BYTES);
+            n += write_mp3_audio(file_data + n, true);
+        } else if (kind < 9U) {
+            n = write_flac(file_data, i);
+            extension = "flac";
+        } else {
+            n = write_mp3_audio(file_data, false);
+        }
+        snprintf(path, sizeof(path), "%s/%06zu.%s", root, i, extension);
+        FILE *file = fopen(path, "wb");
+        if (!file) {
+            return false;
+        }
+        fwrite(file_data, 1, n, file);
+        fclose(file);
+        *total_bytes += n;
+    }
+    return true;
+}
+
+static const char *file_path(char *path, size_t size, const char *root, size_t index) {
+    size_t kind = index % 10U;
+    snprintf(path, size, "%s/%06zu.%s", root, index, (kind >= 6U && kind < 9U) ? "flac" : "mp3");
+    return path;
+}
+
+static void bench_count(size_t files) {
+    char root[] = "/tmp/nuno-tag-bench-XXXXXX";
+    if (!mkdtemp(root)) {
+        printf("%10zu (cannot create a temporary directory)\n", files);
+        return;
+    }
+    size_t corpus_bytes = 0U;
+    if (build_corpus(root, files, &corpus_bytes)) {
+        char path[256];
+        TrackTags tags;
+        size_t parsed = 0U;
+        uint64_t bytes_read = 0U;
+        uint32_t most_read = 0U;
+        double start = now_ms();
+        for (size_t i = 0; i < files; i++) {
+            if (TagReader_ReadFile(file_path(path, sizeof(path), root, i), read_buffer,
+                                   sizeof(read_buffer), &tags) &&
+                tags.duration_seconds > 0U && (tags.title[0] || i % 10U == 9U)) {
+                parsed++;
+            }
+            bytes_read += tags.bytes_read;
+            most_read = tags.bytes_read > most_read ? tags.bytes_read : most_read;
+        }
+        double tag_ms = now_ms() - start;
+
+        FormatDecoder *decoder = format_decoder_create();
+        size_t opened = 0U;
+        start = now_ms();
+        for (size_t i = 0; decoder && i < files; i++) {
+            if (format_decoder_open(decoder, file_path(path, sizeof(path), root, i))) {
+                opened += format_decoder_get_total_frames(decoder) > 0U;
+                format_decoder_close(decoder);
+            }
+        }
+        double open_ms = now_ms() - start;
+        if (decoder) {
+            format_decoder_destroy(decoder);
+        }
+
+        printf("%10zu %10.1f %10zu %10.1f %10.0f %10.0f %10u %10zu %10.1f %10.0f\n", files,
+               (double)corpus_bytes / 1048576.0, parsed, tag_ms, (double)files * 1e3 / tag_ms,
+               (double)bytes_read / (double)files, (unsigned)most_read, opened, open_ms,
+               (double)files * 1e3 / open_ms);
+    } else {
+        printf("%10zu (cannot build the corpus)\n", files);
+    }
+
+    char command[64];
+    snprintf(command, sizeof(command), "rm -rf '%s'", root);
+    if (system(command) != 0) {
+        printf("could not remove %s\n", root);
+    }
+}
+
+int main(int argc, char **argv) {
+    printf("%10s %10s %10s %10s %10s %10s %10s %10s %10s %10s\n", "files", "corpus MB", "parsed",
+           "tags ms", "files/s", "mean B", "max B", "opened", "open ms", "files/s");
+    if (argc > 1) {
+        for (int i = 1; i < argc; i++) {
+            bench_count((size_t)strtoul(argv[i], NULL, 10));
+        }
+        return 0;
+    }
+    for (size_t i = 0; i < sizeof(k_default_counts) / sizeof(k_default_counts[0]); i++) {
+        bench_count(k_default_counts[i]);
+    }
+    return 0;
+}
@@ -0,0 +1,704 @@
+#include <unity.h>
+#include "nuno/audio_buffer.h"
+#include "nuno/byte_source.h"
+#include "nuno/filesystem.h"
+#include "nuno/format_decoder.h"
+#include "nuno/platform.h"
+#include "nuno/read_ahead.h"
+
+#include <stdio.h>
+#include <string.h>
+
+/*
+ * AudioBuffer ring tests. No decoder is installed, so fill_buffer() takes the
+ * raw-PCM fallback and pulls from the FileSystem_ReadAudioData stub below. The
+ * stub emits a stream where every sample of block N carries the value N + 1,
+ * which lets the tests check ordering from the consumer side.
+ *
+ * The S16 fast-path tests decode a real MP3 from the bundled library, so they
+ * only run when the build points NUNO_DEFAULT_LIBRARY_PATH at assets/music.
+ */
+
+#ifdef NUNO_DEFAULT_LIBRARY_PATH
+#define TEST_MP3_PATH NUNO_DEFAULT_LIBRARY_PATH \
+    "/bach/open-goldberg-variations/Kimiko_Ishizaka_-_Open_Goldberg_Variations_-_02_Variatio_1.mp3"
+#endif
+
+static size_t stub_blocks_total;
+static size_t stub_blocks_read;
+static int stub_wake_count;
+static int stub_lookahead_opens;
+static int stub_lookahead_commits;
+static int stub_provider_calls;
+static size_t stub_playlist_remaining;
+
+size_t FileSystem_ReadAudioData(void *buffer, size_t bytes) {
+    if (stub_blocks_read >= stub_blocks_total) {
+        return 0U;
+    }
+    uint16_t *samples = (uint16_t *)buffer;
+    size_t count = bytes / sizeof(uint16_t);
+    for (size_t i = 0; i < count; i++) {
+        samples[i] = (uint16_t)(stub_blocks_read + 1U);
+    }
+    stub_blocks_read++;
+    return bytes;
+}
+
+bool FileSystem_Seek(size_t position) {
+    (void)position;
+    return true;
+}
+
+uint32_t platform_get_time_ms(void) {
+    return 0U;
+}
+
+static void stub_wake(void) {
+    stub_wake_count++;
+}
+
+// Test fixture setup and teardown
+void setUp(void) {
+    stub_blocks_total = 1000U;
+    stub_blocks_read = 0U;
+    stub_wake_count = 0;
+    stub_lookahead_opens = 0;
+    stub_lookahead_commits = 0;
+    stub_provider_calls = 0;
+    stub_playlist_remaining = 0U;
+}
+
+void tearDown(void) {
+    AudioBuffer_SetProducerWake(NULL);
+    AudioBuffer_SetCrossfadeRegion(NULL, 0U);
+    AudioBuffer_Cleanup();
+    AudioBuffer_SetOutputMode(AUDIO_BUFFER_MODE_RING);
+}
+
+void test_init_rejects_out_of_range_depth(void) {
+    TEST_ASSERT_FALSE(AudioBuffer_InitWithDepth(AUDIO_BUFFER_MIN_BLOCKS - 1U));
+    TEST_ASSERT_FALSE(AudioBuffer_InitWithDepth(AUDIO_BUFFER_MAX_BLOCKS + 1U));
+    TEST_ASSERT_TRUE(AudioBuffer_InitWithDepth(AUDIO_BUFFER_MIN_BLOCKS));
+    TEST_ASSERT_EQUAL(AUDIO_BUFFER_MIN_BLOCKS, AudioBuffer_GetDepth());
+}
+
+void test_start_playback_primes_whole_ring(void) {
+    // Arrange
+    TEST_ASSERT_TRUE(AudioBuffer_InitWithDepth(AUDIO_BUFFER_MAX_BLOCKS));
+
+    // Act
+    TEST_ASSERT_TRUE(AudioBuffer_StartPlayback());
+
+    // Assert
+    AudioBufferStats stats;
+    AudioBuffer_GetBufferStats(&stats);
+    TEST_ASSERT_EQUAL(AUDIO_BUFFER_MAX_BLOCKS, stats.ring_depth);
+    TEST_ASSERT_EQUAL(AUDIO_BUFFER_MAX_BLOCKS, stats.ring_occupancy);
+    TEST_ASSERT_EQUAL(1U, AudioBuffer_GetBuffer()[0]);
+}
+
+void test_inline_fill_delivers_blocks_in_order(void) {
+    // Arrange
+    TEST_ASSERT_TRUE(AudioBuffer_InitWithDepth(AUDIO_BUFFER_MAX_BLOCKS));
+    TEST_ASSERT_TRUE(AudioBuffer_StartPlayback());
+
+    // Act / Assert: walk well past the ring depth so slots are reused.
+    for (uint16_t block = 1U; block <= 3U * AUDIO_BUFFER_MAX_BLOCKS; block++) {
+        uint16_t *samples = AudioBuffer_GetBuffer();
+        TEST_ASSERT_EQUAL(block, samples[0]);
+        TEST_ASSERT_EQUAL(block, samples[AUDIO_BUFFER_SIZE - 1U]);
+        TEST_ASSERT_TRUE(AudioBuffer_Done());
+    }
+}
+
+void test_decoupled_consumer_starves_then_recovers(void) {
+    // Arrange
+    TEST_ASSERT_TRUE(AudioBuffer_InitWithDepth(AUDIO_BUFFER_MIN_BLOCKS));
+    AudioBuffer_SetProducerWake(stub_wake);
+    TEST_ASSERT_TRUE(AudioBuffer_StartPlayback());
+
+    // Act: drain the primed ring without ever servicing the producer.
+    for (size_t i = 0; i < AUDIO_BUFFER_MIN_BLOCKS; i++) {
+        TEST_ASSERT_TRUE(AudioBuffer_Done());
+    }
+
+    // Assert: the consumer is handed silence and the underrun is counted.
+    AudioBufferStats stats;
+    AudioBuffer_GetBufferStats(&stats);
+    TEST_ASSERT_EQUAL(AUDIO_BUFFER_MIN_BLOCKS, (size_t)stub_wake_count);
+    TEST_ASSERT_EQUAL(1U, stats.underruns);
+    TEST_ASSERT_EQUAL(0U, stats.ring_occupancy);
+    TEST_ASSERT_EQUAL(0U, stats.ring_min_occupancy);
+    TEST_ASSERT_EQUAL(BUFFER_STATE_UNDERRUN, AudioBuffer_GetState());
+    TEST_ASSERT_EQUAL(0U, AudioBuffer_GetBuffer()[0]);
+
+    // Act: the producer catches up.
+    AudioBuffer_Service();
+
+    // Assert: playback resumes with the next block in sequence.
+    AudioBuffer_GetBufferStats(&stats);
+    TEST_ASSERT_EQUAL(AUDIO_BUFFER_MIN_BLOCKS, stats.ring_occupancy);
+    TEST_ASSERT_EQUAL(AUDIO_BUFFER_MIN_BLOCKS + 1U, AudioBuffer_GetBuffer()[0]);
+}
+
+void test_track_position_counts_played_blocks_only(void) {
+    // Arrange: the whole ring is decoded ahead of the consumer.
+    TEST_ASSERT_TRUE(AudioBuffer_InitWithDepth(AUDIO_BUFFER_MIN_BLOCKS));
+    AudioBuffer_SetProducerWake(stub_wake);
+    TEST_ASSERT_TRUE(AudioBuffer_StartPlayback());
+    AudioBufferStats stats;
+    AudioBuffer_GetBufferStats(&stats);
+    TEST_ASSERT_EQUAL(AUDIO_BUFFER_MIN_BLOCKS * AUDIO_BUFFER_FRAMES, stats.total_samples);
+    TEST_ASSERT_EQUAL(0U, stats.track_frames_played);
+
+    // Act: play the ring out, then starve once.
+    for (size_t i = 0; i <= AUDIO_BUFFER_MIN_BLOCKS; i++) {
+        TEST_ASSERT_TRUE(AudioBuffer_Done());
+    }
+
+    // Assert: the silent block is not counted.
+    AudioBuffer_GetBufferStats(&stats);
+    TEST_ASSERT_EQUAL(AUDIO_BUFFER_MIN_BLOCKS * AUDIO_BUFFER_FRAMES, stats.track_frames_played);
+
+    // Act / Assert: a flush (Skip / Previous) starts the next track at zero.
+    TEST_ASSERT_TRUE(AudioBuffer_Flush(false));
+    AudioBuffer_GetBufferStats(&stats);
+    TEST_ASSERT_EQUAL(0U, stats.track_frames_played);
+}
+
+void test_ring_drains_to_end_of_stream(void) {
+    // Arrange: a stream shorter than the ring.
+    stub_blocks_total = 2U;
+    TEST_ASSERT_TRUE(AudioBuffer_InitWithDepth(AUDIO_BUFFER_MAX_BLOCKS));
+    TEST_ASSERT_TRUE(AudioBuffer_StartPlayback());
+
+    // Act / Assert
+    TEST_ASSERT_TRUE(AudioBuffer_Done());
+    TEST_ASSERT_FALSE(AudioBuffer_Done());
+    TEST_ASSERT_EQUAL(BUFFER_STATE_END_OF_STREAM, AudioBuffer_GetState());
+}
+
+void test_ping_pong_refills_the_half_that_drained(void) {
+    // Arrange
+    AudioBuffer_SetOutputMode(AUDIO_BUFFER_MODE_PING_PONG);
+    TEST_ASSERT_TRUE(AudioBuffer_Init());
+    AudioBuffer_SetProducerWake(stub_wake);
+    TEST_ASSERT_TRUE(AudioBuffer_StartPlayback());
+
+    size_t region_samples = 0U;
+    uint16_t *region = AudioBuffer_GetDmaRegion(&region_samples);
+    const size_t half = region_samples / 2U;
+    TEST_ASSERT_EQUAL(AUDIO_BUFFER_SIZE, region_samples);
+    TEST_ASSERT_EQUAL(half, AudioBuffer_GetBlockSamples());
+    TEST_ASSERT_EQUAL(1U, region[0]);
+    TEST_ASSERT_EQUAL(2U, region[half]);
+
+    // Act / Assert: HT hands back the first half, TC the second.
+    AudioBuffer_HalfDone();
+    AudioBuffer_Service();
+    TEST_ASSERT_EQUAL(3U, region[0]);
+    TEST_ASSERT_EQUAL(2U, region[half]);
+
+    TEST_ASSERT_TRUE(AudioBuffer_Done());
+    AudioBuffer_Service();
+    TEST_ASSERT_EQUAL(3U, region[0]);
+    TEST_ASSERT_EQUAL(4U, region[half]);
+}
+
+void test_late_ping_pong_producer_skips_the_playing_half(void) {
+    // Arrange
+    AudioBuffer_SetOutputMode(AUDIO_BUFFER_MODE_PING_PONG);
+    TEST_ASSERT_TRUE(AudioBuffer_Init());
+    AudioBuffer_SetProducerWake(stub_wake);
+    TEST_ASSERT_TRUE(AudioBuffer_StartPlayback());
+    size_t region_samples = 0U;
+    uint16_t *region = AudioBuffer_GetDmaRegion(&region_samples);
+    const size_t half = region_samples / 2U;
+
+    // Act: three half events with no producer service; the DMA is now
+    // replaying the stale second half.
+    AudioBuffer_HalfDone();
+    TEST_ASSERT_TRUE(AudioBuffer_Done());
+    AudioBuffer_HalfDone();
+
+    // The consumer has run past the producer: the ring reads as empty, not
+    // as a wrapped-around near-SIZE_MAX count.
+    AudioBufferStats stats;
+    AudioBuffer_GetBufferStats(&stats);
+    TEST_ASSERT_EQUAL(0U, stats.ring_occupancy);
+    TEST_ASSERT_TRUE(AudioBuffer_IsUnderThreshold());
+
+    AudioBuffer_Service();
+
+    // Assert: the producer wrote the first half (next to play), not the one
+    // under the DMA, and the starved events were counted.
+    AudioBuffer_GetBufferStats(&stats);
+    TEST_ASSERT_GREATER_OR_EQUAL(1U, stats.underruns);
+    TEST_ASSERT_EQUAL(3U, region[0]);
+    TEST_ASSERT_EQUAL(2U, region[half]);
+    TEST_ASSERT_EQUAL(stats.ring_depth, stats.ring_occupancy);
+    TEST_ASSERT_FALSE(AudioBuffer_IsUnderThreshold());
+}
+
+#ifdef TEST_MP3_PATH
+static FormatDecoder *open_test_mp3(void) {
+    FormatDecoder *decoder = format_decoder_create();
+    TEST_ASSERT_NOT_NULL(decoder);
+    TEST_ASSERT_TRUE(format_decoder_open(decoder, TEST_MP3_PATH));
+    TEST_ASSERT_EQUAL(AUDIO_OUT_CHANNELS, format_decoder_get_channels(decoder));
+    TEST_ASSERT_TRUE(format_decoder_supports_s16(decoder));
+    return decoder;
+}
+#endif
+
+void test_s16_source_at_unity_gain_is_copied_bit_exact(void) {
+#ifdef TEST_MP3_PATH
+    // Arrange: a reference decoder on the same file gives the codec's output.
+    static int16_t expected[AUDIO_BUFFER_SIZE];
+    FormatDecoder *reference = open_test_mp3();
+    TEST_ASSERT_EQUAL(AUDIO_BUFFER_FRAMES,
+                      format_decoder_read_s16(reference, expected, AUDIO_BUFFER_FRAMES));
+    format_decoder_destroy(reference);
+
+    TEST_ASSERT_TRUE(AudioBuffer_InitWithDepth(AUDIO_BUFFER_MAX_BLOCKS));
+    TEST_ASSERT_TRUE(AudioBuffer_SetDecoder(open_test_mp3()));
+
+    // Act
+    TEST_ASSERT_TRUE(AudioBuffer_StartPlayback());
+
+    // Assert
+    AudioBufferStats stats;
+    AudioBuffer_GetBufferStats(&stats);
+    TEST_ASSERT_EQUAL_MEMORY(expected, AudioBuffer_GetBuffer(), sizeof(expected));
+    TEST_ASSERT_EQUAL(AUDIO_BUFFER_MAX_BLOCKS * AUDIO_BUFFER_FRAMES, stats.fast_path_frames);
+#else
+    TEST_IGNORE_MESSAGE("NUNO_DEFAULT_LIBRARY_PATH not set");
+#endif
+}
+
+void test_s16_source_below_unity_gain_uses_q15(void) {
+#ifdef TEST_MP3_PATH
+    // Arrange: from 100% the first block ramps one step, to a gain of 0.75.
+    static int16_t source[AUDIO_BUFFER_SIZE];
+    FormatDecoder *reference = open_test_mp3();
+    TEST_ASSERT_EQUAL(AUDIO_BUFFER_FRAMES,
+                      format_decoder_read_s16(reference, source, AUDIO_BUFFER_FRAMES));
+    format_decoder_destroy(reference);
+
+    TEST_ASSERT_TRUE(AudioBuffer_InitWithDepth(AUDIO_BUFFER_MIN_BLOCKS));
+    TEST_ASSERT_TRUE(AudioBuffer_SetDecoder(open_test_mp3()));
+    AudioBuffer_SetVolume(50U);
+
+    // Act
+    TEST_ASSERT_TRUE(AudioBuffer_StartPlayback());
+
+    // Assert
+    const int16_t *out = (const int16_t *)AudioBuffer_GetBuffer();
+    for (size_t i = 0; i < AUDIO_BUFFER_SIZE; i++) {
+        int32_t scaled = ((int32_t)source[i] * 24576 + (1 << 14)) >> 15;
+        TEST_ASSERT_EQUAL_INT16((int16_t)scaled, out[i]);
+    }
+#else
+    TEST_IGNORE_MESSAGE("NUNO_DEFAULT_LIBRARY_PATH not set");
+#endif
+}
+
+void test_mismatched_source_rate_is_resampled_to_the_output_clock(void) {
+#ifdef TEST_MP3_PATH
+    // Arrange: the 48 kHz track plays on a fixed 44.1 kHz output clock.
+    TEST_ASSERT_TRUE(AudioBuffer_InitWithDepth(AUDIO_BUFFER_MIN_BLOCKS));
+    FormatDecoder *decoder = open_test_mp3();
+    TEST_ASSERT_EQUAL_UINT32(48000U, format_decoder_get_sample_rate(decoder));
+    TEST_ASSERT_TRUE(AudioBuffer_SetDecoder(decoder));
+    TEST_ASSERT_TRUE(AudioBuffer_ConfigureSampleRate(48000U, 44100U));
+
+    // Act
+    TEST_ASSERT_TRUE(AudioBuffer_StartPlayback());
+
+    // Assert: every primed frame came through the converter, none direct.
+    AudioBufferStats stats;
+    AudioBuffer_GetBufferStats(&stats);
+    TEST_ASSERT_EQUAL(AUDIO_BUFFER_MIN_BLOCKS * AUDIO_BUFFER_FRAMES, stats.resampled_frames);
+    TEST_ASSERT_EQUAL(0U, stats.fast_path_frames);
+
+    ResamplerCost cost;
+    TEST_ASSERT_TRUE(AudioBuffer_GetResamplerCost(&cost));
+    TEST_ASSERT_EQUAL_UINT32(147U, cost.phases);  // 44100/48000 == 147/160
+#else
+    TEST_IGNORE_MESSAGE("NUNO_DEFAULT_LIBRARY_PATH not set");
+#endif
+}
+
+void test_crossfade_tail_is_sized_from_the_fade_and_the_region(void) {
+    // Arrange
+    static int16_t region[1000U * AUDIO_OUT_CHANNELS];
+    AudioBufferMemoryReport report;
+    TEST_ASSERT_TRUE(AudioBuffer_InitWithDepth(AUDIO_BUFFER_MIN_BLOCKS));
+
+    // Act / Assert: nothing is spent while crossfade is off or has no region.
+    AudioBuffer_SetCrossfadeFrames(500U);
+    AudioBuffer_GetMemoryReport(&report);
+    TEST_ASSERT_EQUAL(0U, report.crossfade_tail_bytes);
+
+    AudioBuffer_SetCrossfadeRegion(region, sizeof(region));
+    AudioBuffer_SetCrossfadeFrames(0U);
+    AudioBuffer_GetMemoryReport(&report);
+    TEST_ASSERT_EQUAL(0U, report.crossfade_tail_bytes);
+
+    // S16 stereo: 4 bytes per frame, capped by the region.
+    AudioBuffer_SetCrossfadeFrames(500U);
+    AudioBuffer_GetMemoryReport(&report);
+    TEST_ASSERT_EQUAL(500U * 4U, report.crossfade_tail_bytes);
+    TEST_ASSERT_EQUAL(sizeof(region), report.crossfade_region_bytes);
+
+    AudioBuffer_SetCrossfadeFrames(44100U);
+    AudioBuffer_GetMemoryReport(&report);
+    TEST_ASSERT_EQUAL(sizeof(region), report.crossfade_tail_bytes);
+    TEST_ASSERT_EQUAL_UINT32(1000U, report.crossfade_frames);
+}
+
+void test_armed_crossfade_keeps_the_s16_fast_path(void) {
+#ifdef TEST_MP3_PATH
+    // Arrange
+    static int16_t region[4096U * AUDIO_OUT_CHANNELS];
+    static int16_t expected[AUDIO_BUFFER_SIZE];
+    FormatDecoder *reference = open_test_mp3();
+    TEST_ASSERT_EQUAL(AUDIO_BUFFER_FRAMES,
+                      format_decoder_read_s16(reference, expected, AUDIO_BUFFER_FRAMES));
+    format_decoder_destroy(reference);
+
+    TEST_ASSERT_TRUE(AudioBuffer_InitWithDepth(AUDIO_BUFFER_MIN_BLOCKS));
+    AudioBuffer_SetCrossfadeRegion(region, sizeof(region));
+    AudioBuffer_SetCrossfadeFrames(4096U);
+    TEST_ASSERT_TRUE(AudioBuffer_SetDecoder(open_test_mp3()));
+
+    // Act
+    TEST_ASSERT_TRUE(AudioBuffer_StartPlayback());
+
+    // Assert: the tail is copied from the slot, so the output is untouched.
+    AudioBufferStats stats;
+    AudioBuffer_GetBufferStats(&stats);
+    TEST_ASSERT_EQUAL_MEMORY(expected, AudioBuffer_GetBuffer(), sizeof(expected));
+    TEST_ASSERT_EQUAL(AUDIO_BUFFER_MIN_BLOCKS * AUDIO_BUFFER_FRAMES, stats.fast_path_frames);
+#else
+    TEST_IGNORE_MESSAGE("NUNO_DEFAULT_LIBRARY_PATH not set");
+#endif
+}
+
+#ifdef TEST_MP3_PATH
+static FormatDecoder *stub_lookahead_open(void *user_data) {
+    (void)user_data;
+    stub_lookahead_opens++;
+    return open_test_mp3();
+}
+
+static void stub_lookahead_commit(void *user_data) {
+    (void)user_data;
+    stub_lookahead_commits++;
+}
+
+static FormatDecoder *stub_next_track_provider(void *user_data) {
+    (void)user_data;
+    stub_provider_calls++;
+    return NULL;
+}
+#endif
+
+void test_next_track_is_preopened_and_swapped_in_at_eof(void) {
+#ifdef TEST_MP3_PATH
+    // Arrange: about a second before the end, well inside the default window.
+    TEST_ASSERT_TRUE(AudioBuffer_InitWithDepth(AUDIO_BUFFER_MIN_BLOCKS));
+    AudioBuffer_SetNextTrackProvider(stub_next_track_provider, NULL);
+    AudioBuffer_SetLookAheadProvider(stub_lookahead_open, stub_lookahead_commit, NULL);
+    FormatDecoder *decoder = open_test_mp3();
+    size_t total = format_decoder_get_total_frames(decoder);
+    TEST_ASSERT_TRUE(total > 48000U);
+    format_decoder_seek(decoder, total - 48000U);
+    TEST_ASSERT_TRUE(AudioBuffer_SetDecoder(decoder));
+
+    // Act: priming fills the ring and then opens the next track; play on
+    // until the producer crosses into it.
+    TEST_ASSERT_TRUE(AudioBuffer_StartPlayback());
+    TEST_ASSERT_EQUAL(1, stub_lookahead_opens);
+    TEST_ASSERT_EQUAL(0, stub_lookahead_commits);
+    for (int i = 0; i < 200 && AudioBuffer_GetTrackChangeCount() == 0U; i++) {
+        TEST_ASSERT_TRUE(AudioBuffer_Done());
+    }
+
+    // Assert: the swap used the pre-opened decoder; nothing was opened at EOF.
+    AudioBufferStats stats;
+    AudioBuffer_GetBufferStats(&stats);
+    TEST_ASSERT_EQUAL_UINT32(1U, AudioBuffer_GetTrackChangeCount());
+    TEST_ASSERT_EQUAL(1, stub_lookahead_opens);
+    TEST_ASSERT_EQUAL(1, stub_lookahead_commits);
+    TEST_ASSERT_EQUAL(0, stub_provider_calls);
+    TEST_ASSERT_EQUAL(1U, stats.lookahead_hits);
+    TEST_ASSERT_EQUAL(0U, stats.lookahead_misses);
+#else
+    TEST_IGNORE_MESSAGE("NUNO_DEFAULT_LIBRARY_PATH not set");
+#endif
+}
+
+#ifdef TEST_MP3_PATH
+/* Playlist entry: the test track, entered about a second before its end so a
+ * long playlist plays quickly. */
+static FormatDecoder *open_playlist_track(void) {
+    FormatDecoder *decoder = open_test_mp3();
+    format_decoder_seek(decoder, format_decoder_get_total_frames(decoder) -
+                                     format_decoder_get_sample_rate(decoder));
+    return decoder;
+}
+
+static FormatDecoder *stub_playlist_next(void *user_data) {
+    (void)user_data;
+    if (stub_playlist_remaining == 0U) {
+        return NULL;
+    }
+    stub_playlist_remaining--;
+    return open_playlist_track();
+}
+#endif
+
+void test_track_changes_reuse_pooled_decoders_without_heap_calls(void) {
+#ifdef TEST_MP3_PATH
+    // Arrange: a 100-track playlist, opened through the look-ahead.
+    TEST_ASSERT_TRUE(AudioBuffer_InitWithDepth(AUDIO_BUFFER_MIN_BLOCKS));
+    stub_playlist_remaining = 99U;
+    AudioBuffer_SetNextTrackProvider(stub_playlist_next, NULL);
+    AudioBuffer_SetLookAheadProvider(stub_playlist_next, NULL, NULL);
+    TEST_ASSERT_TRUE(AudioBuffer_SetDecoder(open_playlist_track()));
+    TEST_ASSERT_TRUE(AudioBuffer_StartPlayback());
+
+    // Act: the first transitions warm every pool slot in rotation; count the
+    // heap calls from there to the end of the playlist.
+    bool warmed = false;
+    size_t heap_calls = 0U;
+    for (int i = 0; i < 10000 && AudioBuffer_Done(); i++) {
+        if (!warmed && AudioBuffer_GetTrackChangeCount() >= 2U) {
+            warmed = true;
+            heap_calls = format_decoder_get_heap_calls();
+        }
+    }
+
+    // Assert
+    TEST_ASSERT_TRUE(warmed);
+    TEST_ASSERT_EQUAL_UINT32(99U, AudioBuffer_GetTrackChangeCount());
+    TEST_ASSERT_EQUAL(heap_calls, format_decoder_get_heap_calls());
+#else
+    TEST_IGNORE_MESSAGE("NUNO_DEFAULT_LIBRARY_PATH not set");
+#endif
+}
+
+void test_mp3_seek_is_sample_exact(void) {
+#ifdef TEST_MP3_PATH
+    // Arrange: decode linearly to a point mid-frame, a few seconds in.
+    const size_t target = 3U * 48000U + 517U;
+    static int16_t scratch[AUDIO_BUFFER_SIZE];
+    static int16_t expected[AUDIO_BUFFER_SIZE];
+    FormatDecoder *reference = open_test_mp3();
+    for (size_t done = 0; done < target;) {
+        size_t want = target - done;
+        if (want > AUDIO_BUFFER_FRAMES) {
+            want = AUDIO_BUFFER_FRAMES;
+        }
+        TEST_ASSERT_EQUAL(want, format_decoder_read_s16(reference, scratch, want));
+        done += want;
+    }
+    TEST_ASSERT_EQUAL(AUDIO_BUFFER_FRAMES,
+                      format_decoder_read_s16(reference, expected, AUDIO_BUFFER_FRAMES));
+    format_decoder_destroy(reference);
+
+    // Act: a fresh decoder seeks there directly, with nothing indexed yet.
+    FormatDecoder *decoder = open_test_mp3();
+    format_decoder_seek(decoder, target);
+
+    // Assert
+    TEST_ASSERT_EQUAL(FD_ERROR_NONE, format_decoder_get_last_error(decoder));
+    TEST_ASSERT_EQUAL(AUDIO_BUFFER_FRAMES,
+                      format_decoder_read_s16(decoder, scratch, AUDIO_BUFFER_FRAMES));
+    TEST_ASSERT_EQUAL_MEMORY(expected, scratch, sizeof(expected));
+    format_decoder_destroy(decoder);
+#else
+    TEST_IGNORE_MESSAGE("NUNO_DEFAULT_LIBRARY_PATH not set");
+#endif
+}
+
+void test_seek_index_is_cached_across_opens(void) {
+#if defined(TEST_MP3_PATH) && defined(NUNO_TEST_CACHE_DIR)
+    // Arrange: an exact seek without the cache is the reference.
+    const size_t target = 90U * 48000U + 517U;
+    static int16_t scratch[AUDIO_BUFFER_SIZE];
+    static int16_t expected[AUDIO_BUFFER_SIZE];
+    FormatDecoder *reference = open_test_mp3();
+    format_decoder_seek(reference, target);
+    TEST_ASSERT_EQUAL(AUDIO_BUFFER_FRAMES,
+                      format_decoder_read_s16(reference, expected, AUDIO_BUFFER_FRAMES));
+    format_decoder_destroy(reference);
+
+    // Play one decoder to the end so its index covers the whole track.
+    TEST_ASSERT_TRUE(format_decoder_set_seek_cache_dir(NUNO_TEST_CACHE_DIR));
+    FormatDecoder *decoder = open_test_mp3();
+    while (format_decoder_read_s16(decoder, scratch, AUDIO_BUFFER_FRAMES) > 0U) {
+    }
+    size_t full_index = format_decoder_get_seek_points(decoder);
+    format_decoder_destroy(decoder);
+    format_decoder_flush_seek_cache();
+
+    // Act: reopen and seek near the start; only the cached index reaches 90 s.
+    decoder = open_test_mp3();
+    size_t opened_with = format_decoder_get_seek_points(decoder);
+    format_decoder_seek(decoder, 48000U);
+    size_t after_seek = format_decoder_get_seek_points(decoder);
+    format_decoder_seek(decoder, target);
+
+    // Assert
+    TEST_ASSERT_EQUAL(1U, opened_with);  // loaded lazily, on the first seek
+    TEST_ASSERT_EQUAL(full_index, after_seek);
+    TEST_ASSERT_EQUAL(AUDIO_BUFFER_FRAMES,
+                      format_decoder_read_s16(decoder, scratch, AUDIO_BUFFER_FRAMES));
+    TEST_ASSERT_EQUAL_MEMORY(expected, scratch, sizeof(expected));
+    format_decoder_destroy(decoder);
+    format_decoder_set_seek_cache_dir(NULL);
+#else
+    TEST_IGNORE_MESSAGE("NUNO_DEFAULT_LIBRARY_PATH or NUNO_TEST_CACHE_DIR not set");
+#endif
+}
+
+void test_memory_source_decodes_like_the_file(void) {
+#ifdef TEST_MP3_PATH
+    // Arrange: the whole file in memory, and a file decoder as reference.
+    static uint8_t encoded[3U * 1024U * 1024U];
+    static int16_t expected[AUDIO_BUFFER_SIZE];
+    static int16_t actual[AUDIO_BUFFER_SIZE];
+    const size_t target = 60U * 48000U + 99U;
+    FILE *file = fopen(TEST_MP3_PATH, "rb");
+    TEST_ASSERT_NOT_NULL(file);
+    size_t size = fread(encoded, 1, sizeof(encoded), file);
+    fclose(file);
+    TEST_ASSERT_TRUE(size > 0U && size < sizeof(encoded));
+    FormatDecoder *reference = open_test_mp3();
+    format_decoder_seek(reference, target);
+    TEST_ASSERT_EQUAL(AUDIO_BUFFER_FRAMES,
+                      format_decoder_read_s16(reference, expected, AUDIO_BUFFER_FRAMES));
+
+    // Act: the memory source is parsed in place (ByteSource_Map).
+    ByteSource source;
+    ByteSource_InitMemory(&source, encoded, size);
+    FormatDecoder *decoder = format_decoder_create();
+    TEST_ASSERT_TRUE(format_decoder_open_source(decoder, &source));
+    format_decoder_seek(decoder, target);
+
+    // Assert
+    TEST_ASSERT_EQUAL(format_decoder_get_total_frames(reference),
+                      format_decoder_get_total_frames(decoder));
+    TEST_ASSERT_EQUAL(AUDIO_BUFFER_FRAMES,
+                      format_decoder_read_s16(decoder, actual, AUDIO_BUFFER_FRAMES));
+    TEST_ASSERT_EQUAL_MEMORY(expected, actual, sizeof(expected));
+    format_decoder_destroy(decoder);
+    format_decoder_destroy(reference);
+#else
+    TEST_IGNORE_MESSAGE("NUNO_DEFAULT_LIBRARY_PATH not set");
+#endif
+}
+
+void test_read_ahead_window_decodes_like_the_file(void) {
+#ifdef TEST_MP3_PATH
+    // Arrange: reference blocks far apart, so each seek leaves the window.
+    static int16_t expected[2][AUDIO_BUFFER_SIZE];
+    static int16_t actual[AUDIO_BUFFER_SIZE];
+    const size_t targets[2] = { 60U * 48000U + 99U, 5U * 48000U };
+    FormatDecoder *reference = open_test_mp3();
+    for (size_t i = 0; i < 2U; i++) {
+        format_decoder_seek(reference, targets[i]);
+        TEST_ASSERT_EQUAL(AUDIO_BUFFER_FRAMES,
+                          format_decoder_read_s16(reference, expected[i], AUDIO_BUFFER_FRAMES));
+    }
+
+    // Act: the smallest window, refilled inline (no I/O thread registered).
+    ReadAhead_SetWindowBytes(READ_AHEAD_MIN_WINDOW);
+    FormatDecoder *decoder = open_test_mp3();
+    ReadAhead_SetWindowBytes(0U);
+
+    // Assert
+    for (size_t i = 0; i < 2U; i++) {
+        format_decoder_seek(decoder, targets[i]);
+        TEST_ASSERT_EQUAL(AUDIO_BUFFER_FRAMES,
+                          format_decoder_read_s16(decoder, actual, AUDIO_BUFFER_FRAMES));
+        TEST_ASSERT_EQUAL_MEMORY(expected[i], actual, sizeof(actual));
+    }
+    format_decoder_destroy(decoder);
+    format_decoder_destroy(reference);
+#else
+    TEST_IGNORE_MESSAGE("NUNO_DEFAULT_LIBRARY_PATH not set");
+#endif
+}
+
+void test_read_ahead_sleeps_until_the_low_watermark(void) {
+#ifdef TEST_MP3_PATH
+    // Arrange: 128 KiB window, refill below 64 KiB. Opening fills it in one
+    // burst up to the history kept behind the reader (window / 8).
+    static uint8_t bytes[50U * 1024U];
+    const size_t window = READ_AHEAD_MIN_WINDOW;
+    ReadAhead_SetWindowBytes(window);
+    ReadAhead_SetLowWatermarkPercent(50U);
+    ReadAhead_SetStorageHooks(NULL);
+    ReadAhead_ResetStats();
+    ByteSource source;
+    TEST_ASSERT_TRUE(ByteSource_OpenReadAhead(&source, TEST_MP3_PATH));
+    ReadAhead_SetWindowBytes(0U);
+    ReadAheadStats stats;
+    ReadAhead_GetStats(&stats);
+    TEST_ASSERT_EQUAL_UINT32(1U, stats.bursts);
+    TEST_ASSERT_EQUAL_UINT32(window - window / 8U, stats.last_burst_bytes);
+
+    // Act / Assert: storage stays idle while the window holds 64 KiB or more...
+    TEST_ASSERT_EQUAL(40U * 1024U, ByteSource_Read(&source, bytes, 40U * 1024U));
+    ReadAhead_GetStats(&stats);
+    TEST_ASSERT_EQUAL_UINT32(1U, stats.bursts);
+
+    // ...and the read that drops below it refills everything it consumed.
+    TEST_ASSERT_EQUAL(10U * 1024U, ByteSource_Read(&source, bytes, 10U * 1024U));
+    ReadAhead_GetStats(&stats);
+    TEST_ASSERT_EQUAL_UINT32(2U, stats.bursts);
+    TEST_ASSERT_EQUAL_UINT32(50U * 1024U, stats.last_burst_bytes);
+    TEST_ASSERT_EQUAL_UINT32(0U, stats.stalls);
+    ByteSource_Close(&source);
+#else
+    TEST_IGNORE_MESSAGE("NUNO_DEFAULT_LIBRARY_PATH not set");
+#endif
+}
+
+void test_unsupported_ratio_is_rejected(void) {
+    TEST_ASSERT_TRUE(AudioBuffer_InitWithDepth(AUDIO_BUFFER_MIN_BLOCKS));
+    TEST_ASSERT_FALSE(AudioBuffer_ConfigureSampleRate(44101U, 48000U));
+    TEST_ASSERT_TRUE(AudioBuffer_ConfigureSampleRate(48000U, 48000U));
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_init_rejects_out_of_range_depth);
+    RUN_TEST(test_start_playback_primes_whole_ring);
+    RUN_TEST(test_inline_fill_delivers_blocks_in_order);
+    RUN_TEST(test_decoupled_consumer_starves_then_recovers);
+    RUN_TEST(test_track_position_counts_played_blocks_only);
+    RUN_TEST(test_ring_drains_to_end_of_stream);
+    RUN_TEST(test_ping_pong_refills_the_half_that_drained);
+    RUN_TEST(test_late_ping_pong_producer_skips_the_playing_half);
+    RUN_TEST(test_s16_source_at_unity_gain_is_copied_bit_exact);
+    RUN_TEST(test_s16_source_below_unity_gain_uses_q15);
+    RUN_TEST(test_mismatched_source_rate_is_resampled_to_the_output_clock);
+    RUN_TEST(test_unsupported_ratio_is_rejected);
+    RUN_TEST(test_crossfade_tail_is_sized_from_the_fade_and_the_region);
+    RUN_TEST(test_armed_crossfade_keeps_the_s16_fast_path);
+    RUN_TEST(test_next_track_is_preopened_and_swapped_in_at_eof);
+    RUN_TEST(test_track_changes_reuse_pooled_decoders_without_heap_calls);
+    RUN_TEST(test_mp3_seek_is_sample_exact);
+    RUN_TEST(test_seek_index_is_cached_across_opens);
+    RUN_TEST(test_memory_source_decodes_like_the_file);
+    RUN_TEST(test_read_ahead_window_decodes_like_the_file);
+    RUN_TEST(test_read_ahead_sleeps_until_the_low_watermark);
+
+    return UNITY_END();
+}
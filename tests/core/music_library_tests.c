@@ -0,0 +1,786 @@
+#define _POSIX_C_SOURCE 200809L  // mkdtemp, mkstemp, strdup, truncate
+
+#include <unity.h>
+#include "nuno/filesystem.h"
+#include "nuno/library_scanner.h"
+#include "nuno/music_catalog.h"
+#include "nuno/music_library.h"
+#include "nuno/tag_reader.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*
+ * Music catalog, library database, tag reader and scanner tests. The scanner and
+ * database tests work under /tmp; the bundled-library test only runs when the
+ * build points NUNO_DEFAULT_LIBRARY_PATH at assets/music.
+ */
+
+bool FileSystem_OpenFile(const char *filename) {
+    (void)filename;
+    return true;
+}
+
+static char tree_root[64];
+
+static void write_file(const char *relative, const void *data, size_t size) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", tree_root, relative);
+    FILE *file = fopen(path, "wb");
+    TEST_ASSERT_NOT_NULL(file);
+    fwrite(data, 1, size, file);
+    fclose(file);
+}
+
+static void make_dir(const char *relative) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", tree_root, relative);
+    TEST_ASSERT_EQUAL_INT(0, mkdir(path, 0755));
+}
+
+/* Backdates everything in the tree, so that a change made in the same second
+ * as the scan still moves an mtime. */
+static void age_tree(void) {
+    char command[160];
+    snprintf(command, sizeof(command), "find '%s' -exec touch -d @1000000000 {} +", tree_root);
+    TEST_ASSERT_EQUAL_INT(0, system(command));
+}
+
+static void remove_path(const char *relative) {
+    char path[256];
+    snprintf(path, sizeof(path), "%s/%s", tree_root, relative);
+    TEST_ASSERT_EQUAL_INT(0, remove(path));
+}
+
+static void remove_tree(void) {
+    char command[128];
+    snprintf(command, sizeof(command), "rm -rf '%s'", tree_root);
+    TEST_ASSERT_EQUAL_INT(0, system(command));
+}
+
+void setUp(void) {
+    MusicCatalog_Clear();
+}
+
+void tearDown(void) {
+    MusicCatalog_Clear();
+}
+
+static void test_catalog_copies_and_interns_names(void) {
+    char title[16] = "Song";
+    MusicLibraryTrack track = {
+        .title = title, .album = "Album", .artist = "Artist", .filename = "a.mp3",
+    };
+    TEST_ASSERT_TRUE(MusicCatalog_AddTrack(&track));
+    strcpy(title, "Other");
+    track.filename = "b.mp3";
+    TEST_ASSERT_TRUE(MusicCatalog_AddTrack(&track));
+    track.album = NULL;
+    TEST_ASSERT_TRUE(MusicCatalog_AddTrack(&track));
+
+    TEST_ASSERT_EQUAL_size_t(3U, MusicCatalog_GetCount());
+    MusicLibraryTrack first;
+    MusicLibraryTrack second;
+    TEST_ASSERT_TRUE(MusicCatalog_GetTrack(0U, &first));
+    TEST_ASSERT_TRUE(MusicCatalog_GetTrack(1U, &second));
+    TEST_ASSERT_EQUAL_STRING("Song", first.title);
+    TEST_ASSERT_EQUAL_STRING("Other", second.title);
+    TEST_ASSERT_EQUAL_STRING("b.mp3", second.filename);
+    // One copy of each album and artist name
+    TEST_ASSERT_EQUAL_PTR(first.album, second.album);
+    TEST_ASSERT_EQUAL_PTR(first.artist, second.artist);
+    TEST_ASSERT_TRUE(MusicCatalog_GetTrack(2U, &track));
+    TEST_ASSERT_EQUAL_STRING("", track.album);
+    TEST_ASSERT_FALSE(MusicCatalog_GetTrack(3U, &track));
+
+    // Records are fixed-width and repeated strings are stored once
+    size_t before = MusicCatalog_GetMemoryUsage();
+    track.title = "Other";
+    track.album = "Album";
+    for (int i = 0; i < 1000; i++) {
+        TEST_ASSERT_TRUE(MusicCatalog_AddTrack(&track));
+    }
+    TEST_ASSERT_TRUE(MusicCatalog_GetMemoryUsage() - before <= 1024U * sizeof(MusicCatalogRecord));
+    TEST_ASSERT_TRUE(MusicCatalog_GetTrack(1002U, &track));
+    TEST_ASSERT_EQUAL_STRING("Other", track.title);
+    TEST_ASSERT_TRUE(MusicCatalog_GetTrack(0U, &track));
+    TEST_ASSERT_EQUAL_STRING("Song", track.title);
+}
+
+static void test_database_round_trips_and_checks_its_root(void) {
+    char path[] = "/tmp/nuno-db-XXXXXX";
+    int fd = mkstemp(path);
+    TEST_ASSERT_TRUE(fd >= 0);
+    close(fd);
+
+    MusicLibraryTrack track = {
+        .title = "One", .album = "Album", .artist = "Artist", .filename = "a/1.mp3",
+        .duration_seconds = 61U,
+    };
+    TEST_ASSERT_TRUE(MusicCatalog_AddTrack(&track));
+    track.title = "Two";
+    track.filename = "a/2.flac";
+    TEST_ASSERT_TRUE(MusicCatalog_AddTrack(&track));
+    TEST_ASSERT_TRUE(MusicCatalog_Save(path, "/music"));
+    MusicCatalog_Clear();
+
+    TEST_ASSERT_FALSE(MusicCatalog_Load(path, "/elsewhere"));
+    TEST_ASSERT_EQUAL_size_t(0U, MusicCatalog_GetCount());
+    TEST_ASSERT_TRUE(MusicCatalog_Load(path, "/music"));
+    TEST_ASSERT_EQUAL_size_t(2U, MusicCatalog_GetCount());
+    MusicLibraryTrack loaded;
+    TEST_ASSERT_TRUE(MusicCatalog_GetTrack(1U, &loaded));
+    TEST_ASSERT_EQUAL_STRING("Two", loaded.title);
+    TEST_ASSERT_EQUAL_STRING("Album", loaded.album);
+    TEST_ASSERT_EQUAL_STRING("Artist", loaded.artist);
+    TEST_ASSERT_EQUAL_STRING("a/2.flac", loaded.filename);
+    TEST_ASSERT_EQUAL_UINT32(61U, loaded.duration_seconds);
+
+    // A loaded catalog takes further tracks and keeps sharing its strings
+    track.title = "Three";
+    TEST_ASSERT_TRUE(MusicCatalog_AddTrack(&track));
+    MusicLibraryTrack first;
+    TEST_ASSERT_TRUE(MusicCatalog_GetTrack(0U, &first));
+    TEST_ASSERT_TRUE(MusicCatalog_GetTrack(2U, &loaded));
+    TEST_ASSERT_EQUAL_STRING("One", first.title);
+    TEST_ASSERT_EQUAL_STRING("Three", loaded.title);
+    TEST_ASSERT_EQUAL_PTR(first.album, loaded.album);
+
+    // A truncated file is refused
+    TEST_ASSERT_EQUAL_INT(0, truncate(path, 40));
+    TEST_ASSERT_FALSE(MusicCatalog_Load(path, "/music"));
+    remove(path);
+}
+
+static void add(const char *title, const char *album, const char *artist, uint16_t track_number) {
+    MusicLibraryTrack track = {
+        .title = title, .album = album, .artist = artist, .filename = title,
+        .track_number = track_number,
+    };
+    TEST_ASSERT_TRUE(MusicCatalog_AddTrack(&track));
+}
+
+static const char *title_of(uint32_t index) {
+    MusicLibraryTrack track;
+    return MusicCatalog_GetTrack(index, &track) ? track.title : NULL;
+}
+
+static void check_browse_index(void) {
+    // Artists case-folded: "abba" before "Zappa"
+    TEST_ASSERT_EQUAL_size_t(2U, MusicCatalog_GetArtistCount());
+    uint32_t albums = 0U;
+    uint32_t tracks = 0U;
+    TEST_ASSERT_EQUAL_STRING("abba", MusicCatalog_GetArtistName(0U, &albums, &tracks));
+    TEST_ASSERT_EQUAL_UINT32(2U, albums);
+    TEST_ASSERT_EQUAL_UINT32(3U, tracks);
+    TEST_ASSERT_EQUAL_STRING("Zappa", MusicCatalog_GetArtistName(1U, NULL, NULL));
+    TEST_ASSERT_NULL(MusicCatalog_GetArtistName(2U, NULL, NULL));
+
+    // Artist -> albums by name -> tracks by number
+    uint32_t album = MusicCatalog_ArtistAlbumAt(0U, 0U);
+    uint32_t artist = MUSIC_CATALOG_NONE;
+    TEST_ASSERT_EQUAL_STRING("Arrival", MusicCatalog_GetAlbumName(album, &artist, &tracks));
+    TEST_ASSERT_EQUAL_UINT32(0U, artist);
+    TEST_ASSERT_EQUAL_UINT32(2U, tracks);
+    TEST_ASSERT_EQUAL_STRING("Dancing Queen", title_of(MusicCatalog_AlbumTrackAt(album, 0U)));
+    TEST_ASSERT_EQUAL_STRING("Money", title_of(MusicCatalog_AlbumTrackAt(album, 1U)));
+    TEST_ASSERT_EQUAL_UINT32(MUSIC_CATALOG_NONE, MusicCatalog_AlbumTrackAt(album, 2U));
+    TEST_ASSERT_EQUAL_STRING("Waterloo",
+                             MusicCatalog_GetAlbumName(MusicCatalog_ArtistAlbumAt(0U, 1U), NULL, NULL));
+    TEST_ASSERT_EQUAL_UINT32(MUSIC_CATALOG_NONE, MusicCatalog_ArtistAlbumAt(0U, 2U));
+
+    // Albums list by album name, whoever the artist
+    TEST_ASSERT_EQUAL_size_t(3U, MusicCatalog_GetAlbumCount());
+    TEST_ASSERT_EQUAL_STRING("Apostrophe", MusicCatalog_GetAlbumName(MusicCatalog_AlbumAt(0U), NULL, NULL));
+    TEST_ASSERT_EQUAL_STRING("Arrival", MusicCatalog_GetAlbumName(MusicCatalog_AlbumAt(1U), NULL, NULL));
+    TEST_ASSERT_EQUAL_STRING("Waterloo", MusicCatalog_GetAlbumName(MusicCatalog_AlbumAt(2U), NULL, NULL));
+
+    // Songs by title, and prefix lookups by binary search
+    TEST_ASSERT_EQUAL_STRING("cosmik Debris", title_of(MusicCatalog_SongAt(0U)));
+    TEST_ASSERT_EQUAL_STRING("Dancing Queen", title_of(MusicCatalog_SongAt(1U)));
+    TEST_ASSERT_EQUAL_STRING("Waterloo", title_of(MusicCatalog_SongAt(3U)));
+    TEST_ASSERT_EQUAL_UINT32(MUSIC_CATALOG_NONE, MusicCatalog_SongAt(4U));
+    TEST_ASSERT_EQUAL_size_t(1U, MusicCatalog_FindSong("d"));
+    TEST_ASSERT_EQUAL_size_t(2U, MusicCatalog_FindSong("MON"));
+    TEST_ASSERT_EQUAL_size_t(4U, MusicCatalog_FindSong("x"));
+    TEST_ASSERT_EQUAL_size_t(1U, MusicCatalog_FindArtist("z"));
+    TEST_ASSERT_EQUAL_size_t(2U, MusicCatalog_FindAlbum("W"));
+}
+
+static void test_browse_index_sorts_and_survives_the_database(void) {
+    add("Waterloo", "Waterloo", "abba", 1U);
+    add("cosmik Debris", "Apostrophe", "Zappa", 5U);
+    add("Money", "Arrival", "abba", 2U);
+    add("Dancing Queen", "Arrival", "abba", 1U);
+    TEST_ASSERT_FALSE(MusicCatalog_HasIndex());
+    TEST_ASSERT_EQUAL_size_t(0U, MusicCatalog_GetArtistCount());
+    TEST_ASSERT_TRUE(MusicCatalog_BuildIndex());
+    check_browse_index();
+
+    char path[] = "/tmp/nuno-index-XXXXXX";
+    int fd = mkstemp(path);
+    TEST_ASSERT_TRUE(fd >= 0);
+    close(fd);
+    TEST_ASSERT_TRUE(MusicCatalog_Save(path, "/music"));
+    TEST_ASSERT_TRUE(MusicCatalog_Load(path, "/music"));
+    remove(path);
+    TEST_ASSERT_TRUE(MusicCatalog_HasIndex());
+    check_browse_index();
+
+    // Adding a track drops the index until it is rebuilt
+    add("Peaches en Regalia", "Hot Rats", "Zappa", 1U);
+    TEST_ASSERT_FALSE(MusicCatalog_HasIndex());
+    TEST_ASSERT_TRUE(MusicCatalog_BuildIndex());
+    TEST_ASSERT_EQUAL_size_t(4U, MusicCatalog_GetAlbumCount());
+    TEST_ASSERT_EQUAL_STRING("Hot Rats", MusicCatalog_GetAlbumName(MusicCatalog_AlbumAt(2U), NULL, NULL));
+}
+
+/* Writes an ID3v2.3 frame at 'p'; returns its size. */
+static size_t id3_frame(uint8_t *p, const char *id, const void *body, size_t size) {
+    memcpy(p, id, 4);
+    p[4] = (uint8_t)(size >> 24);
+    p[5] = (uint8_t)(size >> 16);
+    p[6] = (uint8_t)(size >> 8);
+    p[7] = (uint8_t)size;
+    p[8] = 0;
+    p[9] = 0;
+    memcpy(p + 10, body, size);
+    return 10U + size;
+}
+
+/* ID3v2.3 header for a tag whose frames (and padding) end at 'end'. */
+static void id3_header(uint8_t *p, size_t end) {
+    size_t body = end - 10U;
+    const uint8_t header[10] = { 'I', 'D', '3', 3, 0, 0, (uint8_t)((body >> 21) & 0x7FU),
+                                 (uint8_t)((body >> 14) & 0x7FU), (uint8_t)((body >> 7) & 0x7FU),
+                                 (uint8_t)(body & 0x7FU) };
+    memcpy(p, header, sizeof(header));
+}
+
+/* MPEG-1 layer III, 128 kbit/s, 44.1 kHz, stereo: 417-byte frames of 1152
+ * samples. A nonzero 'xing_frames' adds a Xing header with that count. */
+static size_t mp3_frame(uint8_t *p, uint32_t xing_frames) {
+    static const uint8_t header[4] = { 0xFF, 0xFB, 0x90, 0x64 };
+    memset(p, 0, 417U);
+    memcpy(p, header, sizeof(header));
+    if (xing_frames) {
+        static const uint8_t xing[8] = { 'X', 'i', 'n', 'g', 0, 0, 0, 1 };
+        memcpy(p + 36, xing, sizeof(xing));
+        p[44] = (uint8_t)(xing_frames >> 24);
+        p[45] = (uint8_t)(xing_frames >> 16);
+        p[46] = (uint8_t)(xing_frames >> 8);
+        p[47] = (uint8_t)xing_frames;
+    }
+    return 417U;
+}
+
+static void test_tag_reader_reads_id3v2_and_the_first_frame(void) {
+    static uint8_t file[2048];
+    static const uint8_t utf16_artist[] = { 1, 0xFF, 0xFE, 'B', 0, 'a', 0, 'n', 0, 'd', 0 };
+    size_t n = 10U;
+    n += id3_frame(file + n, "TIT2", "\0Caf\xE9", 5U);
+    n += id3_frame(file + n, "TPE1", utf16_artist, sizeof(utf16_artist));
+    n += id3_frame(file + n, "TALB", "\3Album \xC3\xA9t\xC3\xA9", 13U);
+    n += id3_frame(file + n, "TRCK", "\0" "3/12", 5U);
+    n += id3_frame(file + n, "TPOS", "\0" "2", 2U);
+    memset(file + n, 0, 20U);  // padding
+    n += 20U;
+    id3_header(file, n);
+    size_t audio = n;
+    n += mp3_frame(file + n, 1000U);
+    n += mp3_frame(file + n, 0U);
+
+    TrackTags tags;
+    TEST_ASSERT_TRUE(TagReader_Parse(file, n, n, &tags));
+    TEST_ASSERT_EQUAL_INT(AUDIO_FORMAT_MP3, tags.format);
+    TEST_ASSERT_EQUAL_STRING("Caf\xC3\xA9", tags.title);
+    TEST_ASSERT_EQUAL_STRING("Band", tags.artist);
+    TEST_ASSERT_EQUAL_STRING("Album \xC3\xA9t\xC3\xA9", tags.album);
+    TEST_ASSERT_EQUAL_UINT16(3U, tags.track_number);
+    TEST_ASSERT_EQUAL_UINT16(2U, tags.disc_number);
+    TEST_ASSERT_EQUAL_UINT32(44100U, tags.sample_rate);
+    TEST_ASSERT_EQUAL_UINT8(2U, tags.channels);
+    TEST_ASSERT_EQUAL_UINT32(26U, tags.duration_seconds);  // 1000 frames of 1152
+    TEST_ASSERT_FALSE(tags.duration_estimated);
+
+    // Without a Xing header: estimated from the size, 160000 bytes at 128 kbit/s
+    mp3_frame(file + audio, 0U);
+    TEST_ASSERT_TRUE(TagReader_Parse(file, n, audio + 160000U, &tags));
+    TEST_ASSERT_EQUAL_UINT32(10U, tags.duration_seconds);
+    TEST_ASSERT_TRUE(tags.duration_estimated);
+
+    // A tag followed by text is not audio
+    memset(file + audio, 'x', n - audio);
+    TEST_ASSERT_FALSE(TagReader_Parse(file, n, n, &tags));
+}
+
+static void put_le32(uint8_t *p, uint32_t value) {
+    for (size_t i = 0; i < 4U; i++) {
+        p[i] = (uint8_t)(value >> (8U * i));
+    }
+}
+
+static void test_tag_reader_reads_flac_streaminfo_and_comments(void) {
+    static const char *const comments[] = { "title=Song", "ARTIST=Band", "TrackNumber=07",
+                                            "ALBUM" };
+    uint8_t file[256];
+    memcpy(file, "fLaC", 4);
+    const uint8_t streaminfo_header[4] = { 0, 0, 0, 34 };
+    memcpy(file + 4, streaminfo_header, 4);
+    uint8_t *info = file + 8;
+    memset(info, 0, 34U);
+    // 44100 Hz, 2 channels, 16 bits, 441000 samples
+    const uint8_t fields[8] = { 0x0A, 0xC4, 0x42, 0xF0, 0x00, 0x06, 0xBA, 0xA8 };
+    memcpy(info + 10, fields, sizeof(fields));
+
+    size_t n = 8U + 34U + 4U;
+    put_le32(file + n, 1U);
+    file[n + 4] = 'x';
+    put_le32(file + n + 5, 4U);
+    n += 9U;
+    for (size_t i = 0; i < 4U; i++) {
+        size_t length = strlen(comments[i]);
+        put_le32(file + n, (uint32_t)length);
+        memcpy(file + n + 4, comments[i], length);
+        n += 4U + length;
+    }
+    size_t block = n - (8U + 34U + 4U);
+    const uint8_t comment_header[4] = { 0x84, 0, 0, (uint8_t)block };  // last block
+    memcpy(file + 8 + 34, comment_header, 4);
+
+    TrackTags tags;
+    TEST_ASSERT_TRUE(TagReader_Parse(file, n, n, &tags));
+    TEST_ASSERT_EQUAL_INT(AUDIO_FORMAT_FLAC, tags.format);
+    TEST_ASSERT_EQUAL_UINT32(44100U, tags.sample_rate);
+    TEST_ASSERT_EQUAL_UINT8(2U, tags.channels);
+    TEST_ASSERT_EQUAL_UINT32(10U, tags.duration_seconds);
+    TEST_ASSERT_EQUAL_STRING("Song", tags.title);
+    TEST_ASSERT_EQUAL_STRING("Band", tags.artist);
+    TEST_ASSERT_EQUAL_STRING("", tags.album);
+    TEST_ASSERT_EQUAL_UINT16(7U, tags.track_number);
+}
+
+static void test_tag_reader_reads_past_cover_art_within_its_budget(void) {
+    enum { ART_BYTES = 30000 };
+    uint8_t *file = (uint8_t *)calloc(1U, ART_BYTES + 2048U);
+    uint8_t *art = (uint8_t *)calloc(1U, ART_BYTES);
+    uint8_t *buffer = (uint8_t *)malloc(TAG_READER_BUDGET_BYTES);
+    TEST_ASSERT_NOT_NULL(file);
+    TEST_ASSERT_NOT_NULL(art);
+    TEST_ASSERT_NOT_NULL(buffer);
+    size_t n = 10U;
+    n += id3_frame(file + n, "TIT2", "\0Song", 5U);
+    n += id3_frame(file + n, "APIC", art, ART_BYTES);
+    id3_header(file, n);
+    n += mp3_frame(file + n, 500U);
+    n += mp3_frame(file + n, 0U);
+
+    // The tag alone outgrows the first read
+    TrackTags tags;
+    TEST_ASSERT_FALSE(TagReader_Parse(file, TAG_READER_BUDGET_BYTES, n, &tags));
+
+    char path[] = "/tmp/nuno-tags-XXXXXX";
+    int fd = mkstemp(path);
+    TEST_ASSERT_TRUE(fd >= 0);
+    TEST_ASSERT_EQUAL_INT((int)n, (int)write(fd, file, n));
+    close(fd);
+    bool read = TagReader_ReadFile(path, buffer, TAG_READER_BUDGET_BYTES, &tags);
+    remove(path);
+    free(file);
+    free(art);
+    free(buffer);
+    TEST_ASSERT_TRUE(read);
+    TEST_ASSERT_EQUAL_STRING("Song", tags.title);
+    TEST_ASSERT_EQUAL_UINT32(13U, tags.duration_seconds);  // 500 frames of 1152
+    TEST_ASSERT_EQUAL_UINT32(TAG_READER_BUDGET_BYTES + 834U, tags.bytes_read);
+}
+
+static void test_scan_names_tracks_and_skips_non_audio(void) {
+    strcpy(tree_root, "/tmp/nuno-scan-XXXXXX");
+    TEST_ASSERT_NOT_NULL(mkdtemp(tree_root));
+
+    static const uint8_t mp3[] = { 0xFF, 0xFB, 0x94, 0x64, 0, 0, 0, 0 };
+    static const uint8_t flac[] = { 'f', 'L', 'a', 'C', 0, 0, 0, 0x22 };
+    // ID3v2 tag of 20 bytes whose body holds a false sync, then the frame
+    static const uint8_t id3_mp3[] = { 'I', 'D', '3', 4, 0, 0, 0, 0, 0, 20,
+                                       0xFF, 0xE0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                       0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+                                       0xFF, 0xFB, 0x94, 0x64 };
+    static const uint8_t id3_text[] = { 'I', 'D', '3', 4, 0, 0, 0, 0, 0, 4,
+                                        0xFF, 0xE0, 0, 0, 't', 'e', 'x', 't' };
+    make_dir("Some_Artist");
+    make_dir("Some_Artist/Album");
+    make_dir(".hidden");
+    write_file("Some_Artist/Album/02 Second.MP3", mp3, sizeof(mp3));
+    write_file("Some_Artist/Album/01_First.flac", flac, sizeof(flac));
+    write_file("Some_Artist/Album/cover.jpg", mp3, sizeof(mp3));
+    write_file("Some_Artist/Album/notes.mp3", "not audio", 9U);
+    write_file("Some_Artist/Album/tagged.mp3", id3_mp3, sizeof(id3_mp3));
+    write_file("Some_Artist/Album/tag_only.mp3", id3_text, sizeof(id3_text));
+    write_file("Loose_-_Single_-_7 Track.mp3", mp3, sizeof(mp3));
+    write_file(".hidden/ignored.mp3", mp3, sizeof(mp3));
+
+    LibraryScanStats stats;
+    bool scanned = LibraryScanner_Scan(tree_root, &stats);
+    remove_tree();
+    TEST_ASSERT_TRUE(scanned);
+    TEST_ASSERT_EQUAL_UINT32(3U, stats.directories);
+    TEST_ASSERT_EQUAL_UINT32(7U, stats.files);
+    TEST_ASSERT_EQUAL_UINT32(4U, stats.tracks);
+    TEST_ASSERT_EQUAL_UINT32(2U, stats.rejected);
+    TEST_ASSERT_EQUAL_size_t(4U, MusicCatalog_GetCount());
+
+    // Name order within each directory; names from the file or its directories
+    MusicLibraryTrack track;
+    TEST_ASSERT_TRUE(MusicCatalog_GetTrack(0U, &track));
+    TEST_ASSERT_EQUAL_STRING("Loose_-_Single_-_7 Track.mp3", track.filename);
+    TEST_ASSERT_EQUAL_STRING("Track", track.title);
+    TEST_ASSERT_EQUAL_STRING("Single", track.album);
+    TEST_ASSERT_EQUAL_STRING("Loose", track.artist);
+
+    TEST_ASSERT_TRUE(MusicCatalog_GetTrack(1U, &track));
+    TEST_ASSERT_EQUAL_STRING("Some_Artist/Album/01_First.flac", track.filename);
+    TEST_ASSERT_EQUAL_STRING("First", track.title);
+    TEST_ASSERT_EQUAL_STRING("Album", track.album);
+    TEST_ASSERT_EQUAL_STRING("Some Artist", track.artist);
+
+    TEST_ASSERT_EQUAL_UINT16(1U, track.track_number);
+
+    MusicLibraryTrack other;
+    TEST_ASSERT_TRUE(MusicCatalog_GetTrack(2U, &other));
+    TEST_ASSERT_EQUAL_STRING("Second", other.title);
+    TEST_ASSERT_EQUAL_UINT16(2U, other.track_number);
+    TEST_ASSERT_TRUE(MusicCatalog_GetTrack(3U, &other));
+    TEST_ASSERT_EQUAL_STRING("tagged", other.title);
+    TEST_ASSERT_EQUAL_PTR(track.album, other.album);
+}
+
+static void test_parallel_scan_matches_a_serial_one(void) {
+    strcpy(tree_root, "/tmp/nuno-scan-XXXXXX");
+    TEST_ASSERT_NOT_NULL(mkdtemp(tree_root));
+    static const uint8_t mp3[] = { 0xFF, 0xFB, 0x94, 0x64, 0, 0, 0, 0 };
+    char name[64];
+    // Enough entries per directory for several batches, names that sort
+    // across the directory boundary ("A" before "A b", "A/z" before "A b")
+    make_dir("A");
+    make_dir("A/Deep");
+    for (unsigned i = 0; i < 150U; i++) {
+        snprintf(name, sizeof(name), "A/%03u.mp3", i);
+        write_file(name, mp3, sizeof(mp3));
+        snprintf(name, sizeof(name), "A/Deep/%03u.mp3", i);
+        write_file(name, mp3, sizeof(mp3));
+    }
+    write_file("A/z.mp3", mp3, sizeof(mp3));
+    write_file("A b.mp3", mp3, sizeof(mp3));
+    write_file("0.mp3", mp3, sizeof(mp3));
+
+    LibraryScanStats serial;
+    LibraryScanStats parallel;
+    LibraryScanner_SetThreadCount(1U);
+    TEST_ASSERT_TRUE(LibraryScanner_Scan(tree_root, &serial));
+    size_t count = MusicCatalog_GetCount();
+    char **filenames = (char **)calloc(count, sizeof(*filenames));
+    TEST_ASSERT_NOT_NULL(filenames);
+    for (size_t i = 0; i < count; i++) {
+        MusicLibraryTrack track;
+        TEST_ASSERT_TRUE(MusicCatalog_GetTrack(i, &track));
+        filenames[i] = strdup(track.filename);
+    }
+
+    LibraryScanner_SetThreadCount(4U);
+    bool scanned = LibraryScanner_Scan(tree_root, &parallel);
+    LibraryScanner_SetThreadCount(0U);
+    remove_tree();
+    TEST_ASSERT_TRUE(scanned);
+    TEST_ASSERT_EQUAL_UINT32(1U, serial.threads);
+    TEST_ASSERT_EQUAL_UINT32(4U, parallel.threads);
+    TEST_ASSERT_EQUAL_UINT32(serial.directories, parallel.directories);
+    TEST_ASSERT_EQUAL_UINT32(serial.files, parallel.files);
+    TEST_ASSERT_EQUAL_UINT32(303U, parallel.tracks);
+    TEST_ASSERT_EQUAL_size_t(count, MusicCatalog_GetCount());
+    for (size_t i = 0; i < count; i++) {
+        MusicLibraryTrack track;
+        TEST_ASSERT_TRUE(MusicCatalog_GetTrack(i, &track));
+        TEST_ASSERT_EQUAL_STRING(filenames[i], track.filename);
+        free(filenames[i]);
+    }
+    free(filenames);
+    MusicLibraryTrack track;
+    TEST_ASSERT_TRUE(MusicCatalog_GetTrack(0U, &track));
+    TEST_ASSERT_EQUAL_STRING("0.mp3", track.filename);
+    TEST_ASSERT_TRUE(MusicCatalog_GetTrack(1U, &track));
+    TEST_ASSERT_EQUAL_STRING("A/000.mp3", track.filename);
+    TEST_ASSERT_TRUE(MusicCatalog_GetTrack(count - 2U, &track));
+    TEST_ASSERT_EQUAL_STRING("A/z.mp3", track.filename);
+    TEST_ASSERT_TRUE(MusicCatalog_GetTrack(count - 1U, &track));
+    TEST_ASSERT_EQUAL_STRING("A b.mp3", track.filename);
+}
+
+static void test_scan_of_a_missing_root_leaves_an_empty_catalog(void) {
+    MusicLibraryTrack track = { .title = "Stale", .filename = "stale.mp3" };
+    TEST_ASSERT_TRUE(MusicCatalog_AddTrack(&track));
+    TEST_ASSERT_FALSE(LibraryScanner_Scan("/nonexistent/nuno-library", NULL));
+    TEST_ASSERT_EQUAL_size_t(0U, MusicCatalog_GetCount());
+}
+
+static void test_rebuild_serves_the_old_tracks_until_it_ends(void) {
+    MusicLibraryTrack track = { .title = "Old", .album = "Album", .filename = "old.mp3" };
+    TEST_ASSERT_TRUE(MusicCatalog_AddTrack(&track));
+    track.filename = "old2.mp3";
+    TEST_ASSERT_TRUE(MusicCatalog_AddTrack(&track));
+    TEST_ASSERT_TRUE(MusicCatalog_BuildIndex());
+
+    TEST_ASSERT_TRUE(MusicCatalog_BeginRebuild());
+    TEST_ASSERT_FALSE(MusicCatalog_BeginRebuild());
+    track.title = "New";
+    track.filename = "new.mp3";
+    TEST_ASSERT_TRUE(MusicCatalog_AddTrack(&track));
+    MusicLibraryTrack seen;
+    TEST_ASSERT_EQUAL_size_t(2U, MusicCatalog_GetCount());
+    TEST_ASSERT_TRUE(MusicCatalog_GetTrack(1U, &seen));
+    TEST_ASSERT_EQUAL_STRING("old2.mp3", seen.filename);
+    MusicCatalog_AbortRebuild();
+    TEST_ASSERT_EQUAL_size_t(2U, MusicCatalog_GetCount());
+    TEST_ASSERT_EQUAL_size_t(1U, MusicCatalog_GetAlbumCount());
+
+    TEST_ASSERT_TRUE(MusicCatalog_BeginRebuild());
+    TEST_ASSERT_TRUE(MusicCatalog_AddTrack(&track));
+    TEST_ASSERT_TRUE(MusicCatalog_AddRemovedTrack());
+    TEST_ASSERT_TRUE(MusicCatalog_GetTrack(0U, &seen));
+    TEST_ASSERT_EQUAL_STRING("Old", seen.title);
+    MusicCatalog_EndRebuild();
+    TEST_ASSERT_EQUAL_size_t(2U, MusicCatalog_GetCount());
+    TEST_ASSERT_TRUE(MusicCatalog_GetTrack(0U, &seen));
+    TEST_ASSERT_EQUAL_STRING("New", seen.title);
+    TEST_ASSERT_FALSE(MusicCatalog_GetTrack(1U, &seen));
+    TEST_ASSERT_TRUE(MusicCatalog_IsRemoved(1U));
+
+    // The tombstone is in no list, and compaction drops it
+    TEST_ASSERT_TRUE(MusicCatalog_BuildIndex());
+    TEST_ASSERT_EQUAL_UINT32(0U, MusicCatalog_SongAt(0U));
+    TEST_ASSERT_EQUAL_UINT32(MUSIC_CATALOG_NONE, MusicCatalog_SongAt(1U));
+    size_t current = 1U;
+    TEST_ASSERT_TRUE(MusicCatalog_Compact(&current));
+    TEST_ASSERT_EQUAL_size_t(0U, current);
+    TEST_ASSERT_EQUAL_size_t(1U, MusicCatalog_GetCount());
+    TEST_ASSERT_EQUAL_size_t(0U, MusicCatalog_GetRemovedCount());
+}
+
+static void test_song_rows_follow_the_title_index(void) {
+    static const char *const titles[] = { "Beta", "alpha", "Gamma" };
+    char filename[16];
+    for (size_t i = 0; i < 3U; i++) {
+        snprintf(filename, sizeof(filename), "%zu.mp3", i);
+        MusicLibraryTrack track = { .title = titles[i], .album = "Album", .filename = filename };
+        TEST_ASSERT_TRUE(MusicCatalog_AddTrack(&track));
+    }
+
+    // Scan order until the index is built
+    TEST_ASSERT_EQUAL_size_t(3U, MusicLibrary_GetSongCount());
+    TEST_ASSERT_EQUAL_size_t(0U, MusicLibrary_SongAt(0U));
+    TEST_ASSERT_EQUAL_size_t(SIZE_MAX, MusicLibrary_SongAt(3U));
+
+    TEST_ASSERT_TRUE(MusicCatalog_BuildIndex());
+    TEST_ASSERT_EQUAL_size_t(1U, MusicLibrary_SongAt(0U));
+    TEST_ASSERT_EQUAL_size_t(0U, MusicLibrary_SongAt(1U));
+    TEST_ASSERT_EQUAL_size_t(2U, MusicLibrary_SongAt(2U));
+
+    // A tombstone is no row
+    TEST_ASSERT_TRUE(MusicCatalog_BeginRebuild());
+    MusicLibraryTrack track = { .title = "Beta", .album = "Album", .filename = "0.mp3" };
+    TEST_ASSERT_TRUE(MusicCatalog_AddTrack(&track));
+    TEST_ASSERT_TRUE(MusicCatalog_AddRemovedTrack());
+    MusicCatalog_EndRebuild();
+    TEST_ASSERT_TRUE(MusicCatalog_BuildIndex());
+    TEST_ASSERT_EQUAL_size_t(1U, MusicLibrary_GetSongCount());
+    TEST_ASSERT_EQUAL_size_t(0U, MusicLibrary_SongAt(0U));
+    TEST_ASSERT_EQUAL_size_t(SIZE_MAX, MusicLibrary_SongAt(1U));
+}
+
+/* Runs a refresh to the end a few stats at a time; returns the steps taken. */
+static unsigned run_refresh(LibraryRefreshProgress *progress) {
+    TEST_ASSERT_TRUE(LibraryScanner_BeginRefresh(tree_root));
+    unsigned steps = 1U;
+    while (LibraryScanner_RefreshStep(2U)) {
+        steps++;
+    }
+    LibraryScanner_GetRefreshProgress(progress);
+    TEST_ASSERT_EQUAL_INT(LIBRARY_REFRESH_DONE, progress->phase);
+    return steps;
+}
+
+static void test_refresh_reads_only_what_changed(void) {
+    strcpy(tree_root, "/tmp/nuno-refresh-XXXXXX");
+    TEST_ASSERT_NOT_NULL(mkdtemp(tree_root));
+    static const uint8_t mp3[] = { 0xFF, 0xFB, 0x94, 0x64, 0, 0, 0, 0 };
+    static const uint8_t longer_mp3[] = { 0xFF, 0xFB, 0x94, 0x64, 0, 0, 0, 0, 0, 0, 0, 0 };
+    make_dir("A");
+    make_dir("B");
+    write_file("A/01 One.mp3", mp3, sizeof(mp3));
+    write_file("A/02 Two.mp3", mp3, sizeof(mp3));
+    write_file("A/03 Three.mp3", mp3, sizeof(mp3));
+    write_file("B/x.mp3", mp3, sizeof(mp3));
+    age_tree();
+    TEST_ASSERT_TRUE(LibraryScanner_Scan(tree_root, NULL));
+    TEST_ASSERT_EQUAL_size_t(4U, MusicCatalog_GetCount());
+    TEST_ASSERT_EQUAL_size_t(3U, MusicCatalog_GetDirectoryCount());
+
+    // Nothing changed: every file stat'ed, no tag read, catalog untouched
+    LibraryRefreshProgress progress;
+    run_refresh(&progress);
+    TEST_ASSERT_EQUAL_UINT32(4U, progress.files);
+    TEST_ASSERT_EQUAL_UINT32(0U, progress.probes);
+    TEST_ASSERT_EQUAL_UINT32(0U, progress.listed);
+    TEST_ASSERT_FALSE(progress.committed);
+
+    // One removed, one rewritten, one added in a new directory
+    remove_path("A/02 Two.mp3");
+    write_file("A/03 Three.mp3", longer_mp3, sizeof(longer_mp3));
+    make_dir("C");
+    write_file("C/new.mp3", mp3, sizeof(mp3));
+    write_file("C/readme.mp3", "not audio", 9U);
+    unsigned steps = run_refresh(&progress);
+    TEST_ASSERT_TRUE(steps > 2U);
+    TEST_ASSERT_TRUE(progress.committed);
+    TEST_ASSERT_EQUAL_UINT32(3U, progress.probes);  // the rewrite and C's two files
+    TEST_ASSERT_EQUAL_UINT32(3U, progress.listed);  // the root, A and C
+    TEST_ASSERT_EQUAL_UINT32(1U, progress.added);
+    TEST_ASSERT_EQUAL_UINT32(1U, progress.updated);
+    TEST_ASSERT_EQUAL_UINT32(1U, progress.removed);
+    TEST_ASSERT_EQUAL_UINT32(1U, progress.rejected);
+
+    // Indices stay put: the removed track is a tombstone, the new one follows
+    MusicLibraryTrack track;
+    TEST_ASSERT_EQUAL_size_t(5U, MusicCatalog_GetCount());
+    TEST_ASSERT_EQUAL_size_t(1U, MusicCatalog_GetRemovedCount());
+    TEST_ASSERT_EQUAL_size_t(4U, MusicCatalog_GetDirectoryCount());
+    TEST_ASSERT_TRUE(MusicCatalog_GetTrack(0U, &track));
+    TEST_ASSERT_EQUAL_STRING("A/01 One.mp3", track.filename);
+    TEST_ASSERT_TRUE(MusicCatalog_IsRemoved(1U));
+    TEST_ASSERT_TRUE(MusicCatalog_GetTrack(2U, &track));
+    TEST_ASSERT_EQUAL_STRING("A/03 Three.mp3", track.filename);
+    TEST_ASSERT_EQUAL_UINT32(sizeof(longer_mp3), track.file_size);
+    TEST_ASSERT_TRUE(MusicCatalog_GetTrack(4U, &track));
+    TEST_ASSERT_EQUAL_STRING("C/new.mp3", track.filename);
+    TEST_ASSERT_EQUAL_UINT32(MUSIC_CATALOG_NONE, MusicCatalog_SongAt(4U));
+
+    // The journal and the tombstone survive the database, so the next
+    // refresh finds nothing to do
+    char path[] = "/tmp/nuno-db-XXXXXX";
+    int fd = mkstemp(path);
+    TEST_ASSERT_TRUE(fd >= 0);
+    close(fd);
+    TEST_ASSERT_TRUE(MusicCatalog_Save(path, tree_root));
+    TEST_ASSERT_TRUE(MusicCatalog_Load(path, tree_root));
+    remove(path);
+    TEST_ASSERT_EQUAL_size_t(1U, MusicCatalog_GetRemovedCount());
+    TEST_ASSERT_EQUAL_size_t(4U, MusicCatalog_GetDirectoryCount());
+    run_refresh(&progress);
+    TEST_ASSERT_EQUAL_UINT32(0U, progress.probes);
+    TEST_ASSERT_FALSE(progress.committed);
+
+    // A vanished directory takes its tracks without a stat each
+    remove_path("B/x.mp3");
+    remove_path("B");
+    run_refresh(&progress);
+    remove_tree();
+    TEST_ASSERT_EQUAL_UINT32(1U, progress.directories_removed);
+    TEST_ASSERT_EQUAL_UINT32(1U, progress.removed);
+    TEST_ASSERT_EQUAL_UINT32(0U, progress.probes);
+    TEST_ASSERT_TRUE(MusicCatalog_IsRemoved(3U));
+    TEST_ASSERT_EQUAL_size_t(3U, MusicCatalog_GetDirectoryCount());
+}
+
+static void test_refresh_leaves_compaction_to_the_next_start(void) {
+    strcpy(tree_root, "/tmp/nuno-compact-XXXXXX");
+    TEST_ASSERT_NOT_NULL(mkdtemp(tree_root));
+    static const uint8_t mp3[] = { 0xFF, 0xFB, 0x94, 0x64, 0, 0, 0, 0 };
+    make_dir("A");
+    write_file("A/01 One.mp3", mp3, sizeof(mp3));
+    write_file("A/02 Two.mp3", mp3, sizeof(mp3));
+    write_file("A/03 Three.mp3", mp3, sizeof(mp3));
+    write_file("A/04 Four.mp3", mp3, sizeof(mp3));
+    age_tree();
+    TEST_ASSERT_TRUE(MusicLibrary_Init(tree_root));
+    TEST_ASSERT_EQUAL_size_t(4U, MusicLibrary_GetTrackCount());
+    TEST_ASSERT_TRUE(MusicLibrary_SelectTrack(0U));
+
+    // A refresh while running keeps every index, so the playing track and
+    // its look-ahead stay valid; the walks and counts skip the tombstones
+    remove_path("A/02 Two.mp3");
+    remove_path("A/04 Four.mp3");
+    TEST_ASSERT_TRUE(MusicLibrary_StartRefresh(NULL, NULL));
+    while (MusicLibrary_RefreshStep()) {
+    }
+    TEST_ASSERT_EQUAL_size_t(4U, MusicLibrary_GetTrackCount());
+    TEST_ASSERT_TRUE(MusicCatalog_IsRemoved(1U));
+    TEST_ASSERT_TRUE(MusicCatalog_IsRemoved(3U));
+    TEST_ASSERT_EQUAL_size_t(0U, MusicLibrary_GetCurrentIndex());
+    TEST_ASSERT_EQUAL_size_t(2U, MusicLibrary_GetNextIndex());
+    TEST_ASSERT_EQUAL_size_t(1U, MusicLibrary_GetRemainingTracks());
+    TEST_ASSERT_FALSE(MusicLibrary_HasPreviousTrack());
+    TEST_ASSERT_TRUE(MusicLibrary_SelectTrack(2U));
+    TEST_ASSERT_EQUAL_size_t(SIZE_MAX, MusicLibrary_GetNextIndex());
+    TEST_ASSERT_FALSE(MusicLibrary_HasNextTrack());
+    TEST_ASSERT_EQUAL_size_t(0U, MusicLibrary_GetRemainingTracks());
+    TEST_ASSERT_TRUE(MusicLibrary_HasPreviousTrack());
+
+    // The next start, with nothing playing, compacts what the refresh saved
+    TEST_ASSERT_TRUE(MusicLibrary_Init(tree_root));
+    remove_tree();
+    remove(NUNO_LIBRARY_DB_PATH);
+    TEST_ASSERT_EQUAL_size_t(2U, MusicLibrary_GetTrackCount());
+    TEST_ASSERT_EQUAL_size_t(0U, MusicCatalog_GetRemovedCount());
+}
+
+#ifdef NUNO_DEFAULT_LIBRARY_PATH
+static void test_library_serves_the_bundled_tracks(void) {
+    TEST_ASSERT_TRUE(MusicLibrary_Init(NUNO_DEFAULT_LIBRARY_PATH));
+    TEST_ASSERT_TRUE(MusicLibrary_GetTrackCount() >= 2U);
+    MusicLibraryTrack track;
+    TEST_ASSERT_TRUE(MusicLibrary_GetTrack(0U, &track));
+    TEST_ASSERT_EQUAL_STRING("Kimiko Ishizaka", track.artist);
+    TEST_ASSERT_EQUAL_STRING("Open Goldberg Variations", track.album);
+    TEST_ASSERT_EQUAL_STRING("Variatio 1", track.title);
+    TEST_ASSERT_EQUAL_UINT16(2U, track.track_number);
+    TEST_ASSERT_TRUE(track.duration_seconds > 0U);  // from the Xing header
+    TEST_ASSERT_EQUAL_STRING(
+        "bach/open-goldberg-variations/Kimiko_Ishizaka_-_Open_Goldberg_Variations_-_02_Variatio_1.mp3",
+        track.filename);
+    TEST_ASSERT_TRUE(MusicLibrary_GetTrack(1U, &track));
+    TEST_ASSERT_EQUAL_STRING("Variatio 2", track.title);
+    TEST_ASSERT_FALSE(MusicLibrary_GetTrack(MusicLibrary_GetTrackCount(), &track));
+
+    // The scan left a database behind; the next start loads it instead
+    size_t count = MusicLibrary_GetTrackCount();
+    MusicCatalog_Clear();
+    TEST_ASSERT_TRUE(MusicCatalog_Load(NUNO_LIBRARY_DB_PATH, NUNO_DEFAULT_LIBRARY_PATH));
+    TEST_ASSERT_EQUAL_size_t(count, MusicCatalog_GetCount());
+}
+#endif
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_catalog_copies_and_interns_names);
+    RUN_TEST(test_database_round_trips_and_checks_its_root);
+    RUN_TEST(test_browse_index_sorts_and_survives_the_database);
+    RUN_TEST(test_tag_reader_reads_id3v2_and_the_first_frame);
+    RUN_TEST(test_tag_reader_reads_flac_streaminfo_and_comments);
+    RUN_TEST(test_tag_reader_reads_past_cover_art_within_its_budget);
+    RUN_TEST(test_scan_names_tracks_and_skips_non_audio);
+    RUN_TEST(test_parallel_scan_matches_a_serial_one);
+    RUN_TEST(test_scan_of_a_missing_root_leaves_an_empty_catalog);
+    RUN_TEST(test_song_rows_follow_the_title_index);
+    RUN_TEST(test_rebuild_serves_the_old_tracks_until_it_ends);
+    RUN_TEST(test_refresh_reads_only_what_changed);
+    RUN_TEST(test_refresh_leaves_compaction_to_the_next_start);
+#ifdef NUNO_DEFAULT_LIBRARY_PATH
+    RUN_TEST(test_library_serves_the_bundled_tracks);
+#endif
+
+    return UNITY_END();
+}
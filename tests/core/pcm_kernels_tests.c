@@ -0,0 +1,153 @@
+#include <unity.h>
+#include "nuno/pcm_kernels.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/*
+ * Every built variant must match the scalar reference bit-for-bit. Inputs are
+ * pseudo-random with deliberate overshoot past [-1, 1] so the clamp is
+ * exercised, and lengths are odd so the vector loops' scalar tails run too.
+ */
+
+#define TEST_FRAMES 1029U
+#define TEST_MAX_CHANNELS 8U
+
+static float input[TEST_FRAMES * TEST_MAX_CHANNELS];
+static float expected_f32[TEST_FRAMES * 2U];
+static float actual_f32[TEST_FRAMES * 2U];
+static int16_t expected_s16[TEST_FRAMES * 2U];
+static int16_t actual_s16[TEST_FRAMES * 2U];
+
+static uint32_t rng_state;
+
+static uint32_t next_random(void) {
+    rng_state = rng_state * 1664525U + 1013904223U;
+    return rng_state;
+}
+
+static void fill_input(void) {
+    for (size_t i = 0; i < TEST_FRAMES * TEST_MAX_CHANNELS; i++) {
+        // Uniform in [-1.25, 1.25)
+        input[i] = ((float)(next_random() >> 8) / 16777216.0f) * 2.5f - 1.25f;
+    }
+    input[0] = 1.0f;
+    input[1] = -1.0f;
+}
+
+static void fill_s16(int16_t *samples, size_t count) {
+    for (size_t i = 0; i < count; i++) {
+        samples[i] = (int16_t)(next_random() >> 16);
+    }
+    samples[0] = INT16_MIN;
+    samples[1] = INT16_MAX;
+}
+
+void setUp(void) {
+    rng_state = 12345U;
+    fill_input();
+}
+
+void tearDown(void) {
+}
+
+void test_scalar_is_always_available(void) {
+    TEST_ASSERT_NOT_NULL(PcmKernels_Get(PCM_KERNELS_SCALAR));
+    TEST_ASSERT_NOT_NULL(PcmKernels_Best());
+    TEST_ASSERT_NULL(PcmKernels_Get(PCM_KERNELS_VARIANT_COUNT));
+}
+
+void test_reference_quantiser_clamps_and_truncates(void) {
+    // Arrange
+    const PcmKernels *ref = PcmKernels_Get(PCM_KERNELS_SCALAR);
+    const float in[6] = { 2.0f, -2.0f, 0.5f, -0.5f, 1.0f, 0.99999f };
+
+    // Act
+    ref->f32_to_s16(in, actual_s16, 6U, 1.0f);
+
+    // Assert
+    TEST_ASSERT_EQUAL_INT16(32767, actual_s16[0]);
+    TEST_ASSERT_EQUAL_INT16(-32767, actual_s16[1]);
+    TEST_ASSERT_EQUAL_INT16(16383, actual_s16[2]);
+    TEST_ASSERT_EQUAL_INT16(-16383, actual_s16[3]);
+    TEST_ASSERT_EQUAL_INT16(32767, actual_s16[4]);
+    TEST_ASSERT_EQUAL_INT16(32766, actual_s16[5]);
+}
+
+void test_variants_match_reference_downmix(void) {
+    const PcmKernels *ref = PcmKernels_Get(PCM_KERNELS_SCALAR);
+    const uint32_t layouts[] = { 1U, 2U, 3U, 6U, 8U };
+
+    for (int v = 0; v < PCM_KERNELS_VARIANT_COUNT; v++) {
+        const PcmKernels *k = PcmKernels_Get((PcmKernelsVariant)v);
+        if (!k) {
+            continue;
+        }
+        for (size_t l = 0; l < sizeof(layouts) / sizeof(layouts[0]); l++) {
+            ref->downmix_to_stereo(input, layouts[l], expected_f32, TEST_FRAMES, 0.7f);
+            k->downmix_to_stereo(input, layouts[l], actual_f32, TEST_FRAMES, 0.7f);
+            TEST_ASSERT_EQUAL_MEMORY(expected_f32, actual_f32, sizeof(expected_f32));
+        }
+    }
+}
+
+void test_variants_match_reference_quantiser(void) {
+    const PcmKernels *ref = PcmKernels_Get(PCM_KERNELS_SCALAR);
+    const float gains[] = { 1.0f, 0.5625f, 0.0f };
+
+    for (int v = 0; v < PCM_KERNELS_VARIANT_COUNT; v++) {
+        const PcmKernels *k = PcmKernels_Get((PcmKernelsVariant)v);
+        if (!k) {
+            continue;
+        }
+        for (size_t g = 0; g < sizeof(gains) / sizeof(gains[0]); g++) {
+            ref->f32_to_s16(input, expected_s16, TEST_FRAMES * 2U, gains[g]);
+            k->f32_to_s16(input, actual_s16, TEST_FRAMES * 2U, gains[g]);
+            TEST_ASSERT_EQUAL_INT16_ARRAY(expected_s16, actual_s16, TEST_FRAMES * 2U);
+        }
+    }
+}
+
+void test_variants_match_reference_q15_gain(void) {
+    const PcmKernels *ref = PcmKernels_Get(PCM_KERNELS_SCALAR);
+    const int32_t gains[] = { PCM_Q15_UNITY, 32767, 24576, 1, 0, -5 };
+
+    for (int v = 0; v < PCM_KERNELS_VARIANT_COUNT; v++) {
+        const PcmKernels *k = PcmKernels_Get((PcmKernelsVariant)v);
+        if (!k) {
+            continue;
+        }
+        for (size_t g = 0; g < sizeof(gains) / sizeof(gains[0]); g++) {
+            fill_s16(expected_s16, TEST_FRAMES * 2U);
+            memcpy(actual_s16, expected_s16, sizeof(actual_s16));
+            ref->s16_gain_q15(expected_s16, TEST_FRAMES * 2U, gains[g]);
+            k->s16_gain_q15(actual_s16, TEST_FRAMES * 2U, gains[g]);
+            TEST_ASSERT_EQUAL_INT16_ARRAY(expected_s16, actual_s16, TEST_FRAMES * 2U);
+        }
+    }
+}
+
+void test_q15_unity_is_bit_exact(void) {
+    // Arrange
+    fill_s16(expected_s16, TEST_FRAMES * 2U);
+    memcpy(actual_s16, expected_s16, sizeof(actual_s16));
+
+    // Act
+    PcmKernels_Best()->s16_gain_q15(actual_s16, TEST_FRAMES * 2U, PCM_Q15_UNITY);
+
+    // Assert
+    TEST_ASSERT_EQUAL_INT16_ARRAY(expected_s16, actual_s16, TEST_FRAMES * 2U);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_scalar_is_always_available);
+    RUN_TEST(test_reference_quantiser_clamps_and_truncates);
+    RUN_TEST(test_variants_match_reference_downmix);
+    RUN_TEST(test_variants_match_reference_quantiser);
+    RUN_TEST(test_variants_match_reference_q15_gain);
+    RUN_TEST(test_q15_unity_is_bit_exact);
+
+    return UNITY_END();
+}
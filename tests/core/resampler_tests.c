@@ -0,0 +1,161 @@
+#include <unity.h>
+#include "nuno/resampler.h"
+
+#include <math.h>
+#include <string.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/*
+ * Resampler tests drive the converter the way fill_buffer() does (pull, and
+ * push input only when a pull comes back empty) with synthetic stereo tones,
+ * then measure the output level.
+ */
+
+#define OUT_FRAMES 8192U
+
+static Resampler rs;
+static float output[OUT_FRAMES * 2U];
+static double tone_phase;
+
+/* Runs the converter until OUT_FRAMES frames are out; the input is a sine of
+ * 'freq' Hz at 'amplitude' on both channels. */
+static void run_tone(double freq, float amplitude) {
+    size_t produced = 0U;
+    tone_phase = 0.0;
+    while (produced < OUT_FRAMES) {
+        size_t n = Resampler_Pull(&rs, &output[produced * 2U], OUT_FRAMES - produced);
+        if (n > 0U) {
+            produced += n;
+            continue;
+        }
+        size_t space = 0U;
+        float *in = Resampler_InputSpace(&rs, &space);
+        size_t want = Resampler_InputFramesFor(&rs, OUT_FRAMES - produced);
+        TEST_ASSERT_TRUE(want > 0U);
+        TEST_ASSERT_TRUE(space > 0U);
+        if (want > space) {
+            want = space;
+        }
+        for (size_t i = 0; i < want; i++) {
+            float v = amplitude * (float)sin(tone_phase);
+            in[i * 2U] = v;
+            in[i * 2U + 1U] = v;
+            tone_phase += 2.0 * M_PI * freq / (double)rs.in_rate;
+        }
+        Resampler_CommitInput(&rs, want);
+    }
+}
+
+/* RMS of the left channel, skipping the start-up transient. */
+static double output_rms(void) {
+    double sum = 0.0;
+    size_t count = 0U;
+    for (size_t i = 1024U; i < OUT_FRAMES; i++) {
+        sum += (double)output[i * 2U] * (double)output[i * 2U];
+        count++;
+    }
+    return sqrt(sum / (double)count);
+}
+
+void setUp(void) {
+    memset(&rs, 0, sizeof(rs));
+}
+
+void tearDown(void) {
+}
+
+void test_supported_ratios(void) {
+    TEST_ASSERT_TRUE(Resampler_IsSupported(48000U, 44100U));
+    TEST_ASSERT_TRUE(Resampler_IsSupported(44100U, 48000U));
+    TEST_ASSERT_TRUE(Resampler_IsSupported(96000U, 44100U));
+    TEST_ASSERT_TRUE(Resampler_IsSupported(22050U, 44100U));
+    TEST_ASSERT_FALSE(Resampler_IsSupported(44101U, 44100U));  // L = 44100
+    TEST_ASSERT_FALSE(Resampler_IsSupported(0U, 44100U));
+}
+
+void test_configure_steps_down_a_tier_when_table_is_too_big(void) {
+    // 11025 -> 48000 is L = 640: 64 taps/phase would not fit.
+    TEST_ASSERT_TRUE(Resampler_Configure(&rs, 11025U, 48000U, RESAMPLER_QUALITY_HIGH));
+    TEST_ASSERT_EQUAL(640U, rs.phases);
+    TEST_ASSERT_TRUE(rs.quality < RESAMPLER_QUALITY_HIGH);
+}
+
+void test_dc_passes_at_unity_gain(void) {
+    TEST_ASSERT_TRUE(Resampler_Configure(&rs, 48000U, 44100U, RESAMPLER_QUALITY_MEDIUM));
+
+    size_t produced = 0U;
+    while (produced < OUT_FRAMES) {
+        size_t n = Resampler_Pull(&rs, &output[produced * 2U], OUT_FRAMES - produced);
+        if (n == 0U) {
+            size_t space = 0U;
+            float *in = Resampler_InputSpace(&rs, &space);
+            for (size_t i = 0; i < space * 2U; i++) {
+                in[i] = 0.5f;
+            }
+            Resampler_CommitInput(&rs, space);
+        }
+        produced += n;
+    }
+
+    for (size_t i = 256U; i < OUT_FRAMES; i++) {
+        TEST_ASSERT_FLOAT_WITHIN(1e-4f, 0.5f, output[i * 2U]);
+    }
+}
+
+void test_output_rate_matches_ratio(void) {
+    // Arrange
+    TEST_ASSERT_TRUE(Resampler_Configure(&rs, 44100U, 48000U, RESAMPLER_QUALITY_LOW));
+    const size_t in_frames = 441U * 2U;
+
+    // Act: push exactly in_frames and drain.
+    size_t space = 0U;
+    float *in = Resampler_InputSpace(&rs, &space);
+    TEST_ASSERT_TRUE(space >= in_frames);
+    memset(in, 0, in_frames * 2U * sizeof(float));
+    Resampler_CommitInput(&rs, in_frames);
+    size_t out = Resampler_Pull(&rs, output, OUT_FRAMES);
+
+    // Assert: 960 frames, less the half window still waiting for input.
+    TEST_ASSERT_TRUE(out <= 960U);
+    TEST_ASSERT_TRUE(out >= 960U - rs.taps * 2U);
+}
+
+void test_every_tier_passes_audio_band_and_rejects_aliases(void) {
+    for (int q = 0; q < RESAMPLER_QUALITY_COUNT; q++) {
+        // Passband: 1 kHz at 0.5 amplitude keeps its level.
+        TEST_ASSERT_TRUE(Resampler_Configure(&rs, 48000U, 44100U, (ResamplerQuality)q));
+        run_tone(1000.0, 0.5f);
+        TEST_ASSERT_FLOAT_WITHIN(0.005, 0.5 / sqrt(2.0), output_rms());
+
+        // Stopband: 23.5 kHz is above the 22.05 kHz output Nyquist and would
+        // alias to 20.6 kHz. Require at least 40 dB (LOW) of rejection.
+        TEST_ASSERT_TRUE(Resampler_Configure(&rs, 48000U, 44100U, (ResamplerQuality)q));
+        run_tone(23500.0, 0.5f);
+        TEST_ASSERT_TRUE(output_rms() < (0.5 / sqrt(2.0)) * 0.01);
+    }
+}
+
+void test_cost_grows_with_tier(void) {
+    ResamplerCost low;
+    ResamplerCost high;
+    TEST_ASSERT_TRUE(Resampler_EstimateCost(RESAMPLER_QUALITY_LOW, 48000U, 44100U, &low));
+    TEST_ASSERT_TRUE(Resampler_EstimateCost(RESAMPLER_QUALITY_HIGH, 48000U, 44100U, &high));
+    TEST_ASSERT_EQUAL(low.taps * 2U, low.macs_per_frame);
+    TEST_ASSERT_TRUE(high.est_cycles_per_frame > low.est_cycles_per_frame);
+}
+
+int main(void) {
+    UNITY_BEGIN();
+
+    RUN_TEST(test_supported_ratios);
+    RUN_TEST(test_configure_steps_down_a_tier_when_table_is_too_big);
+    RUN_TEST(test_dc_passes_at_unity_gain);
+    RUN_TEST(test_output_rate_matches_ratio);
+    RUN_TEST(test_every_tier_passes_audio_band_and_rejects_aliases);
+    RUN_TEST(test_cost_grows_with_tier);
+
+    return UNITY_END();
+}